@@ -0,0 +1,799 @@
+/*****************************************************************************
+ *
+ * Copyright (C) 2014-2016, Neil Johnson
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms,
+ * with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of Neil Johnson nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *****************************************************************************/
+ 
+/*****************************************************************************
+ *
+ * Assembler source output.
+ *
+ * With -a the disassembler writes source that the target's assembler (named
+ *  by DASM_SYNTAX in each decoder) turns back into the original image:
+ *
+ *   - every jump, call, table and pointer target is given a label, as are
+ *     data references that land on the start of an item.  Targets inside
+ *     an item are defined relative to its start, and targets outside the
+ *     image with equates.
+ *   - each command file segment starts with an ORG.
+ *   - data segments become DB and DW (and string) directives, with long
+ *     runs of one byte value written as a fill where the assembler has one.
+ *   - the listing's address and byte columns, page headers and banners are
+ *     not written; comments are kept as assembler comments.
+ *
+ * An instruction is written as raw bytes, with the instruction in a comment,
+ *  if it was not decoded, if it branches outside the image, or if the
+ *  assembler could pick a different encoding for it (a short address form
+ *  for a small address, on targets that have them).  This keeps the output
+ *  byte-exact.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "dasmxx.h"
+
+/*****************************************************************************
+ *        Data Types, Macros, Constants
+ *****************************************************************************/
+
+#define GEN_LABEL_FORMAT    GEN_LABEL_PREFIX "L%04X"
+
+/* References that are always labelled, and those labelled if they start
+   an item. */
+#define CODE_REFS       ( ( 1 << X_JMP ) | ( 1 << X_CALL ) \
+                        | ( 1 << X_TABLE ) | ( 1 << X_PTR ) )
+#define DATA_REFS       ( 1 << X_DATA )
+
+/* Shortest run of one byte value written as a fill */
+#define MIN_FILL_RUN    ( 32 )
+
+/* Bytes per line when writing raw bytes */
+#define BYTES_PER_LINE  ( 16 )
+
+/*****************************************************************************
+ *        Private Data
+ *****************************************************************************/
+
+static const asm_syntax_t * syn = &dasm_asm_syntax;
+
+/* Bitmap of addresses that start an item, from the scan pass */
+static UBYTE * starts      = NULL;
+static ADDR    starts_base = 0;
+static ADDR    starts_size = 0;
+static ADDR    image_end   = 0;
+
+/* Pending run of fill bytes */
+static ADDR         fill_addr  = 0;
+static unsigned int fill_count = 0;
+static int          fill_value = 0;
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      is_start
+ *
+ * DESCRIPTION
+ *      Tests whether an item starts at the given address.
+ *
+ * RETURNS
+ *      non-zero if an item starts at addr
+ *
+ ************************************************************/
+
+static int is_start( ADDR addr )
+{
+    if ( addr < starts_base || addr - starts_base >= starts_size )
+        return 0;
+        
+    addr -= starts_base;
+    return starts[addr >> 3] & ( 1 << ( addr & 7 ) );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      in_image
+ *
+ * DESCRIPTION
+ *      Tests whether an address is within the disassembly.
+ *
+ * RETURNS
+ *      non-zero if addr is in the image
+ *
+ ************************************************************/
+
+static int in_image( ADDR addr )
+{
+    return addr >= starts_base && addr < image_end;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      inner_labels
+ *
+ * DESCRIPTION
+ *      Defines any labels that fall inside an item relative
+ *       to its start.  If emit is zero, only counts them.
+ *
+ * RETURNS
+ *      number of labels inside the item
+ *
+ ************************************************************/
+
+static int inner_labels( const insn_t *insn, int emit )
+{
+    char offset[32];
+    const char *label;
+    unsigned int i;
+    int n = 0;
+    
+    for ( i = 1; i < insn->length; i++ )
+    {
+        if ( ( label = xref_findaddrlabel( insn->addr + i ) ) )
+        {
+            if ( emit )
+            {
+                sprintf( offset, "%s+%u", syn->here, i );
+                printf( syn->equ, label, offset );
+                putchar( '\n' );
+            }
+            n++;
+        }
+    }
+    
+    return n;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      hexnum
+ *
+ * DESCRIPTION
+ *      Formats a number in the assembler's hex notation
+ *       with at least the given number of digits.
+ *
+ * RETURNS
+ *      pointer to buf
+ *
+ ************************************************************/
+
+static char * hexnum( char *buf, unsigned int value, int digits )
+{
+    sprintf( buf, "%s%0*X%s", syn->hex_prefix, digits, value, syn->hex_suffix );
+    return buf;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_conversion
+ *
+ * DESCRIPTION
+ *      Finds the printf conversion in an operand format.
+ *      *start and *end are set to the first character of
+ *       the conversion and the one after it, and *width to
+ *       its field width.
+ *
+ * RETURNS
+ *      conversion character, or 0 if there is none
+ *
+ ************************************************************/
+
+static int find_conversion( const char *fmt, int *start, int *end, int *width )
+{
+    int i, j;
+    
+    for ( i = 0; fmt[i]; i++ )
+    {
+        if ( fmt[i] != '%' )
+            continue;
+        if ( fmt[i + 1] == '%' )
+        {
+            i++;
+            continue;
+        }
+        
+        for ( j = i + 1; fmt[j] && strchr( "-+ #0", fmt[j] ); j++ )
+            ;
+        for ( *width = 0; isdigit( fmt[j] ); j++ )
+            *width = *width * 10 + fmt[j] - '0';
+            
+        *start = i;
+        *end   = j + 1;
+        return fmt[j];
+    }
+    
+    return 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      format_operand
+ *
+ * DESCRIPTION
+ *      Formats an operand for the assembler.  Hex numbers
+ *       are rewritten from the decoder's notation ($12, 012H
+ *       or plain 12) into the assembler's.  Labels replace
+ *       the number only, keeping any prefix such as '#'.
+ *
+ * RETURNS
+ *      number of chars written
+ *
+ ************************************************************/
+
+static int format_operand( const operand_t *op, char *buf )
+{
+    char part[128];
+    const char *label;
+    char *p = buf;
+    int c, start, end, width, pre_end, post;
+    
+    if ( op->type == OPND_TEXT )
+        return sprintf( buf, "%s", op->fmt );
+        
+    /* Register names and conditions are kept as the decoder wrote them */
+    c = find_conversion( op->fmt, &start, &end, &width );
+    if ( !c || op->type == OPND_REG || op->type == OPND_COND )
+        return sprintf( buf, op->fmt, op->value );
+        
+    pre_end = start;
+    post    = end;
+    
+    if ( c == 'X' || c == 'x' )
+    {
+        if ( start > 0 && op->fmt[start - 1] == '$' )
+            pre_end--;
+        else if ( start > 0 && op->fmt[start - 1] == '0' && op->fmt[end] == 'H' )
+        {
+            pre_end--;
+            post++;
+        }
+    }
+    
+    /* Prefix, with any %% unescaped */
+    sprintf( part, "%.*s", pre_end, op->fmt );
+    p += sprintf( p, part );
+    
+    /* Label or number */
+    label = NULL;
+    if ( op->flags & OPF_LABEL )
+    {
+        if ( ( label = xref_findaddrlabel( op->ref ) ) )
+            p += sprintf( p, "%s", label );
+        else if ( ( op->flags & OPF_LABEL_NEAR ) 
+                  && ( label = xref_findaddrlabel( op->ref - 1 ) ) )
+            p += sprintf( p, "%s+1", label );
+    }
+    
+    if ( !label )
+    {
+        if ( c == 'X' || c == 'x' )
+            p += strlen( hexnum( p, (unsigned int)op->value, width ) );
+        else
+        {
+            sprintf( part, "%.*s", end - start, op->fmt + start );
+            p += sprintf( p, part, op->value );
+        }
+    }
+    
+    /* Suffix */
+    p += sprintf( p, op->fmt + post );
+    
+    return p - buf;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      needs_bytes
+ *
+ * DESCRIPTION
+ *      Decides whether an instruction must be written as raw
+ *       bytes: it was not decoded, or the assembler might
+ *       choose a shorter encoding for one of its addresses.
+ *
+ * RETURNS
+ *      non-zero if the instruction is written as bytes
+ *
+ ************************************************************/
+
+static int needs_bytes( const insn_t *insn )
+{
+    int i, c, start, end, width;
+    
+    if ( !insn->opcode )
+        return 1;
+        
+    for ( i = 0; i < insn->n_operands; i++ )
+    {
+        const operand_t *op = &insn->operands[i];
+        
+        if ( strstr( op->fmt, "???" ) )
+            return 1;
+            
+        /* Branches out of the image may rely on address wrap-around */
+        if ( op->type == OPND_REL && !in_image( op->ref ) )
+            return 1;
+            
+        if ( !syn->short_forms 
+             || ( op->type != OPND_ADDR && op->type != OPND_DISP ) )
+            continue;
+            
+        c = find_conversion( op->fmt, &start, &end, &width );
+        if ( ( c == 'X' || c == 'x' ) && width >= 4 
+             && (unsigned int)op->value < 0x100 )
+            return 1;
+    }
+    
+    return 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      emit_comment
+ *
+ * DESCRIPTION
+ *      Writes each line of a (block) comment.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void emit_comment( const char *text )
+{
+    const char *nl;
+    
+    do {
+        nl = strchr( text, '\n' );
+        printf( "%s %.*s\n", syn->comment, 
+                nl ? (int)( nl - text ) : (int)strlen( text ), text );
+        text = nl + 1;
+    } while ( nl && *text );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      emit_bytes
+ *
+ * DESCRIPTION
+ *      Writes bytes with the byte directive, or words with
+ *       the word directive for targets whose instructions
+ *       are read a word at a time.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void emit_bytes( const UBYTE *bytes, unsigned int n, int words )
+{
+    char num[32];
+    unsigned int i, step = words ? 2 : 1;
+    
+    for ( i = 0; i < n; i += step )
+    {
+        if ( ( i % BYTES_PER_LINE ) == 0 )
+            printf( "%s\t%s\t", i ? "\n" : "", words ? syn->dw : syn->db );
+        else
+            printf( ", " );
+            
+        /* Word instructions are held MSB first, in listing order */
+        if ( words )
+            printf( "%s", hexnum( num, ( bytes[i] << 8 ) | bytes[i + 1], 4 ) );
+        else
+            printf( "%s", hexnum( num, bytes[i], 2 ) );
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      emit_string
+ *
+ * DESCRIPTION
+ *      Writes a string item, with runs of printable
+ *       characters as quoted strings and the rest as bytes.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+#define QUOTABLE(c)     ( isprint( c ) && (c) != syn->quote && (c) != '\\' )
+
+static void emit_string( const UBYTE *s, unsigned int n )
+{
+    unsigned int i, j;
+    
+    for ( i = 0; i < n; i = j )
+    {
+        for ( j = i; j < n && QUOTABLE( s[j] ); j++ )
+            ;
+            
+        if ( j > i && syn->ascii )
+        {
+            printf( "\t%s\t%c%.*s%c\n", syn->ascii, syn->quote, 
+                    (int)( j - i ), s + i, syn->quote );
+            continue;
+        }
+        
+        for ( j = i; j < n && !QUOTABLE( s[j] ); j++ )
+            ;
+        if ( j == i )
+            j = n;
+        emit_bytes( s + i, j - i, 0 );
+        putchar( '\n' );
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      flush_fill
+ *
+ * DESCRIPTION
+ *      Writes out any pending run of fill bytes.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void flush_fill( void )
+{
+    char num[32];
+    UBYTE buf[BYTES_PER_LINE];
+    unsigned int n;
+    
+    if ( fill_count >= MIN_FILL_RUN )
+    {
+        printf( "\t" );
+        printf( syn->fill, fill_count, hexnum( num, fill_value, 2 ) );
+        putchar( '\n' );
+    }
+    else
+    {
+        memset( buf, fill_value, sizeof( buf ) );
+        for ( ; fill_count; fill_count -= n )
+        {
+            n = MIN( fill_count, BYTES_PER_LINE );
+            emit_bytes( buf, n, 0 );
+            putchar( '\n' );
+        }
+    }
+    
+    fill_count = 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      fill_byte
+ *
+ * DESCRIPTION
+ *      Checks whether a byte item could be part of a fill:
+ *       all of its bytes have one value.
+ *
+ * RETURNS
+ *      the value, or -1 if not
+ *
+ ************************************************************/
+
+static int fill_byte( const record_t *rec )
+{
+    unsigned int i;
+    
+    if ( rec->kind != REC_BYTES || !syn->fill || rec->comment || !rec->n_bytes 
+         || inner_labels( rec->insn, 0 ) )
+        return -1;
+        
+    for ( i = 1; i < rec->n_bytes; i++ )
+        if ( rec->bytes[i] != rec->bytes[0] )
+            return -1;
+            
+    return rec->bytes[0];
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      gen_label
+ *      emit_equate
+ *
+ * DESCRIPTION
+ *      xref_foreach() callbacks.  gen_label names the targets
+ *       that need labels; emit_equate defines the labels that
+ *       are outside the image.  Labels inside an item are
+ *       defined relative to it by inner_labels().
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void gen_label( ADDR ref, const char *label, unsigned int types )
+{
+    char buf[32];
+    
+    if ( label )
+        return;
+        
+    if ( ( types & CODE_REFS ) || ( ( types & DATA_REFS ) && is_start( ref ) ) )
+    {
+        sprintf( buf, GEN_LABEL_FORMAT, ref );
+        xref_addxreflabel( ref, buf );
+    }
+}
+
+static void emit_equate( ADDR ref, const char *label, unsigned int types )
+{
+    char num[32];
+    
+    if ( label && !in_image( ref ) )
+    {
+        printf( syn->equ, label, hexnum( num, ref, 4 ) );
+        putchar( '\n' );
+    }
+}
+
+/*****************************************************************************
+ *        Public Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      asm_scan
+ *
+ * DESCRIPTION
+ *      Notes the start of an item during the scan pass, made
+ *       before any output so that every label target is known.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+void asm_scan( const record_t *rec )
+{
+    ADDR addr = rec->insn->addr;
+    
+    if ( !starts )
+    {
+        starts_base = addr;
+        starts_size = 0;
+    }
+    
+    if ( addr < starts_base )
+        error( "Address " FORMAT_ADDR " is below the start of disassembly", addr );
+        
+    addr -= starts_base;
+    
+    if ( addr >= starts_size )
+    {
+        ADDR size = MAX( starts_size * 2, MAX( addr + 1, 0x1000 ) );
+        UBYTE *p = zalloc( ( size + 7 ) / 8 );
+        
+        if ( starts )
+        {
+            memcpy( p, starts, ( starts_size + 7 ) / 8 );
+            free( starts );
+        }
+        starts      = p;
+        starts_size = size;
+    }
+    
+    starts[addr >> 3] |= 1 << ( addr & 7 );
+    
+    image_end = MAX( image_end, rec->insn->addr + rec->insn->length );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      asm_begin
+ *
+ * DESCRIPTION
+ *      Names all label targets then writes the source header
+ *       and equates.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+void asm_begin( void )
+{
+    xref_foreach( gen_label );
+    
+    printf( "%s %s -- %s Disassembler --\n", syn->comment, dasm_name, dasm_description );
+    printf( "%s %s source\n\n", syn->comment, syn->name );
+    
+    if ( syn->header )
+        printf( "%s\n\n", syn->header );
+        
+    xref_foreach( emit_equate );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      asm_emit
+ *
+ * DESCRIPTION
+ *      Writes the source for one instruction or data item.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+void asm_emit( const record_t *rec )
+{
+    const insn_t *insn = rec->insn;
+    char buf[512], num[32];
+    char *p;
+    int i, fill;
+    
+    if ( rec->n_bytes < insn->length )
+        error( "Item at " FORMAT_ADDR " is too long for source output", insn->addr );
+        
+    fill = fill_byte( rec );
+    
+    if ( fill_count )
+    {
+        if ( fill == fill_value && insn->addr == fill_addr + fill_count
+             && !rec->label && !rec->note && !rec->segment )
+        {
+            fill_count += rec->n_bytes;
+            return;
+        }
+        flush_fill();
+    }
+    
+    if ( rec->segment )
+        printf( "\n\t%s\t%s\n", syn->org, hexnum( num, insn->addr, 4 ) );
+    
+    if ( rec->proc )
+        printf( "\n%s Function: %s\n", syn->comment, rec->proc );
+        
+    if ( rec->note )
+    {
+        putchar( '\n' );
+        emit_comment( rec->note );
+    }
+    
+    if ( rec->label )
+    {
+        printf( syn->label, rec->label );
+        putchar( '\n' );
+    }
+    
+    inner_labels( insn, 1 );
+    
+    if ( fill >= 0 )
+    {
+        fill_addr  = insn->addr;
+        fill_count = rec->n_bytes;
+        fill_value = fill;
+        return;
+    }
+    
+    switch ( rec->kind )
+    {
+    case REC_CODE:
+        if ( needs_bytes( insn ) )
+        {
+            emit_bytes( rec->bytes, rec->n_bytes, dasm_insn_width_bytes == 2 );
+            for ( i = dasm_format( insn, buf ); i > 0 && buf[i - 1] == ' '; i-- )
+                buf[i - 1] = '\0';
+            printf( "\t%s %s", syn->comment, buf );
+        }
+        else
+        {
+            p = buf;
+            for ( i = 0; i < insn->n_operands; i++ )
+                p += format_operand( &insn->operands[i], p );
+            *p = '\0';
+            
+            if ( insn->n_operands )
+                printf( "\t%-*s %s", dasm_max_opcode_width, insn->opcode, buf );
+            else
+                printf( "\t%s", insn->opcode );
+        }
+        break;
+        
+    case REC_STRING:
+        emit_string( rec->bytes, rec->n_bytes );
+        break;
+        
+    case REC_WORDS:
+    case REC_VECTOR:
+        printf( "\t%s\t", syn->dw );
+        for ( i = 0; i < insn->n_operands; i++ )
+        {
+            format_operand( &insn->operands[i], buf );
+            printf( "%s%s", i ? ", " : "", buf );
+        }
+        break;
+        
+    default:
+        emit_bytes( rec->bytes, rec->n_bytes, 0 );
+        break;
+    }
+    
+    if ( rec->kind != REC_STRING )
+    {
+        if ( rec->comment )
+            printf( "\t%s %s", syn->comment, rec->comment );
+        putchar( '\n' );
+    }
+    else if ( rec->comment )
+        emit_comment( rec->comment );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      asm_end
+ *
+ * DESCRIPTION
+ *      Finishes the source.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+void asm_end( void )
+{
+    if ( fill_count )
+        flush_fill();
+        
+    if ( syn->end )
+        printf( "\n\t%s\n", syn->end );
+}
+
+/******************************************************************************/
+/******************************************************************************/
+/******************************************************************************/
@@ -0,0 +1,1308 @@
+/*****************************************************************************
+ *
+ * Copyright (C) 2014-2016, Neil Johnson
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms,
+ * with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of Neil Johnson nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *****************************************************************************/
+ 
+/*****************************************************************************
+ *
+ * Control flow graph.
+ *
+ * The code segments are split into basic blocks: runs of instructions
+ *  that are only entered at the first and only left after the last.
+ *  A block ends at a branch, jump, return or skip, and a new block starts
+ *  at every branch, jump or call target and after every block end.  Calls
+ *  do not end a block; the graph is of flow within procedures.
+ *
+ * The graph is built from a scan pass over the input (cfg_scan), then
+ *  split into blocks (cfg_build).  It is held in three flat arrays which
+ *  grow linearly with the number of instructions:
+ *
+ *      insns   - address, length, flow and target of each instruction,
+ *                in address order
+ *      blocks  - first instruction and successors of each block
+ *      edges   - successors, grouped by block
+ *
+ *  Blocks and edges refer to each other by index, and a target address
+ *  is found by binary search of the instructions, so nothing is indexed
+ *  by address and banked images cost no more than flat ones.
+ *
+ * How an instruction moves the flow of control is taken from its operands
+ *  (an X_JMP reference is a conditional branch, X_CALL a call) unless the
+ *  mnemonic appears in the target's flow table (DASM_FLOW), which names
+ *  the unconditional jumps, returns and skips.
+ *  An indirect jump has no successors unless its jump table has been
+ *  resolved (jumptab.c), when it has one per distinct table entry.
+ *
+ * Procedures start at the p commands of the command file and, if asked
+ *  (-p), at the start of the disassembly and every call target.  Each runs up to the start of the next, but
+ *  its size is taken up to its last return or jump, so that unreached code
+ *  between procedures is not counted.  The call graph links each procedure
+ *  to the procedures it calls, counting call sites and distinct callers
+ *  and callees.  Procedures that call themselves, directly or through
+ *  others, are found as the strongly connected components of the call
+ *  graph.  All of this is worked out from the instruction array in a few
+ *  linear sweeps; the input is only decoded once.
+ *
+ * Both graphs are written in Graphviz dot format, the flow graph (-g)
+ *  with the blocks of each procedure grouped in a cluster and the call
+ *  graph (-c) with one node per procedure:
+ *
+ *      dot -Tsvg -o foo.svg foo.dot
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "dasmxx.h"
+
+/*****************************************************************************
+ *        Data Types, Macros, Constants
+ *****************************************************************************/
+
+/* One per instruction */
+typedef struct {
+    ADDR         addr;
+    ADDR         target;    /* destination, or NO_TARGET                */
+    UBYTE        length;
+    UBYTE        flow;      /* FLOW_xxx                                 */
+    UBYTE        flags;     /* CI_xxx                                   */
+} cfg_insn_t;
+
+#define CI_RANGE        ( 0x01 )  /* first after data or disassembly start */
+#define CI_LEADER       ( 0x02 )  /* first of a basic block                */
+#define CI_ENTRY        ( 0x04 )  /* first of a procedure                  */
+#define CI_CALLED       ( 0x08 )  /* target of a call                      */
+#define CI_AFTER_END    ( 0x10 )  /* follows a return, jump or stop        */
+#define CI_JOIN         ( 0x20 )  /* may be reached other than by falling
+                                     through from the one before          */
+
+/* One per basic block */
+typedef struct {
+    unsigned int first;     /* index of first instruction               */
+    unsigned int n_insns;
+    unsigned int edge;      /* index of first successor                 */
+    unsigned int n_edges;
+} cfg_block_t;
+
+/* One per successor */
+typedef struct {
+    unsigned int to;        /* block index, or address if EDGE_OUT      */
+    UBYTE        kind;
+} cfg_edge_t;
+
+#define EDGE_FALL       ( 0 )     /* falls through to next block           */
+#define EDGE_TAKEN      ( 1 )     /* conditional branch taken              */
+#define EDGE_JUMP       ( 2 )     /* unconditional jump                    */
+#define EDGE_SKIP       ( 3 )     /* skips the next instruction            */
+#define EDGE_OUT        ( 0x80 )  /* target is not in the code segments    */
+
+/* One per procedure */
+typedef struct {
+    unsigned int first;     /* index of first instruction               */
+    unsigned int last;      /* index of last, up to its final return    */
+    const char * name;
+    unsigned int n_sites;   /* calls to this procedure                  */
+    unsigned int n_callers; /* distinct procedures calling it           */
+    unsigned int n_callees; /* distinct procedures it calls             */
+    unsigned int callee;    /* index of first callee in calls           */
+    unsigned int flags;     /* PROC_xxx                                 */
+} cfg_proc_t;
+
+#define PROC_NAMED      ( 0x01 )  /* from a p command                      */
+#define PROC_RECURSIVE  ( 0x02 )  /* calls itself, directly or not         */
+
+/* Name of an inferred procedure with no label */
+#define GEN_PROC_FORMAT     GEN_LABEL_PREFIX "SUB_%04X"
+
+#define NO_TARGET       ( (ADDR)-1 )
+#define NO_INDEX        ( (unsigned int)-1 )
+
+/* Flow table lookups are cached by mnemonic pointer and operand count */
+#define FLOW_CACHE_SIZE ( 256 )
+
+/*****************************************************************************
+ *        Private Data
+ *****************************************************************************/
+
+static cfg_insn_t  * insns  = NULL;
+static cfg_block_t * blocks = NULL;
+static cfg_edge_t  * edges  = NULL;
+static cfg_proc_t  * procs  = NULL;
+static unsigned int * calls  = NULL;   /* callees, grouped by caller */
+
+static unsigned int n_insns = 0, max_insns = 0;
+static unsigned int n_blocks = 0;
+static unsigned int n_edges = 0;
+static unsigned int n_procs = 0, max_procs = 0;
+static unsigned int n_calls = 0;
+
+/* Set once cfg_build() has run */
+static int built = 0;
+
+/* Set while the scan pass is in a run of code */
+static int in_code = 0;
+
+static struct {
+    const char   * opcode;
+    int            n_operands;
+    const flow_t * entry;
+} flow_cache[FLOW_CACHE_SIZE];
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_flow
+ *
+ * DESCRIPTION
+ *      Looks up an instruction in the target's flow table.
+ *       Mnemonics match regardless of case, and of a size
+ *       suffix such as the eZ80's ".LIL".
+ *
+ * RETURNS
+ *      matching table entry, or NULL
+ *
+ ************************************************************/
+
+static const flow_t * find_flow( const char *opcode, int n_operands )
+{
+    const flow_t *fl;
+    unsigned int h;
+    
+    h = ( (unsigned int)(size_t)opcode >> 2 ^ n_operands ) % FLOW_CACHE_SIZE;
+    if ( flow_cache[h].opcode == opcode 
+         && flow_cache[h].n_operands == n_operands )
+        return flow_cache[h].entry;
+        
+    for ( fl = dasm_flow_table; fl->opcode; fl++ )
+    {
+        const char *a = fl->opcode, *b = opcode;
+        
+        while ( *a && tolower( (UBYTE)*a ) == tolower( (UBYTE)*b ) )
+            a++, b++;
+            
+        if ( ( *a == *b || ( *a == '\0' && *b == '.' ) )
+             && ( fl->n_operands < 0 || fl->n_operands == n_operands ) )
+            break;
+    }
+    
+    flow_cache[h].opcode     = opcode;
+    flow_cache[h].n_operands = n_operands;
+    flow_cache[h].entry      = fl->opcode ? fl : NULL;
+    
+    return flow_cache[h].entry;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_insn
+ *
+ * DESCRIPTION
+ *      Finds the instruction starting at an address.
+ *
+ * RETURNS
+ *      instruction index, or NO_INDEX if no instruction starts
+ *       at addr
+ *
+ ************************************************************/
+
+static unsigned int find_insn( ADDR addr )
+{
+    unsigned int lo = 0, hi = n_insns;
+    
+    while ( lo < hi )
+    {
+        unsigned int mid = lo + ( hi - lo ) / 2;
+        
+        if ( insns[mid].addr < addr )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    
+    return ( lo < n_insns && insns[lo].addr == addr ) ? lo : NO_INDEX;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_block
+ *
+ * DESCRIPTION
+ *      Finds the block containing an instruction.
+ *
+ * RETURNS
+ *      block index
+ *
+ ************************************************************/
+
+static unsigned int find_block( unsigned int insn )
+{
+    unsigned int lo = 0, hi = n_blocks;
+    
+    while ( hi - lo > 1 )
+    {
+        unsigned int mid = lo + ( hi - lo ) / 2;
+        
+        if ( blocks[mid].first <= insn )
+            lo = mid;
+        else
+            hi = mid;
+    }
+    
+    return lo;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_proc
+ *
+ * DESCRIPTION
+ *      Finds the procedure starting at an address.
+ *
+ * RETURNS
+ *      procedure index, or NO_INDEX if none starts at addr
+ *
+ ************************************************************/
+
+static unsigned int find_proc( ADDR addr )
+{
+    unsigned int lo = 0, hi = n_procs;
+    
+    while ( lo < hi )
+    {
+        unsigned int mid = lo + ( hi - lo ) / 2;
+        
+        if ( insns[procs[mid].first].addr < addr )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    
+    return ( lo < n_procs && insns[procs[lo].first].addr == addr ) ? lo : NO_INDEX;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      falls_through
+ *
+ * DESCRIPTION
+ *      Tests whether control can pass from instruction i to
+ *       the one n places after it without a branch.
+ *
+ * RETURNS
+ *      non-zero if it can
+ *
+ ************************************************************/
+
+static int falls_through( unsigned int i, unsigned int n )
+{
+    while ( n-- )
+        if ( ++i >= n_insns || ( insns[i].flags & CI_RANGE ) )
+            return 0;
+            
+    return 1;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      add_edge
+ *
+ * DESCRIPTION
+ *      Adds a successor to a block.  Targets outside the
+ *       code segments are kept as addresses.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void add_edge( cfg_block_t *b, int kind, ADDR target )
+{
+    unsigned int i = find_insn( target );
+    
+    if ( i == NO_INDEX )
+    {
+        edges[n_edges].to   = target;
+        edges[n_edges].kind = kind | EDGE_OUT;
+    }
+    else
+    {
+        edges[n_edges].to   = find_block( i );
+        edges[n_edges].kind = kind;
+    }
+    
+    n_edges++;
+    b->n_edges++;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      write_string
+ *
+ * DESCRIPTION
+ *      Writes text as part of a quoted dot string.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void write_string( FILE *fp, const char *s )
+{
+    for ( ; *s; s++ )
+    {
+        if ( *s == '"' || *s == '\\' )
+            fputc( '\\', fp );
+        fputc( *s, fp );
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      write_label
+ *
+ * DESCRIPTION
+ *      Writes the label of an address, if it has one, as a
+ *       line of a quoted dot string.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void write_label( FILE *fp, ADDR addr )
+{
+    const char *s = xref_findaddrlabel( addr );
+    
+    if ( s )
+    {
+        write_string( fp, s );
+        fputs( "\\n", fp );
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_procs
+ *
+ * DESCRIPTION
+ *      Makes the procedure list from the marked entry points,
+ *       keeping the names of those from the command file.
+ *       Others take the label of their address, or are given
+ *       one.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void find_procs( void )
+{
+    cfg_proc_t *named = procs;
+    unsigned int n_named = n_procs, i, k = 0;
+    char buf[32];
+    
+    procs   = NULL;
+    n_procs = max_procs = 0;
+    
+    for ( i = 0; i < n_insns; i++ )
+    {
+        cfg_proc_t *p;
+        
+        if ( !( insns[i].flags & CI_ENTRY ) )
+            continue;
+            
+        procs = grow( procs, n_procs, &max_procs, sizeof( *procs ) );
+        p = &procs[n_procs++];
+        memset( p, 0, sizeof( *p ) );
+        p->first = i;
+        
+        if ( k < n_named && named[k].first == i )
+            *p = named[k];
+        else if ( ( p->name = xref_findaddrlabel( insns[i].addr ) ) )
+            p->name = dupstr( p->name );
+        else
+        {
+            sprintf( buf, GEN_PROC_FORMAT, insns[i].addr );
+            xref_addxreflabel( insns[i].addr, buf );
+            p->name = dupstr( buf );
+        }
+        
+        while ( k < n_named && named[k].first <= i )
+            k++;
+    }
+    
+    free( named );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      link_blocks
+ *
+ * DESCRIPTION
+ *      Makes the blocks from the marked leaders and links
+ *       each to its successors.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void link_blocks( void )
+{
+    unsigned int i, j, k, n, n_table = 0;
+    const ADDR *targets;
+    
+    for ( i = 0, j = 0; i < n_insns; i++ )
+    {
+        if ( insns[i].flags & CI_LEADER )
+            j++;
+        if ( insns[i].flow == FLOW_JUMP && insns[i].target == NO_TARGET )
+            n_table += jt_targets( insns[i].addr, &targets );
+    }
+            
+    /* No block has more than two successors, except through a jump table */
+    blocks = zalloc( ( j + 1 ) * sizeof( *blocks ) );
+    edges  = zalloc( ( 2 * j + n_table + 1 ) * sizeof( *edges ) );
+    
+    for ( i = 0; i < n_insns; i++ )
+        if ( insns[i].flags & CI_LEADER )
+            blocks[n_blocks++].first = i;
+            
+    for ( j = 0; j < n_blocks; j++ )
+    {
+        cfg_block_t *b = &blocks[j];
+        unsigned int end = ( j + 1 < n_blocks ) ? blocks[j + 1].first : n_insns;
+        cfg_insn_t *last = &insns[end - 1];
+        
+        b->n_insns = end - b->first;
+        b->edge    = n_edges;
+        
+        if ( last->target != NO_TARGET && last->flow != FLOW_CALL )
+            add_edge( b, last->flow == FLOW_JUMP ? EDGE_JUMP : EDGE_TAKEN,
+                      last->target );
+                      
+        /* One edge per distinct target of a jump table */
+        if ( last->flow == FLOW_JUMP && last->target == NO_TARGET )
+            for ( i = 0, n = jt_targets( last->addr, &targets ); i < n; i++ )
+            {
+                for ( k = 0; k < i && targets[k] != targets[i]; k++ )
+                    ;
+                if ( k == i )
+                    add_edge( b, EDGE_JUMP, targets[i] );
+            }
+                      
+        if ( last->flow != FLOW_JUMP && last->flow != FLOW_RETURN 
+             && last->flow != FLOW_STOP && falls_through( end - 1, 1 ) )
+            add_edge( b, EDGE_FALL, insns[end].addr );
+            
+        if ( last->flow == FLOW_SKIP && falls_through( end - 1, 2 ) )
+            add_edge( b, EDGE_SKIP, insns[end + 1].addr );
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      link_calls
+ *
+ * DESCRIPTION
+ *      Finds the extent of each procedure and links it to
+ *       the procedures it calls.  Each callee is listed once
+ *       per caller: the callers are visited in order, so a
+ *       callee only needs to remember the last caller that
+ *       listed it.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void link_calls( void )
+{
+    unsigned int i, j, p = 0, cur = NO_INDEX;
+    unsigned int *stamp;
+    int ended = 0;
+    
+    for ( i = 0, j = 0; i < n_insns; i++ )
+        if ( insns[i].flow == FLOW_CALL )
+            j++;
+            
+    calls = zalloc( ( j + 1 ) * sizeof( *calls ) );
+    stamp = zalloc( ( n_procs + 1 ) * sizeof( *stamp ) );
+    
+    for ( i = 0; i < n_insns; i++ )
+    {
+        const cfg_insn_t *ci = &insns[i];
+        unsigned int callee;
+        
+        if ( p < n_procs && procs[p].first == i )
+        {
+            /* A procedure with no return runs up to the next */
+            if ( cur != NO_INDEX && !ended )
+                procs[cur].last = i - 1;
+                
+            cur = p++;
+            procs[cur].callee = n_calls;
+            ended = 0;
+        }
+        
+        if ( ci->flow == FLOW_RETURN || ci->flow == FLOW_JUMP 
+             || ci->flow == FLOW_STOP )
+        {
+            if ( cur != NO_INDEX )
+                procs[cur].last = i;
+            ended = 1;
+        }
+            
+        if ( ci->flow != FLOW_CALL || ci->target == NO_TARGET 
+             || ( callee = find_proc( ci->target ) ) == NO_INDEX )
+            continue;
+            
+        procs[callee].n_sites++;
+        
+        if ( cur == NO_INDEX || stamp[callee] == cur + 1 )
+            continue;
+            
+        stamp[callee] = cur + 1;
+        calls[n_calls++] = callee;
+        procs[cur].n_callees++;
+        procs[callee].n_callers++;
+    }
+    
+    if ( cur != NO_INDEX && !ended )
+        procs[cur].last = n_insns - 1;
+        
+    free( stamp );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_recursion
+ *
+ * DESCRIPTION
+ *      Marks the procedures that can call themselves: those
+ *       in a strongly connected component of the call graph
+ *       with more than one member, or calling themselves
+ *       directly.  Tarjan's algorithm, with an explicit
+ *       stack in place of recursion.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void find_recursion( void )
+{
+    unsigned int n = n_procs + 1;
+    unsigned int *index = zalloc( n * sizeof( *index ) );
+    unsigned int *low   = zalloc( n * sizeof( *low ) );
+    unsigned int *stack = zalloc( n * sizeof( *stack ) );
+    unsigned int *path  = zalloc( n * sizeof( *path ) );
+    unsigned int *pos   = zalloc( n * sizeof( *pos ) );
+    UBYTE *on_stack     = zalloc( n );
+    unsigned int next_index = 1, sp = 0, depth, root, v, w;
+    
+    for ( root = 0; root < n_procs; root++ )
+    {
+        if ( index[root] )
+            continue;
+            
+        index[root] = low[root] = next_index++;
+        stack[sp++] = root;
+        on_stack[root] = 1;
+        path[0] = root;
+        pos[0]  = procs[root].callee;
+        depth   = 1;
+        
+        while ( depth )
+        {
+            v = path[depth - 1];
+            
+            if ( pos[depth - 1] < procs[v].callee + procs[v].n_callees )
+            {
+                w = calls[pos[depth - 1]++];
+                
+                if ( w == v )
+                    procs[v].flags |= PROC_RECURSIVE;
+                    
+                if ( !index[w] )
+                {
+                    index[w] = low[w] = next_index++;
+                    stack[sp++] = w;
+                    on_stack[w] = 1;
+                    path[depth] = w;
+                    pos[depth]  = procs[w].callee;
+                    depth++;
+                }
+                else if ( on_stack[w] )
+                    low[v] = MIN( low[v], index[w] );
+                    
+                continue;
+            }
+            
+            /* All of v's callees done: v may be the root of a component */
+            if ( low[v] == index[v] )
+            {
+                int cycle = ( stack[sp - 1] != v );
+                
+                do {
+                    w = stack[--sp];
+                    on_stack[w] = 0;
+                    if ( cycle )
+                        procs[w].flags |= PROC_RECURSIVE;
+                } while ( w != v );
+            }
+            
+            if ( --depth )
+                low[path[depth - 1]] = MIN( low[path[depth - 1]], low[v] );
+        }
+    }
+    
+    free( index );
+    free( low );
+    free( stack );
+    free( path );
+    free( pos );
+    free( on_stack );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      get_info
+ *
+ * DESCRIPTION
+ *      Fills in the summary of a procedure.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void get_info( unsigned int i, proc_info_t *info )
+{
+    const cfg_proc_t *p = &procs[i];
+    const cfg_insn_t *last = &insns[p->last];
+    unsigned int first_block = find_block( p->first );
+    unsigned int end_block = ( i + 1 < n_procs ) 
+                           ? find_block( procs[i + 1].first ) : n_blocks;
+    
+    info->name      = p->name;
+    info->addr      = insns[p->first].addr;
+    info->size      = last->addr + last->length - info->addr;
+    info->n_blocks  = end_block - first_block;
+    info->n_sites   = p->n_sites;
+    info->n_callers = p->n_callers;
+    info->n_callees = p->n_callees;
+    info->named     = ( p->flags & PROC_NAMED ) != 0;
+    info->recursive = ( p->flags & PROC_RECURSIVE ) != 0;
+}
+
+/*****************************************************************************
+ *        Public Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_flow
+ *
+ * DESCRIPTION
+ *      Classifies how a decoded instruction affects the flow
+ *       of control.
+ *      *target is set to the destination of a branch, jump or
+ *       call, or to NO_TARGET if it is not known (e.g. an
+ *       indirect jump).
+ *
+ * RETURNS
+ *      FLOW_xxx
+ *
+ ************************************************************/
+
+FLOW_TYPE cfg_flow( const insn_t *insn, ADDR *target )
+{
+    FLOW_TYPE flow = FLOW_NEXT;
+    const flow_t *fl;
+    int i, n = 0;
+    
+    *target = NO_TARGET;
+    
+    if ( !insn->opcode )
+        return FLOW_STOP;
+        
+    for ( i = 0; i < insn->n_operands; i++ )
+    {
+        const operand_t *op = &insn->operands[i];
+        
+        if ( op->type == OPND_TEXT )
+            continue;
+            
+        n++;
+        if ( *target == NO_TARGET 
+             && ( op->type == OPND_ADDR || op->type == OPND_REL ) 
+             && ( op->xtype == X_JMP || op->xtype == X_CALL ) )
+        {
+            *target = op->ref;
+            flow = ( op->xtype == X_JMP ) ? FLOW_BRANCH : FLOW_CALL;
+        }
+    }
+    
+    if ( ( fl = find_flow( insn->opcode, n ) ) )
+        flow = fl->flow;
+        
+    if ( flow != FLOW_BRANCH && flow != FLOW_JUMP && flow != FLOW_CALL )
+        *target = NO_TARGET;
+        
+    return flow;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_scan
+ *
+ * DESCRIPTION
+ *      Adds one item of the scan pass to the graph.  Data
+ *       items only break the runs of code.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void cfg_scan( const record_t *rec )
+{
+    cfg_insn_t *ci;
+    ADDR target;
+    
+    if ( rec->kind != REC_CODE )
+    {
+        in_code = 0;
+        return;
+    }
+    
+    if ( rec->proc )
+    {
+        procs = grow( procs, n_procs, &max_procs, sizeof( *procs ) );
+        memset( &procs[n_procs], 0, sizeof( *procs ) );
+        procs[n_procs].first = n_insns;
+        procs[n_procs].name  = rec->proc;
+        procs[n_procs].flags = PROC_NAMED;
+        n_procs++;
+    }
+    
+    insns = grow( insns, n_insns, &max_insns, sizeof( *insns ) );
+    ci = &insns[n_insns++];
+    
+    ci->addr   = rec->insn->addr;
+    ci->length = rec->insn->length;
+    ci->flow   = cfg_flow( rec->insn, &target );
+    ci->target = target;
+    ci->flags  = in_code ? 0 : CI_RANGE;
+    
+    in_code = 1;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_build
+ *
+ * DESCRIPTION
+ *      Splits the scanned instructions into basic blocks and
+ *       procedures, and links them into the flow and call
+ *       graphs.  If infer_procs is set the disassembly start
+ *       and every call target start a procedure, as well as
+ *       the p commands.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void cfg_build( int infer_procs )
+{
+    unsigned int i, j;
+    
+    for ( i = 0; i < n_procs; i++ )
+        insns[procs[i].first].flags |= CI_ENTRY;
+        
+    if ( infer_procs && n_insns )
+        insns[0].flags |= CI_ENTRY;
+        
+    /* Mark the leaders and called entry points */
+    for ( i = 0; i < n_insns; i++ )
+    {
+        cfg_insn_t *ci = &insns[i];
+        
+        if ( ci->target != NO_TARGET 
+             && ( j = find_insn( ci->target ) ) != NO_INDEX )
+        {
+            insns[j].flags |= CI_LEADER;
+            /* A branch to the next instruction joins nothing */
+            if ( ci->target != ci->addr + ci->length )
+                insns[j].flags |= CI_JOIN;
+            if ( ci->flow == FLOW_CALL )
+                insns[j].flags |= CI_CALLED;
+            if ( infer_procs && ci->flow == FLOW_CALL )
+                insns[j].flags |= CI_ENTRY;
+        }
+        
+        if ( ci->flow == FLOW_JUMP && ci->target == NO_TARGET )
+        {
+            const ADDR *targets;
+            unsigned int k, n = jt_targets( ci->addr, &targets );
+            
+            for ( k = 0; k < n; k++ )
+                if ( ( j = find_insn( targets[k] ) ) != NO_INDEX )
+                    insns[j].flags |= CI_LEADER | CI_JOIN;
+        }
+            
+        if ( ci->flow != FLOW_NEXT && ci->flow != FLOW_CALL 
+             && i + 1 < n_insns )
+            insns[i + 1].flags |= CI_LEADER;
+            
+        if ( ( ci->flow == FLOW_JUMP || ci->flow == FLOW_RETURN 
+               || ci->flow == FLOW_STOP ) && i + 1 < n_insns )
+            insns[i + 1].flags |= CI_AFTER_END;
+            
+        if ( ci->flow == FLOW_SKIP && i + 2 < n_insns )
+            insns[i + 2].flags |= CI_LEADER | CI_JOIN;
+    }
+    
+    for ( i = 0; i < n_insns; i++ )
+    {
+        if ( insns[i].flags & ( CI_RANGE | CI_ENTRY ) )
+            insns[i].flags |= CI_LEADER;
+        if ( insns[i].flags & ( CI_RANGE | CI_ENTRY | CI_AFTER_END ) )
+            insns[i].flags |= CI_JOIN;
+    }
+    
+    if ( infer_procs )
+        find_procs();
+        
+    link_blocks();
+    link_calls();
+    find_recursion();
+    
+    built = 1;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_in_code
+ *
+ * DESCRIPTION
+ *      Tests whether an address is within an instruction of
+ *       the scan pass or, if start is set, whether one
+ *       starts there.
+ *
+ * RETURNS
+ *      non-zero if it is
+ *
+ ************************************************************/
+
+int cfg_in_code( ADDR addr, int start )
+{
+    unsigned int lo = 0, hi = n_insns;
+    const cfg_insn_t *ci;
+    
+    while ( lo < hi )
+    {
+        unsigned int mid = lo + ( hi - lo ) / 2;
+        
+        if ( insns[mid].addr <= addr )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    
+    if ( lo == 0 )
+        return 0;
+        
+    ci = &insns[lo - 1];
+    return start ? ( ci->addr == addr ) : ( addr < ci->addr + ci->length );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_is_join
+ *
+ * DESCRIPTION
+ *      Tests whether the instruction at addr may be reached
+ *       other than by falling through from the instruction
+ *       before it: it is a jump, branch or call target, the
+ *       entry of a procedure, or follows data or the end of
+ *       a block.  Addresses not scanned count as joins.
+ *
+ * RETURNS
+ *      non-zero if it is
+ *
+ ************************************************************/
+
+int cfg_is_join( ADDR addr )
+{
+    unsigned int i = find_insn( addr );
+    
+    return i == NO_INDEX || ( insns[i].flags & CI_JOIN );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_foreach_insn
+ *
+ * DESCRIPTION
+ *      Calls fn for each instruction of the scan pass, with
+ *       entry set if it looks like the entry point of a
+ *       routine: it is called, starts a procedure or a run
+ *       of code, or follows a return or jump.  Only valid
+ *       once the graph is built.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void cfg_foreach_insn( void (*fn)( ADDR addr, unsigned int length, int entry ) )
+{
+    unsigned int i;
+    
+    for ( i = 0; i < n_insns; i++ )
+        fn( insns[i].addr, insns[i].length, 
+            ( insns[i].flags & ( CI_CALLED | CI_AFTER_END | CI_RANGE | CI_ENTRY ) ) != 0 );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_foreach_proc
+ *
+ * DESCRIPTION
+ *      Calls fn for each procedure, in address order, with
+ *       its entry and name.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void cfg_foreach_proc( void (*fn)( ADDR addr, const char *name ) )
+{
+    unsigned int i;
+    
+    if ( !built )
+        return;
+        
+    for ( i = 0; i < n_procs; i++ )
+        fn( insns[procs[i].first].addr, procs[i].name );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_reset
+ *
+ * DESCRIPTION
+ *      Discards the scanned instructions, ready for another
+ *       scan pass.  Must be called before cfg_build().
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void cfg_reset( void )
+{
+    free( insns );
+    free( procs );
+    insns   = NULL;
+    procs   = NULL;
+    n_insns = max_insns = 0;
+    n_procs = max_procs = 0;
+    in_code = 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_proc_name
+ *
+ * DESCRIPTION
+ *      Looks up the procedure starting at an address.
+ *
+ * RETURNS
+ *      name of the procedure, or NULL if none starts at addr
+ *
+ ************************************************************/
+
+const char * cfg_proc_name( ADDR addr )
+{
+    unsigned int i;
+    
+    if ( !built || ( i = find_proc( addr ) ) == NO_INDEX )
+        return NULL;
+        
+    return procs[i].name;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_proc_info
+ *
+ * DESCRIPTION
+ *      Fills in a summary of the procedure starting at addr.
+ *
+ * RETURNS
+ *      non-zero if a procedure starts at addr
+ *
+ ************************************************************/
+
+int cfg_proc_info( ADDR addr, proc_info_t *info )
+{
+    unsigned int i;
+    
+    if ( !built || ( i = find_proc( addr ) ) == NO_INDEX )
+        return 0;
+        
+    get_info( i, info );
+    
+    return 1;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_proc_rename
+ *
+ * DESCRIPTION
+ *      Names the procedure starting at addr, and labels its
+ *       entry, unless it already has a name of its own (from
+ *       a p command or a label) or the name is in use.
+ *
+ * RETURNS
+ *      non-zero if the procedure was renamed
+ *
+ ************************************************************/
+
+int cfg_proc_rename( ADDR addr, const char *name )
+{
+    unsigned int i;
+    ADDR other;
+    char *copy;
+    
+    if ( !built || ( i = find_proc( addr ) ) == NO_INDEX 
+         || ( procs[i].flags & PROC_NAMED )
+         || strncmp( procs[i].name, GEN_LABEL_PREFIX, strlen( GEN_LABEL_PREFIX ) )
+         || xref_findlabeladdr( name, &other ) )
+        return 0;
+        
+    copy = dupstr( name );
+    xref_addxreflabel( addr, copy );
+    procs[i].name = copy;
+    
+    return 1;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_dump_procs
+ *
+ * DESCRIPTION
+ *      Dumps the procedure table to screen.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void cfg_dump_procs( void )
+{
+    proc_info_t info;
+    unsigned int i;
+    
+    printf( "\n\nPROCEDURES :\n\n---------------------------\n" );
+    printf( "Addr   Size Blocks Calls Callers Callees  Name\n" );
+    for ( i = 0; i < n_procs; i++ )
+    {
+        get_info( i, &info );
+        printf( FORMAT_ADDR ": %5u %5u %5u %6u %7u   %s%s%s\n",
+                info.addr, info.size, info.n_blocks, info.n_sites,
+                info.n_callers, info.n_callees, info.name,
+                info.n_callees ? "" : " (leaf)",
+                info.recursive ? " (recursive)" : "" );
+    }
+    puts( "---------------------------\n" );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_write_dot
+ *
+ * DESCRIPTION
+ *      Writes the graph in Graphviz dot format.  Each block
+ *       is labelled with its address range and instruction
+ *       count; targets outside the code are drawn as plain
+ *       text.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void cfg_write_dot( FILE *fp )
+{
+    static const char * const edge_style[] = {
+        "",                         /* EDGE_FALL  */
+        " [color=darkgreen]",       /* EDGE_TAKEN */
+        " [color=blue]",            /* EDGE_JUMP  */
+        " [style=dashed]"           /* EDGE_SKIP  */
+    };
+    unsigned int i, j, p = 0;
+    int in_cluster = 0;
+    
+    fprintf( fp, "digraph \"%s\" {\n", dasm_name );
+    fprintf( fp, "    node [shape=box, fontname=\"monospace\"];\n" );
+    
+    for ( i = 0; i < n_blocks; i++ )
+    {
+        const cfg_block_t *b = &blocks[i];
+        const cfg_insn_t *last = &insns[b->first + b->n_insns - 1];
+        
+        if ( p < n_procs && procs[p].first == b->first )
+        {
+            if ( in_cluster )
+                fprintf( fp, "    }\n" );
+            fprintf( fp, "    subgraph \"cluster_%u\" {\n", p );
+            fprintf( fp, "        label=\"" );
+            write_string( fp, procs[p].name ? procs[p].name : "" );
+            fprintf( fp, "\";\n" );
+            in_cluster = 1;
+            p++;
+        }
+        
+        fprintf( fp, "%s    b%u [label=\"", in_cluster ? "    " : "", i );
+        write_label( fp, insns[b->first].addr );
+        fprintf( fp, FORMAT_ADDR "-" FORMAT_ADDR "\\n%u insn%s\"];\n", 
+                 insns[b->first].addr, last->addr + last->length - 1,
+                 b->n_insns, b->n_insns == 1 ? "" : "s" );
+    }
+    
+    if ( in_cluster )
+        fprintf( fp, "    }\n" );
+        
+    for ( i = 0; i < n_blocks; i++ )
+    {
+        for ( j = blocks[i].edge; j < blocks[i].edge + blocks[i].n_edges; j++ )
+        {
+            const cfg_edge_t *e = &edges[j];
+            
+            if ( e->kind & EDGE_OUT )
+            {
+                fprintf( fp, "    x" FORMAT_ADDR " [shape=plaintext, label=\"", 
+                         e->to );
+                write_label( fp, e->to );
+                fprintf( fp, FORMAT_ADDR "\"];\n", e->to );
+                fprintf( fp, "    b%u -> x" FORMAT_ADDR "%s;\n", 
+                         i, e->to, edge_style[e->kind & ~EDGE_OUT] );
+            }
+            else
+                fprintf( fp, "    b%u -> b%u%s;\n", 
+                         i, e->to, edge_style[e->kind] );
+        }
+    }
+    
+    fprintf( fp, "}\n" );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cfg_write_callgraph
+ *
+ * DESCRIPTION
+ *      Writes the call graph in Graphviz dot format.  Each
+ *       procedure is labelled with its name, address and
+ *       size; recursive procedures are drawn bold.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void cfg_write_callgraph( FILE *fp )
+{
+    proc_info_t info;
+    unsigned int i, j;
+    
+    fprintf( fp, "digraph \"%s\" {\n", dasm_name );
+    fprintf( fp, "    node [shape=box, fontname=\"monospace\"];\n" );
+    
+    for ( i = 0; i < n_procs; i++ )
+    {
+        get_info( i, &info );
+        fprintf( fp, "    p%u [label=\"", i );
+        write_string( fp, info.name );
+        fprintf( fp, "\\n" FORMAT_ADDR "\\n%u bytes\"%s];\n", 
+                 info.addr, info.size, info.recursive ? ", style=bold" : "" );
+    }
+    
+    for ( i = 0; i < n_procs; i++ )
+        for ( j = procs[i].callee; j < procs[i].callee + procs[i].n_callees; j++ )
+            fprintf( fp, "    p%u -> p%u;\n", i, calls[j] );
+            
+    fprintf( fp, "}\n" );
+}
+
+/******************************************************************************/
+/******************************************************************************/
+/******************************************************************************/
@@ -0,0 +1,742 @@
+/*****************************************************************************
+ *
+ * Copyright (C) 2014-2016, Neil Johnson
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms,
+ * with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of Neil Johnson nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *****************************************************************************/
+ 
+/*****************************************************************************
+ *
+ * Data classification.
+ *
+ * The byte segments (b commands) of the command file are what has not yet
+ *  been identified.  Each is scanned for runs that look like strings,
+ *  text, vectors, pointer tables or bitmaps, and these are written out as
+ *  a command file of proposed segments which can be included after the
+ *  original one (a later command at the same address replaces an earlier
+ *  one).  Each proposal is preceded by a comment giving its score, a
+ *  rough percentage confidence, and the evidence for it:
+ *
+ *      s   - strings of at least MIN_STRING printable characters, each
+ *            ending in the string terminator (t command).  Scored by the
+ *            number of strings and how much of them is letters.
+ *      a   - printable text with no terminator, at least MIN_CHARS long.
+ *      v   - at least MIN_VECTORS words which are each the address of an
+ *            instruction of the code segments that is labelled or looks
+ *            like the start of a routine (see cfg_foreach_insn).  Scored
+ *            by count.
+ *      w   - at least MIN_POINTERS words which are each the address of a
+ *            label or of the start of a string, but not of code.
+ *      m   - runs of BITMAP_BLOCK byte blocks with few distinct values,
+ *            e.g. character glyphs.  Scored down by how much of the run
+ *            decodes as valid instructions.
+ *
+ *  The kinds are tried in the order v, w, m, s, a, as vectors and bitmaps
+ *  are often printable.  Runs of 00 or FF are padding and are left as
+ *  bytes.
+ *
+ * The image is held in memory, with a map of which bytes are code, and
+ *  scanned a machine word at a time where possible: a word of eight printable bytes, or of eight padding bytes,
+ *  is passed over with a few logical operations (see HAS_LESS etc.)
+ *  rather than byte by byte.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "dasmxx.h"
+
+/*****************************************************************************
+ *        Data Types, Macros, Constants
+ *****************************************************************************/
+
+/* Shortest runs worth proposing */
+#define MIN_STRING      ( 4 )     /* printable bytes before a terminator   */
+#define MIN_CHARS       ( 16 )    /* printable bytes with no terminator    */
+#define MIN_VECTORS     ( 3 )     /* code addresses                        */
+#define MIN_POINTERS    ( 3 )     /* addresses of labels or strings        */
+#define MIN_FILL        ( 8 )     /* repeats of 00 or FF                   */
+#define MIN_BLOCKS      ( 2 )     /* bitmap blocks                         */
+
+/* Bitmaps are looked at in blocks of this many bytes */
+#define BITMAP_BLOCK    ( 8 )
+#define BITMAP_VALUES   ( 5 )     /* most distinct values in a block       */
+
+/* Word-at-a-time tests, for any size of unsigned long */
+typedef unsigned long swar_t;
+#define ONES            ( ~(swar_t)0 / 255 )          /* 0x0101...01 */
+#define HIGHS           ( ONES * 0x80 )               /* 0x8080...80 */
+
+/* Non-zero if any byte of x is zero, less than n, or more than n (n < 128) */
+#define HAS_ZERO(x)     ( ( (x) - ONES ) & ~(x) & HIGHS )
+#define HAS_LESS(x,n)   ( ( (x) - ONES * (n) ) & ~(x) & HIGHS )
+#define HAS_MORE(x,n)   ( ( ( (x) + ONES * ( 127 - (n) ) ) | (x) ) & HIGHS )
+
+/* One proposed segment */
+typedef struct {
+    int          cmd;             /* command letter, 0 if none       */
+    ADDR         start, end;
+    unsigned int items;           /* strings, words, blocks          */
+    unsigned int score;
+} proposal_t;
+
+/*****************************************************************************
+ *        Private Data
+ *****************************************************************************/
+
+static UBYTE * image     = NULL;
+static ADDR    image_base;
+static long    image_length;
+static FILE  * image_file;
+static FILE  * out;
+static int     terminator;
+
+/* Bytes that may appear in a string */
+static UBYTE is_text[256];
+
+/* What the code segments have at each byte of the image */
+static UBYTE * code_map  = NULL;
+#define MAP_INSN        ( 0x01 )  /* part of an instruction              */
+#define MAP_START       ( 0x02 )  /* first byte of an instruction        */
+#define MAP_ENTRY       ( 0x04 )  /* ... which looks like a routine      */
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      load
+ *
+ * DESCRIPTION
+ *      Loads a machine word from any alignment.
+ *
+ * RETURNS
+ *      the word
+ *
+ ************************************************************/
+
+static swar_t load( const UBYTE *p )
+{
+    swar_t x;
+    
+    memcpy( &x, p, sizeof( x ) );
+    return x;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      text_run
+ *
+ * DESCRIPTION
+ *      Measures the run of string bytes from p, not going
+ *       past end.  Whole words of plain printable bytes are
+ *       passed over at once.
+ *
+ * RETURNS
+ *      length of the run
+ *
+ ************************************************************/
+
+static unsigned int text_run( const UBYTE *p, const UBYTE *end )
+{
+    const UBYTE *q = p;
+    swar_t t = ONES * (UBYTE)terminator;
+    
+    for ( ;; )
+    {
+        while ( end - q >= (long)sizeof( swar_t ) )
+        {
+            swar_t x = load( q );
+            
+            if ( HAS_LESS( x, 0x20 ) || HAS_MORE( x, 0x7E ) || HAS_ZERO( x ^ t ) )
+                break;
+            q += sizeof( swar_t );
+        }
+        
+        if ( q < end && is_text[*q] )
+            q++;
+        else
+            break;
+    }
+    
+    return q - p;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      fill_run
+ *
+ * DESCRIPTION
+ *      Measures the run of padding (00 or FF) from p, not
+ *       going past end.
+ *
+ * RETURNS
+ *      length of the run
+ *
+ ************************************************************/
+
+static unsigned int fill_run( const UBYTE *p, const UBYTE *end )
+{
+    const UBYTE *q = p;
+    swar_t fill;
+    
+    if ( p >= end || ( *p != 0x00 && *p != 0xFF ) )
+        return 0;
+        
+    fill = ONES * *p;
+    while ( end - q >= (long)sizeof( swar_t ) && load( q ) == fill )
+        q += sizeof( swar_t );
+    while ( q < end && *q == *p )
+        q++;
+        
+    return q - p;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      letters
+ *
+ * DESCRIPTION
+ *      Measures how much of a run is letters and spaces.
+ *
+ * RETURNS
+ *      percentage
+ *
+ ************************************************************/
+
+static unsigned int letters( const UBYTE *p, unsigned int n )
+{
+    unsigned int i, k = 0;
+    
+    for ( i = 0; i < n; i++ )
+        if ( isalpha( p[i] ) || p[i] == ' ' )
+            k++;
+            
+    return n ? k * 100 / n : 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      word_at
+ *
+ * DESCRIPTION
+ *      Reads a word in the target's byte order.
+ *
+ * RETURNS
+ *      the word
+ *
+ ************************************************************/
+
+static ADDR word_at( const UBYTE *p )
+{
+    if ( dasm_word_msb_first )
+        return ( p[0] << 8 ) | p[1];
+    else
+        return p[0] | ( p[1] << 8 );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      map_insn
+ *
+ * DESCRIPTION
+ *      Marks an instruction in the code map.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void map_insn( ADDR addr, unsigned int length, int entry )
+{
+    long i = (long)addr - (long)image_base;
+    
+    if ( i < 0 || i + (long)length > image_length )
+        return;
+        
+    code_map[i] |= MAP_START | ( entry ? MAP_ENTRY : 0 );
+    while ( length-- )
+        code_map[i++] |= MAP_INSN;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      code_at
+ *
+ * DESCRIPTION
+ *      Looks up an address in the code map.
+ *
+ * RETURNS
+ *      MAP_xxx flags, 0 if not in code
+ *
+ ************************************************************/
+
+static int code_at( ADDR addr )
+{
+    long i = (long)addr - (long)image_base;
+    
+    return ( i >= 0 && i < image_length ) ? code_map[i] : 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      is_string_start
+ *
+ * DESCRIPTION
+ *      Tests whether a string of the image starts at addr:
+ *       a string byte following a terminator.
+ *
+ * RETURNS
+ *      non-zero if one does
+ *
+ ************************************************************/
+
+static int is_string_start( ADDR addr )
+{
+    long i = (long)addr - (long)image_base;
+    
+    return i > 0 && i < image_length 
+           && image[i - 1] == terminator && is_text[image[i]];
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      match_strings
+ *
+ * DESCRIPTION
+ *      Measures the run of terminated strings from p.
+ *       *n is set to the number of strings.
+ *
+ * RETURNS
+ *      length of the run
+ *
+ ************************************************************/
+
+static unsigned int match_strings( const UBYTE *p, const UBYTE *end, 
+                                   unsigned int *n )
+{
+    const UBYTE *q = p;
+    unsigned int r;
+    
+    for ( *n = 0; q < end; q += r + 1, (*n)++ )
+    {
+        r = text_run( q, end );
+        if ( r < MIN_STRING || q + r >= end || q[r] != terminator )
+            break;
+    }
+    
+    return q - p;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      match_words
+ *
+ * DESCRIPTION
+ *      Measures the run of words from p which are addresses
+ *       of routines or, if code is not set, of labelled data
+ *       or strings.  *n is set to the number of words.
+ *
+ * RETURNS
+ *      length of the run
+ *
+ ************************************************************/
+
+static unsigned int match_words( const UBYTE *p, const UBYTE *end, int code,
+                                 unsigned int *n )
+{
+    const UBYTE *q = p;
+    
+    for ( *n = 0; end - q >= 2; q += 2, (*n)++ )
+    {
+        ADDR w = word_at( q );
+        
+        if ( w == 0x0000 || w == 0xFFFF )
+            break;
+        if ( code && !( code_at( w ) & MAP_ENTRY ) 
+             && !( ( code_at( w ) & MAP_START ) && xref_findaddrlabel( w ) ) )
+            break;
+        if ( !code && ( code_at( w ) 
+                        || !( is_string_start( w ) || xref_findaddrlabel( w ) ) ) )
+            break;
+    }
+    
+    return q - p;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      is_word_table
+ *
+ * DESCRIPTION
+ *      Tests whether a table of code or data addresses long
+ *       enough to propose starts at p.
+ *
+ * RETURNS
+ *      non-zero if one does
+ *
+ ************************************************************/
+
+static int is_word_table( const UBYTE *p, const UBYTE *end )
+{
+    unsigned int n;
+    
+    return ( match_words( p, end, 1, &n ), n >= MIN_VECTORS )
+           || ( match_words( p, end, 0, &n ), n >= MIN_POINTERS );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      match_bitmap
+ *
+ * DESCRIPTION
+ *      Measures the run of bitmap-like blocks from p: blocks 
+ *       of BITMAP_BLOCK bytes with only a few distinct
+ *       values, but more than one, and not looking like words
+ *       with a common high byte.  The run stops at a block in
+ *       which a table of addresses starts.  *n is set to the
+ *       number of blocks.
+ *
+ * RETURNS
+ *      length of the run
+ *
+ ************************************************************/
+
+static unsigned int match_bitmap( const UBYTE *p, const UBYTE *end, 
+                                  unsigned int *n )
+{
+    const UBYTE *q = p;
+    UBYTE seen[BITMAP_BLOCK];
+    unsigned int i, j, k, same[2];
+    
+    for ( *n = 0; end - q >= BITMAP_BLOCK; q += BITMAP_BLOCK, (*n)++ )
+    {
+        same[0] = same[1] = 1;
+        for ( i = 0, k = 0; i < BITMAP_BLOCK; i++ )
+        {
+            for ( j = 0; j < k && seen[j] != q[i]; j++ )
+                ;
+            if ( j == k )
+                seen[k++] = q[i];
+            if ( i >= 2 && q[i] != q[i - 2] )
+                same[i & 1] = 0;
+        }
+        
+        if ( k < 2 || k > BITMAP_VALUES || same[0] || same[1] )
+            break;
+            
+        for ( i = 0; i < BITMAP_BLOCK && !is_word_table( q + i, end ); i++ )
+            ;
+        if ( i < BITMAP_BLOCK )
+            break;
+    }
+    
+    return q - p;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      decode_rate
+ *
+ * DESCRIPTION
+ *      Decodes a run of the image as code.
+ *
+ * RETURNS
+ *      percentage of its bytes in valid instructions
+ *
+ ************************************************************/
+
+static unsigned int decode_rate( ADDR start, ADDR end )
+{
+    ADDR addr = start, next_addr;
+    unsigned int valid = 0;
+    insn_t insn;
+    
+    fseek( image_file, start - image_base, SEEK_SET );
+    dasm_begin_walk();
+    
+    while ( addr < end 
+            && (long)( addr - image_base ) + dasm_max_insn_length <= image_length )
+    {
+        next_addr = dasm_decode( image_file, &insn, addr );
+        if ( insn.opcode )
+            valid += MIN( next_addr, end ) - addr;
+        addr = next_addr;
+    }
+    
+    return valid * 100 / ( end - start );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      classify
+ *
+ * DESCRIPTION
+ *      Proposes a segment for the run starting at addr, not
+ *       going past end.
+ *
+ * RETURNS
+ *      the proposal; its cmd is 0 if nothing was found, and
+ *       its end is the end of the run
+ *
+ ************************************************************/
+
+static proposal_t classify( ADDR addr, ADDR end )
+{
+    const UBYTE *p = image + ( addr - image_base );
+    const UBYTE *e = image + ( end - image_base );
+    proposal_t pr;
+    unsigned int n, len;
+    
+    memset( &pr, 0, sizeof( pr ) );
+    pr.start = addr;
+    
+    if ( ( len = fill_run( p, e ) ) >= MIN_FILL )
+    {
+        pr.end = addr + len;
+        return pr;
+    }
+    
+    if ( ( len = match_words( p, e, 1, &n ) ) && n >= MIN_VECTORS )
+    {
+        pr.cmd   = 'v';
+        pr.score = MIN( 30 + 10 * n, 95 );
+    }
+    else if ( ( len = match_words( p, e, 0, &n ) ) && n >= MIN_POINTERS )
+    {
+        pr.cmd   = 'w';
+        pr.score = MIN( 30 + 10 * n, 85 );
+    }
+    else if ( ( len = match_bitmap( p, e, &n ) ) && n >= MIN_BLOCKS )
+    {
+        pr.cmd   = 'm';
+        pr.score = 70 - 40 * decode_rate( addr, addr + len ) / 100;
+    }
+    else if ( ( len = match_strings( p, e, &n ) ) && n )
+    {
+        pr.cmd   = 's';
+        pr.score = MIN( 55 + 5 * n, 85 ) + ( letters( p, len ) >= 60 ? 10 : 0 );
+    }
+    else if ( ( len = text_run( p, e ) ) >= MIN_CHARS )
+    {
+        n = len;
+        pr.cmd   = 'a';
+        pr.score = MIN( 40 + len / 4, 75 ) + ( letters( p, len ) >= 60 ? 10 : 0 );
+    }
+    else
+        len = 1;
+    
+    pr.items = n;
+    pr.end   = addr + len;
+    return pr;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      write_proposal
+ *
+ * DESCRIPTION
+ *      Writes a proposed segment and its evidence.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void write_proposal( const proposal_t *pr )
+{
+    static const struct {
+        int          cmd;
+        const char * one;
+        const char * many;
+    } whats[] = {
+        { 's', "string",       "strings" },
+        { 'a', "character",    "characters" },
+        { 'v', "code address", "code addresses" },
+        { 'w', "data address", "data addresses" },
+        { 'm', "bitmap block", "bitmap blocks" },
+        { 0,   NULL,           NULL }
+    };
+    unsigned int i;
+    
+    for ( i = 0; whats[i].cmd != pr->cmd; i++ )
+        ;
+        
+    fprintf( out, "# %2u%%: %u %s, %u bytes\n", pr->score, pr->items, 
+             pr->items == 1 ? whats[i].one : whats[i].many, 
+             pr->end - pr->start );
+    fprintf( out, "%c" FORMAT_ADDR "\n", pr->cmd, pr->start );
+}
+
+/*****************************************************************************
+ *        Public Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      classify_begin
+ *
+ * DESCRIPTION
+ *      Loads the image from f, whose first byte is at address
+ *       base, and maps the code found by the flow graph, ready
+ *       to classify regions of it.  Proposals
+ *       are written to fp.  term is the string terminator.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void classify_begin( FILE *f, ADDR base, int term, FILE *fp )
+{
+    int c;
+    
+    fseek( f, 0, SEEK_END );
+    image_length = ftell( f );
+    image_base   = base;
+    image_file   = f;
+    image        = zalloc( image_length + 1 );
+    code_map     = zalloc( image_length + 1 );
+    terminator   = term;
+    out          = fp;
+    
+    rewind( f );
+    if ( fread( image, 1, image_length, f ) != (size_t)image_length )
+        error( "Failed to read input for data classification" );
+        
+    cfg_foreach_insn( map_insn );
+    
+    for ( c = 0; c < 256; c++ )
+        is_text[c] = ( isprint( c ) || c == '\t' || c == '\n' || c == '\r' )
+                     && c != terminator;
+                     
+    fprintf( out, "# %s: data segments proposed for the byte segments\n"
+                  "# Include after the original commands to apply them.\n",
+                  dasm_name );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      classify_region
+ *
+ * DESCRIPTION
+ *      Classifies a byte segment, from start up to end, with
+ *       bpl bytes per line.  Neighbouring runs of the same
+ *       kind are proposed as one segment, and each proposal
+ *       is followed by a b command to resume the byte dump.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void classify_region( ADDR start, ADDR end, unsigned int bpl )
+{
+    proposal_t cur, pr;
+    ADDR addr;
+    
+    if ( start < image_base )
+        start = image_base;
+    if ( (long)( end - image_base ) > image_length )
+        end = image_base + image_length;
+        
+    memset( &cur, 0, sizeof( cur ) );
+    
+    for ( addr = start; addr < end; addr = pr.end )
+    {
+        pr = classify( addr, end );
+        
+        if ( cur.cmd && pr.cmd == cur.cmd )
+        {
+            cur.score = ( cur.score * ( cur.end - cur.start ) 
+                          + pr.score * ( pr.end - pr.start ) )
+                        / ( pr.end - cur.start );
+            cur.items += pr.items;
+            cur.end    = pr.end;
+            continue;
+        }
+        
+        if ( cur.cmd )
+        {
+            write_proposal( &cur );
+            if ( !pr.cmd )
+                fprintf( out, "b" FORMAT_ADDR ",%u\n", cur.end, bpl );
+        }
+        
+        cur = pr;
+    }
+    
+    if ( cur.cmd )
+        write_proposal( &cur );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      classify_end
+ *
+ * DESCRIPTION
+ *      Releases the image and its code map.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void classify_end( void )
+{
+    free( image );
+    free( code_map );
+    image    = NULL;
+    code_map = NULL;
+}
+
+/******************************************************************************/
+/******************************************************************************/
+/******************************************************************************/
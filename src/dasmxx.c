@@ -49,7 +49,54 @@
  * Supported command line options are:
  *      -h         - print helpful usage information
  *      -x         - generate cross-reference list at end of disassembly
+ *      -u         - list the reads and writes of each register in the
+ *                   target's register window at the end of the listing,
+ *                   e.g. the 78K/III saddr and sfr areas (see DASM_REGS)
  *      -o foo     - write output to file "foo" (default is stdout)
+ *      -i foo     - read input from file "foo" in place of the f command
+ *      -j         - write JSON Lines records instead of the listing
+ *      -b         - write fixed-width binary records instead of the listing
+ *                   (see records.c for both record formats)
+ *      -a         - write assembler source instead of the listing
+ *                   (see asmout.c)
+ *      -g foo     - write the control flow graph to file "foo" in
+ *                   Graphviz dot format, and show the number of basic
+ *                   blocks of each procedure (see cfg.c)
+ *      -p         - find procedures from call targets as well as from
+ *                   p commands, and list them with their callers and
+ *                   callees at the end of the listing
+ *      -c foo     - write the call graph to file "foo" in Graphviz dot
+ *                   format
+ *      -t         - resolve jump tables: list the tables of computed
+ *                   jumps as data, label their targets and add them to
+ *                   the flow graph (see jumptab.c)
+ *      -r         - follow the registers used as pointers, such as DPTR
+ *                   and HL, and cross-reference the data they are
+ *                   loaded to point at (see track.c)
+ *      -d foo     - write proposed string, text, vector, word and bitmap
+ *                   segments for the byte segments to command file "foo"
+ *                   (see classify.c)
+ *      -s pat     - search the input for byte pattern "pat" instead of
+ *                   disassembling it, e.g. -s "putc: CD ?? ?3", and list
+ *                   the matches with their nearest labels; may be given
+ *                   more than once, and "-s @foo" reads the patterns from
+ *                   file "foo", one per line (see search.c)
+ *      -q query   - list the instructions matching "query" instead of
+ *                   disassembling, e.g. -q "flow=call and before(imm=1234)"
+ *                   (see query.c for the query language)
+ *      -w foo     - add the signatures of the named procedures to the
+ *                   signature database "foo", creating it if need be
+ *      -m foo     - name the procedures found in the signature database
+ *                   "foo" (see sig.c)
+ *      -M foo     - write the procedure map of the input to file "foo"
+ *      -D foo     - instead of disassembling, compare the procedures of
+ *                   the input with those of procedure map "foo", written
+ *                   by -M from an earlier version, and write a command
+ *                   file porting its names, labels and comments (see
+ *                   diff.c)
+ *      -e foo     - export the segments, procedures, labels and comments
+ *                   found to command file "foo", so that later runs need
+ *                   not repeat the analysis
  *
  * The command list file contains a list of memory segment definitions, used during
  *  processing to tell the disassembler what the memory at a particular address
@@ -59,10 +106,20 @@
  *
  * File commands:
  *      fName       input file = `Name'
+ *                  (`-' reads standard input, e.g. from a pipe)
  *      iName       include file `Name' in place of include command
  *
  * Configuration commands:
  *      tXX         string terminator byte (default = 00)
+ *      oXXXX mode  select a mode of the processor from XXXX onwards, as
+ *                  for code the disassembler cannot follow to it, e.g.
+ *                  MB0 or MB1 for the MCS-48 memory bank, Z180, EZ80
+ *                  and ADL for Z80 derivatives, 6309, or 65C02, 65816
+ *                  and M16/X16 for 6502 derivatives; modes taking a
+ *                  value are given as NAME=XX, as are settings of the
+ *                  board that hold for the whole image wherever they
+ *                  are given, e.g. BANKREG=90 for 8051 code banking
+ *                  (see decode51.c)
  *      eXXXX       end of disassembly
  *      q[,N]["title"]  pagination, N lines (default=60), optional title
  *
@@ -104,6 +161,11 @@
  *   will generate a name for you: "AL_nnnn" for labels, and "PROC_nnnn" for 
  *     procedures.
  *
+ *  If two segment commands give the same address the later one is used,
+ *   so an included file (such as the proposals written by -d) can refine
+ *   the segments of the file that includes it.  A segment with no name
+ *   keeps any label its address already has.
+ *
  *****************************************************************************/
 
 #include <stdio.h>
@@ -112,6 +174,7 @@
 #include <stdarg.h>
 #include <unistd.h> /* for getopt */
 #include <ctype.h>
+#include <sys/stat.h>
 
 #include "dasmxx.h"
 
@@ -139,9 +202,25 @@ struct params {
     const char * listfile;
     const char * inputfile;
     const char * outputfile;
+    const char * inputoverride;
+    const char * graphfile;
+    const char * callgraphfile;
+    const char * datafile;
+    const char * sigwrite;
+    const char * sigmatch;
+    const char * mapfile;
+    const char * difffile;
+    const char * exportfile;
     struct fmt * cmdlist;
     
     int want_xref;
+    int want_regs;
+    int infer_procs;
+    int resolve_tables;
+    int track_regs;
+    int search;
+    int query;
+    int format;         /* REC_FORMAT_xxx */
 };
 
 /* Set various physical limits */
@@ -174,10 +253,22 @@ static char datchars[] = "cbsewapvm";
 #define VECTORS         7
 #define BITMAPS         8
 
-/* Global instruction byte buffer */
+/* Global instruction byte buffer.  It holds every byte of the longest
+ * instructions (eZ80 with a suffix), though the listing only makes room
+ * for dasm_max_insn_length of them */
+#define INSN_BYTES_MAX  ( 16 )
 static UBYTE *insn_byte_buffer = NULL;
 static UBYTE  insn_byte_idx    = 0;
 
+/* Jump table resolution: the segment list being marked and whether it
+ * was changed by the last pass */
+#define MAX_TABLE_PASSES    ( 4 )
+
+/* Furthest a register comment gives an address from a label */
+#define NEAR_LABEL          ( 0x100 )
+static struct fmt *table_list  = NULL;
+static int         resegmented = 0;
+
 /* Pagination Formatting */
 static int pagination   = 0;
 #define PAGINATION_ALLOWANCE        ( 2 )
@@ -189,6 +280,46 @@ static const char *page_title = NULL;
  *        Private Functions
  *****************************************************************************/
 
+/***********************************************************
+ *
+ * FUNCTION
+ *      comment_before
+ *
+ * DESCRIPTION
+ *      Finds the last entry of the given comment list (linecmt
+ *       or blockcmt) before the given address.  The lists are 
+ *       in address order and mostly searched and added to in
+ *       address order, so each search starts from where the 
+ *       last one on the same list stopped, if that is not past
+ *       ref.
+ *
+ * RETURNS
+ *      the entry, or NULL if ref is before all of them
+ *
+ ************************************************************/
+
+static struct comment * comment_before( struct comment *list, ADDR ref )
+{
+    static struct comment *hint[2] = { NULL, NULL };
+    struct comment **h = &hint[list == blockcmt];
+    struct comment *p = NULL;
+    struct comment *q = list;
+    
+    if ( *h && (ADDR)(*h)->ref < ref )
+    {
+        p = *h;
+        q = p->next;
+    }
+        
+    for ( ; q && (ADDR)q->ref < ref; q = q->next )
+        p = q;
+        
+    if ( p )
+        *h = p;
+        
+    return p;
+}
+
 /***********************************************************
  *
  * FUNCTION
@@ -204,17 +335,10 @@ static const char *page_title = NULL;
 
 static void addcomment( struct comment **list, ADDR ref, char *text )
 {
-    struct comment *p = *list;
-    struct comment *q = NULL;
+    struct comment *q = comment_before( *list, ref );
+    struct comment *p = q ? q->next : *list;
 
-    /* Find entry in specified comment list */
-    while ( p != NULL && ref > p->ref )
-    {
-        q = p;
-        p = p->next;
-    }
-
-    if ( p != NULL && ref == p->ref)  /* new addr for ref */
+    if ( p != NULL && ref == (ADDR)p->ref )  /* new addr for ref */
     {
         if ( p->text )
             error( "Multiple comments for same address ($%04X)", ref );
@@ -283,6 +407,29 @@ static void newline( void )
     }
 }
 
+/***********************************************************
+ *
+ * FUNCTION
+ *      lookupcomment
+ *
+ * DESCRIPTION
+ *      Searches the given comment list (linecmt or blockcmt)
+ *       for an entry at the given address.
+ *
+ * RETURNS
+ *      the entry, or NULL if none
+ *
+ ************************************************************/
+
+static struct comment * lookupcomment( struct comment *list, ADDR ref )
+{
+    struct comment *p = comment_before( list, ref );
+    
+    p = p ? p->next : list;
+        
+    return ( p && (ADDR)p->ref == ref ) ? p : NULL;
+}
+
 /***********************************************************
  *
  * FUNCTION
@@ -299,34 +446,28 @@ static void newline( void )
 
 static int printcomment( struct comment *list, ADDR ref, unsigned int padding )
 {
-    int i;
     char *p;
-    struct comment *plist = list;
+    struct comment *plist = lookupcomment( list, ref );
     
-    for ( ; plist; plist = plist->next )
+    if ( !plist )
+        return 0;
+        
+    printf( "%*s ", padding, COMMENT_DELIM );
+    for ( p = plist->text; *p; p++ )
     {
-        if ( plist->ref == ref )
+        if ( *p == '\n' )
         {
+            newline();
             printf( "%*s ", padding, COMMENT_DELIM );
-            for ( p = plist->text; *p; p++ )
-            {
-                if ( *p == '\n' )
-                {
-                    newline();
-                    printf( "%*s ", padding, COMMENT_DELIM );
-                }
-                else
-                    putchar( *p );
-            }
-            
-            if ( list == blockcmt )
-                newline();
-
-            return 1;
         }
-    }    
+        else
+            putchar( *p );
+    }
+    
+    if ( list == blockcmt )
+        newline();
 
-    return 0;
+    return 1;
 }
 
 /***********************************************************
@@ -345,11 +486,28 @@ static int printcomment( struct comment *list, ADDR ref, unsigned int padding )
 
 static int commentexists( struct comment *list, ADDR ref )
 {
-    for ( ; list; list = list->next )
-        if ( list->ref == ref )
-            return 1;
+    return lookupcomment( list, ref ) != NULL;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      findcomment
+ *
+ * DESCRIPTION
+ *      Searches the given comment list for an entry at
+ *       the given address.
+ *
+ * RETURNS
+ *      comment text, or NULL if no comment
+ *
+ ************************************************************/
 
-    return 0;
+static const char * findcomment( struct comment *list, ADDR ref )
+{
+    struct comment *p = lookupcomment( list, ref );
+    
+    return p ? p->text : NULL;
 }
 
 /***********************************************************
@@ -396,8 +554,9 @@ static void addlist( struct fmt **list, ADDR addr, int mode, unsigned int bytes_
 {
     struct fmt *p = *list, *q = NULL;
 
-    /* scan through address-ordered list to find right place to insert */
-    while ( p != NULL && p->addr < addr )
+    /* scan through address-ordered list to find right place to insert,
+     * after any at the same address so that the later command wins */
+    while ( p != NULL && p->addr <= addr )
     {
         q = p;
         p = p->n;
@@ -504,6 +663,7 @@ static void readlist( const char *listfile, struct params *params )
                 {
                     unsigned int cmd_idx = strchr( datchars, cmd ) - datchars;
                     unsigned bytes_per_line = BYTES_PER_LINE;
+                    const char *label;
                     sscanf( pbuf, "%x%n", &addr, &n );
                     pbuf += n;
                     
@@ -529,7 +689,12 @@ static void readlist( const char *listfile, struct params *params )
                     /* If user has provided an optional name for this entity then
                      * store it in the xref database.
                      */
-                    if ( !*pbuf )
+                    label = xref_findaddrlabel( addr );
+                    
+                    /* ...or keep the label the address already has */
+                    if ( !*pbuf && label )
+                        strcpy( pbuf, label );
+                    else if ( !*pbuf )
                     {
                         static struct {
                             char *pfx;
@@ -551,7 +716,7 @@ static void readlist( const char *listfile, struct params *params )
                     }
                     
                     /* Add a cross-ref entry for everything except an end entry */
-                    if ( cmd != 'e' )
+                    if ( cmd != 'e' && !( label && !strcmp( label, pbuf ) ) )
                         xref_addxreflabel( addr, pbuf );
 
                     addlist( &(params->cmdlist), 
@@ -582,6 +747,22 @@ static void readlist( const char *listfile, struct params *params )
                 sscanf( pbuf, "%x", &string_terminator );
                 break;
 
+            case 'o':   /* Decoder mode */
+                {
+                    sscanf( pbuf, "%x%n", &addr, &n );
+                    pbuf += n;
+                    
+                    SKIP_SPACE(pbuf);
+                    for ( q = pbuf; *q && !isspace( *q ); q++ )
+                        ;
+                    *q = '\0';
+                    
+                    if ( !dasm_set_mode( addr, pbuf ) )
+                        error( "%s(%u) :: Unknown mode \"%s\" for %s", 
+                               listfile, lineno, pbuf, dasm_name );
+                }
+                break;
+
            case 'l':   /* Define xref code label */
            case 'd':   /* Define xref data label */
                 {
@@ -664,60 +845,883 @@ static void readlist( const char *listfile, struct params *params )
                 }
                 break;
 
-            default: /* Unknown command */
-                {
-                    if ( isprint( cmd ) )
-                        error( "%s(%u) :: Unknown command code '%d'\n", listfile, lineno, cmd );
-                    else
-                        error( "%s :: Illegal character in command file - is this a binary file?\n", listfile );
-                }
+            default: /* Unknown command */
+                {
+                    if ( isprint( cmd ) )
+                        error( "%s(%u) :: Unknown command code '%d'\n", listfile, lineno, cmd );
+                    else
+                        error( "%s :: Illegal character in command file - is this a binary file?\n", listfile );
+                }
+                break;
+            }   /* switch */
+        }
+        else    /* is LINE_NOTE */
+        {
+            /* Note mode is terminated by a line starting with '.' */
+            if ( *pbuf == '.' )
+            {
+                linemode = LINE_CMD;
+                addcomment( &blockcmt, addr, notebuf );
+            }
+            else
+            {
+                size_t len = MIN( strlen( pbuf ), NOTE_BUF_SIZE - notelength );
+                strncat( notebuf, pbuf, len );
+            }
+        }
+    }
+
+    fclose( f );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      usage
+ *
+ * DESCRIPTION
+ *      prints out usage info for user.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void usage( void )
+{
+    printf( "%s -- %s Disassembler --\n"
+            "Usage:\n"
+            "  %s [options] listfile\n"
+            "\n"
+            "  options:\n"
+            "     -h        print helpful usage information\n"
+            "     -x        with cross-reference list\n"
+            "     -u        with register read and write counts\n"
+            "     -o foo    write output to `foo' (stdout is default)\n"
+            "     -i foo    read input from `foo' (`-' for stdin)\n"
+            "     -j        write JSON Lines records instead of listing\n"
+            "     -b        write binary records instead of listing\n"
+            "     -a        write assembler source instead of listing\n"
+            "     -g foo    write control flow graph to `foo' (dot)\n"
+            "     -p        find procedures from calls and returns\n"
+            "     -c foo    write call graph to `foo' (dot)\n"
+            "     -t        resolve jump tables\n"
+            "     -r        resolve references through pointer registers\n"
+            "     -d foo    write proposed data segments to `foo'\n"
+            "     -s pat    search for byte pattern `pat' (`@foo' reads file)\n"
+            "     -q query  list instructions matching `query'\n"
+            "     -w foo    add procedure signatures to database `foo'\n"
+            "     -m foo    name procedures from signature database `foo'\n"
+            "     -M foo    write procedure map to `foo'\n"
+            "     -D foo    diff procedures against procedure map `foo'\n"
+            "     -e foo    export analysis as command file `foo'\n",
+            dasm_name, dasm_description, dasm_name );
+    exit(EXIT_FAILURE);
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      open_input
+ *
+ * DESCRIPTION
+ *      Opens the input file, or standard input if the name
+ *       is "-".  The input is only ever read forwards, so it
+ *       may be a pipe.
+ *      *length is set to the size of a regular file, or -1
+ *       if the size is not known in advance.
+ *
+ * RETURNS
+ *      input stream
+ *
+ ************************************************************/
+
+static FILE * open_input( const char *inputfile, long *length )
+{
+    struct stat st;
+    FILE *f;
+    
+    if ( !strcmp( inputfile, "-" ) )
+        f = stdin;
+    else
+        f = fopen( inputfile, "rb" );
+        
+    if ( !f )
+        error( "Failed to open input file" );
+        
+    if ( fstat( fileno( f ), &st ) == 0 && S_ISREG( st.st_mode ) )
+        *length = (long)st.st_size;
+    else
+        *length = -1;
+        
+    return f;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      spool_input
+ *
+ * DESCRIPTION
+ *      Copies a stream to a temporary file so that it can
+ *       be read more than once.
+ *
+ * RETURNS
+ *      temporary file, positioned at its start
+ *
+ ************************************************************/
+
+static FILE * spool_input( FILE *f )
+{
+    char buf[4096];
+    size_t n;
+    FILE *tmp = tmpfile();
+    
+    if ( !tmp )
+        error( "Failed to create temporary file" );
+        
+    while ( ( n = fread( buf, 1, sizeof( buf ), f ) ) > 0 )
+        if ( fwrite( buf, 1, n, tmp ) != n )
+            error( "Failed to write temporary file" );
+            
+    if ( ferror( f ) )
+        error( "Failed to read input file" );
+        
+    fclose( f );
+    rewind( tmp );
+    
+    return tmp;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      add_data_operand
+ *
+ * DESCRIPTION
+ *      Appends a value to a data item's operand list.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void add_data_operand( insn_t *insn, OPND_TYPE type, const char *fmt, 
+                              int value, XREF_TYPE xtype, int flags )
+{
+    operand_t *op = &insn->operands[insn->n_operands++];
+    
+    op->type  = type;
+    op->fmt   = fmt;
+    op->value = value;
+    op->ref   = value;
+    op->xtype = xtype;
+    op->flags = flags;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      read_data_item
+ *
+ * DESCRIPTION
+ *      Reads one data item (the contents of one line of the
+ *       listing) from a data segment ending at end.
+ *      buf receives up to bufsize raw bytes.  Table xrefs are
+ *       only recorded if want_xrefs is set.
+ *
+ * RETURNS
+ *      address of next input byte
+ *
+ ************************************************************/
+
+static ADDR read_data_item( FILE *f, struct fmt *seg, ADDR addr, ADDR end,
+                            insn_t *insn, UBYTE *buf, unsigned int bufsize,
+                            unsigned int *n_bytes, int want_xrefs )
+{
+    unsigned int n = 0;
+    int c, w, b_1st, b_2nd;
+    
+    memset( insn, 0, sizeof( *insn ) );
+    insn->addr   = addr;
+    insn->opcode = "DB";
+    
+    switch ( seg->mode )
+    {
+    case BYTES:
+        while ( addr < end && n < seg->bpl )
+        {
+            buf[n] = next( f, &addr );
+            add_data_operand( insn, OPND_IMM, "%02X", buf[n++], X_NONE, 0 );
+        }
+        break;
+        
+    case STRINGS:
+        while ( ( c = next( f, &addr ) ) )
+        {
+            if ( n < bufsize )
+                buf[n] = c;
+            n++;
+            if ( c == string_terminator )
+                break;
+        }
+        if ( c == 0 && n < bufsize )
+            buf[n++] = 0;
+        break;
+        
+    case WORDS:
+    case VECTORS:
+        insn->opcode = "DW";
+        do {
+            b_1st = buf[n++] = next( f, &addr );
+            b_2nd = buf[n++] = next( f, &addr );
+
+            if ( dasm_word_msb_first )
+                SWAP( b_1st, b_2nd );
+
+            w = b_1st | ( b_2nd << 8 );
+            if ( want_xrefs )
+                xref_addxref( X_TABLE, addr - 2, w );
+            
+            if ( seg->mode == VECTORS )
+                add_data_operand( insn, OPND_ADDR, "%04X", w, X_TABLE, OPF_LABEL );
+            else
+                add_data_operand( insn, OPND_IMM, "%04X", w, X_TABLE, 0 );
+        } while ( seg->mode == WORDS && addr < end && n < 16 );
+        break;
+        
+    case CHARS:
+        while ( addr < end && n < 8 )
+        {
+            buf[n] = next( f, &addr );
+            add_data_operand( insn, OPND_IMM, isprint( buf[n] ) ? "'%c'" : "%02X", 
+                              buf[n], X_NONE, 0 );
+            n++;
+        }
+        break;
+        
+    case BITMAPS:
+        buf[n] = next( f, &addr );
+        add_data_operand( insn, OPND_IMM, "%02X", buf[n++], X_NONE, 0 );
+        break;
+    }
+    
+    insn->length = addr - insn->addr;
+    *n_bytes     = MIN( n, bufsize );
+    
+    return addr;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      walk_records
+ *
+ * DESCRIPTION
+ *      Walks the segments of the input in the same way as
+ *       run_disasm(), passing one record per instruction or
+ *       data item to emit.  Xrefs are only recorded if
+ *       want_xrefs is set.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+#define MAX_DATA_ITEM       ( 1024 )
+
+static void walk_records( FILE *f, struct fmt *clist, 
+                          void (*emit)( const record_t * ), int want_xrefs )
+{
+    ADDR  addr;
+    int   prevmode = -1;
+    insn_t   insn;
+    record_t rec;
+    UBYTE buf[MAX_DATA_ITEM];
+    static const REC_KIND kinds[] = {
+        REC_CODE, REC_BYTES, REC_STRING, REC_CODE, REC_WORDS,
+        REC_CHARS, REC_CODE, REC_VECTOR, REC_BITMAP
+    };
+    
+    dasm_begin_walk();
+    
+    for ( addr = clist->addr; clist->n && clist->mode != END; clist = clist->n )
+    {
+        ADDR end = clist->n->addr;
+        const char *proc = ( clist->mode == PROCS ) ? clist->name : NULL;
+        int mode = ( clist->mode == PROCS ) ? CODE : clist->mode;
+        int segment = ( mode != prevmode );
+        
+        prevmode = mode;
+        
+        while ( addr < end )
+        {
+            memset( &rec, 0, sizeof( rec ) );
+            rec.kind    = kinds[clist->mode];
+            rec.insn    = &insn;
+            rec.label   = xref_findaddrlabel( addr );
+            rec.note    = findcomment( blockcmt, addr );
+            rec.segment = segment;
+            segment = 0;
+            
+            if ( rec.kind == REC_CODE )
+            {
+                insn_byte_idx = 0;
+                addr = dasm_decode( f, &insn, addr );
+                if ( want_xrefs )
+                    dasm_addxrefs( &insn );
+                
+                rec.bytes   = insn_byte_buffer;
+                rec.n_bytes = insn_byte_idx;
+                rec.comment = findcomment( linecmt, insn.addr );
+                if ( !rec.comment && insn.note[0] )
+                    rec.comment = insn.note;
+                rec.proc    = proc ? proc : cfg_proc_name( insn.addr );
+                proc = NULL;
+            }
+            else
+            {
+                addr = read_data_item( f, clist, addr, end, &insn, 
+                                       buf, sizeof( buf ), &rec.n_bytes,
+                                       want_xrefs );
+                rec.bytes   = buf;
+                rec.comment = findcomment( linecmt, insn.addr );
+            }
+            
+            emit( &rec );
+        }
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      write_graph
+ *
+ * DESCRIPTION
+ *      Writes a graph to the named file.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void write_graph( const char *graphfile, void (*write)( FILE * ) )
+{
+    FILE *fp = fopen( graphfile, "w" );
+    
+    if ( !fp )
+        error( "Failed to open graph file `%s'", graphfile );
+        
+    write( fp );
+    fclose( fp );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      scan_tables
+ *
+ * DESCRIPTION
+ *      Scan pass for both the flow graph and jump tables.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void scan_tables( const record_t *rec )
+{
+    cfg_scan( rec );
+    jt_scan( rec );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      scan_procs
+ *
+ * DESCRIPTION
+ *      Scan pass for procedure signatures and the procedure
+ *       map.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void scan_procs( const record_t *rec )
+{
+    sig_scan( rec );
+    diff_scan( rec );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      mark_segment
+ *
+ * DESCRIPTION
+ *      Lists part of a code segment, from start up to end,
+ *       as data of the given mode.  Segments of data and
+ *       ranges crossing into the next segment are left as
+ *       they are.
+ *
+ * RETURNS
+ *      non-zero if the segment list was changed
+ *
+ ************************************************************/
+
+static int mark_segment( struct fmt *list, ADDR start, ADDR end, int mode, 
+                         char *name )
+{
+    struct fmt *p = list;
+    
+    while ( p->n && p->n->addr <= start )
+        p = p->n;
+        
+    if ( !p->n || p->addr > start || end > p->n->addr
+         || ( p->mode != CODE && p->mode != PROCS ) )
+        return 0;
+        
+    if ( end < p->n->addr )
+        addlist( &list, end, CODE, p->bpl, NULL );
+        
+    if ( p->addr == start )
+        p->mode = mode;
+    else
+        addlist( &list, start, mode, BYTES_PER_LINE, name );
+        
+    return 1;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      mark_table
+ *
+ * DESCRIPTION
+ *      Called for each jump table found: notes the table in
+ *       a comment on the jump, and lists tables of addresses
+ *       as vectors and tables of page offsets as bytes.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void mark_table( const jump_table_t *jt )
+{
+    char buf[128];
+    char *label = xref_findaddrlabel( jt->table );
+    ADDR end = jt->table + jt->n_entries * jt->entry_size;
+    
+    if ( !findcomment( linecmt, jt->jump ) )
+    {
+        sprintf( buf, "jump table %s, %u entr%s", label,
+                 jt->n_entries, jt->n_entries == 1 ? "y" : "ies" );
+        addcomment( &linecmt, jt->jump, buf );
+    }
+    
+    if ( jt->kind == TABLE_WORDS )
+        resegmented |= mark_segment( table_list, jt->table, end, VECTORS, label );
+    else if ( jt->kind == TABLE_PAGE )
+        resegmented |= mark_segment( table_list, jt->table, end, BYTES, label );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      mark_ref
+ *
+ * DESCRIPTION
+ *      Notes the address that a pointer register was found to
+ *       hold in a comment on the instruction using it.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void mark_ref( ADDR addr, const char *reg, ADDR value )
+{
+    char buf[128];
+    const char *label;
+    ADDR base;
+    
+    if ( findcomment( linecmt, addr ) )
+        return;
+        
+    label = xref_nearestlabel( value, &base );
+    if ( label && base == value )
+        sprintf( buf, "%s -> %s", reg, label );
+    else if ( label && value - base < NEAR_LABEL )
+        sprintf( buf, "%s -> %s+%X", reg, label, (unsigned int)( value - base ) );
+    else
+        sprintf( buf, "%s -> " FORMAT_ADDR, reg, value );
+    addcomment( &linecmt, addr, buf );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      classify_data
+ *
+ * DESCRIPTION
+ *      Writes proposed segments for each byte segment to the
+ *       data command file.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void classify_data( FILE *f, struct params params )
+{
+    FILE *fp = fopen( params.datafile, "w" );
+    struct fmt *p;
+    
+    if ( !fp )
+        error( "Failed to open data command file `%s'", params.datafile );
+        
+    classify_begin( f, params.cmdlist->addr, string_terminator, fp );
+    
+    for ( p = params.cmdlist; p->n; p = p->n )
+        if ( p->mode == BYTES )
+            classify_region( p->addr, p->n->addr, p->bpl );
+            
+    classify_end();
+    fclose( fp );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      export_proc
+ *
+ * DESCRIPTION
+ *      cfg_foreach_proc() callback collecting the procedures
+ *       for export_commands().
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static ADDR *export_procs = NULL;
+static unsigned int n_export_procs = 0, max_export_procs = 0;
+
+static void export_proc( ADDR addr, const char *name )
+{
+    export_procs = grow( export_procs, n_export_procs, &max_export_procs, sizeof( ADDR ) );
+    
+    export_procs[n_export_procs++] = addr;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      export_label
+ *
+ * DESCRIPTION
+ *      xref_foreach() callback writing an l command for each
+ *       label not already given by a segment or p command.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static FILE *export_fp;
+static struct fmt *export_list;
+
+static void export_label( ADDR ref, const char *label, unsigned int types )
+{
+    static struct fmt *p = NULL;
+    static unsigned int k = 0;
+    
+    if ( !label )
+        return;
+        
+    /* Labels come in address order, as do segments and procedures */
+    for ( p = p ? p : export_list; p->n && p->addr < ref; p = p->n )
+        ;
+    while ( k < n_export_procs && export_procs[k] < ref )
+        k++;
+        
+    if ( ( p->addr == ref && p->mode != END ) 
+         || ( k < n_export_procs && export_procs[k] == ref ) )
+        return;
+        
+    fprintf( export_fp, "l" FORMAT_ADDR " %s\n", ref, label );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      export_mode
+ *
+ * DESCRIPTION
+ *      dasm_foreach_mode() callback writing an o command for
+ *       each decoder mode selected.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void export_mode( ADDR addr, const char *name )
+{
+    fprintf( export_fp, "o" FORMAT_ADDR " %s\n", addr, name );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      export_commands
+ *
+ * DESCRIPTION
+ *      Writes what is known of the input as a command file:
+ *       the segments, including those made for jump tables,
+ *       the procedures, the labels and the comments.  Loading
+ *       it gives the same listing without the analysis.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void export_commands( struct params params )
+{
+    FILE *fp = fopen( params.exportfile, "w" );
+    struct fmt *p;
+    struct comment *c;
+    unsigned int k = 0;
+    
+    if ( !fp )
+        error( "Failed to open export command file `%s'", params.exportfile );
+        
+    fprintf( fp, "# %s commands for `%s', exported from `%s'\n\n", 
+             dasm_name, params.inputfile, params.listfile );
+    fprintf( fp, "f%s\n", params.inputfile );
+    if ( string_terminator )
+        fprintf( fp, "t%02X\n", string_terminator );
+    if ( pagination )
+    {
+        fprintf( fp, "q,%d", pagination + PAGINATION_ALLOWANCE );
+        if ( page_title && page_title != params.inputfile )
+            fprintf( fp, " \"%s\"", page_title );
+        fputc( '\n', fp );
+    }
+    
+    export_fp = fp;
+    dasm_foreach_mode( export_mode );
+    
+    /* Segments, with the procedures in them */
+    n_export_procs = 0;
+    cfg_foreach_proc( export_proc );
+    fputc( '\n', fp );
+    
+    for ( p = params.cmdlist; p; p = p->n )
+    {
+        const char *label = xref_findaddrlabel( p->addr );
+        
+        for ( ; k < n_export_procs && export_procs[k] < p->addr; k++ )
+            fprintf( fp, "p" FORMAT_ADDR " %s\n", export_procs[k], 
+                     cfg_proc_name( export_procs[k] ) );
+        if ( p->mode == CODE && k < n_export_procs && export_procs[k] == p->addr )
+        {
+            /* A procedure at the start of a code segment stands for both */
+            fprintf( fp, "p" FORMAT_ADDR " %s\n", p->addr, cfg_proc_name( p->addr ) );
+            k++;
+            continue;
+        }
+        
+        fprintf( fp, "%c" FORMAT_ADDR, datchars[p->mode], p->addr );
+        if ( p->mode == BYTES && p->bpl != BYTES_PER_LINE )
+            fprintf( fp, ",%u", p->bpl );
+        if ( p->mode != END && label )
+            fprintf( fp, " %s", label );
+        else if ( p->mode != END )
+        {
+            /* Name it, or it would be given the next generated name of
+               its kind, which may already be in use */
+            fprintf( fp, " " GEN_LABEL_PREFIX "SEG_" FORMAT_ADDR, p->addr );
+        }
+        fputc( '\n', fp );
+        
+        if ( p->mode == PROCS && k < n_export_procs && export_procs[k] == p->addr )
+            k++;
+    }
+    
+    /* Other labels */
+    fputc( '\n', fp );
+    export_fp   = fp;
+    export_list = params.cmdlist;
+    xref_foreach( export_label );
+    
+    /* Comments */
+    fputc( '\n', fp );
+    for ( c = linecmt; c; c = c->next )
+        if ( c->text )
+            fprintf( fp, "k" FORMAT_ADDR " %s\n", c->ref, c->text );
+    for ( c = blockcmt; c; c = c->next )
+        if ( c->text )
+            fprintf( fp, "n" FORMAT_ADDR "\n%s%s.\n", c->ref, c->text,
+                     ( *c->text && c->text[strlen( c->text ) - 1] == '\n' ) ? "" : "\n" );
+            
+    if ( fclose( fp ) )
+        error( "Failed to write export command file `%s'", params.exportfile );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      prepare_input
+ *
+ * DESCRIPTION
+ *      Opens the input for the output passes, first running
+ *       any pass that must see the whole image: the flow and
+ *       call graph scan, and the label scan for assembler
+ *       source.  If the input cannot be rewound for a later
+ *       pass it is spooled to a temporary file.
+ *      *length is set as for open_input().
+ *
+ * RETURNS
+ *      input stream, positioned at its start
+ *
+ ************************************************************/
+
+static FILE * prepare_input( struct params params, long *length )
+{
+    int want_cfg = params.graphfile || params.callgraphfile 
+                   || params.infer_procs || params.resolve_tables
+                   || params.track_regs
+                   || params.datafile || params.sigwrite || params.sigmatch
+                   || params.mapfile || params.difffile;
+    int want_sigs = params.sigwrite || params.sigmatch 
+                    || params.mapfile || params.difffile;
+    int pass;
+    FILE *f;
+    
+    f = open_input( params.inputfile, length );
+    
+    if ( *length < 0 && ( want_cfg || params.format == REC_FORMAT_ASM ) )
+        f = spool_input( f );
+        
+    if ( want_cfg )
+    {
+        walk_records( f, params.cmdlist, 
+                      params.resolve_tables ? scan_tables : cfg_scan, 0 );
+        
+        /* Listing a table as data changes what follows it, so rescan */
+        table_list = params.cmdlist;
+        for ( pass = 0; params.resolve_tables && pass < MAX_TABLE_PASSES; pass++ )
+        {
+            resegmented = 0;
+            if ( !jt_resolve( f, params.cmdlist->addr, mark_table ) || !resegmented )
                 break;
-            }   /* switch */
+                
+            cfg_reset();
+            rewind( f );
+            walk_records( f, params.cmdlist, scan_tables, 0 );
         }
-        else    /* is LINE_NOTE */
+        
+        cfg_build( params.infer_procs || want_sigs );
+        rewind( f );
+        
+        /* Name the procedures before anything shows their names */
+        if ( want_sigs )
         {
-            /* Note mode is terminated by a line starting with '.' */
-            if ( *pbuf == '.' )
-            {
-                linemode = LINE_CMD;
-                addcomment( &blockcmt, addr, notebuf );
-            }
-            else
-            {
-                size_t len = MIN( strlen( pbuf ), NOTE_BUF_SIZE - notelength );
-                strncat( notebuf, pbuf, len );
-            }
+            walk_records( f, params.cmdlist, scan_procs, 0 );
+            rewind( f );
+            
+            if ( params.sigmatch )
+                sig_match( params.sigmatch );
+            if ( params.sigwrite )
+                sig_write( params.sigwrite );
+            if ( params.mapfile )
+                diff_write_map( params.mapfile );
+        }
+        
+        if ( params.track_regs )
+        {
+            walk_records( f, params.cmdlist, track_scan, 0 );
+            rewind( f );
+            track_resolve( mark_ref );
+        }
+        
+        if ( params.graphfile )
+            write_graph( params.graphfile, cfg_write_dot );
+        if ( params.callgraphfile )
+            write_graph( params.callgraphfile, cfg_write_callgraph );
+        if ( params.datafile )
+        {
+            classify_data( f, params );
+            rewind( f );
         }
     }
-
-    fclose( f );
+    
+    if ( params.exportfile )
+        export_commands( params );
+    
+    if ( params.format == REC_FORMAT_ASM )
+    {
+        walk_records( f, params.cmdlist, asm_scan, 1 );
+        rewind( f );
+    }
+    
+    return f;
 }
 
 /***********************************************************
  *
  * FUNCTION
- *      usage
+ *      proc_banner
  *
  * DESCRIPTION
- *      prints out usage info for user.
+ *      Prints the banner at the start of a procedure, unless
+ *       it has a block comment of its own.  The banner shows
+ *       what is known of the procedure from the flow and call
+ *       graphs.
  *
  * RETURNS
  *      nothing
  *
  ************************************************************/
 
-static void usage( void )
+static void proc_banner( const struct params *params, const char *name, ADDR addr )
 {
-    printf( "%s -- %s Disassembler --\n"
-            "Usage:\n"
-            "  %s [options] listfile\n"
-            "\n"
-            "  options:\n"
-            "     -h        print helpful usage information\n"
-            "     -x        with cross-reference list\n"
-            "     -o foo    write output to `foo' (stdout is default)\n",
-            dasm_name, dasm_description, dasm_name );
-    exit(EXIT_FAILURE);
+    proc_info_t info;
+    
+    if ( commentexists( blockcmt, addr ) )
+        return;
+        
+    printf( "----------------------------------------------------------------" );
+    newline();
+    printf( "        Function: %s", ( name ) ? name : "" );
+    newline();
+    
+    if ( cfg_proc_info( addr, &info ) )
+    {
+        if ( params->graphfile )
+        {
+            printf( "        Basic blocks: %u", info.n_blocks );
+            newline();
+        }
+        if ( params->infer_procs )
+        {
+            printf( "        Size: %u byte%s, called from %u site%s by %u caller%s, "
+                    "%u callee%s%s",
+                    info.size, info.size == 1 ? "" : "s",
+                    info.n_sites, info.n_sites == 1 ? "" : "s", 
+                    info.n_callers, info.n_callers == 1 ? "" : "s",
+                    info.n_callees, info.n_callees == 1 ? "" : "s",
+                    info.recursive ? ", recursive" : "" );
+            newline();
+        }
+    }
+    newline();
 }
 
 /***********************************************************
@@ -744,13 +1748,7 @@ static void run_disasm( struct params params )
     unsigned int bpl;
     char *name;
     
-    f = fopen( inputfile, "rb" );
-    if ( !f )
-        error( "Failed to open input file" );
-        
-    fseek( f, 0, SEEK_END );
-    filelength = ftell( f );
-    fseek( f, 0, SEEK_SET );
+    f = prepare_input( params, &filelength );
     
     addr  = clist->addr;
     mode  = clist->mode;
@@ -758,11 +1756,16 @@ static void run_disasm( struct params params )
     bpl   = clist->bpl;
     clist = clist->n;
     
-    printf( ";   Processing \"%s\" (%ld bytes)", inputfile, filelength ); newline();
+    if ( filelength < 0 )
+        printf( ";   Processing \"%s\" (streamed)", inputfile );
+    else
+        printf( ";   Processing \"%s\" (%ld bytes)", inputfile, filelength ); 
+    newline();
     printf( ";   Disassembly start address: 0x%04X", addr );              newline();
     printf( ";   String terminator: 0x%02x", string_terminator );         newline();
     newline();
 
+    dasm_begin_walk();
     while ( !feof( f ) && clist )
     {
         if ( addr >= clist->addr )
@@ -786,6 +1789,15 @@ static void run_disasm( struct params params )
             int column, i;
             ADDR lineaddr;
             char insnbuf[256];
+            insn_t insn;
+            proc_info_t info;
+            
+            if ( params.infer_procs && cfg_proc_info( addr, &info ) 
+                 && !info.named )
+            {
+                newline();
+                proc_banner( &params, info.name, addr );
+            }
 
             printcomment( blockcmt, addr, 0 );
 
@@ -793,9 +1805,14 @@ static void run_disasm( struct params params )
             lineaddr = addr;
             insn_byte_idx = 0;
 
-            addr = dasm_insn( f, insnbuf, addr );
+            addr = dasm_decode( f, &insn, addr );
+            if ( params.want_xref )
+                dasm_addxrefs( &insn );
+            if ( params.want_regs )
+                dasm_addaccesses( &insn );
+            dasm_format( &insn, insnbuf );
 
-            for ( i = 0; i < dasm_max_insn_length; i++ )
+            for ( i = 0; i < dasm_max_insn_length || i < insn_byte_idx; i++ )
                 if ( i < insn_byte_idx )
                     printf( "%02X ", insn_byte_buffer[i] );
                 else
@@ -806,7 +1823,9 @@ static void run_disasm( struct params params )
             i = printf("%s", insnbuf );
             column += i;
 
-            printcomment( linecmt, lineaddr, COL_LINECOMMENT - column );
+            if ( !printcomment( linecmt, lineaddr, COL_LINECOMMENT - column )
+                 && insn.note[0] )
+                printf( "%*s %s", COL_LINECOMMENT - column, COMMENT_DELIM, insn.note );
             newline();
         }
         else if ( mode == BYTES )
@@ -937,7 +1956,8 @@ static void run_disasm( struct params params )
                 w = b_1st | ( b_2nd << 8 );
 
                 printf( "%04X ", w );
-                xref_addxref( X_TABLE, addr - 2, w );
+                if ( params.want_xref )
+                    xref_addxref( X_TABLE, addr - 2, w );
 
                 if ( ( i & 7 ) == 7 )
                     newline();
@@ -960,6 +1980,7 @@ static void run_disasm( struct params params )
             *****************************************************************/
 
             int v, b_1st, b_2nd, i = 0;
+            char vbuf[32];
             
             newline();
             printcomment( blockcmt, addr, 0 );
@@ -977,8 +1998,9 @@ static void run_disasm( struct params params )
 
                 v = b_1st | ( b_2nd << 8 );
 
-                printf( "%s", xref_genwordaddr( NULL, "%04X", v ) ); newline();
-                xref_addxref( X_TABLE, addr - 2, v );
+                printf( "%s", xref_genwordaddr( vbuf, "%04X", v ) ); newline();
+                if ( params.want_xref )
+                    xref_addxref( X_TABLE, addr - 2, v );
 
                 i++;
             }
@@ -1044,13 +2066,7 @@ static void run_disasm( struct params params )
             *            p - PROCS
             *****************************************************************/
 
-            if ( !commentexists( blockcmt, addr ) )
-            {
-                printf( "----------------------------------------------------------------" );
-                newline();
-                printf( "        Function: %s", ( name ) ? name : "" );
-                newline(); newline();
-            }
+            proc_banner( &params, name, addr );
 
             mode = CODE;
         }
@@ -1092,6 +2108,119 @@ static void run_disasm( struct params params )
     fclose( f );
 }
 
+/***********************************************************
+ *
+ * FUNCTION
+ *      run_records
+ *
+ * DESCRIPTION
+ *      Run a complete disassembly pass on the input, writing
+ *       one output record per instruction or data item in
+ *       place of the text listing.
+ *      Assembler source needs every label target before any
+ *       output, so it is preceded by a scan pass (see
+ *       prepare_input).
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void run_records( struct params params )
+{
+    FILE *f;
+    long  filelength;
+    
+    f = prepare_input( params, &filelength );
+        
+    record_begin( params.format );
+    walk_records( f, params.cmdlist, record_emit, 0 );
+    record_end();
+    
+    fclose( f );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      run_search
+ *
+ * DESCRIPTION
+ *      Searches the input for the -s patterns, after the
+ *       usual scan so that the matches can be placed by the
+ *       labels it finds.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void run_search( struct params params )
+{
+    FILE *f;
+    long  filelength;
+    
+    f = prepare_input( params, &filelength );
+    
+    search_run( f, params.cmdlist->addr );
+    
+    fclose( f );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      run_diff
+ *
+ * DESCRIPTION
+ *      Compares the procedures of the input with the -D
+ *       procedure map.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void run_diff( struct params params )
+{
+    FILE *f;
+    long  filelength;
+    
+    f = prepare_input( params, &filelength );
+    
+    diff_report( params.difffile );
+    
+    fclose( f );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      run_query
+ *
+ * DESCRIPTION
+ *      Lists the instructions matching the -q query.  Only
+ *       the matches are formatted.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void run_query( struct params params )
+{
+    FILE *f;
+    long  filelength;
+    
+    f = prepare_input( params, &filelength );
+    
+    query_begin();
+    walk_records( f, params.cmdlist, query_record, 0 );
+    query_end();
+    
+    fclose( f );
+}
+
 /***********************************************************
  *
  * FUNCTION
@@ -1106,7 +2235,7 @@ static void run_disasm( struct params params )
  *
  ************************************************************/
 
-#define OPTSTRING        "xho:"
+#define OPTSTRING        "xuho:i:jbag:pc:trd:s:q:w:m:M:D:e:"
 
 static struct params process_args( int argc, char **argv )
 {
@@ -1123,10 +2252,87 @@ static struct params process_args( int argc, char **argv )
             params.want_xref = 1;
             break;
          
+        case 'u':
+            params.want_regs = 1;
+            break;
+         
         case 'o':
             params.outputfile = (const char*)dupstr(optarg);
             break;
          
+        case 'i':
+            params.inputoverride = (const char*)dupstr(optarg);
+            break;
+         
+        case 'j':
+            params.format = REC_FORMAT_JSON;
+            break;
+         
+        case 'b':
+            params.format = REC_FORMAT_BINARY;
+            break;
+         
+        case 'a':
+            params.format = REC_FORMAT_ASM;
+            break;
+         
+        case 'g':
+            params.graphfile = (const char*)dupstr(optarg);
+            break;
+         
+        case 'p':
+            params.infer_procs = 1;
+            break;
+         
+        case 'c':
+            params.callgraphfile = (const char*)dupstr(optarg);
+            break;
+         
+        case 't':
+            params.resolve_tables = 1;
+            break;
+         
+        case 'r':
+            params.track_regs = 1;
+            break;
+         
+        case 'd':
+            params.datafile = (const char*)dupstr(optarg);
+            break;
+         
+        case 's':
+            if ( optarg[0] == '@' )
+                search_add_file( optarg + 1 );
+            else
+                search_add( optarg );
+            params.search = 1;
+            break;
+         
+        case 'q':
+            query_set( optarg );
+            params.query = 1;
+            break;
+         
+        case 'w':
+            params.sigwrite = (const char*)dupstr(optarg);
+            break;
+         
+        case 'm':
+            params.sigmatch = (const char*)dupstr(optarg);
+            break;
+         
+        case 'M':
+            params.mapfile = (const char*)dupstr(optarg);
+            break;
+         
+        case 'D':
+            params.difffile = (const char*)dupstr(optarg);
+            break;
+         
+        case 'e':
+            params.exportfile = (const char*)dupstr(optarg);
+            break;
+         
         case 'h':
             usage();
             break;
@@ -1158,7 +2364,7 @@ static struct params process_args( int argc, char **argv )
 
 static void display_banner( struct params params )
 {
-    char *prefix = params.outputfile ? ";" : "";
+    char *prefix = ( params.outputfile && strcmp( params.outputfile, "-" ) ) ? ";" : "";
     
     printf( "%s   %s -- %s Disassembler --", prefix, dasm_name, dasm_description ); newline();
     printf( "%s" SPACER, prefix ); 
@@ -1247,6 +2453,34 @@ void *zalloc( size_t n )
     return p;
 }
 
+/***********************************************************
+ *
+ * FUNCTION
+ *      grow
+ *
+ * DESCRIPTION
+ *      Makes room for one more element in an array of n 
+ *       elements of the given size, doubling it when full.
+ *       *max is the number of elements it has room for.
+ *
+ * RETURNS
+ *      the array, perhaps moved
+ *
+ ************************************************************/
+
+void * grow( void *array, unsigned int n, unsigned int *max, size_t size )
+{
+    if ( n < *max )
+        return array;
+        
+    *max  = *max ? *max * 2 : 256;
+    array = realloc( array, *max * size );
+    if ( !array )
+        error( "Out of memory" );
+        
+    return array;
+}
+
 /***********************************************************
  *
  * FUNCTION
@@ -1276,6 +2510,8 @@ char * dupstr( const char *s )
  *
  * DESCRIPTION
  *      Gets the next byte from the file stream.  If EOF then abort.
+ *      The stream is only ever read by this thread, so it is read
+ *      without locking.
  *
  * RETURNS
  *      next byte in fp
@@ -1286,11 +2522,11 @@ UBYTE next( FILE* fp, ADDR *addr )
 {
     int c;
     
-    c = fgetc( fp );
+    c = getc_unlocked( fp );
     if ( c == EOF )
         error( "Ran past end of input file" );
         
-    if ( insn_byte_idx < dasm_max_insn_length )
+    if ( insn_byte_idx < INSN_BYTES_MAX )
         insn_byte_buffer[insn_byte_idx++] = (UBYTE)c;
     
     (*addr)++;
@@ -1319,18 +2555,18 @@ UWORD nextw( FILE* fp, ADDR *addr )
     int lo, hi;
     UWORD w = 0;
     
-    lo = fgetc( fp );
+    lo = getc_unlocked( fp );
     if ( lo == EOF )
         error( "Ran past end of input file" );
         
-    hi = fgetc( fp );
+    hi = getc_unlocked( fp );
     if ( hi == EOF )
         error( "Ran past end of input file" );    
         
-    if ( insn_byte_idx < dasm_max_insn_length )
+    if ( insn_byte_idx < INSN_BYTES_MAX )
         insn_byte_buffer[insn_byte_idx++] = (UBYTE)hi;
         
-    if ( insn_byte_idx < dasm_max_insn_length )
+    if ( insn_byte_idx < INSN_BYTES_MAX )
         insn_byte_buffer[insn_byte_idx++] = (UBYTE)lo;
     
     (*addr)++;
@@ -1392,6 +2628,9 @@ int main(int argc, char **argv)
     /* Process first arg: listfile */
     readlist( params.listfile, &params );
 
+    if ( params.inputoverride )
+        params.inputfile = params.inputoverride;
+
     /* Check things are set up ready to run */
     if ( !params.cmdlist )
         error( "Empty list file" );
@@ -1399,20 +2638,70 @@ int main(int argc, char **argv)
     if ( !params.inputfile )
         error( "No input file specified" );
         
+    if ( params.want_regs && !dasm_regs_size )
+        error( "%s has no register window to count", dasm_description );
+        
     /* Prepare then instruction byte buffer */
-    insn_byte_buffer = zalloc( dasm_max_insn_length );
+    insn_byte_buffer = zalloc( INSN_BYTES_MAX );
     insn_byte_idx = 0;
     
-    if ( params.outputfile )
-        stdout = freopen( params.outputfile, "w", stdout );
+    if ( params.outputfile && strcmp( params.outputfile, "-" ) )
+        if ( !freopen( params.outputfile, 
+                       params.format == REC_FORMAT_BINARY ? "wb" : "w", 
+                       stdout ) )
+            error( "Failed to open output file `%s'", params.outputfile );
 
+    if ( params.difffile )
+    {
+        if ( params.format != REC_FORMAT_TEXT || params.want_xref 
+             || params.want_regs || params.search || params.query )
+            error( "Diff writes a command file and cannot be combined with other reports" );
+            
+        run_diff( params );
+        return EXIT_SUCCESS;
+    }
+    
+    if ( params.search || params.query )
+    {
+        if ( params.format != REC_FORMAT_TEXT || params.want_xref 
+             || params.want_regs )
+            error( "Search and query are only available as text reports" );
+        if ( params.search && params.query )
+            error( "Cannot search and query at the same time" );
+            
+        emit_page_header();
+        display_banner( params );
+        if ( params.search )
+            run_search( params );
+        else
+            run_query( params );
+        return EXIT_SUCCESS;
+    }
+    
+    if ( params.format != REC_FORMAT_TEXT )
+    {
+        if ( params.want_xref )
+            error( "Cross-reference list is only available in the text listing" );
+        if ( params.want_regs )
+            error( "Register counts are only available in the text listing" );
+            
+        run_records( params );
+        return EXIT_SUCCESS;
+    }
+    
     emit_page_header();
     display_banner( params );
 
     run_disasm( params );
 
+    if ( params.infer_procs )
+        cfg_dump_procs();
+        
     if ( params.want_xref )
         xref_dump();
+        
+    if ( params.want_regs )
+        xref_dumpregs();
 
     return EXIT_SUCCESS;
 }
@@ -67,6 +67,7 @@ typedef UWORD              OPC;
 extern void error( char *fmt, ... );
 extern void warning( char *fmt, ... );
 extern void *zalloc( size_t n );
+extern void * grow( void *array, unsigned int n, unsigned int *max, size_t size );
 extern UBYTE next( FILE* fp, ADDR *addr );
 extern UWORD nextw( FILE *fp, ADDR *addr );
 extern UBYTE peek( FILE *fp );
@@ -92,13 +93,73 @@ typedef enum {
 extern void xref_addxref( XREF_TYPE type, ADDR addr, ADDR ref );
 extern void xref_addxreflabel( ADDR ref, char *label );
 extern char * xref_findaddrlabel( ADDR addr );
+extern const char * xref_nearestlabel( ADDR addr, ADDR *base );
+extern int  xref_findlabeladdr( const char *label, ADDR *addr );
 extern char * xref_genwordaddr( char * buf, const char * format, ADDR addr );
+extern void xref_foreach( void (*fn)( ADDR ref, const char *label, 
+                                      unsigned int types ) );
 extern void xref_dump( void );
+extern void xref_addaccess( ADDR ref, unsigned int reads, unsigned int writes );
+extern void xref_dumpregs( void );
+
+/*****************************************************************************/
+/*                              Decoded Instructions                         */
+/*****************************************************************************/
+
+/* Operand types */
+typedef enum {
+   OPND_TEXT,     /* punctuation or other fixed text     */
+   OPND_REG,      /* register                            */
+   OPND_IMM,      /* immediate value                     */
+   OPND_ADDR,     /* absolute address                    */
+   OPND_REL,      /* relative target, resolved to addr   */
+   OPND_BIT,      /* bit number                          */
+   OPND_DISP,     /* displacement, offset or count       */
+   OPND_COND      /* condition code                      */
+} OPND_TYPE;
+
+/* Operand flags */
+#define OPF_LABEL       ( 0x01 )  /* replace with label of ref if any    */
+#define OPF_LABEL_NEAR  ( 0x02 )  /* ... or with "label+1" of ref-1      */
+
+/**
+    A single operand fragment.  The decoder fills in the value and the
+    format it is to be shown with; nothing is formatted until the
+    instruction is passed to dasm_format().
+**/
+typedef struct {
+   OPND_TYPE    type;
+   XREF_TYPE    xtype;    /* xref to record against ref, or X_NONE   */
+   int          flags;
+   int          value;    /* value passed to fmt                     */
+   ADDR         ref;      /* address used for labels and xrefs       */
+   const char * fmt;      /* printf format, or literal text          */
+} operand_t;
+
+#define MAX_OPERANDS    ( 24 )
+#define MAX_NOTE        ( 64 )
+
+/**
+    A decoded instruction.
+**/
+typedef struct {
+   ADDR         addr;                   /* address of first byte          */
+   unsigned int length;                 /* number of bytes consumed       */
+   const char * opcode;                 /* mnemonic, NULL if not decoded  */
+   int          n_operands;
+   operand_t    operands[MAX_OPERANDS];
+   char         note[MAX_NOTE];         /* decoder's comment, "" if none  */
+} insn_t;
 
 /*****************************************************************************/
 /*                              Disassembler                                 */
 /*****************************************************************************/
 
+extern ADDR dasm_decode( FILE *f, insn_t *insn, ADDR addr );
+extern void dasm_addxrefs( const insn_t *insn );
+extern void dasm_addaccesses( const insn_t *insn );
+extern int  dasm_format( const insn_t *insn, char *outbuf );
+extern int  dasm_format_operand( const operand_t *op, char *outbuf );
 extern ADDR dasm_insn( FILE *f, char * outbuf, ADDR addr );
 extern const char * dasm_name;
 extern const char * dasm_description;
@@ -115,6 +176,401 @@ extern const int    dasm_insn_width_bytes;
     const int    dasm_word_msb_first = msb;       /* 1 if word is MSB first*/ \
     const int    dasm_insn_width_bytes = iwid;    /* Num bytes per opcode  */
 
+/**
+    Assembler dialect used for source output (-a).  Each target names
+    the assembler its output is written for.
+**/
+typedef struct {
+   const char * name;        /* assembler, for the output header        */
+   const char * header;      /* directives before the first ORG or NULL */
+   const char * comment;     /* comment delimiter                       */
+   const char * label;       /* label definition, printf with label     */
+   const char * equ;         /* equate, printf with label and value     */
+   const char * here;        /* location counter symbol                 */
+   const char * org;         /* directives...                           */
+   const char * db;
+   const char * dw;
+   const char * fill;        /* fill, printf with count and value, or
+                                NULL if the assembler cannot fill       */
+   const char * ascii;       /* string directive, or NULL to use db     */
+   char         quote;       /* string delimiter                        */
+   const char * end;         /* end of source directive, or NULL        */
+   const char * hex_prefix;  /* hex numbers are prefix + digits +       */
+   const char * hex_suffix;  /*  suffix                                 */
+   int          short_forms; /* assembler picks short address forms     */
+} asm_syntax_t;
+
+extern const asm_syntax_t dasm_asm_syntax;
+
+#define DASM_SYNTAX(...) \
+    const asm_syntax_t dasm_asm_syntax = { __VA_ARGS__ };
+
+/* ASxxxx cross assemblers (as6500, as6809, as8051, asz80, ...) */
+#define ASXXXX_SYNTAX(M_area, M_short) DASM_SYNTAX( \
+    .name = "ASxxxx", .header = M_area, .comment = ";", \
+    .label = "%s:", .equ = "%s\t=\t%s", .here = ".", \
+    .org = ".org", .db = ".db", .dw = ".dw", .ascii = ".ascii", \
+    .quote = '"', .hex_prefix = "0x", .hex_suffix = "", \
+    .short_forms = M_short )
+
+/* GNU as */
+#define GNU_SYNTAX(M_name) DASM_SYNTAX( \
+    .name = M_name, .comment = ";", \
+    .label = "%s:", .equ = "\t.equ\t%s, %s", .here = ".", \
+    .org = ".org", .db = ".byte", .dw = ".word", \
+    .fill = ".fill\t%u, 1, %s", .ascii = ".ascii", .quote = '"', \
+    .hex_prefix = "0x", .hex_suffix = "" )
+
+/* Intel-style absolute assemblers (ASM48, ASM96, RA78K3, ...) */
+#define INTEL_SYNTAX(M_name, M_db, M_dw, M_short) DASM_SYNTAX( \
+    .name = M_name, .comment = ";", \
+    .label = "%s:", .equ = "%s\tEQU\t%s", .here = "$", \
+    .org = "ORG", .db = M_db, .dw = M_dw, .ascii = M_db, \
+    .quote = '\'', .end = "END", .hex_prefix = "0", .hex_suffix = "H", \
+    .short_forms = M_short )
+
+/**
+    How an instruction affects the flow of control (see cfg.c).  Each
+    target lists the mnemonics that are not classified by their operands
+    alone: unconditional jumps, returns, skips and so on.
+**/
+typedef enum {
+   FLOW_NEXT,     /* continues with the next instruction       */
+   FLOW_BRANCH,   /* conditional branch                        */
+   FLOW_JUMP,     /* unconditional jump                        */
+   FLOW_CALL,     /* subroutine call                           */
+   FLOW_RETURN,   /* return from subroutine or interrupt       */
+   FLOW_SKIP,     /* may skip the next instruction             */
+   FLOW_STOP      /* not decoded; flow does not continue       */
+} FLOW_TYPE;
+
+typedef struct {
+   const char * opcode;      /* mnemonic, any case                      */
+   FLOW_TYPE    flow;
+   int          n_operands;  /* non-text operands to match, -1 for any  */
+} flow_t;
+
+extern const flow_t dasm_flow_table[];
+
+#define DASM_FLOW(...) \
+    const flow_t dasm_flow_table[] = { __VA_ARGS__ { NULL } };
+#define FLOW(M_opcode, M_flow)          { M_opcode, FLOW_##M_flow, -1 },
+#define FLOW_N(M_opcode, M_flow, M_n)   { M_opcode, FLOW_##M_flow, M_n },
+
+/**
+    Processor state that changes how later instructions decode, such as
+    the MCS-48 memory bank flip-flop.  A target keeps each piece of state
+    in an int, changes it when it decodes an instruction that does, and
+    names the values that the 'o' command of the command file may select
+    from an address onwards; a MODE_ARG takes its value from the command
+    instead, as NAME=value in hex.  The state is carried from one
+    instruction to the next and to the targets of jumps and calls further
+    on; code that is only reached from elsewhere, or by paths that
+    disagree, starts from the value last selected, or else the initial
+    value of the target's int (see optab.c).  An instruction that leaves
+    a state unknown, such as one that pulls it off the stack, calls
+    dasm_forget_state() so that it goes back to the default.  A target
+    whose decoder only changes its state once the command file has
+    selected a mode (the Z80 and its derivatives) uses
+    DASM_SELECTED_MODES instead, so that nothing is followed until then.
+    
+    A SETTING is a fixed property of the board rather than state, such
+    as where a bank switching register lives.  The 'o' command gives it
+    as NAME=value in the same way, but it is set as the command file is
+    read and holds for the whole image, wherever the command is.
+**/
+typedef struct {
+   const char * name;        /* e.g. "MB1", any case                    */
+   int *        state;
+   int          value;
+   int          arg;         /* 1 if the value is given with the name   */
+   int          setting;     /* 1 if set once for the whole image       */
+} dasm_mode_t;
+
+extern const dasm_mode_t dasm_mode_table[];
+extern const int         dasm_modes_selected_only;
+
+#define DASM_MODES(...) \
+    const dasm_mode_t dasm_mode_table[] = { __VA_ARGS__ { NULL } }; \
+    const int dasm_modes_selected_only = 0;
+#define DASM_SELECTED_MODES(...) \
+    const dasm_mode_t dasm_mode_table[] = { __VA_ARGS__ { NULL } }; \
+    const int dasm_modes_selected_only = 1;
+#define MODE(M_name, M_state, M_value)  { M_name, &M_state, M_value, 0, 0 },
+#define MODE_ARG(M_name, M_state)       { M_name, &M_state, 0, 1, 0 },
+#define SETTING(M_name, M_var)          { M_name, &M_var, 0, 1, 1 },
+
+extern int  dasm_set_mode( ADDR addr, const char *name );
+extern void dasm_begin_walk( void );
+extern void dasm_forget_state( int *state );
+extern void dasm_foreach_mode( void (*fn)( ADDR addr, const char *name ) );
+
+/*****************************************************************************/
+/*                              Output Records                               */
+/*****************************************************************************/
+
+/* Kinds of record, one per instruction or data item */
+typedef enum {
+   REC_CODE,
+   REC_BYTES,
+   REC_STRING,
+   REC_WORDS,
+   REC_VECTOR,
+   REC_CHARS,
+   REC_BITMAP
+} REC_KIND;
+
+/* Record output formats */
+#define REC_FORMAT_TEXT     ( 0 )    /* normal listing, no records   */
+#define REC_FORMAT_JSON     ( 1 )    /* JSON Lines                   */
+#define REC_FORMAT_BINARY   ( 2 )    /* fixed-width binary records   */
+#define REC_FORMAT_ASM      ( 3 )    /* assembler source             */
+
+/**
+    A single item of output.  Data items use the mnemonic and
+    operands of the insn record for their values (e.g. "DW" and a list
+    of words).
+**/
+typedef struct {
+   REC_KIND       kind;
+   const insn_t * insn;       /* address, length, mnemonic, operands     */
+   const UBYTE  * bytes;      /* raw bytes                               */
+   unsigned int   n_bytes;    /* number of raw bytes, <= insn->length    */
+   const char   * label;      /* label at this address, or NULL          */
+   const char   * comment;    /* line comment, or NULL                   */
+   const char   * note;       /* block comment before item, or NULL      */
+   const char   * proc;       /* procedure name if item starts one       */
+   int            segment;    /* 1 if item starts a command file segment */
+} record_t;
+
+extern void record_begin( int format );
+extern void record_emit( const record_t *rec );
+extern void record_end( void );
+
+extern void asm_scan( const record_t *rec );
+extern void asm_begin( void );
+extern void asm_emit( const record_t *rec );
+extern void asm_end( void );
+
+/*****************************************************************************/
+/*                              Control Flow                                 */
+/*****************************************************************************/
+
+/**
+    Summary of a procedure, from the control flow and call graphs.
+**/
+typedef struct {
+   const char * name;
+   ADDR         addr;
+   unsigned int size;        /* bytes, up to the last return            */
+   unsigned int n_blocks;    /* basic blocks                            */
+   unsigned int n_sites;     /* calls to it                             */
+   unsigned int n_callers;   /* distinct procedures calling it          */
+   unsigned int n_callees;   /* distinct procedures it calls            */
+   int          named;       /* 1 if from a p command                   */
+   int          recursive;   /* 1 if it can call itself                 */
+} proc_info_t;
+
+extern FLOW_TYPE cfg_flow( const insn_t *insn, ADDR *target );
+extern void cfg_scan( const record_t *rec );
+extern void cfg_build( int infer_procs );
+extern const char * cfg_proc_name( ADDR addr );
+extern int  cfg_proc_info( ADDR addr, proc_info_t *info );
+extern int  cfg_proc_rename( ADDR addr, const char *name );
+extern void cfg_dump_procs( void );
+extern void cfg_write_dot( FILE *fp );
+extern void cfg_write_callgraph( FILE *fp );
+extern int  cfg_in_code( ADDR addr, int start );
+extern int  cfg_is_join( ADDR addr );
+extern void cfg_foreach_insn( void (*fn)( ADDR addr, unsigned int length, 
+                                         int entry ) );
+extern void cfg_foreach_proc( void (*fn)( ADDR addr, const char *name ) );
+extern void cfg_reset( void );
+
+/*****************************************************************************/
+/*                              Jump Tables                                  */
+/*****************************************************************************/
+
+/**
+    How the entries of a jump table are laid out.
+**/
+typedef enum {
+   TABLE_WORDS,   /* code addresses, in the target's word order          */
+   TABLE_JUMPS,   /* jump instructions, all of the same length           */
+   TABLE_PAGE,    /* bytes, each the low byte of an address in the page  */
+   TABLE_ANY      /* jumps if the first entry is a jump, else words      */
+} TABLE_KIND;
+
+/**
+    An idiom for a computed jump through a table (see jumptab.c).  Each
+    shape is matched against an instruction as a pattern (e.g.
+    "MOV DPTR,#"), in which '#' matches an immediate operand, '%' any
+    numeric operand, '*' any text, and '|' separates alternatives.
+    The value of the first numeric operand is captured.
+**/
+typedef struct {
+   const char * jump;     /* the indirect jump                           */
+   const char * base;     /* loads the table address, NULL if in jump    */
+   const char * base_hi;  /* loads its high byte, if loaded in halves    */
+   const char * bound;    /* compares the index with the entry count     */
+   TABLE_KIND   kind;
+   int          scale;    /* bytes per unit of the loaded address        */
+} dispatch_t;
+
+extern const dispatch_t dasm_dispatch_table[];
+
+#define DASM_DISPATCH(...) \
+    const dispatch_t dasm_dispatch_table[] = { __VA_ARGS__ { NULL } };
+#define DISPATCH(M_jump, M_base, M_base_hi, M_bound, M_kind, M_scale) \
+    { M_jump, M_base, M_base_hi, M_bound, TABLE_##M_kind, M_scale },
+
+/**
+    A resolved jump table.
+**/
+typedef struct {
+   ADDR           jump;        /* address of the indirect jump          */
+   ADDR           table;       /* address of the first entry            */
+   TABLE_KIND     kind;        /* WORDS, JUMPS or PAGE                  */
+   unsigned int   entry_size;  /* bytes per entry                       */
+   unsigned int   n_entries;
+   ADDR         * targets;     /* destination of each entry             */
+} jump_table_t;
+
+extern void jt_scan( const record_t *rec );
+extern int  jt_resolve( FILE *f, ADDR base, 
+                        void (*found)( const jump_table_t *jt ) );
+extern unsigned int jt_targets( ADDR jump, const ADDR **targets );
+extern int  jt_shape( const insn_t *insn, char *shape, unsigned int size, 
+                      ADDR *value );
+extern int  jt_match( const char *pat, const char *shape );
+
+/*****************************************************************************/
+/*                              Register Tracking                            */
+/*****************************************************************************/
+
+typedef enum {
+   TR_LOAD,       /* sets the register to the first numeric operand   */
+   TR_STEP,       /* adds a constant to the register                  */
+   TR_KILL,       /* leaves the register unknown                      */
+   TR_USE         /* refers to memory through the register            */
+} TRACK_OP;
+
+/**
+    How a target's instructions use the registers that hold addresses
+    (see track.c).  The shapes are patterns as for DASM_DISPATCH.  Any
+    instruction naming a register that matches none of its entries
+    leaves it unknown; TRACK_KILL entries name the other instructions
+    that change it, such as those writing one of its halves, and a
+    TRACK_USE of NONE names those that only read it.
+**/
+typedef struct {
+   const char * reg;      /* register name, e.g. "DPTR"                  */
+   const char * shape;
+   TRACK_OP     op;
+   XREF_TYPE    xtype;    /* TR_USE: reference made                      */
+   int          arg;      /* TR_STEP: amount added; TR_USE: non-zero to
+                             add the displacement operand; TR_KILL:
+                             if non-zero, the first numeric operand
+                             must be this address                       */
+} track_t;
+
+extern const track_t dasm_track_table[];
+
+#define DASM_TRACK(...) \
+    const track_t dasm_track_table[] = { __VA_ARGS__ { NULL } };
+#define TRACK_LOAD(M_reg, M_shape) \
+    { M_reg, M_shape, TR_LOAD, X_NONE, 0 },
+#define TRACK_STEP(M_reg, M_shape, M_delta) \
+    { M_reg, M_shape, TR_STEP, X_NONE, M_delta },
+#define TRACK_KILL(M_reg, M_shape) \
+    { M_reg, M_shape, TR_KILL, X_NONE, 0 },
+#define TRACK_KILL_AT(M_reg, M_shape, M_addr) \
+    { M_reg, M_shape, TR_KILL, X_NONE, M_addr },
+#define TRACK_USE(M_reg, M_shape, M_xtype) \
+    { M_reg, M_shape, TR_USE, X_##M_xtype, 0 },
+#define TRACK_USE_DISP(M_reg, M_shape, M_xtype) \
+    { M_reg, M_shape, TR_USE, X_##M_xtype, 1 },
+
+extern void track_scan( const record_t *rec );
+extern unsigned int track_resolve( void (*found)( ADDR addr, const char *reg, 
+                                                  ADDR value ) );
+
+/*****************************************************************************/
+/*                              Register Window                              */
+/*****************************************************************************/
+
+typedef enum {
+   ACCESS_STORE,     /* writes its first operand, reads the others      */
+   ACCESS_READ,      /* reads all its operands, e.g. compares and tests */
+   ACCESS_MODIFY,    /* reads them all, and writes the first as well    */
+   ACCESS_EXCHANGE   /* reads and writes all its operands               */
+} ACCESS_TYPE;
+
+/**
+    A window of the address space holding the target's registers, such
+    as the 78K/III saddr and sfr areas at FE00-FFFF.  Their labels are
+    kept in an array indexed by address, and -u counts the reads and
+    writes of each.  Instructions are taken to be ACCESS_STORE unless
+    listed with another access; an operand written inside brackets is
+    a pointer, and only read.  DASM_REGS( 0, 0 ) for none.
+**/
+typedef struct {
+   const char * opcode;      /* mnemonic, any case                      */
+   ACCESS_TYPE  access;
+} reg_access_t;
+
+extern const ADDR         dasm_regs_base;
+extern const unsigned int dasm_regs_size;
+extern const reg_access_t dasm_reg_access_table[];
+
+#define DASM_REGS(M_base, M_size, ...) \
+    const ADDR         dasm_regs_base = M_base; \
+    const unsigned int dasm_regs_size = M_size; \
+    const reg_access_t dasm_reg_access_table[] = { __VA_ARGS__ { NULL } };
+#define ACCESS(M_opcode, M_access)      { M_opcode, ACCESS_##M_access },
+
+/*****************************************************************************/
+/*                              Data Classification                          */
+/*****************************************************************************/
+
+extern void classify_begin( FILE *f, ADDR base, int term, FILE *fp );
+extern void classify_region( ADDR start, ADDR end, unsigned int bpl );
+extern void classify_end( void );
+
+/*****************************************************************************/
+/*                              Pattern Search                               */
+/*****************************************************************************/
+
+extern void search_add( const char *text );
+extern void search_add_file( const char *filename );
+extern unsigned int search_run( FILE *f, ADDR base );
+
+/*****************************************************************************/
+/*                              Instruction Queries                          */
+/*****************************************************************************/
+
+extern void query_set( const char *text );
+extern void query_begin( void );
+extern void query_record( const record_t *rec );
+extern unsigned long query_end( void );
+
+/*****************************************************************************/
+/*                              Procedure Signatures                         */
+/*****************************************************************************/
+
+extern void sig_scan( const record_t *rec );
+extern int  sig_proc( ADDR addr, unsigned long long *hash, unsigned int *n_insns );
+extern unsigned int sig_match( const char *dbfile );
+extern unsigned int sig_write( const char *dbfile );
+
+/*****************************************************************************/
+/*                              Version Differences                          */
+/*****************************************************************************/
+
+extern void diff_scan( const record_t *rec );
+extern void diff_write_map( const char *mapfile );
+extern void diff_report( const char *mapfile );
+
 /*****************************************************************************/
 
 #endif
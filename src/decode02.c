@@ -43,6 +43,51 @@
  *****************************************************************************/
 
 DASM_PROFILE( "dasm02", "MOS Technology 6502", 3, 9, 0, 1 )
+ASXXXX_SYNTAX( "\t.area\tCODE\t(ABS)", 1 )
+DASM_FLOW(
+    FLOW  ( "jmp",  JUMP )
+    FLOW  ( "jml",  JUMP )
+    FLOW  ( "bra",  JUMP )
+    FLOW  ( "brl",  JUMP )
+    FLOW  ( "rts",  RETURN )
+    FLOW  ( "rtl",  RETURN )
+    FLOW  ( "rti",  RETURN )
+)
+DASM_DISPATCH(
+    DISPATCH( "jmp (%)",     "lda %,X|lda %,Y", NULL, "cmp #|cpx #|cpy #", WORDS, 1 )
+)
+DASM_TRACK()
+DASM_REGS( 0, 0 )
+
+/**
+    Processor variant, chosen by the command file: "o0000 65C02" for
+    the CMOS 65C02, R65C02 for Rockwell's with the RMB, SMB, BBR and
+    BBS bit instructions, W65C02 for WDC's with WAI and STP as well,
+    or 65816.  On the 65816 the widths of the accumulator (the M flag)
+    and of the index registers (the X flag) set the size of immediate
+    operands, so they are followed through REP and SEP; 1 while 16 bits
+    wide.  M16, M8, X16 and X8 set them from the command file.
+**/
+#define CPU_65C02               ( 0x01 )
+#define CPU_BITOPS              ( 0x02 )
+#define CPU_WDC                 ( 0x04 )
+#define CPU_65816               ( 0x08 )
+
+static int cpu = 0;
+static int m16 = 0;
+static int x16 = 0;
+
+DASM_SELECTED_MODES(
+    MODE( "6502",   cpu, 0 )
+    MODE( "65C02",  cpu, CPU_65C02 )
+    MODE( "R65C02", cpu, CPU_65C02 | CPU_BITOPS )
+    MODE( "W65C02", cpu, CPU_65C02 | CPU_BITOPS | CPU_WDC )
+    MODE( "65816",  cpu, CPU_65C02 | CPU_WDC | CPU_65816 )
+    MODE( "M8",     m16, 0 )
+    MODE( "M16",    m16, 1 )
+    MODE( "X8",     x16, 0 )
+    MODE( "X16",    x16, 1 )
+)
 
 /*****************************************************************************
  * Private data types, macros, constants.
@@ -51,11 +96,20 @@ DASM_PROFILE( "dasm02", "MOS Technology 6502", 3, 9, 0, 1 )
 /* Common output formats */
 #define FORMAT_NUM_8BIT         "$%02X"
 #define FORMAT_NUM_16BIT        "$%04X"
+#define FORMAT_NUM_24BIT        "$%06X"
 #define FORMAT_REG              "R%d"
 
 /* Construct a 16-bit word out of low and high bytes */
 #define MK_WORD(l,h)            ( ((l) & 0xFF) | (((h) & 0xFF) << 8) )
 
+/* Construct a 24-bit long address out of a word and a bank byte */
+#define MK_LONG(w,b)            ( ((w) & 0xFFFF) | (((ADDR)((b) & 0xFF)) << 16) )
+
+/* 65816 status register bits for the register widths, and REP */
+#define PSR_M                   ( 0x20 )
+#define PSR_X                   ( 0x10 )
+#define OPC_REP                 ( 0xC2 )
+
 /*****************************************************************************
  *        Private Functions
  *****************************************************************************/
@@ -86,7 +140,7 @@ OPERAND_FUNC(imm8)
 {
     UBYTE byte = next( f, addr );
     
-    operand( "#" FORMAT_NUM_8BIT, byte );
+    emit_imm( "#" FORMAT_NUM_8BIT, byte );
 }
 
 /***********************************************************
@@ -97,8 +151,7 @@ OPERAND_FUNC(zeropage)
 {
     UBYTE zp = next( f, addr );
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_8BIT, (ADDR)zp ) );
-    xref_addxref( xtype, g_insn_addr, zp );
+    emit_addr( FORMAT_NUM_8BIT, zp, xtype );
 }
 
 /***********************************************************
@@ -109,7 +162,7 @@ OPERAND_FUNC(zeropage_X)
 {
     operand_zeropage( f, addr, opc, xtype );
     COMMA;
-    operand( "X" );
+    emit_reg( "X", 0 );
 }
 
 /***********************************************************
@@ -120,7 +173,7 @@ OPERAND_FUNC(zeropage_Y)
 {
     operand_zeropage( f, addr, opc, xtype );
     COMMA;
-    operand( "Y" );
+    emit_reg( "Y", 0 );
 }
 
 /***********************************************************
@@ -133,8 +186,12 @@ OPERAND_FUNC(abs16)
     UBYTE high_addr = next( f, addr );
     UWORD addr16    = MK_WORD( low_addr, high_addr );
 
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr16 ) );
-    xref_addxref( xtype, g_insn_addr, addr16 );
+    /* 65816 jumps and calls stay in the bank of the instruction */
+    if ( ( cpu & CPU_65816 ) && ( xtype == X_JMP || xtype == X_CALL ) )
+        emit_operand( OPND_ADDR, FORMAT_NUM_16BIT, addr16, 
+                      MK_LONG( addr16, g_insn_addr >> 16 ), xtype, OPF_LABEL );
+    else
+        emit_addr( FORMAT_NUM_16BIT, addr16, xtype );
 }
 
 /***********************************************************
@@ -147,11 +204,9 @@ OPERAND_FUNC(abs16_X)
     UBYTE high_addr = next( f, addr );
     UWORD addr16    = MK_WORD( low_addr, high_addr );
 
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr16 ) );
+    emit_addr( FORMAT_NUM_16BIT, addr16, xtype );
     COMMA;
-    operand( "X" );
-    
-    xref_addxref( xtype, g_insn_addr, addr16 );
+    emit_reg( "X", 0 );
 }
 
 /***********************************************************
@@ -164,11 +219,9 @@ OPERAND_FUNC(abs16_Y)
     UBYTE high_addr = next( f, addr );
     UWORD addr16    = MK_WORD( low_addr, high_addr );
 
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr16 ) );
+    emit_addr( FORMAT_NUM_16BIT, addr16, xtype );
     COMMA;
-    operand( "Y" );
-    
-    xref_addxref( xtype, g_insn_addr, addr16 );
+    emit_reg( "Y", 0 );
 }
 
 /***********************************************************
@@ -177,10 +230,11 @@ OPERAND_FUNC(abs16_Y)
 
 OPERAND_FUNC(ind8_X)
 {
-    operand( "(" );
+    emit_text( "(" );
     operand_zeropage( f, addr, opc, xtype );
     COMMA;
-    operand( "X)" );
+    emit_reg( "X", 0 );
+    emit_text( ")" );
 }
 
 /***********************************************************
@@ -189,11 +243,11 @@ OPERAND_FUNC(ind8_X)
 
 OPERAND_FUNC(ind8_Y)
 {
-    operand( "(" );
+    emit_text( "(" );
     operand_zeropage( f, addr, opc, xtype );
-    operand( ")" );
+    emit_text( ")" );
     COMMA;
-    operand( "Y" );
+    emit_reg( "Y", 0 );
 }
 
 /***********************************************************
@@ -206,9 +260,9 @@ OPERAND_FUNC(ind16)
     UBYTE high_addr = next( f, addr );
     UWORD addr16    = MK_WORD( low_addr, high_addr );
 
-    operand( "(%s)", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr16 ) );
-    
-    xref_addxref( xtype, g_insn_addr, addr16 );
+    emit_text( "(" );
+    emit_addr( FORMAT_NUM_16BIT, addr16, xtype );
+    emit_text( ")" );
 }
 
 /***********************************************************
@@ -220,8 +274,226 @@ OPERAND_FUNC(rel8)
     BYTE disp = (BYTE)next( f, addr );
     ADDR dest = *addr + disp;
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest );
+    emit_rel( FORMAT_NUM_16BIT, dest, xtype );
+}
+
+/***********************************************************
+ * Process "#imm16" operands.
+ ************************************************************/
+
+OPERAND_FUNC(imm16)
+{
+    UBYTE low  = next( f, addr );
+    UBYTE high = next( f, addr );
+    
+    emit_imm( "#" FORMAT_NUM_16BIT, MK_WORD( low, high ) );
+}
+
+/***********************************************************
+ * Process 65816 "#imm" operands sized by the M flag.
+ ************************************************************/
+
+OPERAND_FUNC(imm_M)
+{
+    if ( m16 )
+        operand_imm16( f, addr, opc, xtype );
+    else
+        operand_imm8( f, addr, opc, xtype );
+}
+
+/***********************************************************
+ * Process 65816 "#imm" operands sized by the X flag.
+ ************************************************************/
+
+OPERAND_FUNC(imm_X)
+{
+    if ( x16 )
+        operand_imm16( f, addr, opc, xtype );
+    else
+        operand_imm8( f, addr, opc, xtype );
+}
+
+/***********************************************************
+ * Process the "#imm8" operand of REP and SEP, which clear
+ *  and set the M and X flags.
+ ************************************************************/
+
+OPERAND_FUNC(psr_bits)
+{
+    UBYTE bits = next( f, addr );
+    
+    emit_imm( "#" FORMAT_NUM_8BIT, bits );
+    
+    if ( bits & PSR_M )
+        m16 = ( opc == OPC_REP );
+    if ( bits & PSR_X )
+        x16 = ( opc == OPC_REP );
+}
+
+/***********************************************************
+ * Process PLP and RTI, which pull the M and X flags off
+ *  the stack, so their widths are no longer known.
+ ************************************************************/
+
+OPERAND_FUNC(pull_psr)
+{
+    if ( cpu & CPU_65816 )
+    {
+        dasm_forget_state( &m16 );
+        dasm_forget_state( &x16 );
+    }
+}
+
+/***********************************************************
+ * Process "(ind8)" operands.
+ ************************************************************/
+
+OPERAND_FUNC(ind8)
+{
+    emit_text( "(" );
+    operand_zeropage( f, addr, opc, xtype );
+    emit_text( ")" );
+}
+
+/***********************************************************
+ * Process "(ind16,X)" operand.
+ ************************************************************/
+
+OPERAND_FUNC(ind16_X)
+{
+    UBYTE low_addr  = next( f, addr );
+    UBYTE high_addr = next( f, addr );
+    UWORD addr16    = MK_WORD( low_addr, high_addr );
+
+    emit_text( "(" );
+    emit_addr( FORMAT_NUM_16BIT, addr16, xtype );
+    COMMA;
+    emit_reg( "X", 0 );
+    emit_text( ")" );
+}
+
+/***********************************************************
+ * Process "zeropage,rel8" operands of BBR and BBS.
+ ************************************************************/
+
+OPERAND_FUNC(zeropage_rel8)
+{
+    operand_zeropage( f, addr, opc, X_PTR );
+    COMMA;
+    operand_rel8( f, addr, opc, xtype );
+}
+
+/***********************************************************
+ * Process 65816 "long" operands.
+ ************************************************************/
+
+OPERAND_FUNC(long24)
+{
+    UBYTE low_addr  = next( f, addr );
+    UBYTE high_addr = next( f, addr );
+    UBYTE bank      = next( f, addr );
+    
+    emit_addr( FORMAT_NUM_24BIT, MK_LONG( MK_WORD( low_addr, high_addr ), bank ), xtype );
+}
+
+/***********************************************************
+ * Process 65816 "long,X" operands.
+ ************************************************************/
+
+OPERAND_FUNC(long24_X)
+{
+    operand_long24( f, addr, opc, xtype );
+    COMMA;
+    emit_reg( "X", 0 );
+}
+
+/***********************************************************
+ * Process 65816 "[ind8]" operands.
+ ************************************************************/
+
+OPERAND_FUNC(ind8_long)
+{
+    emit_text( "[" );
+    operand_zeropage( f, addr, opc, xtype );
+    emit_text( "]" );
+}
+
+/***********************************************************
+ * Process 65816 "[ind8],Y" operands.
+ ************************************************************/
+
+OPERAND_FUNC(ind8_long_Y)
+{
+    operand_ind8_long( f, addr, opc, xtype );
+    COMMA;
+    emit_reg( "Y", 0 );
+}
+
+/***********************************************************
+ * Process 65816 "[ind16]" operand.
+ ************************************************************/
+
+OPERAND_FUNC(ind16_long)
+{
+    emit_text( "[" );
+    operand_abs16( f, addr, opc, xtype );
+    emit_text( "]" );
+}
+
+/***********************************************************
+ * Process 65816 "stack,S" operands.
+ ************************************************************/
+
+OPERAND_FUNC(stack_S)
+{
+    UBYTE offset = next( f, addr );
+    
+    emit_disp( FORMAT_NUM_8BIT, offset );
+    COMMA;
+    emit_reg( "S", 0 );
+}
+
+/***********************************************************
+ * Process 65816 "(stack,S),Y" operands.
+ ************************************************************/
+
+OPERAND_FUNC(stack_S_Y)
+{
+    emit_text( "(" );
+    operand_stack_S( f, addr, opc, xtype );
+    emit_text( ")" );
+    COMMA;
+    emit_reg( "Y", 0 );
+}
+
+/***********************************************************
+ * Process 65816 "rel16" operands, which stay in the bank of
+ *  the instruction.
+ ************************************************************/
+
+OPERAND_FUNC(rel16)
+{
+    UBYTE low  = next( f, addr );
+    UBYTE high = next( f, addr );
+    UWORD dest = *addr + MK_WORD( low, high );
+    
+    emit_operand( OPND_REL, FORMAT_NUM_16BIT, dest, 
+                  MK_LONG( dest, g_insn_addr >> 16 ), xtype, OPF_LABEL );
+}
+
+/***********************************************************
+ * Process the "srcbank,dstbank" operands of MVN and MVP,
+ *  which are encoded the other way round.
+ ************************************************************/
+
+OPERAND_FUNC(banks)
+{
+    UBYTE dst = next( f, addr );
+    UBYTE src = next( f, addr );
+    
+    emit_imm( FORMAT_NUM_8BIT, src );
+    COMMA;
+    emit_imm( FORMAT_NUM_8BIT, dst );
 }
 
 /******************************************************************************/
@@ -229,8 +501,166 @@ OPERAND_FUNC(rel8)
 /** Note: tables are here as they refer to operand functions defined above.  **/
 /******************************************************************************/
 
+/******************************************************************************/
+/* CMOS 65C02 additions, also on the 65816 */
+/******************************************************************************/
+
+static optab_t base65C02[] = {
+
+    INSN ( "ora", ind8,       0x12, X_PTR  )
+    INSN ( "and", ind8,       0x32, X_PTR  )
+    INSN ( "eor", ind8,       0x52, X_PTR  )
+    INSN ( "adc", ind8,       0x72, X_PTR  )
+    INSN ( "sta", ind8,       0x92, X_PTR  )
+    INSN ( "lda", ind8,       0xB2, X_PTR  )
+    INSN ( "cmp", ind8,       0xD2, X_PTR  )
+    INSN ( "sbc", ind8,       0xF2, X_PTR  )
+    
+    INSN ( "stz", zeropage,   0x64, X_PTR  )
+    INSN ( "stz", zeropage_X, 0x74, X_PTR  )
+    INSN ( "stz", abs16,      0x9C, X_PTR  )
+    INSN ( "stz", abs16_X,    0x9E, X_PTR  )
+    
+    INSN ( "bit", imm8,       0x89, X_NONE )
+    INSN ( "bit", zeropage_X, 0x34, X_PTR  )
+    INSN ( "bit", abs16_X,    0x3C, X_PTR  )
+    
+    INSN ( "tsb", zeropage,   0x04, X_PTR  )
+    INSN ( "tsb", abs16,      0x0C, X_PTR  )
+    INSN ( "trb", zeropage,   0x14, X_PTR  )
+    INSN ( "trb", abs16,      0x1C, X_PTR  )
+    
+    INSN ( "inc", none,       0x1A, X_NONE )
+    INSN ( "dec", none,       0x3A, X_NONE )
+    
+    INSN ( "phx", none,       0xDA, X_NONE )
+    INSN ( "plx", none,       0xFA, X_NONE )
+    INSN ( "phy", none,       0x5A, X_NONE )
+    INSN ( "ply", none,       0x7A, X_NONE )
+    
+    INSN ( "bra", rel8,       0x80, X_JMP  )
+    INSN ( "jmp", ind16_X,    0x7C, X_PTR  )
+    
+    END
+};
+
+/******************************************************************************/
+/* Rockwell bit instructions */
+/******************************************************************************/
+
+#define BIT_OP(M_bit) \
+    INSN ( "rmb" #M_bit, zeropage,      ( 0x07 | ( M_bit << 4 ) ), X_PTR ) \
+    INSN ( "smb" #M_bit, zeropage,      ( 0x87 | ( M_bit << 4 ) ), X_PTR ) \
+    INSN ( "bbr" #M_bit, zeropage_rel8, ( 0x0F | ( M_bit << 4 ) ), X_JMP ) \
+    INSN ( "bbs" #M_bit, zeropage_rel8, ( 0x8F | ( M_bit << 4 ) ), X_JMP )
+
+static optab_t bitops65C02[] = {
+
+    BIT_OP( 0 )
+    BIT_OP( 1 )
+    BIT_OP( 2 )
+    BIT_OP( 3 )
+    BIT_OP( 4 )
+    BIT_OP( 5 )
+    BIT_OP( 6 )
+    BIT_OP( 7 )
+    
+    END
+};
+
+/******************************************************************************/
+/* WDC additions, also on the 65816 */
+/******************************************************************************/
+
+static optab_t wdc65C02[] = {
+
+    INSN ( "wai", none,       0xCB, X_NONE )
+    INSN ( "stp", none,       0xDB, X_NONE )
+    
+    END
+};
+
+/******************************************************************************/
+/* 65816 additions */
+/******************************************************************************/
+
+#define LONG_OP(M_name, M_base) \
+    INSN ( M_name, stack_S,     ( 0x03 | M_base ), X_NONE ) \
+    INSN ( M_name, stack_S_Y,   ( 0x13 | M_base ), X_NONE ) \
+    INSN ( M_name, ind8_long,   ( 0x07 | M_base ), X_PTR  ) \
+    INSN ( M_name, ind8_long_Y, ( 0x17 | M_base ), X_PTR  ) \
+    INSN ( M_name, long24,      ( 0x0F | M_base ), X_PTR  ) \
+    INSN ( M_name, long24_X,    ( 0x1F | M_base ), X_PTR  )
+    
+#define IMM_OP(M_name, M_base) \
+    INSN ( M_name, imm_M,       ( 0x09 | M_base ), X_NONE ) \
+    LONG_OP( M_name, M_base )
+
+static optab_t base65816[] = {
+
+    IMM_OP ( "ora", 0x00 )
+    IMM_OP ( "and", 0x20 )
+    IMM_OP ( "eor", 0x40 )
+    IMM_OP ( "adc", 0x60 )
+    LONG_OP( "sta", 0x80 )
+    IMM_OP ( "lda", 0xA0 )
+    IMM_OP ( "cmp", 0xC0 )
+    IMM_OP ( "sbc", 0xE0 )
+    
+    INSN ( "bit", imm_M,      0x89, X_NONE )
+    INSN ( "ldx", imm_X,      0xA2, X_NONE )
+    INSN ( "ldy", imm_X,      0xA0, X_NONE )
+    INSN ( "cpx", imm_X,      0xE0, X_NONE )
+    INSN ( "cpy", imm_X,      0xC0, X_NONE )
+    
+    INSN ( "rep", psr_bits,   0xC2, X_NONE )
+    INSN ( "sep", psr_bits,   0xE2, X_NONE )
+    INSN ( "xce", none,       0xFB, X_NONE )
+    
+    INSN ( "tcd", none,       0x5B, X_NONE )
+    INSN ( "tdc", none,       0x7B, X_NONE )
+    INSN ( "tcs", none,       0x1B, X_NONE )
+    INSN ( "tsc", none,       0x3B, X_NONE )
+    INSN ( "txy", none,       0x9B, X_NONE )
+    INSN ( "tyx", none,       0xBB, X_NONE )
+    INSN ( "xba", none,       0xEB, X_NONE )
+    
+    INSN ( "phb", none,       0x8B, X_NONE )
+    INSN ( "plb", none,       0xAB, X_NONE )
+    INSN ( "phd", none,       0x0B, X_NONE )
+    INSN ( "pld", none,       0x2B, X_NONE )
+    INSN ( "phk", none,       0x4B, X_NONE )
+    INSN ( "pea", abs16,      0xF4, X_PTR  )
+    INSN ( "pei", ind8,       0xD4, X_PTR  )
+    INSN ( "per", rel16,      0x62, X_PTR  )
+    
+    INSN ( "mvn", banks,      0x54, X_NONE )
+    INSN ( "mvp", banks,      0x44, X_NONE )
+    
+    INSN ( "brl", rel16,      0x82, X_JMP  )
+    INSN ( "jml", long24,     0x5C, X_JMP  )
+    INSN ( "jml", ind16_long, 0xDC, X_PTR  )
+    INSN ( "jsl", long24,     0x22, X_CALL )
+    INSN ( "jsr", ind16_X,    0xFC, X_PTR  )
+    INSN ( "rtl", none,       0x6B, X_NONE )
+    
+    INSN ( "cop", imm8,       0x02, X_NONE )
+    INSN ( "wdm", imm8,       0x42, X_NONE )
+    
+    END
+};
+
+/******************************************************************************/
+/* 6502 */
+/******************************************************************************/
+
 optab_t base_optab[] = {
 
+    VARIANT ( base65816,   cpu, CPU_65816  )
+    VARIANT ( bitops65C02, cpu, CPU_BITOPS )
+    VARIANT ( wdc65C02,    cpu, CPU_WDC    )
+    VARIANT ( base65C02,   cpu, CPU_65C02  )
+
 #undef ACC_OP
 #define ACC_OP(M_name, M_base) \
     INSN ( M_name, imm8,       ( 0x09 | M_base ), X_NONE ) \
@@ -294,7 +724,7 @@ optab_t base_optab[] = {
     INSN ( "pha",  none,      0x48, X_NONE )
     INSN ( "php",  none,      0x08, X_NONE )
     INSN ( "pla",  none,      0x68, X_NONE )
-    INSN ( "plp",  none,      0x28, X_NONE )
+    INSN ( "plp",  pull_psr,  0x28, X_NONE )
     
 /*----------------------------------------------------------------------------
   Logical
@@ -400,7 +830,7 @@ optab_t base_optab[] = {
     
     INSN ( "brk",     none, 0x00, X_NONE )
     INSN ( "nop",     none, 0xEA, X_NONE )
-    INSN ( "rti",     none, 0x40, X_NONE )
+    INSN ( "rti",     pull_psr, 0x40, X_NONE )
 
     END
 };
@@ -43,6 +43,32 @@
  *****************************************************************************/
 
 DASM_PROFILE( "dasm09", "Motorola 6809", 4, 9, 0, 1 )
+ASXXXX_SYNTAX( "\t.area\tCODE\t(ABS)", 1 )
+DASM_FLOW(
+    FLOW  ( "BRA",  JUMP )
+    FLOW  ( "LBRA", JUMP )
+    FLOW  ( "JMP",  JUMP )
+    FLOW  ( "BRN",  NEXT )
+    FLOW  ( "LBRN", NEXT )
+    FLOW  ( "RTS",  RETURN )
+    FLOW  ( "RTI",  RETURN )
+)
+DASM_DISPATCH()
+DASM_TRACK()
+DASM_REGS( 0, 0 )
+
+/**
+    Processor variant, chosen by the command file: "o0000 6309" for the
+    Hitachi 6309, whose additions are decoded as well.
+**/
+#define CPU_6309                ( 0x01 )
+
+static int cpu = 0;
+
+DASM_SELECTED_MODES(
+    MODE( "6809", cpu, 0 )
+    MODE( "6309", cpu, CPU_6309 )
+)
 
 /*****************************************************************************
  * Private data types, macros, constants.
@@ -51,11 +77,22 @@ DASM_PROFILE( "dasm09", "Motorola 6809", 4, 9, 0, 1 )
 /* Common output formats */
 #define FORMAT_NUM_8BIT         "$%02X"
 #define FORMAT_NUM_16BIT        "$%04X"
+#define FORMAT_NUM_32BIT        "$%08X"
 #define FORMAT_REG              "R%d"
 
 /* Construct a 16-bit word out of low and high bytes */
 #define MK_WORD(l,h)            ( ((l) & 0xFF) | (((h) & 0xFF) << 8) )
 
+/* Register names in EXG, TFR, the 6309 register-register ops and TFM */
+static const char * rtab6809[16] = {
+    "D", "X", "Y", "U", "S", "PC", "???", "???",
+    "A", "B", "CCR", "DPR", "???", "???", "???", "???"
+};
+static const char * rtab6309[16] = {
+    "D", "X", "Y", "U", "S", "PC", "W", "V",
+    "A", "B", "CCR", "DPR", "0", "0", "E", "F"
+};
+
 /*****************************************************************************
  *        Private Functions
  *****************************************************************************/
@@ -86,7 +123,7 @@ OPERAND_FUNC(imm8)
 {
     UBYTE byte = next( f, addr );
     
-    operand( "#" FORMAT_NUM_8BIT, byte );
+    emit_imm( "#" FORMAT_NUM_8BIT, byte );
 }
 
 /***********************************************************
@@ -99,8 +136,22 @@ OPERAND_FUNC(imm16)
     UBYTE lsb   = next( f, addr );
     UWORD imm16 = MK_WORD( lsb, msb );
 
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, imm16 ) );
-    xref_addxref( xtype, g_insn_addr, imm16 );
+    emit_operand( OPND_IMM, FORMAT_NUM_16BIT, imm16, imm16, xtype, OPF_LABEL );
+}
+
+/***********************************************************
+ * Process "imm32" operand (6309 LDQ).
+ ************************************************************/
+
+OPERAND_FUNC(imm32)
+{
+    UBYTE b3 = next( f, addr );
+    UBYTE b2 = next( f, addr );
+    UBYTE b1 = next( f, addr );
+    UBYTE b0 = next( f, addr );
+    
+    emit_imm( "#" FORMAT_NUM_32BIT, 
+              (int)( ( (unsigned int)b3 << 24 ) | ( b2 << 16 ) | ( b1 << 8 ) | b0 ) );
 }
 
 /***********************************************************
@@ -111,8 +162,7 @@ OPERAND_FUNC(direct)
 {
     UBYTE a = next( f, addr );
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, (ADDR)a ) );
-    xref_addxref( xtype, g_insn_addr, a );
+    emit_addr( FORMAT_NUM_16BIT, a, xtype );
 }
 
 /***********************************************************
@@ -129,25 +179,112 @@ enum {
     MODE_REG_ONLY  = 0x04,
     MODE_REG_ACCB  = 0x05,
     MODE_REG_ACCA  = 0x06,
+    MODE_REG_ACCE  = 0x07,      /* 6309 */
     MODE_REG_8OFF  = 0x08,
     MODE_REG_16OFF = 0x09,
+    MODE_REG_ACCF  = 0x0A,      /* 6309 */
     MODE_REG_D     = 0x0B,
     MODE_PCR_8OFF  = 0x0C,
     MODE_PCR_16OFF = 0x0D,
+    MODE_REG_W     = 0x0E,      /* 6309 */
     MODE_EXT_IND   = 0x0F    
 };
 
+/***********************************************************
+ * Emits the effective address of a PC-relative or extended
+ * indirect operand.  The address in an indirect operand holds
+ * a pointer; otherwise it is what the instruction refers to.
+ ************************************************************/
+
+static void emit_ea( ADDR ea, int ind, XREF_TYPE xtype )
+{
+    if ( ind )
+        xtype = X_PTR;
+    else if ( xtype == X_NONE )
+        xtype = X_DATA;
+        
+    emit_operand( OPND_ADDR, FORMAT_NUM_16BIT, ea, ea, xtype, OPF_LABEL );
+}
+
+/***********************************************************
+ * The 6309 indexed modes through W, which use postbytes that
+ * are illegal on the 6809.
+ *
+ * Returns non-zero if the postbyte was one of them.
+ ************************************************************/
+
+static int indexed_w( FILE *f, ADDR *addr, UBYTE postbyte )
+{
+    int ind;
+    
+    switch ( postbyte )
+    {
+    case 0x8F: case 0xAF: case 0xCF: case 0xEF:
+        ind = 0;
+        break;
+    case 0x90: case 0xB0: case 0xD0: case 0xF0:
+        ind = 1;
+        break;
+    default:
+        return 0;
+    }
+    
+    if ( ind )
+        emit_text( "[" );
+        
+    switch ( postbyte & 0x60 )
+    {
+    case 0x00:
+        emit_text( "," );
+        emit_reg( "W", 0 );
+        break;
+        
+    case 0x20:
+        {
+            UBYTE msb    = next( f, addr );
+            UBYTE lsb    = next( f, addr );
+            WORD  offset = MK_WORD( lsb, msb );
+            emit_disp( "%d", offset );
+            COMMA;
+            emit_reg( "W", 0 );
+        }
+        break;
+        
+    case 0x40:
+        emit_text( "," );
+        emit_reg( "W", 0 );
+        emit_text( "++" );
+        break;
+        
+    case 0x60:
+        emit_text( ",--" );
+        emit_reg( "W", 0 );
+        break;
+    }
+    
+    if ( ind )
+        emit_text( "]" );
+        
+    return 1;
+}
+
 OPERAND_FUNC(indexed)
 {
     UBYTE postbyte = next( f, addr );
     UBYTE rr = ( postbyte >> 5 ) & 0x03;
     static const char * rrtab[] = { "X", "Y", "U", "S" };
     
-    if ( postbyte & BIT(7) )
+    if ( !( postbyte & BIT(7) ) )
     {
         BYTE offset = ((BYTE)( ( postbyte & 0x1F ) << 3 )) >> 3;
         
-        operand( "%d, %s", offset, rrtab[rr] );    
+        emit_disp( "%d", offset );
+        COMMA;
+        emit_reg( rrtab[rr], rr );
+    }
+    else if ( ( cpu & CPU_6309 ) && indexed_w( f, addr, postbyte ) )
+    {
+        /* done */
     }
     else
     {
@@ -155,46 +292,85 @@ OPERAND_FUNC(indexed)
         int   ind  = postbyte & 0x10;
         
         if ( ind )
-            operand("[");
+            emit_text( "[" );
             
         switch ( mode )
         {
         case MODE_AUTO_INC:
-            operand( ",%s+", rrtab[rr] );
+            if ( ind )      /* only the double step may be indirect */
+            {
+                emit_text( "???" );
+                break;
+            }
+            emit_text( "," );
+            emit_reg( rrtab[rr], rr );
+            emit_text( "+" );
             break;
             
         case MODE_AUTO_INC2:
-            operand( ",%s++", rrtab[rr] );
+            emit_text( "," );
+            emit_reg( rrtab[rr], rr );
+            emit_text( "++" );
             break;
             
         case MODE_AUTO_DEC:
-            operand( ",-%s", rrtab[rr] );
+            if ( ind )
+            {
+                emit_text( "???" );
+                break;
+            }
+            emit_text( ",-" );
+            emit_reg( rrtab[rr], rr );
             break;
             
         case MODE_AUTO_DEC2:
-            operand( ",--%s", rrtab[rr] );
+            emit_text( ",--" );
+            emit_reg( rrtab[rr], rr );
             break;
             
         case MODE_REG_ONLY:
-            operand( ",%s", rrtab[rr] );
+            emit_text( "," );
+            emit_reg( rrtab[rr], rr );
             break;
             
         case MODE_REG_ACCB:
-            operand( "B, %s", rrtab[rr] );
+            emit_reg( "B", 0 );
+            COMMA;
+            emit_reg( rrtab[rr], rr );
             break;
             
         case MODE_REG_ACCA:
-            operand( "A, %s", rrtab[rr] );
+            emit_reg( "A", 0 );
+            COMMA;
+            emit_reg( rrtab[rr], rr );
+            break;
+            
+        case MODE_REG_ACCE:
+        case MODE_REG_ACCF:
+        case MODE_REG_W:
+            if ( !( cpu & CPU_6309 ) )
+            {
+                emit_text( "???" );
+                break;
+            }
+            emit_reg( mode == MODE_REG_ACCE ? "E" : 
+                      mode == MODE_REG_ACCF ? "F" : "W", 0 );
+            COMMA;
+            emit_reg( rrtab[rr], rr );
             break;
             
         case MODE_REG_D:
-            operand( "D, %s", rrtab[rr] );
+            emit_reg( "D", 0 );
+            COMMA;
+            emit_reg( rrtab[rr], rr );
             break;
             
         case MODE_REG_8OFF:
             {
                 BYTE offset = (BYTE)next( f, addr );
-                operand( "%d, %s", offset, rrtab[rr] );
+                emit_disp( "%d", offset );
+                COMMA;
+                emit_reg( rrtab[rr], rr );
             }
             break;
             
@@ -203,14 +379,18 @@ OPERAND_FUNC(indexed)
                 UBYTE msb    = next( f, addr );
                 UBYTE lsb    = next( f, addr );
                 WORD  offset = MK_WORD( lsb, msb );
-                operand( "%d, %s", offset, rrtab[rr] );
+                emit_disp( "%d", offset );
+                COMMA;
+                emit_reg( rrtab[rr], rr );
             }
             break;
             
         case MODE_PCR_8OFF:
             {
                 BYTE offset = (BYTE)next( f, addr );
-                operand( "%d, PCR", offset );
+                emit_ea( ( *addr + offset ) & 0xFFFF, ind, xtype );
+                COMMA;
+                emit_reg( "PCR", 0 );
             }
             break;
             
@@ -219,26 +399,31 @@ OPERAND_FUNC(indexed)
                 UBYTE msb    = next( f, addr );
                 UBYTE lsb    = next( f, addr );
                 WORD  offset = MK_WORD( lsb, msb );
-                operand( "%d, PCR", offset );
+                emit_ea( ( *addr + offset ) & 0xFFFF, ind, xtype );
+                COMMA;
+                emit_reg( "PCR", 0 );
             }
             break;
             
         case MODE_EXT_IND:
+            /* Only valid indirect */
+            if ( ind )
             {
                 UBYTE msb = next( f, addr );
                 UBYTE lsb = next( f, addr );
-                WORD  ea  = MK_WORD( lsb, msb );
-                operand( "%d", ea );
+                emit_ea( MK_WORD( lsb, msb ), ind, xtype );
             }
+            else
+                emit_text( "???" );
             break;
             
         default:
-            operand( "???" );
+            emit_text( "???" );
             break;
         }
         
         if ( ind )
-            operand("]");
+            emit_text( "]" );
     }
 }
 
@@ -252,8 +437,7 @@ OPERAND_FUNC(extended)
     UBYTE lsb    = next( f, addr );
     UWORD addr16 = MK_WORD( lsb, msb );
 
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr16 ) );
-    xref_addxref( xtype, g_insn_addr, addr16 );
+    emit_addr( FORMAT_NUM_16BIT, addr16, xtype );
 }
 
 /***********************************************************
@@ -265,8 +449,7 @@ OPERAND_FUNC(rel8)
     BYTE disp = (BYTE)next( f, addr );
     ADDR dest = *addr + disp;
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest );
+    emit_rel( FORMAT_NUM_16BIT, dest, xtype );
 }
 
 /***********************************************************
@@ -280,12 +463,12 @@ OPERAND_FUNC(rel16)
     WORD disp = MK_WORD( lsb, msb );
     ADDR dest = *addr + disp;
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest );
+    emit_rel( FORMAT_NUM_16BIT, dest, xtype );
 }
 
 /***********************************************************
- * Process "r1_r2" operands.
+ * Process "r1_r2" operands: source register in the high
+ * nibble of the postbyte, destination in the low nibble.
  ************************************************************/
 
 OPERAND_FUNC(r1_r2)
@@ -293,33 +476,238 @@ OPERAND_FUNC(r1_r2)
     UBYTE postbyte = next( f, addr );
     int   src = ( postbyte >> 4 ) & 0x0F;
     int   dst =   postbyte        & 0x0F;
+    const char ** rtab = ( cpu & CPU_6309 ) ? rtab6309 : rtab6809;
+    
+    emit_reg( rtab[src], src );
+    COMMA;
+    emit_reg( rtab[dst], dst );
+}
+
+/***********************************************************
+ * Process 6309 TFM operands, the registers stepping as
+ * given by the opcode (r+,r+  r-,r-  r+,r  r,r+).
+ ************************************************************/
+
+OPERAND_FUNC(tfm)
+{
+    UBYTE postbyte = next( f, addr );
+    int   src = ( postbyte >> 4 ) & 0x0F;
+    int   dst =   postbyte        & 0x0F;
+    static const char * srcstep[] = { "+", "-", "+", ""  };
+    static const char * dststep[] = { "+", "-", "",  "+" };
+    
+    emit_reg( rtab6309[src], src );
+    emit_text( srcstep[opc & 0x03] );
+    COMMA;
+    emit_reg( rtab6309[dst], dst );
+    emit_text( dststep[opc & 0x03] );
+}
+
+/***********************************************************
+ * Process 6309 bit transfer operands: register, source 
+ * (memory) bit, destination (register) bit, direct address.
+ ************************************************************/
+
+OPERAND_FUNC(bitop)
+{
+    UBYTE postbyte = next( f, addr );
+    int   reg = ( postbyte >> 6 ) & 0x03;
+    static const char * rtab[] = { "CCR", "A", "B", "???" };
     
-    static const char * rtab[] = {
-        "D",
-        "X",
-        "Y",
-        "U",
-        "S",
-        "PC",
-        "???", "???", /* not used */
-        "A",
-        "B",
-        "CCR",
-        "DPR"
-    };
-    
-    operand( "%s", rtab[dst] );
+    emit_reg( rtab[reg], reg );
+    COMMA;
+    emit_bit( "%d", ( postbyte >> 3 ) & 0x07 );
+    COMMA;
+    emit_bit( "%d", postbyte & 0x07 );
     COMMA;
-    operand( "%s", rtab[src] );
+    operand_direct( f, addr, opc, xtype );
 }
 
+/******************************************************************************/
+/**                            Double Operands                               **/
+/******************************************************************************/
+
+TWO_OPERAND(imm8, direct)
+TWO_OPERAND(imm8, indexed)
+TWO_OPERAND(imm8, extended)
+
 /******************************************************************************/
 /** Instruction Decoding Tables                                              **/
 /** Note: tables are here as they refer to operand functions defined above.  **/
 /******************************************************************************/
 
+/** Macros to define classes of instruction **/
+
+#define ACC_ARGS_OP(M_name, M_base)    \
+        INSN(M_name, imm8,     (0x80 | M_base), X_NONE) \
+        INSN(M_name, direct,   (0x90 | M_base), X_NONE) \
+        INSN(M_name, indexed,  (0xA0 | M_base), X_NONE) \
+        INSN(M_name, extended, (0xB0 | M_base), X_NONE)
+        
+#define ACC_ARGS_OPD(M_name, M_base)    \
+        INSN(M_name, imm16,    (0xC0 | M_base), X_NONE) \
+        INSN(M_name, direct,   (0xD0 | M_base), X_NONE) \
+        INSN(M_name, indexed,  (0xE0 | M_base), X_NONE) \
+        INSN(M_name, extended, (0xF0 | M_base), X_NONE)        
+
+#define ACC_AB_ARGS_OP(M_name, M_base)    \
+        ACC_ARGS_OP(M_name "A", (0x00 | M_base)) \
+        ACC_ARGS_OP(M_name "B", (0x40 | M_base))
+
+#define SINGLE_OP(M_name, M_base) \
+        INSN(M_name, direct,   (0x00 | M_base), X_NONE) \
+        INSN(M_name, indexed,  (0x60 | M_base), X_NONE) \
+        INSN(M_name, extended, (0x70 | M_base), X_NONE)
+        
+#define ACC_ARGS_OP_NOIMM(M_name, M_base, M_xref)    \
+        INSN(M_name, direct,   (0x90 | M_base), M_xref) \
+        INSN(M_name, indexed,  (0xA0 | M_base), M_xref) \
+        INSN(M_name, extended, (0xB0 | M_base), M_xref)
+        
+#define ACC_OP_INH(M_name, M_base) \
+        INSN( M_name "A", none, ( 0x40 | M_base ), X_NONE ) \
+        INSN( M_name "B", none, ( 0x50 | M_base ), X_NONE )            
+
+#define ACC_ARGS_OPW(M_name, M_base)    \
+        INSN(M_name, imm16,    (0x80 | M_base), X_NONE) \
+        INSN(M_name, direct,   (0x90 | M_base), X_NONE) \
+        INSN(M_name, indexed,  (0xA0 | M_base), X_NONE) \
+        INSN(M_name, extended, (0xB0 | M_base), X_NONE)
+
+#define MEM_IMM_OP(M_name, M_base) \
+        INSN(M_name, imm8_direct,   (0x00 | M_base), X_NONE) \
+        INSN(M_name, imm8_indexed,  (0x60 | M_base), X_NONE) \
+        INSN(M_name, imm8_extended, (0x70 | M_base), X_NONE)
+
+/******************************************************************************/
+/* Hitachi 6309 additions */
+/******************************************************************************/
+
+static optab_t base6309[] = {
+
+    MEM_IMM_OP( "OIM", 0x01 )
+    MEM_IMM_OP( "AIM", 0x02 )
+    MEM_IMM_OP( "EIM", 0x05 )
+    MEM_IMM_OP( "TIM", 0x0B )
+    
+    INSN ( "SEXW", none,  0x14, X_NONE )
+    INSN ( "LDQ",  imm32, 0xCD, X_NONE )
+    
+    END
+};
+
+static optab_t page2_6309[] = {
+
+    INSN ( "ADDR",  r1_r2, 0x30, X_NONE )
+    INSN ( "ADCR",  r1_r2, 0x31, X_NONE )
+    INSN ( "SUBR",  r1_r2, 0x32, X_NONE )
+    INSN ( "SBCR",  r1_r2, 0x33, X_NONE )
+    INSN ( "ANDR",  r1_r2, 0x34, X_NONE )
+    INSN ( "ORR",   r1_r2, 0x35, X_NONE )
+    INSN ( "EORR",  r1_r2, 0x36, X_NONE )
+    INSN ( "CMPR",  r1_r2, 0x37, X_NONE )
+    
+    INSN ( "PSHSW", none,  0x38, X_NONE )
+    INSN ( "PULSW", none,  0x39, X_NONE )
+    INSN ( "PSHUW", none,  0x3A, X_NONE )
+    INSN ( "PULUW", none,  0x3B, X_NONE )
+    
+    INSN ( "NEGD",  none,  0x40, X_NONE )
+    INSN ( "COMD",  none,  0x43, X_NONE )
+    INSN ( "LSRD",  none,  0x44, X_NONE )
+    INSN ( "RORD",  none,  0x46, X_NONE )
+    INSN ( "ASRD",  none,  0x47, X_NONE )
+    INSN ( "ASLD",  none,  0x48, X_NONE )
+    INSN ( "ROLD",  none,  0x49, X_NONE )
+    INSN ( "DECD",  none,  0x4A, X_NONE )
+    INSN ( "INCD",  none,  0x4C, X_NONE )
+    INSN ( "TSTD",  none,  0x4D, X_NONE )
+    INSN ( "CLRD",  none,  0x4F, X_NONE )
+    
+    INSN ( "COMW",  none,  0x53, X_NONE )
+    INSN ( "LSRW",  none,  0x54, X_NONE )
+    INSN ( "RORW",  none,  0x56, X_NONE )
+    INSN ( "ROLW",  none,  0x59, X_NONE )
+    INSN ( "DECW",  none,  0x5A, X_NONE )
+    INSN ( "INCW",  none,  0x5C, X_NONE )
+    INSN ( "TSTW",  none,  0x5D, X_NONE )
+    INSN ( "CLRW",  none,  0x5F, X_NONE )
+    
+    ACC_ARGS_OPW( "SUBW", 0x00 )
+    ACC_ARGS_OPW( "CMPW", 0x01 )
+    ACC_ARGS_OPW( "SBCD", 0x02 )
+    ACC_ARGS_OPW( "ANDD", 0x04 )
+    ACC_ARGS_OPW( "BITD", 0x05 )
+    ACC_ARGS_OPW( "LDW",  0x06 )
+    ACC_ARGS_OPW( "EORD", 0x08 )
+    ACC_ARGS_OPW( "ADCD", 0x09 )
+    ACC_ARGS_OPW( "ORD",  0x0A )
+    ACC_ARGS_OPW( "ADDW", 0x0B )
+    ACC_ARGS_OP_NOIMM( "STW", 0x07, X_PTR )
+    
+    INSN ( "LDQ",   direct,   0xDC, X_NONE )
+    INSN ( "LDQ",   indexed,  0xEC, X_NONE )
+    INSN ( "LDQ",   extended, 0xFC, X_NONE )
+    INSN ( "STQ",   direct,   0xDD, X_PTR )
+    INSN ( "STQ",   indexed,  0xED, X_PTR )
+    INSN ( "STQ",   extended, 0xFD, X_PTR )
+    
+    END
+};
+
+static optab_t page3_6309[] = {
+
+    INSN ( "BAND",  bitop, 0x30, X_NONE )
+    INSN ( "BIAND", bitop, 0x31, X_NONE )
+    INSN ( "BOR",   bitop, 0x32, X_NONE )
+    INSN ( "BIOR",  bitop, 0x33, X_NONE )
+    INSN ( "BEOR",  bitop, 0x34, X_NONE )
+    INSN ( "BIEOR", bitop, 0x35, X_NONE )
+    INSN ( "LDBT",  bitop, 0x36, X_NONE )
+    INSN ( "STBT",  bitop, 0x37, X_PTR )
+    
+    RANGE( "TFM",   tfm,   0x38, 0x3B, X_NONE )
+    INSN ( "BITMD", imm8,  0x3C, X_NONE )
+    INSN ( "LDMD",  imm8,  0x3D, X_NONE )
+    
+    INSN ( "COME",  none,  0x43, X_NONE )
+    INSN ( "DECE",  none,  0x4A, X_NONE )
+    INSN ( "INCE",  none,  0x4C, X_NONE )
+    INSN ( "TSTE",  none,  0x4D, X_NONE )
+    INSN ( "CLRE",  none,  0x4F, X_NONE )
+    INSN ( "COMF",  none,  0x53, X_NONE )
+    INSN ( "DECF",  none,  0x5A, X_NONE )
+    INSN ( "INCF",  none,  0x5C, X_NONE )
+    INSN ( "TSTF",  none,  0x5D, X_NONE )
+    INSN ( "CLRF",  none,  0x5F, X_NONE )
+    
+    ACC_ARGS_OP( "SUBE", 0x00 )
+    ACC_ARGS_OP( "CMPE", 0x01 )
+    ACC_ARGS_OP( "LDE",  0x06 )
+    ACC_ARGS_OP( "ADDE", 0x0B )
+    ACC_ARGS_OP_NOIMM( "STE", 0x07, X_PTR )
+    
+    ACC_ARGS_OP( "SUBF", 0x40 )
+    ACC_ARGS_OP( "CMPF", 0x41 )
+    ACC_ARGS_OP( "LDF",  0x46 )
+    ACC_ARGS_OP( "ADDF", 0x4B )
+    ACC_ARGS_OP_NOIMM( "STF", 0x47, X_PTR )
+    
+    ACC_ARGS_OP ( "DIVD", 0x0D )
+    ACC_ARGS_OPW( "DIVQ", 0x0E )
+    ACC_ARGS_OPW( "MULD", 0x0F )
+    
+    END
+};
+
+/******************************************************************************/
+/* 6809 */
+/******************************************************************************/
+
 static optab_t page2[] = {
 
+    VARIANT ( page2_6309, cpu, CPU_6309 )
+
     INSN ( "LBRN", rel16, 0x21, X_JMP )
     INSN ( "LBHI", rel16, 0x22, X_JMP )
     INSN ( "LBLS", rel16, 0x23, X_JMP )
@@ -377,6 +765,8 @@ static optab_t page2[] = {
 
 static optab_t page3[] = {
 
+    VARIANT ( page3_6309, cpu, CPU_6309 )
+
     INSN ( "SWI3", none,     0x3F, X_NONE )
 
     INSN ( "CMPU", imm16,    0x83, X_NONE )
@@ -394,40 +784,10 @@ static optab_t page3[] = {
     END
 };
 
-/** Macros to define classes of instruction **/
-
-#define ACC_ARGS_OP(M_name, M_base)    \
-        INSN(M_name, imm8,     (0x80 | M_base), X_NONE) \
-        INSN(M_name, direct,   (0x90 | M_base), X_NONE) \
-        INSN(M_name, indexed,  (0xA0 | M_base), X_NONE) \
-        INSN(M_name, extended, (0xB0 | M_base), X_NONE)
-        
-#define ACC_ARGS_OPD(M_name, M_base)    \
-        INSN(M_name, imm16,    (0xC0 | M_base), X_NONE) \
-        INSN(M_name, direct,   (0xD0 | M_base), X_NONE) \
-        INSN(M_name, indexed,  (0xE0 | M_base), X_NONE) \
-        INSN(M_name, extended, (0xF0 | M_base), X_NONE)        
-
-#define ACC_AB_ARGS_OP(M_name, M_base)    \
-        ACC_ARGS_OP(M_name "A", (0x00 | M_base)) \
-        ACC_ARGS_OP(M_name "B", (0x40 | M_base))
-
-#define SINGLE_OP(M_name, M_base) \
-        INSN(M_name, direct,   (0x00 | M_base), X_NONE) \
-        INSN(M_name, indexed,  (0x60 | M_base), X_NONE) \
-        INSN(M_name, extended, (0x70 | M_base), X_NONE)
-        
-#define ACC_ARGS_OP_NOIMM(M_name, M_base, M_xref)    \
-        INSN(M_name, direct,   (0x90 | M_base), M_xref) \
-        INSN(M_name, indexed,  (0xA0 | M_base), M_xref) \
-        INSN(M_name, extended, (0xB0 | M_base), M_xref)
-        
-#define ACC_OP_INH(M_name, M_base) \
-        INSN( M_name "A", none, ( 0x40 | M_base ), X_NONE ) \
-        INSN( M_name "B", none, ( 0x50 | M_base ), X_NONE )            
-
 optab_t base_optab[] = {
 
+    VARIANT ( base6309, cpu, CPU_6309 )
+
 /*----------------------------------------------------------------------------
   8-bit Accumulator and Memory
   ----------------------------------------------------------------------------*/
@@ -556,7 +916,9 @@ optab_t base_optab[] = {
     INSN ( "SWI",   none, 0x3F, X_NONE )
     INSN ( "SYNC",  none, 0x13, X_NONE )
 
-    SINGLE_OP( "JMP", 0x0E )
+    INSN ( "JMP",   direct,   0x0E, X_NONE )
+    INSN ( "JMP",   indexed,  0x6E, X_JMP )
+    INSN ( "JMP",   extended, 0x7E, X_JMP )
     ACC_ARGS_OP_NOIMM( "JSR", 0x0D, X_CALL )
     
 /*----------------------------------------------------------------------------
@@ -43,6 +43,27 @@
  *****************************************************************************/
 
 DASM_PROFILE( "dasm8048", "Intel MCS-48 (8048, 8049)", 4, 9, 0, 1 )
+INTEL_SYNTAX( "ASM48", "DB", "DW", 0 )
+DASM_FLOW(
+    FLOW  ( "JMP",  JUMP )
+    FLOW  ( "JMPP", JUMP )
+    FLOW  ( "RET",  RETURN )
+    FLOW  ( "RETR", RETURN )
+)
+DASM_DISPATCH(
+    DISPATCH( "JMPP @A",     "ADD A,#",      NULL,           NULL,       PAGE,  1 )
+)
+DASM_TRACK()
+DASM_REGS( 0, 0 )
+
+/* Memory bank flip-flop, set by SEL MB0/MB1; -1 for the bank of the insn */
+static int mem_bank = -1;
+
+DASM_MODES(
+    MODE( "MB0",    mem_bank,   0 )
+    MODE( "MB1",    mem_bank,   1 )
+    MODE( "MBX",    mem_bank,  -1 )
+)
 
 /*****************************************************************************
  * Private data types, macros, constants.
@@ -84,87 +105,90 @@ OPERAND_FUNC(none)
 
 OPERAND_FUNC(A)
 {
-   operand( "A" );
+   emit_reg( "A", 0 );
 }
 
 OPERAND_FUNC(indA)
 {
-   operand( "@A" );
+   emit_text( "@" );
+   emit_reg( "A", 0 );
 }
 
 OPERAND_FUNC(I)
 {
-   operand( "I" );
+   emit_reg( "I", 0 );
 }
 
 OPERAND_FUNC(C)
 {
-   operand( "C" );
+   emit_reg( "C", 0 );
 }
 
 OPERAND_FUNC(T)
 {
-   operand( "T" );
+   emit_reg( "T", 0 );
 }
 
 OPERAND_FUNC(PSW)
 {
-   operand( "PSW" );
+   emit_reg( "PSW", 0 );
 }
 
 OPERAND_FUNC(BUS)
 {
-   operand( "BUS" );
+   emit_reg( "BUS", 0 );
 }
 
 OPERAND_FUNC(CLK)
 {
-   operand( "CLK" );
+   emit_reg( "CLK", 0 );
 }
 
 OPERAND_FUNC(CNT)
 {
-   operand( "CNT" );
+   emit_reg( "CNT", 0 );
 }
 
 OPERAND_FUNC(TCNT)
 {
-   operand( "TCNT" );
+   emit_reg( "TCNT", 0 );
 }
 
 OPERAND_FUNC(TCNTI)
 {
-   operand( "TCNTI" );
+   emit_reg( "TCNTI", 0 );
 }
 
 OPERAND_FUNC(F0)
 {
-   operand( "F0" );
+   emit_reg( "F0", 0 );
 }
 
 OPERAND_FUNC(F1)
 {
-   operand( "F1" );
+   emit_reg( "F1", 0 );
 }
 
 OPERAND_FUNC(RB0)
 {
-   operand( "RB0" );
+   emit_reg( "RB0", 0 );
 }
 
 OPERAND_FUNC(RB1)
 {
-   operand( "RB1" );
+   emit_reg( "RB1", 0 );
 }
 
 OPERAND_FUNC(MB0)
 {
-   operand( "MB0" );
+   emit_reg( "MB0", 0 );
+   mem_bank = 0;
 }
 
 OPERAND_FUNC(MB1)
 {
-   operand( "MB1" );
+   emit_reg( "MB1", 0 );
+   mem_bank = 1;
 }
 
 /***********************************************************
@@ -176,7 +200,7 @@ OPERAND_FUNC(reg)
 {
    UBYTE reg = opc & 0x07;
    
-   operand( FORMAT_REG, reg );
+   emit_reg( FORMAT_REG, reg );
 }
 
 /***********************************************************
@@ -188,7 +212,7 @@ OPERAND_FUNC(port)
 {
    UBYTE port = opc & 0x03;
    
-   operand( FORMAT_PORT, port );
+   emit_reg( FORMAT_PORT, port );
 }
 
 /***********************************************************
@@ -200,7 +224,7 @@ OPERAND_FUNC(portH)
 {
    UBYTE port = ( opc & 0x03 ) + 4;
    
-   operand( FORMAT_PORT, port );
+   emit_reg( FORMAT_PORT, port );
 }
 
 /***********************************************************
@@ -212,7 +236,8 @@ OPERAND_FUNC(indreg)
 {
    UBYTE reg = opc & 0x01;
    
-   operand( "@" FORMAT_REG, reg );
+   emit_text( "@" );
+   emit_reg( FORMAT_REG, reg );
 }
 
 /***********************************************************
@@ -224,7 +249,7 @@ OPERAND_FUNC(imm8)
 {
    UBYTE imm8 = next( f, addr );
    
-   operand( "#" FORMAT_NUM_8BIT, imm8 );
+   emit_imm( "#" FORMAT_NUM_8BIT, imm8 );
 }
 
 /***********************************************************
@@ -236,7 +261,7 @@ OPERAND_FUNC(addrbit)
 {
    UBYTE bit = ( opc >> 5 ) & 0x07;
 
-   operand( "%d", bit );
+   emit_bit( "%d", bit );
 }
 
 /***********************************************************
@@ -248,13 +273,13 @@ OPERAND_FUNC(addr8)
 {
    UBYTE addr8 = (UBYTE)next( f, addr );
    
-   operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr8 ) );
-   xref_addxref( xtype, g_insn_addr, addr8 );
+   emit_addr( FORMAT_NUM_16BIT, addr8, xtype );
 }
 
 /***********************************************************
  * 11-bit address
- *   Address comes from top three bits of OPC and next byte.
+ *   Address comes from top three bits of OPC and next byte,
+ *   with A11 from the memory bank flip-flop if it is known.
  ************************************************************/
  
 OPERAND_FUNC(addr11)
@@ -262,9 +287,13 @@ OPERAND_FUNC(addr11)
    UBYTE msb_addr  = ( opc >> 5) & 0x07;
    UBYTE lsb_addr  = next( f, addr );
    UWORD addr11    = MK_WORD( lsb_addr, msb_addr );
+   
+   if ( mem_bank < 0 )
+      addr11 |= g_insn_addr & 0x800;
+   else
+      addr11 |= mem_bank << 11;
 
-   operand( "%s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr11 ) );
-   xref_addxref( xtype, g_insn_addr, addr11 );
+   emit_addr( FORMAT_NUM_16BIT, addr11, xtype );
 }
 
 /******************************************************************************/
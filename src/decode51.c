@@ -43,6 +43,54 @@
  *****************************************************************************/
 
 DASM_PROFILE( "dasm8051", "Intel 8051", 4, 9, 0, 1 )
+ASXXXX_SYNTAX( "\t.area\tCSEG\t(ABS,CODE)", 0 )
+DASM_FLOW(
+    FLOW  ( "AJMP", JUMP )
+    FLOW  ( "LJMP", JUMP )
+    FLOW  ( "SJMP", JUMP )
+    FLOW  ( "JMP",  JUMP )
+    FLOW  ( "RET",  RETURN )
+    FLOW  ( "RETI", RETURN )
+)
+DASM_DISPATCH(
+    DISPATCH( "JMP @A+DPTR", "MOV DPTR,#",   NULL,           "CJNE A,#,%", JUMPS, 1 )
+)
+DASM_TRACK(
+    TRACK_LOAD    ( "DPTR", "MOV DPTR,#" )
+    TRACK_STEP    ( "DPTR", "INC DPTR", 1 )
+    TRACK_KILL_AT ( "DPTR", "MOV %,*|INC %|DEC %|POP %|XCH A,%|ANL %,*|ORL %,*|XRL %,*|DJNZ %,*", 0x82 )
+    TRACK_KILL_AT ( "DPTR", "MOV %,*|INC %|DEC %|POP %|XCH A,%|ANL %,*|ORL %,*|XRL %,*|DJNZ %,*", 0x83 )
+    TRACK_USE     ( "DPTR", "JMP @A+DPTR",     TABLE )
+    TRACK_USE     ( "DPTR", "MOVC *,@A+DPTR",  TABLE )
+    TRACK_USE     ( "DPTR", "MOVX *@DPTR*",    DATA )
+)
+DASM_REGS( 0, 0 )
+
+/**
+    Code banking.  Boards with more than 64K of code switch banks of it
+    into a window of the address space by writing to a port or other
+    direct address, and the image holds the banks one after another:
+    bank n of the window at BANKLO + n * BANKSTEP.  Jumps and calls into
+    the window go to the bank last selected by a MOV of a constant to 
+    the bank register, else to the bank of the code making them.  The
+    layout is fixed for the image; only the bank selected is followed.
+**/
+static int bank      = -1;      /* selected bank, -1 for that of the insn  */
+static int bank_reg  = -1;      /* direct address selecting it             */
+static int bank_mask = 0xFF;    /* bits of it giving the bank number       */
+static int bank_lo   = 0x8000;  /* start of the window                     */
+static int bank_size = 0;       /* size of the window, 0 for no banking    */
+static int bank_step = 0;       /* distance between banks in the image, 
+                                   0 for the size of the window            */
+
+DASM_MODES(
+    MODE_ARG( "BANK",     bank )
+    SETTING ( "BANKREG",  bank_reg )
+    SETTING ( "BANKMASK", bank_mask )
+    SETTING ( "BANKLO",   bank_lo )
+    SETTING ( "BANKSIZE", bank_size )
+    SETTING ( "BANKSTEP", bank_step )
+)
 
 /*****************************************************************************
  * Private data types, macros, constants.
@@ -60,6 +108,73 @@ DASM_PROFILE( "dasm8051", "Intel 8051", 4, 9, 0, 1 )
  *        Private Functions
  *****************************************************************************/
 
+/***********************************************************
+ * Bank of the window that an image address lies in, or -1.
+ ************************************************************/
+
+static int bank_of( ADDR addr )
+{
+   ADDR step = bank_step ? (ADDR)bank_step : (ADDR)bank_size;
+   
+   if ( !bank_size || addr < (ADDR)bank_lo 
+        || ( addr - bank_lo ) % step >= (ADDR)bank_size )
+      return -1;
+      
+   return ( addr - bank_lo ) / step;
+}
+
+/***********************************************************
+ * Image address of a code address, in the selected bank if it
+ *  lies in the window.
+ ************************************************************/
+
+static ADDR banked( UWORD target )
+{
+   int n = bank >= 0 ? bank : bank_of( g_insn_addr );
+   
+   if ( !bank_size || target < bank_lo || target >= bank_lo + bank_size )
+      return target;
+      
+   return bank_lo + ( n > 0 ? n : 0 ) * ( bank_step ? bank_step : bank_size )
+          + ( target - bank_lo );
+}
+
+/***********************************************************
+ * Code address of an image address, as the processor sees it.
+ ************************************************************/
+
+static UWORD unbanked( ADDR addr )
+{
+   if ( bank_of( addr ) > 0 )
+      return bank_lo + ( addr - bank_lo ) % ( bank_step ? bank_step : bank_size );
+      
+   return (UWORD)addr;
+}
+
+/***********************************************************
+ * Notes a write to a direct address, which selects a bank if
+ *  it is the bank register: value is what is written, or -1 
+ *  if that is not known.
+ ************************************************************/
+
+static void write_direct( UBYTE iaddr, int value )
+{
+   int shift;
+   
+   if ( iaddr != bank_reg )
+      return;
+      
+   if ( value < 0 || !bank_mask )
+   {
+      bank = -1;
+      return;
+   }
+      
+   for ( shift = 0; !( bank_mask & ( 1 << shift ) ); shift++ )
+      ;
+   bank = ( value & bank_mask ) >> shift;
+}
+
 /******************************************************************************/
 /**                            Operand Functions                             **/
 /******************************************************************************/
@@ -83,32 +198,32 @@ OPERAND_FUNC(none)
 
 OPERAND_FUNC(A)
 {
-   operand( "A" );
+   emit_reg( "A", 0 );
 }
 
 OPERAND_FUNC(B)
 {
-   operand( "B" );
+   emit_reg( "B", 0 );
 }
 
 OPERAND_FUNC(C)
 {
-   operand( "C" );
+   emit_reg( "C", 0 );
 }
 
 OPERAND_FUNC(AB)
 {
-   operand( "AB" );
+   emit_reg( "AB", 0 );
 }
 
 OPERAND_FUNC(PC)
 {
-   operand( "PC" );
+   emit_reg( "PC", 0 );
 }
 
 OPERAND_FUNC(dptr)
 {
-   operand( "DPTR" );
+   emit_reg( "DPTR", 0 );
 }
 
 /***********************************************************
@@ -120,7 +235,7 @@ OPERAND_FUNC(reg)
 {
    UBYTE reg = opc & 0x07;
    
-   operand( FORMAT_REG, reg );
+   emit_reg( FORMAT_REG, reg );
 }
 
 /***********************************************************
@@ -132,7 +247,8 @@ OPERAND_FUNC(indreg)
 {
    UBYTE reg = opc & 0x01;
    
-   operand( "@" FORMAT_REG, reg );
+   emit_text( "@" );
+   emit_reg( FORMAT_REG, reg );
 }
 
 /***********************************************************
@@ -144,7 +260,7 @@ OPERAND_FUNC(imm8)
 {
    UBYTE imm8 = next( f, addr );
    
-   operand( "#" FORMAT_NUM_8BIT, imm8 );
+   emit_imm( "#" FORMAT_NUM_8BIT, imm8 );
 }
 
 /***********************************************************
@@ -158,7 +274,7 @@ OPERAND_FUNC(imm16)
    UBYTE lsb   = next( f, addr );
    UWORD imm16 = MK_WORD( lsb, msb );
 
-   operand( "#" FORMAT_NUM_16BIT, imm16 );
+   emit_imm( "#" FORMAT_NUM_16BIT, imm16 );
 }
 
 /***********************************************************
@@ -171,14 +287,12 @@ OPERAND_FUNC(addrbit)
    UBYTE bit      = next( f, addr );
    int bitnum     = bit % 8;
    int bytenum    = bit & 0xF8;
-   const char * s = xref_findaddrlabel( bytenum );
-
-   if ( s )
-      operand( "%s", s );
-   else
-      operand( FORMAT_NUM_8BIT, bytenum );
 
-   operand( ".%d", bitnum );
+   emit_addr( FORMAT_NUM_8BIT, bytenum, X_NONE );
+   emit_bit( ".%d", bitnum );
+   
+   if ( opc == 0x10 || opc == 0x92 || opc == 0xB2 || opc == 0xC2 || opc == 0xD2 )
+      write_direct( bytenum, -1 );
 }
 
 /***********************************************************
@@ -189,12 +303,21 @@ OPERAND_FUNC(addrbit)
 OPERAND_FUNC(iram)
 {
    UBYTE iaddr = next( f, addr );
-   const char * s;
    
-   if ( ( s = xref_findaddrlabel( iaddr ) ) )
-      operand( "%s", s );
-   else
-      operand( FORMAT_NUM_8BIT, iaddr );
+   emit_addr( FORMAT_NUM_8BIT, iaddr, X_NONE );
+   
+   /* Anything but a MOV of a constant leaves the bank unknown */
+   switch ( opc )
+   {
+   case 0x05: case 0x15: case 0x42: case 0x52: case 0x62: case 0x85: 
+   case 0x86: case 0x87: case 0xC5: case 0xD0: case 0xD5: case 0xF5:
+      write_direct( iaddr, -1 );
+      break;
+   default:
+      if ( ( opc & 0xF8 ) == 0x88 )
+         write_direct( iaddr, -1 );
+      break;
+   }
 }
 
 /***********************************************************
@@ -207,11 +330,14 @@ OPERAND_FUNC(addr11)
    UBYTE msb_addr  = ( opc >> 5) & 0x07;
    UBYTE lsb_addr  = next( f, addr );
    UWORD addr11    = MK_WORD( lsb_addr, msb_addr );
-   UWORD addr16    = (UWORD)*addr;
-   addr16 = ( addr16 & 0xF800 ) | addr11;
+   ADDR  dest      = ( *addr & ~(ADDR)0x7FF ) | addr11;
+   
+   /* The 2K page is that of the next insn, in its own bank */
+   if ( !bank_size )
+      dest &= 0xFFFF;
 
-   operand( "%s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr16 ) );
-   xref_addxref( xtype, g_insn_addr, addr16 );
+   emit_operand( OPND_ADDR, FORMAT_NUM_16BIT, unbanked( dest ), dest, 
+                 xtype, OPF_LABEL );
 }
 
 /***********************************************************
@@ -225,8 +351,8 @@ OPERAND_FUNC(addr16)
    UBYTE lsb_addr  = next( f, addr );
    UWORD addr16    = MK_WORD( lsb_addr, msb_addr );
 
-   operand( "%s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr16 ) );
-   xref_addxref( xtype, g_insn_addr, addr16 );
+   emit_operand( OPND_ADDR, FORMAT_NUM_16BIT, addr16, banked( addr16 ), 
+                 xtype, OPF_LABEL );
 }
 
 /***********************************************************
@@ -238,8 +364,12 @@ OPERAND_FUNC(rel8)
    BYTE ofst = (BYTE)next( f, addr );
    ADDR dest = *addr + ofst;
    
-   operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-   xref_addxref( xtype, g_insn_addr, dest );
+   /* The program counter wraps at 64K, as it does in each bank */
+   if ( !bank_size )
+      dest &= 0xFFFF;
+      
+   emit_operand( OPND_REL, FORMAT_NUM_16BIT, unbanked( dest ), dest, 
+                 xtype, OPF_LABEL );
 }
 
 /******************************************************************************/
@@ -249,7 +379,23 @@ OPERAND_FUNC(rel8)
 TWO_OPERAND(A, imm8)
 TWO_OPERAND(reg, imm8)
 TWO_OPERAND(reg, rel8)
-TWO_OPERAND(iram, imm8)
+
+/***********************************************************
+ * Direct address and 8-bit immediate operand.
+ *   A MOV of a constant to the bank register selects a bank.
+ ************************************************************/
+
+OPERAND_FUNC(iram_imm8)
+{
+   UBYTE iaddr = next( f, addr );
+   UBYTE imm8  = next( f, addr );
+   
+   emit_addr( FORMAT_NUM_8BIT, iaddr, X_NONE );
+   COMMA;
+   emit_imm( "#" FORMAT_NUM_8BIT, imm8 );
+   
+   write_direct( iaddr, opc == 0x75 ? imm8 : -1 );
+}
 TWO_OPERAND(iram, rel8)
 TWO_OPERAND(iram, iram)
 TWO_OPERAND(indreg, imm8)
@@ -266,15 +412,15 @@ OPERAND_FUNC(C_n_addrbit)
 {
     operand_C( f, addr, opc, xtype );
     COMMA;
-    operand( "/" );
+    emit_text( "/" );
     operand_addrbit( f, addr, opc, xtype );
 }
 
 OPERAND_FUNC(A_plus_dptr)
 {
-    operand( "@" );
+    emit_text( "@" );
     operand_A( f, addr, opc, xtype );
-    operand( "+" );
+    emit_text( "+" );
     operand_dptr( f, addr, opc, xtype );
 }
 
@@ -282,13 +428,13 @@ OPERAND_FUNC(A_dptr)
 {
     operand_A( f, addr, opc, xtype );
     COMMA;
-    operand( "@" );
+    emit_text( "@" );
     operand_dptr( f, addr, opc, xtype );
 }
 
 OPERAND_FUNC(dptr_A)
 {
-    operand( "@" );
+    emit_text( "@" );
     operand_dptr( f, addr, opc, xtype );
     COMMA;
     operand_A( f, addr, opc, xtype );
@@ -307,9 +453,9 @@ OPERAND_FUNC(A_A_dptr)
 {
     operand_A( f, addr, opc, xtype );
     COMMA;
-    operand( "@" );
+    emit_text( "@" );
     operand_A( f, addr, opc, xtype );
-    operand( "+" );
+    emit_text( "+" );
     operand_dptr( f, addr, opc, xtype );
 }
 
@@ -317,9 +463,9 @@ OPERAND_FUNC(A_A_PC)
 {
     operand_A( f, addr, opc, xtype );
     COMMA;
-    operand( "@" );
+    emit_text( "@" );
     operand_A( f, addr, opc, xtype );
-    operand( "+" );
+    emit_text( "+" );
     operand_PC( f, addr, opc, xtype );
 }
 
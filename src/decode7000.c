@@ -43,6 +43,23 @@
  *****************************************************************************/
 
 DASM_PROFILE( "dasm7000", "TI TMS7000", 4, 9, 1, 1 )
+DASM_SYNTAX( .name = "TI TMS7000 assembler", .comment = "*",
+             .label = "%s\tEQU\t$", .equ = "%s\tEQU\t%s", .here = "$",
+             .org = "AORG", .db = "BYTE", .dw = "DATA", 
+             .ascii = "TEXT", .quote = '\'', .end = "END",
+             .hex_prefix = ">", .hex_suffix = "" )
+DASM_FLOW(
+    FLOW  ( "JMP",  JUMP )
+    FLOW  ( "BR",   JUMP )
+    FLOW  ( "RETS", RETURN )
+    FLOW  ( "RETI", RETURN )
+)
+DASM_DISPATCH(
+    DISPATCH( "BR @%(B)",    NULL,           NULL,           "CMP #,B",  JUMPS, 1 )
+)
+DASM_TRACK()
+DASM_REGS( 0, 0 )
+DASM_MODES()
 
 /*****************************************************************************
  * Private data types, macros, constants.
@@ -83,7 +100,7 @@ OPERAND_FUNC(none)
 
 OPERAND_FUNC(A)
 {
-    operand( "A" );
+    emit_reg( "A", 0 );
 }
 
 /***********************************************************
@@ -92,7 +109,7 @@ OPERAND_FUNC(A)
 
 OPERAND_FUNC(B)
 {
-    operand( "B" );
+    emit_reg( "B", 0 );
 }
 
 /***********************************************************
@@ -101,7 +118,7 @@ OPERAND_FUNC(B)
  
 OPERAND_FUNC(ST)
 {
-    operand( "ST" );
+    emit_reg( "ST", 0 );
 }
 
 /***********************************************************
@@ -113,7 +130,7 @@ OPERAND_FUNC(reg)
 {
     UBYTE reg = next( f, addr );
     
-    operand( FORMAT_REG, reg );
+    emit_reg( FORMAT_REG, reg );
 }
 
 /***********************************************************
@@ -125,7 +142,7 @@ OPERAND_FUNC(iop)
 {
     UBYTE iop = next( f, addr );
     
-    operand( "%%" FORMAT_NUM_8BIT, iop );
+    emit_imm( "%%" FORMAT_NUM_8BIT, iop );
 }
 
 /***********************************************************
@@ -141,13 +158,10 @@ OPERAND_FUNC(iop)
 OPERAND_FUNC(Pn)
 {
     UBYTE pn = next( f, addr );
-    const char * s;
     
-    if ( pn <= MAX_INTERNAL_PERIP_REG 
-         && ( s = xref_findaddrlabel( pn + INTERNAL_PERIP_REG_BASE ) ) )
-        operand( "%s", s );
-    else
-        operand( "P" FORMAT_NUM_8BIT, pn );
+    emit_operand( OPND_ADDR, "P" FORMAT_NUM_8BIT, pn, 
+                  pn + INTERNAL_PERIP_REG_BASE, X_NONE,
+                  pn <= MAX_INTERNAL_PERIP_REG ? OPF_LABEL : 0 );
 }
 
 /***********************************************************
@@ -158,7 +172,7 @@ OPERAND_FUNC(trap)
 {
     UBYTE t = opc - 0xE8;
     
-    operand( "%d", t );
+    emit_disp( "%d", t );
 }
 
 /***********************************************************
@@ -172,8 +186,8 @@ OPERAND_FUNC(iop16)
     UBYTE lsb   = next( f, addr );
     UWORD iop16 = MK_WORD( lsb, msb );
 
-    operand( "%%%s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, iop16 ) );
-    xref_addxref( xtype, g_insn_addr, iop16 );
+    emit_text( "%" );
+    emit_operand( OPND_IMM, FORMAT_NUM_16BIT, iop16, iop16, xtype, OPF_LABEL );
 }
 
 /***********************************************************
@@ -184,7 +198,9 @@ OPERAND_FUNC(iop16)
 OPERAND_FUNC(iop16_B)
 {
     operand_iop16( f, addr, opc, xtype );
-    operand( "(B)" );
+    emit_text( "(" );
+    emit_reg( "B", 0 );
+    emit_text( ")" );
 }
 
 /***********************************************************
@@ -198,8 +214,8 @@ OPERAND_FUNC(label)
     UBYTE lsb_addr  = next( f, addr );
     UWORD addr16    = MK_WORD( lsb_addr, msb_addr );
 
-    operand( "@%s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr16 ) );
-    xref_addxref( xtype, g_insn_addr, addr16 );
+    emit_text( "@" );
+    emit_addr( FORMAT_NUM_16BIT, addr16, xtype );
 }
 
 /***********************************************************
@@ -210,7 +226,9 @@ OPERAND_FUNC(label)
 OPERAND_FUNC(label_B)
 {
     operand_label( f, addr, opc, xtype );
-    operand( "(B)" );
+    emit_text( "(" );
+    emit_reg( "B", 0 );
+    emit_text( ")" );
 }
 
 /***********************************************************
@@ -219,7 +237,7 @@ OPERAND_FUNC(label_B)
  
 OPERAND_FUNC(indreg)
 {
-    operand( "*" );
+    emit_text( "*" );
     operand_reg( f, addr, opc, xtype );
 }
 
@@ -232,8 +250,7 @@ OPERAND_FUNC(ofst)
     BYTE ofst = (BYTE)next( f, addr );
     ADDR dest = *addr + ofst;
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest );
+    emit_rel( FORMAT_NUM_16BIT, dest, xtype );
 }
 
 /******************************************************************************/
@@ -300,6 +317,11 @@ THREE_OPERAND(reg, Pn, ofst)
                 INSN( M_name, label,   ( 0x80 | M_mask ), X_PTR ) \
                 INSN( M_name, label_B, ( 0xA0 | M_mask ), X_PTR ) \
                 INSN( M_name, indreg,  ( 0x90 | M_mask ), X_PTR )
+
+#define FLOW_OPS(M_name, M_mask, M_xref) \
+                INSN( M_name, label,   ( 0x80 | M_mask ), M_xref ) \
+                INSN( M_name, label_B, ( 0xA0 | M_mask ), X_PTR ) \
+                INSN( M_name, indreg,  ( 0x90 | M_mask ), X_PTR )
                 
 #define BT_OP(M_name, M_mask) \
                 INSN( M_name, B_A_ofst,        ( 0x60 | M_mask ), X_NONE ) \
@@ -353,9 +375,9 @@ optab_t base_optab[] = {
 #endif
 
     INSN ( "JMP", ofst, 0xE0, X_JMP )
-    WORD_OPS( "BR",   0x0C )
+    FLOW_OPS( "BR",   0x0C, X_JMP )
     
-    WORD_OPS( "CALL", 0x0E )
+    FLOW_OPS( "CALL", 0x0E, X_CALL )
     INSN ( "RETI", none, 0x0B, X_NONE )
     INSN ( "RETS", none, 0x0A, X_NONE )
 
@@ -43,6 +43,58 @@
  *****************************************************************************/
 
 DASM_PROFILE( "dasm78k3", "NEC 78K/III", 5, 9, 0, 1 )
+INTEL_SYNTAX( "RA78K3", "DB", "DW", 0 )
+DASM_FLOW(
+    FLOW  ( "br",   JUMP )
+    FLOW  ( "ret",  RETURN )
+    FLOW  ( "reti", RETURN )
+    FLOW  ( "retcs", RETURN )
+)
+DASM_DISPATCH()
+DASM_TRACK(
+    TRACK_LOAD    ( "VP", "movw VP,#" )
+    TRACK_LOAD    ( "UP", "movw UP,#" )
+    TRACK_STEP    ( "VP", "incw VP",  1 )
+    TRACK_STEP    ( "VP", "decw VP", -1 )
+    TRACK_STEP    ( "UP", "incw UP",  1 )
+    TRACK_STEP    ( "UP", "decw UP", -1 )
+    TRACK_KILL    ( "VP", "*VPL*|*VPH*" )
+    TRACK_KILL    ( "UP", "*UPL*|*UPH*|pushu*|popu*" )
+    TRACK_USE     ( "VP", "*[VP]*",         DATA )
+    TRACK_USE     ( "UP", "*[UP]*",         DATA )
+    TRACK_USE_DISP( "VP", "*[VP+%]*",       DATA )
+    TRACK_USE_DISP( "UP", "*[UP+%]*",       DATA )
+    TRACK_USE     ( "VP", "*[VP+DE]*|*[VP+HL]*|push*VP*", NONE )
+    TRACK_USE     ( "UP", "push*UP*",       NONE )
+)
+DASM_REGS( 0xFE00, 0x200,
+    ACCESS( "cmp",   READ )
+    ACCESS( "cmpw",  READ )
+    ACCESS( "bt",    READ )
+    ACCESS( "bf",    READ )
+    ACCESS( "add",   MODIFY )
+    ACCESS( "addc",  MODIFY )
+    ACCESS( "sub",   MODIFY )
+    ACCESS( "subc",  MODIFY )
+    ACCESS( "and",   MODIFY )
+    ACCESS( "or",    MODIFY )
+    ACCESS( "xor",   MODIFY )
+    ACCESS( "addw",  MODIFY )
+    ACCESS( "subw",  MODIFY )
+    ACCESS( "inc",   MODIFY )
+    ACCESS( "dec",   MODIFY )
+    ACCESS( "incw",  MODIFY )
+    ACCESS( "decw",  MODIFY )
+    ACCESS( "dbnz",  MODIFY )
+    ACCESS( "set1",  MODIFY )
+    ACCESS( "clr1",  MODIFY )
+    ACCESS( "not1",  MODIFY )
+    ACCESS( "btclr", MODIFY )
+    ACCESS( "bfset", MODIFY )
+    ACCESS( "xch",   EXCHANGE )
+    ACCESS( "xchw",  EXCHANGE )
+)
+DASM_MODES()
 
 /*****************************************************************************
  * Private data types, macros, constants.
@@ -242,8 +294,28 @@ static void emit_saddr( UBYTE offset )
 {
    ADDR saddr = offset + ( offset >= 0x20 ? SADDR_OFFSET : SFR_OFFSET );
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, saddr ) );
-    xref_addxref( saddr >= SFR_OFFSET ? X_REG : X_PTR, g_insn_addr, saddr );
+    emit_addr( FORMAT_NUM_16BIT, saddr, saddr >= SFR_OFFSET ? X_REG : X_PTR );
+}
+
+/************************************************************
+ * FUNCTION
+ *      emit_memmod_reg
+ *
+ * DESCRIPTION
+ *      Emit one of the MEM_MOD_xxx register names.  Not every
+ *      mem code is defined for every mode, so undefined codes
+ *      are shown as "???".
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+static void emit_memmod_reg( const char **tab, unsigned int n, UBYTE mem )
+{
+    if ( mem < n )
+        emit_reg( tab[mem], mem );
+    else
+        emit_text( "???" );
 }
 
 /******************************************************************************/
@@ -271,7 +343,7 @@ OPERAND_FUNC(bit)
 {
     UBYTE bit = opc & 0x07;
     
-    operand( ".%d", bit );
+    emit_bit( ".%d", bit );
 }
 
 /***********************************************************
@@ -283,7 +355,7 @@ OPERAND_FUNC(r)
 {
     UBYTE r = opc & 0x0F;
     
-    operand( "%s", R[r] );
+    emit_reg( R[r], r );
 }
 
 /***********************************************************
@@ -295,7 +367,7 @@ OPERAND_FUNC(r1)
 {
     UBYTE r1 = opc & 0x07;
     
-    operand( "%s", R[r1] );
+    emit_reg( R[r1], r1 );
 }
 
 /***********************************************************
@@ -307,7 +379,7 @@ OPERAND_FUNC(r2)
 {
     UBYTE r2 = opc & 0x01;
     
-    operand( "%s", R2[r2] );
+    emit_reg( R2[r2], r2 );
 }
 
 /***********************************************************
@@ -319,7 +391,7 @@ OPERAND_FUNC(rp)
 {
     UBYTE rp = opc & 0x07;
     
-    operand( "%s", RP[rp] );
+    emit_reg( RP[rp], rp );
 }
 
 /***********************************************************
@@ -331,7 +403,7 @@ OPERAND_FUNC(rp1)
 {
     UBYTE rp1 = opc & 0x07;
     
-    operand( "%s", RP1[rp1] );
+    emit_reg( RP1[rp1], rp1 );
 }
 
 /***********************************************************
@@ -343,7 +415,7 @@ OPERAND_FUNC(rp2)
 {
     UBYTE rp2 = opc & 0x03;
     
-    operand( "%s", RP2[rp2] );
+    emit_reg( RP2[rp2], rp2 );
 }
 
 /***********************************************************
@@ -355,7 +427,7 @@ OPERAND_FUNC(RBn)
 {
     UBYTE n = opc & 0x07;
     
-    operand( "RB%d", n );
+    emit_reg( "RB%d", n );
 }
 
 /***********************************************************
@@ -367,9 +439,9 @@ OPERAND_FUNC(RBn_ALT)
 {
     UBYTE n = opc & 0x07;
     
-    operand( "RB%d", n );
+    emit_reg( "RB%d", n );
     COMMA;
-    operand( "ALT" );
+    emit_reg( "ALT", 0 );
 }
 
 /***********************************************************
@@ -381,7 +453,7 @@ OPERAND_FUNC(byte)
 {
    UBYTE byte = next( f, addr );
     
-    operand( "#" FORMAT_NUM_8BIT, byte );
+    emit_imm( "#" FORMAT_NUM_8BIT, byte );
 }
 
 /***********************************************************
@@ -418,13 +490,12 @@ OPERAND_FUNC(sfr)
    UBYTE sfr_offset = next( f, addr );
     
     if ( sfr_offset == 0xFE )
-        operand( "PSWL" );
+        emit_reg( "PSWL", 0 );
     else if ( sfr_offset == 0xFF )
-        operand( "PSWH" );
+        emit_reg( "PSWH", 0 );
     else
     {
-        operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, sfr_offset + SFR_OFFSET ) );
-        xref_addxref( X_REG, g_insn_addr, sfr_offset + SFR_OFFSET );
+        emit_addr( FORMAT_NUM_16BIT, sfr_offset + SFR_OFFSET, X_REG );
     }
 }
 
@@ -438,15 +509,14 @@ OPERAND_FUNC(sfrp)
    UBYTE sfr_offset = next( f, addr );
     
     if ( sfr_offset == 0xFC )
-        operand( "SP" );
+        emit_reg( "SP", 0 );
     else if ( sfr_offset == 0xFE )
-        operand( "PSWL" );
+        emit_reg( "PSWL", 0 );
     else if ( sfr_offset == 0xFF )
-        operand( "PSWH" );
+        emit_reg( "PSWH", 0 );
     else
     {
-        operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, sfr_offset + SFR_OFFSET ) );
-        xref_addxref( X_REG, g_insn_addr, sfr_offset + SFR_OFFSET );
+        emit_addr( FORMAT_NUM_16BIT, sfr_offset + SFR_OFFSET, X_REG );
     }
 }
 
@@ -460,7 +530,7 @@ OPERAND_FUNC(mem)
 {
     UBYTE mem = opc & 0x07;
     
-    operand( "%s", MEM_MOD_RI[mem] );
+    emit_reg( MEM_MOD_RI[mem], mem );
 }
 
 /***********************************************************
@@ -479,11 +549,13 @@ OPERAND_FUNC(memmod)
     if ( mod == 0x16 ) /* Register Indirect Addressing */
         operand_mem( f, addr, mem, xtype );
     else if ( mod == 0x17 ) /* Base Index Addressing */
-        operand( "%s", MEM_MOD_BI[mem] );
+        emit_memmod_reg( MEM_MOD_BI, 6, mem );
     else if ( mod == 0x06 ) /* Base Addressing */
     {
        low_offset  = next( f, addr );
-        operand( "%s" FORMAT_NUM_8BIT "]", MEM_MOD_BASE[mem], low_offset );
+        emit_memmod_reg( MEM_MOD_BASE, 5, mem );
+        emit_disp( FORMAT_NUM_8BIT, low_offset );
+        emit_text( "]" );
     }
     else if ( mod == 0x0A ) /* Index Addressing */
     {
@@ -493,25 +565,9 @@ OPERAND_FUNC(memmod)
         high_offset = next( f, addr );        
         base        = MK_WORD(low_offset, high_offset);
         
-        if ( xref_findaddrlabel( base ) )
-        {
-            operand( "%s%s", 
-                         xref_genwordaddr( NULL, FORMAT_NUM_16BIT, base ), 
-                        MEM_MOD_INDEX[mem] );
-        }
-        else if ( xref_findaddrlabel( base - 1 ) )
-        {
-            operand( "%s+1%s", 
-                         xref_genwordaddr( NULL, FORMAT_NUM_16BIT, base - 1 ), 
-                        MEM_MOD_INDEX[mem] );
-        }
-        else
-        {
-            operand( "$" FORMAT_ADDR "%s", 
-                         base, 
-                        MEM_MOD_INDEX[mem] );
-        }
-        xref_addxref( X_TABLE, g_insn_addr, base );
+        emit_operand( OPND_ADDR, "$" FORMAT_ADDR, base, base, X_TABLE,
+                      OPF_LABEL | OPF_LABEL_NEAR );
+        emit_memmod_reg( MEM_MOD_INDEX, 4, mem );
     }
 }
 
@@ -524,8 +580,9 @@ OPERAND_FUNC(ind_addr5)
     UBYTE addr5 = opc & 0x1f;
     ADDR  vector = 0x0040 + ( 2 * addr5 );
     
-    operand( "[" FORMAT_NUM_16BIT "]", vector );
-    xref_addxref( xtype, g_insn_addr, vector );
+    emit_text( "[" );
+    emit_operand( OPND_ADDR, FORMAT_NUM_16BIT, vector, vector, xtype, 0 );
+    emit_text( "]" );
 }
 
 /***********************************************************
@@ -537,8 +594,8 @@ OPERAND_FUNC(addr11_abs)
     UBYTE low_addr = next( f, addr );
     ADDR addr11 = MK_WORD( low_addr, opc & 0x07 );
     
-    operand( "!%s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr11 ) );
-    xref_addxref( xtype, g_insn_addr, addr11 );
+    emit_text( "!" );
+    emit_addr( FORMAT_NUM_16BIT, addr11, xtype );
 }
 
 /***********************************************************
@@ -551,8 +608,8 @@ OPERAND_FUNC(addr16_abs)
     UBYTE high_addr = next( f, addr );
     UWORD addr16    = MK_WORD( low_addr, high_addr );
 
-    operand( "!%s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr16 ) );
-    xref_addxref( xtype, g_insn_addr, addr16 );
+    emit_text( "!" );
+    emit_addr( FORMAT_NUM_16BIT, addr16, xtype );
 }
 
 /***********************************************************
@@ -564,8 +621,8 @@ OPERAND_FUNC(addr16_rel)
     BYTE jdisp = (BYTE)next( f, addr );
     ADDR addr16 = *addr + jdisp;
     
-    operand( "$%s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr16 ) );
-    xref_addxref( xtype, g_insn_addr, addr16 );
+    emit_text( "$" );
+    emit_rel( FORMAT_NUM_16BIT, addr16, xtype );
 }
 
 /***********************************************************
@@ -579,8 +636,8 @@ OPERAND_FUNC(word)
     UBYTE high_byte = next( f, addr );
     UWORD word      = MK_WORD( low_byte, high_byte );
     
-    operand( "#%s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, word ) );
-    xref_addxref( xtype, g_insn_addr, word );
+    emit_text( "#" );
+    emit_operand( OPND_IMM, FORMAT_NUM_16BIT, word, word, xtype, OPF_LABEL );
 }
 
 /***********************************************************
@@ -589,7 +646,7 @@ OPERAND_FUNC(word)
  
 OPERAND_FUNC(A)
 {
-    operand( "A" );
+    emit_reg( "A", 0 );
 }
 
 /***********************************************************
@@ -598,7 +655,7 @@ OPERAND_FUNC(A)
  
 OPERAND_FUNC(CY)
 {
-    operand( "CY" );
+    emit_reg( "CY", 0 );
 }
 
 /***********************************************************
@@ -607,7 +664,7 @@ OPERAND_FUNC(CY)
  
 OPERAND_FUNC(SP)
 {
-    operand( "SP" );
+    emit_reg( "SP", 0 );
 }
 
 /***********************************************************
@@ -626,8 +683,8 @@ OPERAND_FUNC(post)
         if ( post & BIT(bit) )
         {
             if ( comma )
-                operand( "," );
-            operand( "%s", RP[bit] );
+                emit_text( "," );
+            emit_reg( RP[bit], bit );
             comma = 1;
         }
     }
@@ -639,7 +696,7 @@ OPERAND_FUNC(post)
  
 OPERAND_FUNC(PSW)
 {
-    operand( "PSW" );
+    emit_reg( "PSW", 0 );
 }
 
 /***********************************************************
@@ -648,7 +705,7 @@ OPERAND_FUNC(PSW)
  
 OPERAND_FUNC(DE_inc)
 {
-    operand( "[DE+]" );
+    emit_reg( "[DE+]", 0 );
 }
 
 /***********************************************************
@@ -657,7 +714,7 @@ OPERAND_FUNC(DE_inc)
  
 OPERAND_FUNC(DE_dec)
 {
-    operand( "[DE-]" );
+    emit_reg( "[DE-]", 0 );
 }
 
 /***********************************************************
@@ -666,7 +723,7 @@ OPERAND_FUNC(DE_dec)
 
 OPERAND_FUNC(HL_inc)
 {
-    operand( "[HL+]" );
+    emit_reg( "[HL+]", 0 );
 }
 
 /***********************************************************
@@ -675,7 +732,7 @@ OPERAND_FUNC(HL_inc)
  
 OPERAND_FUNC(HL_dec)
 {
-    operand( "[HL-]" );
+    emit_reg( "[HL-]", 0 );
 }
 
 /******************************************************************************/
@@ -736,9 +793,9 @@ OPERAND_FUNC(A_saddrp)
 {
     operand_A( f, addr, opc, xtype );
     COMMA;
-    operand( "[" );
+    emit_text( "[" );
     operand_saddrp( f, addr, opc, xtype );
-    operand( "]" );
+    emit_text( "]" );
 }
 
 /***********************************************************
@@ -747,9 +804,9 @@ OPERAND_FUNC(A_saddrp)
  
 OPERAND_FUNC(saddrp_A)
 {
-    operand( "[" );
+    emit_text( "[" );
     operand_saddrp( f, addr, opc, xtype );
-    operand( "]" );
+    emit_text( "]" );
     COMMA;
     operand_A( f, addr, opc, xtype );
 }
@@ -782,7 +839,7 @@ OPERAND_FUNC(addr16_A)
  
 OPERAND_FUNC(AX_saddrp)
 {
-    operand( "AX" );
+    emit_reg( "AX", 0 );
     COMMA;
     operand_saddrp( f, addr, opc, xtype );
 }
@@ -795,7 +852,7 @@ OPERAND_FUNC(saddrp_AX)
 {
     operand_saddrp( f, addr, opc, xtype );
     COMMA;
-    operand( "AX" );
+    emit_reg( "AX", 0 );
 }
 
 /***********************************************************
@@ -822,7 +879,7 @@ OPERAND_FUNC(saddrp_saddrp)
  
 OPERAND_FUNC(AX_sfrp)
 {
-    operand( "AX" );
+    emit_reg( "AX", 0 );
     COMMA;
     operand_sfrp( f, addr, opc, xtype );
 }
@@ -835,7 +892,7 @@ OPERAND_FUNC(sfrp_AX)
 {
     operand_sfrp( f, addr, opc, xtype );
     COMMA;
-    operand( "AX" );
+    emit_reg( "AX", 0 );
 }
 
 /***********************************************************
@@ -866,7 +923,7 @@ OPERAND_FUNC(addr16_rp1)
  
 OPERAND_FUNC(AX_word)
 {
-    operand( "AX" );
+    emit_reg( "AX", 0 );
     COMMA;
     operand_word( f, addr, opc, xtype );
 }
@@ -882,7 +939,7 @@ OPERAND_FUNC(r1_n)
     
     operand_r1( f, addr, args, xtype );
     COMMA;
-    operand( "%d", ( args >> 3 ) & 0x07 );
+    emit_bit( "%d", ( args >> 3 ) & 0x07 );
 }
 
 /***********************************************************
@@ -896,7 +953,7 @@ OPERAND_FUNC(rp1_n)
     
     operand_rp1( f, addr, args, xtype );
     COMMA;
-    operand( "%d", ( args >> 3 ) & 0x07 );
+    emit_bit( "%d", ( args >> 3 ) & 0x07 );
 }
 
 /***********************************************************
@@ -905,9 +962,9 @@ OPERAND_FUNC(rp1_n)
  
 OPERAND_FUNC(rp1_ind)
 {
-    operand( "[" );
+    emit_text( "[" );
     operand_rp1( f, addr, opc, xtype );
-    operand( "]" );
+    emit_text( "]" );
 }
 
 /***********************************************************
@@ -946,7 +1003,7 @@ OPERAND_FUNC(A_bit)
  
 OPERAND_FUNC(X_bit)
 {
-    operand( "X" );
+    emit_reg( "X", 0 );
     operand_bit( f, addr, opc, xtype );
 }
 
@@ -956,7 +1013,7 @@ OPERAND_FUNC(X_bit)
  
 OPERAND_FUNC(PSWL_bit)
 {
-    operand( "PSWL" );
+    emit_reg( "PSWL", 0 );
     operand_bit( f, addr, opc, xtype );
 }
 
@@ -966,7 +1023,7 @@ OPERAND_FUNC(PSWL_bit)
  
 OPERAND_FUNC(PSWH_bit)
 {
-    operand( "PSWH" );
+    emit_reg( "PSWH", 0 );
     operand_bit( f, addr, opc, xtype );
 }
 
@@ -978,7 +1035,7 @@ OPERAND_FUNC(CY_n_saddr_bit)
 {
     operand_CY( f, addr, opc, xtype );
     COMMA;
-    operand( "/" );
+    emit_text( "/" );
     operand_saddr_bit( f, addr, opc, xtype );
 }
 
@@ -990,7 +1047,7 @@ OPERAND_FUNC(CY_n_sfr_bit)
 {
     operand_CY( f, addr, opc, xtype );
     COMMA;
-    operand( "/" );
+    emit_text( "/" );
     operand_sfr_bit( f, addr, opc, xtype );
 }
 
@@ -1002,7 +1059,7 @@ OPERAND_FUNC(CY_n_A_bit)
 {
     operand_CY( f, addr, opc, xtype );
     COMMA;
-    operand( "/" );
+    emit_text( "/" );
     operand_A_bit( f, addr, opc, xtype );
 }
 
@@ -1014,7 +1071,7 @@ OPERAND_FUNC(CY_n_X_bit)
 {
     operand_CY( f, addr, opc, xtype );
     COMMA;
-    operand( "/" );
+    emit_text( "/" );
     operand_X_bit( f, addr, opc, xtype );
 }
 
@@ -1026,7 +1083,7 @@ OPERAND_FUNC(CY_n_PSWL_bit)
 {
     operand_CY( f, addr, opc, xtype );
     COMMA;
-    operand( "/" );
+    emit_text( "/" );
     operand_PSWL_bit( f, addr, opc, xtype );
 }
 
@@ -1038,7 +1095,7 @@ OPERAND_FUNC(CY_n_PSWH_bit)
 {
     operand_CY( f, addr, opc, xtype );
     COMMA;
-    operand( "/" );
+    emit_text( "/" );
     operand_PSWH_bit( f, addr, opc, xtype );
 }
 
@@ -1054,7 +1111,7 @@ OPERAND_FUNC(STBC_byte)
 {
     (void)next( f, addr );
     
-    operand( "STBC" );
+    emit_reg( "STBC", 0 );
     COMMA;
     operand_byte( f, addr, opc, xtype );
 }
@@ -1071,7 +1128,7 @@ OPERAND_FUNC(WDM_byte)
 {
     (void)next( f, addr );
     
-    operand( "WDM" );
+    emit_reg( "WDM", 0 );
     COMMA;
     operand_byte( f, addr, opc, xtype );
 }
@@ -1388,6 +1445,32 @@ static optab_t optab_15[] = {
     END
 };
 
+/******************************************************************************/
+/* Memory-modifier forms, selected by the operation byte after the modifier  */
+/* byte (16H, 17H, 06H or 0AH, see operand_memmod)                           */
+/******************************************************************************/
+
+#undef MEMMOD_OP
+#define MEMMOD_OP(M_name, M_code)  INSN  ( M_name,  A_memmod,      ( 0x00 | M_code ), X_NONE ) \
+                                   INSN  ( M_name,  memmod_A,      ( 0x80 | M_code ), X_NONE )
+
+static optab_t optab_memmod[] = {
+
+    MEMMOD_OP( "mov",  0x00 )
+    INSN  ( "xch",  A_memmod,      0x04, X_NONE )
+    
+    MEMMOD_OP( "add",  0x08 )
+    MEMMOD_OP( "addc", 0x09 )
+    MEMMOD_OP( "sub",  0x0A )
+    MEMMOD_OP( "subc", 0x0B )
+    MEMMOD_OP( "and",  0x0C )
+    MEMMOD_OP( "or",   0x0E )
+    MEMMOD_OP( "xor",  0x0D )
+    MEMMOD_OP( "cmp",  0x0F )
+    
+    END
+};
+
 /******************************************************************************/
 
 optab_t base_optab[] = {
@@ -1407,9 +1490,7 @@ optab_t base_optab[] = {
     INSN  ( "mov",  A_sfr,         0x10, X_NONE )
     INSN  ( "mov",  sfr_A,         0x12, X_NONE )
     RANGE ( "mov",  A_mem,         0x58, 0x5D, X_NONE )
-    MEMMOD( "mov",  A_memmod,      0x00, X_NONE ) 
     RANGE ( "mov",  mem_A,         0x50, 0x55, X_NONE )
-    MEMMOD( "mov",  memmod_A,      0x80, X_NONE )
     INSN  ( "mov",  A_saddrp,      0x18, X_NONE )
     INSN  ( "mov",  saddrp_A,      0x19, X_NONE )
     
@@ -1417,7 +1498,6 @@ optab_t base_optab[] = {
 
     RANGE ( "xch",  A_r1,          0xD8, 0xDF, X_NONE )
     MASK2 ( "xch",  r_r1,          0x25, 0x08, 0x00, X_NONE )
-    MEMMOD( "xch",  A_memmod,      0x04, X_NONE )
     INSN  ( "xch",  A_saddr,       0x21, X_NONE )
     INSN  ( "xch",  A_saddrp,      0x23, X_NONE )
     INSN  ( "xch",  saddr_saddr,   0x39, X_NONE )
@@ -1453,9 +1533,7 @@ optab_t base_optab[] = {
                                             INSN  ( M_name,  saddr_byte,    ( 0x60 | M_code ), X_NONE ) \
                                             MASK2 ( M_name,  r_r1,          ( 0x80 | M_code ), 0x08, 0x00, X_NONE ) \
                                             INSN  ( M_name,  A_saddr,       ( 0x90 | M_code ), X_NONE ) \
-                                            INSN  ( M_name,  saddr_saddr,   ( 0x70 | M_code ), X_NONE ) \
-                                            MEMMOD( M_name,  A_memmod,      ( 0x00 | M_code ), X_NONE ) \
-                                            MEMMOD( M_name,  memmod_A,      ( 0x80 | M_code ), X_NONE )
+                                            INSN  ( M_name,  saddr_saddr,   ( 0x70 | M_code ), X_NONE )
                                             
     BYTE_OP( "add",  0x08 )
     BYTE_OP( "addc", 0x09 )
@@ -1620,6 +1698,11 @@ optab_t base_optab[] = {
   Instruction Sub-Group Tables
   ----------------------------------------------------------------------------*/
     
+    PEEKTBL ( optab_memmod, 0x16, 0x8F )
+    PEEKTBL ( optab_memmod, 0x17, 0x8F )
+    PEEKTBL ( optab_memmod, 0x06, 0x8F )
+    PEEKTBL ( optab_memmod, 0x0A, 0x8F )
+    
     TABLE ( optab_01, 0x01 )
     TABLE ( optab_02, 0x02 )
     TABLE ( optab_03, 0x03 )
@@ -36,668 +36,572 @@
 #include <stdarg.h>
 
 #include "dasmxx.h"
+#include "optab.h"
 
+/*****************************************************************************
+ * Globally-visible decoder properties
+ *****************************************************************************/
 
-DASM_PROFILE( "dasm96", "Intel 8096", 8, 9, 0, 1 )
-
-
-static char * output_buffer = NULL;
-
-
-#define ADDR_DIRECT     0
-#define ADDR_IMMED      1
-#define ADDR_INDIR      2
-#define ADDR_INDEX      3
-
-
-#define FORMAT_NUM_16BIT        "%04X"
-
+DASM_PROFILE( "dasm96", "Intel 8096", 8, 8, 0, 1 )
+INTEL_SYNTAX( "ASM96", "DCB", "DCW", 1 )
+DASM_FLOW(
+    FLOW  ( "sjmp", JUMP )
+    FLOW  ( "ljmp", JUMP )
+    FLOW  ( "br",   JUMP )
+    FLOW  ( "rst",  JUMP )
+    FLOW  ( "ret",  RETURN )
+)
+DASM_DISPATCH(
+    DISPATCH( "br [*]",      "ld *,%[*]",    NULL,           "cmp *,#",  WORDS, 1 )
+)
+DASM_TRACK()
+DASM_REGS( 0, 0 )
+DASM_MODES()
 
 /*****************************************************************************
- *        Instruction Decoding Tables
+ * Private data types, macros, constants.
  *****************************************************************************/
 
-char instrlen[] = {
-/* 0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f  */
-   2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3,   /* 0 */
-   0, 2, 2, 2, 0, 2, 2, 2, 3, 3, 3, 0, 0, 0, 0, 0,   /* 1 */
-   2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,   /* 2 */
-   3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,   /* 3 */
-   4, 5, 4,-5, 4, 5, 4,-5, 4, 5, 4,-5, 4, 5, 4,-5,   /* 4 */
-   4, 4, 4,-5, 4, 4, 4,-5, 4, 4, 4,-5, 4, 4, 4,-5,   /* 5 */
-   3, 4, 3,-4, 3, 4, 3,-4, 3, 4, 3,-4, 3, 4, 3,-4,   /* 6 */
-   3, 3, 3,-4, 3, 3, 3,-4, 3, 3, 3,-4, 3, 3, 3,-4,   /* 7 */
-   3, 4, 3,-4, 3, 4, 3,-4, 3, 4, 3,-4, 3, 4, 3,-4,   /* 8 */
-   3, 3, 3,-4, 3, 3, 3,-4, 3, 3, 3,-4, 3, 3, 3,-4,   /* 9 */
-   3, 4, 3,-4, 3, 4, 3,-4, 3, 4, 3,-4, 3, 3, 3,-4,   /* a */
-   3, 3, 3,-4, 3, 3, 3,-4, 3, 3, 3,-4, 3, 3, 3,-4,   /* b */
-   3, 3, 3,-4, 3, 3, 3,-4, 2, 3, 2,-3, 2, 0, 2,-3,   /* c */
-   2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,   /* d */
-   3, 3, 0, 2, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 3,   /* e */
-   1, 0, 1, 1, 1, 1, 2, 0, 1, 1, 1, 1, 1, 1,-7, 1    /* f */
-};
-/*
-
-00100bbb xxxxxxxx    -> sjmp  bbbxxxxxxxx
-00101bbb xxxxxxxx    -> scall bbbxxxxxxxx
-00110bbb src ofs     -> jbc src, bb, ofs
-00111bbb src ofs     -> jbs src, bb, ofs
-010....0   b0 b1 b2
-010...01   b0 b1 b2 b3
-010...11   b0 b1 b2 b3 b4  (b4 als b0&1)
-0110...0   b0 b1
-0110..01   b0 b1 b2
-0110..11   b0 b1 b2 b3  (b3 als b0&1)
-0111...0   b0 b1
-0111..01   b0 b1
-0111..11   b0 b1 b2 b3  (b3 als b0&1)
-10.0...0   b0 b1
-10.0..01   b0 b1 b2
-10.0..11   b0 b1 b2 b3  (b3 als b0&1)
-10.1...0   b0 b1
-10.1..01   b0 b1
-10.1..11   b0 b1 b2 b3  (b3 als b0&1)
-11001..0   b0
-11000..0   b0 b1
-11001001   b0 b1
-11001.11   b0 b1 b2   (b2 als b0&1)
-11000.11   b0 b1 b2 b3  (b3 als b0&1)
-1101....   ofs      j.. ofs
-*/
-
-/*
-   0 = unknown opcode
-   >0 = # bytes
-   <0 : +1 if 2nd byte odd
-   -7 : extended opcode
-*/
-
+/* Common output formats */
+#define FORMAT_NUM_8BIT         "%02X"
+#define FORMAT_NUM_16BIT        "%04X"
+#define FORMAT_REG              "R%02X"
+
+/* Construct a 16-bit word out of low and high bytes */
+#define MK_WORD(l,h)            ( ((l) & 0xFF) | (((h) & 0xFF) << 8) )
+
+/* Addressing modes, from the bottom two bits of the opcode */
+#define ADDR_DIRECT             ( 0 )
+#define ADDR_IMMED              ( 1 )
+#define ADDR_INDIR              ( 2 )
+#define ADDR_INDEX              ( 3 )
+
+/**
+    The general "source" operand of the arithmetic, load/store and 
+    stack instructions.  It is always the first operand in the 
+    instruction stream but the last one shown, so it is decoded into
+    one of these first and emitted once the registers have been read.
+**/
+typedef struct {
+    UBYTE mode;     /* ADDR_xxx                                      */
+    UBYTE reg;      /* register, or index/indirect base register     */
+    UWORD value;    /* immediate value or index offset               */
+    int   wide;     /* word immediate or long index offset           */
+    int   autoinc;  /* indirect with auto-increment                  */
+} src96_t;
 
 /*****************************************************************************
  *        Private Functions
  *****************************************************************************/
- 
-static void opcode( const char *opcode )
-{
-	int n = sprintf( output_buffer, "%-*s", dasm_max_opcode_width, opcode );
-	output_buffer += n;
-}
-
-static void operand( const char *operand, ... )
-{
-	va_list ap;
-	int n;
-	
-	va_start( ap, operand );
-	n = vsprintf( output_buffer, operand, ap );
-	va_end( ap );
-	
-	output_buffer += n;
-}
-
-/***********************************************************
- *
- ***********************************************************/
-
-union {
-	struct {
-#ifdef __BIG_ENDIAN__	
-		unsigned char hibyte;
-		unsigned char lobyte;
-#else
-		unsigned char lobyte;
-		unsigned char hibyte;
-#endif		
-	} s;
-	unsigned short us_val;
-	signed   short s_val;
-} u;
-
-static unsigned short getAddress( unsigned char * buf )
-{
-	u.s.lobyte = buf[0];
-	u.s.hibyte = buf[1];
-		
-	return u.us_val;
-}
-
-static short getOffset( unsigned char * buf )
-{
-	u.s.lobyte = buf[0];
-	u.s.hibyte = buf[1];
-	
-	return u.s_val;
-}
 
 /***********************************************************
  *
  * FUNCTION
- *      do_sjmp
+ *      read_src
  *
  * DESCRIPTION
- *      Handle sjmp (short jump) instructions
+ *      Reads the source operand bytes for the addressing mode
+ *      given in the bottom two bits of the opcode.
+ *      byte_imm - non-zero if an immediate is a single byte
  *
  * RETURNS
- *      void
+ *      none
  *
  ************************************************************/
 
-static void do_sjmp( int addr, unsigned char *buf, int n )
+static void read_src( FILE *f, ADDR *addr, UBYTE opc, int byte_imm, src96_t *s )
 {
-    short offset;
+    UBYTE lsb;
     
-    offset = ( ( buf[0] & 0x03 ) << 8 ) | buf[1];
+    s->mode    = opc & 0x03;
+    s->wide    = 0;
+    s->autoinc = 0;
+    s->value   = 0;
+    s->reg     = 0;
     
-    if ( buf[0] & 4 )
-        offset |= 0xFC00;
-    
-    operand( "sjmp    %s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr + offset ) );
-    xref_addxref( X_JMP, addr - n, addr + offset );
+    switch ( s->mode )
+    {
+    case ADDR_DIRECT:
+        s->reg = next( f, addr );
+        break;
+        
+    case ADDR_IMMED:
+        lsb = next( f, addr );
+        if ( byte_imm )
+            s->value = lsb;
+        else
+        {
+            s->value = MK_WORD( lsb, next( f, addr ) );
+            s->wide  = 1;
+        }
+        break;
+        
+    case ADDR_INDIR:
+        s->reg     = next( f, addr );
+        s->autoinc = s->reg & 0x01;
+        s->reg    &= 0xFE;
+        break;
+        
+    case ADDR_INDEX:
+        s->reg  = next( f, addr );
+        s->wide = s->reg & 0x01;
+        s->reg &= 0xFE;
+        lsb     = next( f, addr );
+        s->value = s->wide ? MK_WORD( lsb, next( f, addr ) ) : lsb;
+        break;
+    }
 }
 
 /***********************************************************
  *
  * FUNCTION
- *      do_scall
+ *      emit_src
  *
  * DESCRIPTION
- *      Handle scall (short call) instructions
+ *      Emits a source operand read by read_src().
+ *      Word immediates are cross-referenced with xtype, long
+ *      index offsets as pointers.
  *
  * RETURNS
- *      void
+ *      none
  *
  ************************************************************/
 
-static void do_scall( int addr, unsigned char *buf, int n )
+static void emit_src( const src96_t *s, XREF_TYPE xtype )
 {
-    short offset;
-    
-    offset = ( ( buf[0] & 0x03 ) << 8 ) | buf[1];
-    
-    if ( buf[0] & 4 )
-        offset |= 0xFC00;
-    
-    operand( "scall   %s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr + offset ) );
-    xref_addxref( X_CALL, addr - n, addr + offset );
+    switch ( s->mode )
+    {
+    case ADDR_DIRECT:
+        emit_reg( FORMAT_REG, s->reg );
+        break;
+        
+    case ADDR_IMMED:
+        emit_text( "#" );
+        if ( s->wide )
+            emit_operand( OPND_IMM, FORMAT_NUM_16BIT, s->value, s->value, 
+                          xtype, OPF_LABEL );
+        else
+            emit_imm( FORMAT_NUM_8BIT, s->value );
+        break;
+        
+    case ADDR_INDIR:
+        emit_text( "[" );
+        emit_reg( FORMAT_REG, s->reg );
+        emit_text( "]" );
+        if ( s->autoinc )
+            emit_text( "+" );
+        break;
+        
+    case ADDR_INDEX:
+        if ( s->wide )
+            emit_addr( FORMAT_NUM_16BIT, s->value, X_PTR );
+        else
+            emit_disp( FORMAT_NUM_8BIT, s->value );
+        emit_text( "[" );
+        emit_reg( FORMAT_REG, s->reg );
+        emit_text( "]" );
+        break;
+    }
+}
+
+/******************************************************************************/
+/**                            Operand Functions                             **/
+/******************************************************************************/
+
+/******************************************************************************/
+/**                            Empty Operands                                **/
+/******************************************************************************/
+
+OPERAND_FUNC(none)
+{
+    /* empty */
 }
 
+/******************************************************************************/
+/**                            Single Operands                               **/
+/******************************************************************************/
+
 /***********************************************************
- *
- * FUNCTION
- *      do_jbc
- *
- * DESCRIPTION
- *      Handle jbc (jump if bit clear) instruction
- *
- * RETURNS
- *      void
- *
+ * Process "reg" operand.
+ *    reg comes from next byte.
  ************************************************************/
 
-static void do_jbc( int addr, unsigned char *buf, int n )
+OPERAND_FUNC(reg)
 {
-    operand( "jbc     R%02X,%d, %s", buf[1], buf[0] & 0x07, xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr + (char)buf[2] ) );
-    xref_addxref( X_JMP, addr - n, addr + (char)buf[2] );
+    UBYTE reg = next( f, addr );
+    
+    emit_reg( FORMAT_REG, reg );
 }
 
 /***********************************************************
- *
- * FUNCTION
- *      do_jbs
- *
- * DESCRIPTION
- *      Handle jbs (jump if bit set) instruction
- *
- * RETURNS
- *      void
- *
+ * Process "[reg]" operand.
+ *    reg comes from next byte.
  ************************************************************/
 
-static void do_jbs( int addr, unsigned char *buf, int n )
+OPERAND_FUNC(indreg)
 {
-    operand( "jbs     R%02X,%d, %s", buf[1], buf[0] & 0x07, xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr + (char)buf[2] ) );
-    xref_addxref( X_JMP, addr - n, addr + (char)buf[2] );
+    emit_text( "[" );
+    operand_reg( f, addr, opc, xtype );
+    emit_text( "]" );
 }
 
 /***********************************************************
- *
- * FUNCTION
- *      do_condjump
- *
- * DESCRIPTION
- *      Handle conditional jumps
- *
- * RETURNS
- *      void
- *
+ * Process "#imm8" operand.
  ************************************************************/
 
-static void do_condjmp( int addr, unsigned char *buf, int n )
+OPERAND_FUNC(imm8)
 {
-    char *opcodes[] = { "jnst",     "jnh",      "jgt",      "jnc",
-                        "jnvt",     "jnv",      "jge",      "jne",
-                        "jst",      "jh",       "jle",      "jc", 
-                        "jvt",      "jv",       "jlt",      "je" };
-
-    operand( "%-6s  %s", opcodes[buf[0] & 0x0F], xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr + (char)buf[1] ) );
-    xref_addxref( X_JMP, addr - n, addr + (char)buf[1] );
+    UBYTE imm8 = next( f, addr );
+    
+    emit_imm( "#" FORMAT_NUM_8BIT, imm8 );
 }
 
 /***********************************************************
- *
- * FUNCTION
- *      do_f0
- *
- * DESCRIPTION
- *      Handle instructions in the opcode group Fx
- *
- * RETURNS
- *      void
- *
+ * Process single word source operand (push and pop).
+ *    Addressing mode comes from the opcode.
  ************************************************************/
 
-static void do_f0( int addr, unsigned char *buf, int n )
+OPERAND_FUNC(src)
 {
-    char *opcodes[] = { "ret",      "",         "pushf",    "popf",
-                        "pusha",    "popa",     "idlpd",    "trap",
-                        "clrc",     "setc",     "di",       "ei",
-                        "clrvt",    "nop",      "",         "rst" };
-
-    operand( "%s", opcodes[buf[0] & 0x0F] );
+    src96_t s;
+    
+    read_src( f, addr, opc, 0, &s );
+    emit_src( &s, xtype );
 }
 
 /***********************************************************
- *
- * FUNCTION
- *      do_middle
- *
- * DESCRIPTION
- *      Handles 4x .. Bx instruction groups (the middle of the
- *       instruction table).
- *
- * RETURNS
- *      void
- *
+ * Process 11-bit relative "sjmp"/"scall" operand.
+ *    Top three bits of offset come from the opcode.
  ************************************************************/
 
-static void do_middle( int addr, unsigned char *buf, int n, int isSigned )
+OPERAND_FUNC(rel11)
 {
-    char *opcodes[] = { "and",      "add",      "sub",      "mul",
-                        "and",      "add",      "sub",      "mul",
-                        "or",       "xor",      "cmp",      "div",
-                        "ld",       "addc",     "subc",     "ldbse" };
-
-    int op;
-    int i;
-    
-    op = 0;
-    
-        /*
-        01.t00..  and     b
-        01.t01..  add     b
-        01.t10..  sbb     b
-        01.t11..  mulu    b
-        100t00..  or      b
-        100t01..  xor     b
-        100t10..  cmp     b
-        100t11..  divu    b
-        101t00..  ld      b
-        101t01..  addc    b
-        101t10..  subc    b
-        101t11..  ldbse  /ze
-        */
-    
-    if ( buf[0] & 0x80 ) op |= 8;
-    if ( buf[0] & 0x20 ) op |= 4;
-    if ( buf[0] & 0x08 ) op |= 2;
-    if ( buf[0] & 0x04 ) op |= 1;
-    
-    if ( op == 0x0F )   /* Handle ldb{s|z}e */
-        operand( "%s", ( buf[0] & 0x10 ) ? "ldbse " : "ldbze " );
-    else
-    {
-        if ( isSigned )
-            operand( "%s%s%c", opcodes[op], 
-                    ( isSigned ) ? "" : "u", 
-                    ( buf[0] & 0x10 ) ? 'b' : ' ' );
-        else
-            operand( "%s%c", opcodes[op], ( buf[0] & 0x10 ) ? 'b' : ' ' );
-    }
+    UBYTE lsb  = next( f, addr );
+    WORD  disp = ( ( opc & 0x03 ) << 8 ) | lsb;
     
-    for ( i = strlen( opcodes[op] ); i < 7; i++ )
-        operand( " " );;
-    
-    switch( buf[0] & 0x3 )
-    {
-        case ADDR_DIRECT:
-            if ( n == 3 )
-                operand( "R%02X, R%02X", buf[2], buf[1] );
-            else
-                operand( "R%02X, R%02X, R%02X", buf[3], buf[2], buf[1] );
-            break;
-            
-        case ADDR_IMMED:
-            if ( buf[0] & 0x10 || op == 0x0F)
-            {
-                /* byte const */
-                
-                if ( n == 4 )
-                    operand( "R%02X, ", buf[3] );
-                
-                operand( "R%02X, #%02X", buf[2], buf[1] );
-            }
-            else
-            {
-                /* word const */
-                if ( n == 5 )
-                    operand( "R%02X, ", buf[4] );
-                operand( "R%02X, #%s", buf[3], 
-                        xref_genwordaddr( NULL, FORMAT_NUM_16BIT, getAddress(&buf[1]) ) );
-                xref_addxref( X_DATA, addr - n, getAddress(&buf[1]) );
-            }
-            break;
-
-        case ADDR_INDIR:
-            if ( n == 4 )
-                operand( "R%02X, ", buf[3] );
-            
-            if ( n >= 3 )
-                operand( "R%02X, ", buf[2] );
-            
-            operand( "[R%02X]", buf[1] & 0xFE );
-            if ( buf[1] & 0x01 )
-                operand( "+" );
-
-            break;
-
-        case ADDR_INDEX:
-            if ( ( buf[0] & 0xE0 ) == 0x40 )
-            {
-                /* three-op instruction */
-                if ( buf[1] & 0x01 )
-                {
-                    /* word offset */
-                    operand( "R%02X, R%02X, %s[R%02X]", buf[5], buf[4], 
-                            xref_genwordaddr( NULL, FORMAT_NUM_16BIT, getAddress(&buf[2]) ), buf[1] & 0xFE );
-                    xref_addxref( X_PTR, addr - n, getAddress( &buf[2] ) );
-                }
-                else
-                {
-                    /* byte offset */
-                    operand( "R%02X, R%02X, %02X[R%02X]", buf[4], buf[3], buf[2], buf[1] & 0xFE );
-                }
-            }
-            else
-            {
-                /* two-op instruction */                
-                if ( buf[1] & 0x01 )
-                {
-                    /* word offset */
-                    operand( "R%02X, %s[R%02X]", buf[4], xref_genwordaddr( NULL, FORMAT_NUM_16BIT, getAddress(&buf[2]) ),
-                            buf[1] & 0xFE );
-                    xref_addxref( X_PTR, addr - n, getAddress(&buf[2]) );                    
-                }
-                else
-                {
-                    /* byte offset */
-                    operand( "R%02X, %02X[R%02X]", buf[3], buf[2], buf[1] & 0xFE );
-                }
-            }
-            break;
-    }
+    if ( opc & 0x04 )
+        disp |= 0xFC00;
+        
+    emit_rel( FORMAT_NUM_16BIT, *addr + disp, xtype );
 }
 
 /***********************************************************
- *
- * FUNCTION
- *      do_00
- *
- * DESCRIPTION
- *      Handle instructions in the opcode group 0x
- *
- * RETURNS
- *      void
- *
+ * Process 8-bit relative operand.
  ************************************************************/
 
-static void do_00( int addr, unsigned char *buf, int n )
+OPERAND_FUNC(rel8)
 {
-    char *opcodes[] = { "skip",     "clr",      "not",      "neg",
-                        "",         "dec",      "ext",      "inc",
-                        "shr",      "shl",      "shra",     "",
-                        "shrl",     "shll",     "shral",    "norml",
-            
-                        "",         "clrb",     "notb",     "negb",
-                        "",         "decb",     "extb",     "incb",
-                        "shrb",     "shlb",     "shrab",    "",
-                        "",         "",         "",         "" };
+    BYTE disp = (BYTE)next( f, addr );
     
-    operand( "%-6s  ", opcodes[buf[0] & 0x1F] );
+    emit_rel( FORMAT_NUM_16BIT, *addr + disp, xtype );
+}
+
+/***********************************************************
+ * Process 16-bit relative operand.
+ ************************************************************/
+
+OPERAND_FUNC(rel16)
+{
+    UBYTE lsb  = next( f, addr );
+    UBYTE msb  = next( f, addr );
+    WORD  disp = MK_WORD( lsb, msb );
     
-    if ( buf[0] & 0x08 )
-    {
-        operand( "R%02X, ", buf[2] );
-        if ( buf[0] != 0x0F && buf[1] < 0x10 )
-            operand( "#%02X", buf[1] );
-        else
-            operand( "R%02X", buf[1] );
-    }
-    else
-        operand( "R%02X", buf[1] );
+    emit_rel( FORMAT_NUM_16BIT, *addr + disp, xtype );
 }
 
+/******************************************************************************/
+/**                            Double Operands                               **/
+/******************************************************************************/
+
 /***********************************************************
- *
- * FUNCTION
- *      do_c0
- *
- * DESCRIPTION
- *      Handle instructions in the opcode group Cx
- *       store, push and pop
- *
- * RETURNS
- *      void
- *
+ * Process "reg, rel8" operands (djnz).
+ ************************************************************/
+
+TWO_OPERAND(reg, rel8)
+
+/***********************************************************
+ * Process "reg, reg" operands in instruction order (bmov, cmpl).
+ ************************************************************/
+
+TWO_OPERAND(reg, reg)
+
+/***********************************************************
+ * Process "reg, bit, rel8" operands (jbc, jbs).
+ *    bit number comes from the opcode.
  ************************************************************/
 
-static void do_c0( int addr, unsigned char *buf, int n )
+OPERAND_FUNC(jbit)
 {
-    char *opcodes[] = { "st",       "bmov",     "st",       "st",
-                        "stb",      "cmpl",     "stb",      "stb",
-                        "push",     "push",     "push",     "push", 
-                        "pop",      "",         "pop",      "pop" };
+    operand_reg( f, addr, opc, xtype );
+    emit_text( "," );
+    emit_bit( "%d", opc & 0x07 );
+    COMMA;
+    operand_rel8( f, addr, opc, xtype );
+}
 
-    if ( buf[0] == 0xC1 )
-    {
-        /* 80196 -- bmov */
-        
-        operand( "bmov    R%02X, R%02X", buf[1], buf[2] );
-    }
-    else if ( buf[0] == 0xC5 )
-    {
-        /* 80196 -- cmpl */
-        
-        operand( "cmpl    R%02X, R%02X", buf[1], buf[2] );        
-    }
-    else 
-    {
-        operand( "%-6s  ", opcodes[buf[0] & 0x0F] );
-        
-        switch( buf[0] & 0x03 )
-        {
-            case ADDR_DIRECT:
-                if ( n == 3 )
-                    operand( "R%02X, ", buf[2] );
-                operand( "R%02X", buf[1] );
-                break;
-                
-            case ADDR_IMMED:    /* only PUSH words on to stack */
-                operand( "#%s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, getAddress(&buf[1]) ) );
-                break;
-                
-            case ADDR_INDIR:
-                if ( n == 3 )
-                    operand( "R%02X, ", buf[2] );
-                operand( "[R%02X]", buf[1] & 0xFE );
-                if ( buf[1] & 0x01 )
-                    operand( "+" );
-                break;
-                
-            case ADDR_INDEX:
-                if ( buf[0] & 0x08 )
-                {
-                    /* push/pop */
-                    if ( n == 3 )
-                        operand( "%02X[R%02X]", buf[2], buf[1] & 0xFE );
-                    else
-                    {
-                        operand( "%s[R%02X]", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, getAddress(&buf[2]) ), buf[1] & 0xFE );
-                        xref_addxref( X_PTR, addr - n, getAddress(&buf[2]) );
-                    }
-                }
-                else
-                {
-                    /* st(b) */
-                    if ( n == 4 )
-                        operand( "R%02X, %02X[R%02X]", buf[3], buf[2], buf[1] & 0xFE );
-                    else
-                    {
-                        operand( "R%02X, %s[R%02X]", buf[4], xref_genwordaddr( NULL, FORMAT_NUM_16BIT, getAddress(&buf[2]) ),
-                                buf[1] & 0xFE);
-                        xref_addxref( X_PTR, addr - n, getAddress(&buf[2]) );
-                    }
-                }
-                break;
-        }
-    }
+/***********************************************************
+ * Process shift operands "reg, #count" or "reg, Rcount".
+ *    Counts below 16 are immediate, otherwise the count is
+ *    held in a register.  NORML always takes a register.
+ ************************************************************/
+
+OPERAND_FUNC(shift)
+{
+    UBYTE count = next( f, addr );
+    UBYTE reg   = next( f, addr );
+    
+    emit_reg( FORMAT_REG, reg );
+    COMMA;
+    if ( opc != 0x0F && count < 0x10 )
+        emit_imm( "#" FORMAT_NUM_8BIT, count );
+    else
+        emit_reg( FORMAT_REG, count );
 }
 
 /***********************************************************
- *
- * FUNCTION
- *      do_e0
- *
- * DESCRIPTION
- *      Handle instructions in the opcode group Ex
- *       djnz, br, ljmp, lcall
- *
- * RETURNS
- *      void
- *
+ * Process two-operand "dst, src" arithmetic operands.
+ *    Source is first in the instruction, destination last.
  ************************************************************/
- 
-#define OP_DJNZ     0xE0
-#define OP_DJNZW    0xE1
-#define OP_BR       0xE3
-#define OP_LJMP     0xE7
-#define OP_LCALL    0xEF
-
-static void do_e0( int addr, unsigned char *buf, int n )
+
+OPERAND_FUNC(waop2)
 {
-    switch(buf[0])
-    {
-        case OP_DJNZ:
-            operand( "djnz    R%02X, %s", buf[1], xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr + (char)buf[2] ) );
-            xref_addxref( X_JMP, addr - n, addr + (char)buf[2] );
-            break;
-
-        case OP_DJNZW:
-            /* 80196 */
-            operand( "djnzw   R%02X, %s", buf[1], xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr + (char)buf[2] ) );
-            xref_addxref( X_JMP, addr - n, addr + (char)buf[2] );
-            break;
-            
-        case OP_BR:
-            operand( "br      [R%02X]", buf[1] );
-            break;
-            
-        case OP_LJMP:
-            operand( "ljmp    %s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr + getOffset(buf + 1) ) );
-            xref_addxref( X_JMP, addr - n, addr + getOffset(buf + 1) );
-            break;
-        
-        case OP_LCALL:
-            operand( "lcall   %s", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, addr + getOffset(buf + 1) ) );
-            xref_addxref( X_CALL, addr - n, addr + getOffset(buf + 1) );
-            break;
-        
-        default:
-            operand("???");
-    }
+    src96_t s;
+    
+    read_src( f, addr, opc, 0, &s );
+    operand_reg( f, addr, opc, xtype );
+    COMMA;
+    emit_src( &s, xtype );
 }
 
-/*****************************************************************************
- *        Public Functions
- *****************************************************************************/
+OPERAND_FUNC(baop2)
+{
+    src96_t s;
+    
+    read_src( f, addr, opc, 1, &s );
+    operand_reg( f, addr, opc, xtype );
+    COMMA;
+    emit_src( &s, xtype );
+}
+
+/******************************************************************************/
+/**                            Triple Operands                               **/
+/******************************************************************************/
 
 /***********************************************************
- *
- * FUNCTION
- *      dasm_insn
- *
- * DESCRIPTION
- *      Disassembles the next instruction in the input stream.
- *
- * RETURNS
- *      address of next input byte
- *
+ * Process three-operand "dst, src1, src2" arithmetic operands.
+ *    src2 is first in the instruction, then src1, then dst.
  ************************************************************/
-ADDR dasm_insn( FILE *f, char * outbuf, ADDR addr )
+
+OPERAND_FUNC(waop3)
+{
+    src96_t s;
+    UBYTE src1;
+    
+    read_src( f, addr, opc, 0, &s );
+    src1 = next( f, addr );
+    operand_reg( f, addr, opc, xtype );
+    COMMA;
+    emit_reg( FORMAT_REG, src1 );
+    COMMA;
+    emit_src( &s, xtype );
+}
+
+OPERAND_FUNC(baop3)
 {
-	int isSigned = 0;
-	int opc;
-	int n;
-	unsigned char buf[8];
-	int i;
-	
-	output_buffer = outbuf;
-            
-   opc = next( f, &addr );
-   if ( opc == 0xFE )
-   {
-      isSigned = 1;
-      opc = next( f, &addr );
-   }
-
-   n = instrlen[opc];
-   buf[0] = opc;
-            
-   if ( n < 0 )
-   {
-      n = -n;
-      buf[1] = next( f, &addr );
-      if ( buf[1] & 1 ) 
-         n++;
-      for ( i = 2; i < n; i++ )
-         buf[i] = next( f, &addr );
-   }
-   else
-      for ( i = 1; i < n; i++ )
-         buf[i] = next( f, &addr );
-
-   if ( n == 0 )
-   {
-      /* Unknown instruction */
-      operand( "???" );
-   }
-	else
-	{
-
-            if      ( ( opc & 0xf8 ) == 0x20 )  do_sjmp   ( addr, buf, n );
-            else if ( ( opc & 0xf8 ) == 0x28 )  do_scall  ( addr, buf, n );
-            else if ( ( opc & 0xf8 ) == 0x30 )  do_jbc    ( addr, buf, n );
-            else if ( ( opc & 0xf8 ) == 0x38 )  do_jbs    ( addr, buf, n );
-            else if ( ( opc & 0xf0 ) == 0xd0 )  do_condjmp( addr, buf, n );
-            else if ( ( opc & 0xf0 ) == 0xf0 )  do_f0     ( addr, buf, n );
-            else if ( ( opc & 0xf0 ) == 0xe0 )  do_e0     ( addr, buf, n );
-            else if ( ( opc & 0xf0 ) == 0xc0 )  do_c0     ( addr, buf, n );
-            else if ( ( opc & 0xe0 ) == 0 )     do_00     ( addr, buf, n );
-            else                                do_middle ( addr, buf, n, isSigned );
-	}
-
-   return addr;
+    src96_t s;
+    UBYTE src1;
+    
+    read_src( f, addr, opc, 1, &s );
+    src1 = next( f, addr );
+    operand_reg( f, addr, opc, xtype );
+    COMMA;
+    emit_reg( FORMAT_REG, src1 );
+    COMMA;
+    emit_src( &s, xtype );
 }
 
+/******************************************************************************/
+/** Instruction Decoding Tables                                              **/
+/** Note: tables are here as they refer to operand functions defined above.  **/
+/******************************************************************************/
+
+/**
+    The arithmetic instructions come in groups of four opcodes, one 
+    for each addressing mode in the bottom two bits.
+**/
+#define AOP(M_name,M_ops,M_base)    MASK(M_name,M_ops,0xFC,M_base,X_DATA)
+
+/*----------------------------------------------------------------------------
+  Signed multiply and divide, prefixed with 0xFE
+  ----------------------------------------------------------------------------*/
+
+static optab_t signed_optab[] = {
+
+    AOP( "mul",    waop3, 0x4C )
+    AOP( "mulb",   baop3, 0x5C )
+    AOP( "mul",    waop2, 0x6C )
+    AOP( "mulb",   baop2, 0x7C )
+    AOP( "div",    waop2, 0x8C )
+    AOP( "divb",   baop2, 0x9C )
+    
+    END
+};
+
+/*----------------------------------------------------------------------------
+  Main opcode table
+  ----------------------------------------------------------------------------*/
+
+optab_t base_optab[] = {
+
+/*----------------------------------------------------------------------------
+  Single register and shift operations, 00-1F
+  ----------------------------------------------------------------------------*/
+
+    INSN ( "skip",   reg,      0x00, X_NONE )
+    INSN ( "clr",    reg,      0x01, X_NONE )
+    INSN ( "not",    reg,      0x02, X_NONE )
+    INSN ( "neg",    reg,      0x03, X_NONE )
+    INSN ( "dec",    reg,      0x05, X_NONE )
+    INSN ( "ext",    reg,      0x06, X_NONE )
+    INSN ( "inc",    reg,      0x07, X_NONE )
+    INSN ( "shr",    shift,    0x08, X_NONE )
+    INSN ( "shl",    shift,    0x09, X_NONE )
+    INSN ( "shra",   shift,    0x0A, X_NONE )
+    INSN ( "shrl",   shift,    0x0C, X_NONE )
+    INSN ( "shll",   shift,    0x0D, X_NONE )
+    INSN ( "shral",  shift,    0x0E, X_NONE )
+    INSN ( "norml",  shift,    0x0F, X_NONE )
+    INSN ( "clrb",   reg,      0x11, X_NONE )
+    INSN ( "notb",   reg,      0x12, X_NONE )
+    INSN ( "negb",   reg,      0x13, X_NONE )
+    INSN ( "decb",   reg,      0x15, X_NONE )
+    INSN ( "extb",   reg,      0x16, X_NONE )
+    INSN ( "incb",   reg,      0x17, X_NONE )
+    INSN ( "shrb",   shift,    0x18, X_NONE )
+    INSN ( "shlb",   shift,    0x19, X_NONE )
+    INSN ( "shrab",  shift,    0x1A, X_NONE )
+
+/*----------------------------------------------------------------------------
+  Short jumps and bit tests, 20-3F
+  ----------------------------------------------------------------------------*/
+
+    MASK ( "sjmp",   rel11,    0xF8, 0x20, X_JMP )
+    MASK ( "scall",  rel11,    0xF8, 0x28, X_CALL )
+    MASK ( "jbc",    jbit,     0xF8, 0x30, X_JMP )
+    MASK ( "jbs",    jbit,     0xF8, 0x38, X_JMP )
+
+/*----------------------------------------------------------------------------
+  Three-operand arithmetic, 40-5F
+  ----------------------------------------------------------------------------*/
+
+    AOP  ( "and",    waop3,    0x40 )
+    AOP  ( "add",    waop3,    0x44 )
+    AOP  ( "sub",    waop3,    0x48 )
+    AOP  ( "mulu",   waop3,    0x4C )
+    AOP  ( "andb",   baop3,    0x50 )
+    AOP  ( "addb",   baop3,    0x54 )
+    AOP  ( "subb",   baop3,    0x58 )
+    AOP  ( "mulub",  baop3,    0x5C )
+
+/*----------------------------------------------------------------------------
+  Two-operand arithmetic, 60-BF
+  ----------------------------------------------------------------------------*/
+
+    AOP  ( "and",    waop2,    0x60 )
+    AOP  ( "add",    waop2,    0x64 )
+    AOP  ( "sub",    waop2,    0x68 )
+    AOP  ( "mulu",   waop2,    0x6C )
+    AOP  ( "andb",   baop2,    0x70 )
+    AOP  ( "addb",   baop2,    0x74 )
+    AOP  ( "subb",   baop2,    0x78 )
+    AOP  ( "mulub",  baop2,    0x7C )
+    AOP  ( "or",     waop2,    0x80 )
+    AOP  ( "xor",    waop2,    0x84 )
+    AOP  ( "cmp",    waop2,    0x88 )
+    AOP  ( "divu",   waop2,    0x8C )
+    AOP  ( "orb",    baop2,    0x90 )
+    AOP  ( "xorb",   baop2,    0x94 )
+    AOP  ( "cmpb",   baop2,    0x98 )
+    AOP  ( "divub",  baop2,    0x9C )
+    AOP  ( "ld",     waop2,    0xA0 )
+    AOP  ( "addc",   waop2,    0xA4 )
+    AOP  ( "subc",   waop2,    0xA8 )
+    AOP  ( "ldbze",  baop2,    0xAC )
+    AOP  ( "ldb",    baop2,    0xB0 )
+    AOP  ( "addcb",  baop2,    0xB4 )
+    AOP  ( "subcb",  baop2,    0xB8 )
+    AOP  ( "ldbse",  baop2,    0xBC )
+
+/*----------------------------------------------------------------------------
+  Stores, block move and stack, C0-CF
+  ----------------------------------------------------------------------------*/
+
+    INSN ( "st",     waop2,    0xC0, X_NONE )
+    INSN ( "bmov",   reg_reg,  0xC1, X_NONE )    /* 80196 */
+    RANGE( "st",     waop2,    0xC2, 0xC3, X_NONE )
+    INSN ( "stb",    baop2,    0xC4, X_NONE )
+    INSN ( "cmpl",   reg_reg,  0xC5, X_NONE )    /* 80196 */
+    RANGE( "stb",    baop2,    0xC6, 0xC7, X_NONE )
+    MASK ( "push",   src,      0xFC, 0xC8, X_NONE )
+    INSN ( "pop",    src,      0xCC, X_NONE )
+    RANGE( "pop",    src,      0xCE, 0xCF, X_NONE )
+
+/*----------------------------------------------------------------------------
+  Conditional jumps, D0-DF
+  ----------------------------------------------------------------------------*/
+
+    INSN ( "jnst",   rel8,     0xD0, X_JMP )
+    INSN ( "jnh",    rel8,     0xD1, X_JMP )
+    INSN ( "jgt",    rel8,     0xD2, X_JMP )
+    INSN ( "jnc",    rel8,     0xD3, X_JMP )
+    INSN ( "jnvt",   rel8,     0xD4, X_JMP )
+    INSN ( "jnv",    rel8,     0xD5, X_JMP )
+    INSN ( "jge",    rel8,     0xD6, X_JMP )
+    INSN ( "jne",    rel8,     0xD7, X_JMP )
+    INSN ( "jst",    rel8,     0xD8, X_JMP )
+    INSN ( "jh",     rel8,     0xD9, X_JMP )
+    INSN ( "jle",    rel8,     0xDA, X_JMP )
+    INSN ( "jc",     rel8,     0xDB, X_JMP )
+    INSN ( "jvt",    rel8,     0xDC, X_JMP )
+    INSN ( "jv",     rel8,     0xDD, X_JMP )
+    INSN ( "jlt",    rel8,     0xDE, X_JMP )
+    INSN ( "je",     rel8,     0xDF, X_JMP )
+
+/*----------------------------------------------------------------------------
+  Loops, long jumps and calls, E0-EF
+  ----------------------------------------------------------------------------*/
+
+    INSN ( "djnz",   reg_rel8, 0xE0, X_JMP )
+    INSN ( "djnzw",  reg_rel8, 0xE1, X_JMP )     /* 80196 */
+    INSN ( "br",     indreg,   0xE3, X_NONE )
+    INSN ( "ljmp",   rel16,    0xE7, X_JMP )
+    INSN ( "lcall",  rel16,    0xEF, X_CALL )
+
+/*----------------------------------------------------------------------------
+  Miscellaneous, F0-FF
+  ----------------------------------------------------------------------------*/
+
+    INSN ( "ret",    none,     0xF0, X_NONE )
+    INSN ( "pushf",  none,     0xF2, X_NONE )
+    INSN ( "popf",   none,     0xF3, X_NONE )
+    INSN ( "pusha",  none,     0xF4, X_NONE )    /* 80196 */
+    INSN ( "popa",   none,     0xF5, X_NONE )    /* 80196 */
+    INSN ( "idlpd",  imm8,     0xF6, X_NONE )    /* 80196 */
+    INSN ( "trap",   none,     0xF7, X_NONE )
+    INSN ( "clrc",   none,     0xF8, X_NONE )
+    INSN ( "setc",   none,     0xF9, X_NONE )
+    INSN ( "di",     none,     0xFA, X_NONE )
+    INSN ( "ei",     none,     0xFB, X_NONE )
+    INSN ( "clrvt",  none,     0xFC, X_NONE )
+    INSN ( "nop",    none,     0xFD, X_NONE )
+    TABLE( signed_optab,       0xFE )
+    INSN ( "rst",    none,     0xFF, X_NONE )
+
+/*----------------------------------------------------------------------------*/
+
+    END
+};
+
 /******************************************************************************/
 /******************************************************************************/
 /******************************************************************************/
@@ -50,6 +50,40 @@
  *****************************************************************************/
 
 DASM_PROFILE( "dasmavr", "Atmel AVR", 4, 9, 0, 2 )
+GNU_SYNTAX( "avr-as" )
+DASM_FLOW(
+    FLOW  ( "RJMP", JUMP )
+    FLOW  ( "JMP",  JUMP )
+    FLOW  ( "IJMP", JUMP )
+    FLOW  ( "EIJMP", JUMP )
+    FLOW  ( "RET",  RETURN )
+    FLOW  ( "RETI", RETURN )
+    FLOW  ( "CPSE", SKIP )
+    FLOW  ( "SBRC", SKIP )
+    FLOW  ( "SBRS", SKIP )
+    FLOW  ( "SBIC", SKIP )
+    FLOW  ( "SBIS", SKIP )
+)
+DASM_DISPATCH(
+    DISPATCH( "IJMP",        "LDI R30,#",    "LDI R31,#",    "CPI *,#",  JUMPS, 2 )
+    DISPATCH( "EIJMP",       "LDI R30,#",    "LDI R31,#",    "CPI *,#",  JUMPS, 2 )
+)
+DASM_TRACK()
+DASM_REGS( 0, 0 )
+
+/**
+    Parts larger devices add to 16-bit addresses: EIND to Z for EICALL
+    and EIJMP, RAMPZ to Z for ELPM.  They are set by an OUT (or STS)
+    straight after an LDI of the register written, or by the command
+    file; -1 while not known.
+**/
+static int eind  = -1;
+static int rampz = -1;
+
+DASM_MODES(
+    MODE_ARG( "EIND",  eind )
+    MODE_ARG( "RAMPZ", rampz )
+)
 
 /*****************************************************************************
  * Private data types, macros, constants.
@@ -63,6 +97,55 @@ DASM_PROFILE( "dasmavr", "Atmel AVR", 4, 9, 0, 2 )
 /* Construct a 16-bit word out of low and high bytes */
 #define MK_WORD(l,h)            ( ((l) & 0xFF) | (((UWORD)((h) & 0xFF)) << 8) )
 
+/* I/O addresses of the extended address registers */
+#define IO_RAMPZ                ( 0x3B )
+#define IO_EIND                 ( 0x3C )
+
+/* Data space addresses of the I/O registers */
+#define IO_DATA_OFFSET          ( 0x20 )
+
+/*****************************************************************************
+ * Private data.
+ *****************************************************************************/
+
+/* Register loaded by an LDI, the value, and the address after it */
+static int  ldi_reg = -1;
+static int  ldi_value;
+static ADDR ldi_end;
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ * Notes a store of register Rr to an I/O address, which sets
+ *  EIND or RAMPZ to the value of an LDI just before it.
+ ************************************************************/
+static void store_io( int A, int Rr )
+{
+    int value = ( Rr == ldi_reg && ldi_end == g_insn_addr ) ? ldi_value : -1;
+    
+    if ( A == IO_EIND )
+        eind = value;
+    else if ( A == IO_RAMPZ )
+        rampz = value;
+}
+
+/***********************************************************
+ * Annotates an instruction with an extended address register
+ *  if it is known.
+ ************************************************************/
+static void note_ext( const char *name, int value )
+{
+    char buf[64];
+    
+    if ( value < 0 )
+        return;
+        
+    sprintf( buf, "%s = $%02X, Z + $%06X", name, value, (unsigned int)value << 16 );
+    emit_note( buf );
+}
+
 /******************************************************************************/
 /**                            Operand Functions                             **/
 /******************************************************************************/
@@ -90,7 +173,7 @@ OPERAND_FUNC(rD5)
 {
     int Rd = ( opc >> 4 ) & 0x1F;
     
-    operand( FORMAT_REG, Rd );
+    emit_reg( FORMAT_REG, Rd );
 }
 
 /***********************************************************
@@ -103,11 +186,10 @@ OPERAND_FUNC(rD5)
  ************************************************************/
 OPERAND_FUNC(bra7)
 {
-    BYTE disp = ((BYTE)(opc >> 2 )) / 2; /* SIGNED arithmetic! */
+    BYTE disp = ((BYTE)(( opc >> 2 ) & 0xFE )) / 2; /* SIGNED arithmetic! */
     ADDR dest = *addr + ( 2 * disp );
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest );
+    emit_rel( FORMAT_NUM_16BIT, dest, xtype );
 }
 
 /***********************************************************
@@ -123,14 +205,15 @@ OPERAND_FUNC(rel_k12)
     
     ADDR dest = *addr + ( k * 2 );
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest ); 
+    emit_rel( FORMAT_NUM_16BIT, dest, xtype );
 }
 
 /***********************************************************
  * 22-bit long address, encoded in two opcs.
  *  15       8 7       0    15                 0
  *   ---- ---k kkkk ---k     kkkk kkkk kkkk kkkk
+ * The address is in words; shown as a byte address like the
+ *  relative branches.
  ************************************************************/
 OPERAND_FUNC(long_addr)
 {
@@ -138,8 +221,7 @@ OPERAND_FUNC(long_addr)
     dest |= ( opc & 0x0001 ) << 16;
     dest |= ( opc & 0x01F0 ) << 13;
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest ); 
+    emit_addr( FORMAT_NUM_16BIT, dest * 2, xtype );
 }
 
 /***********************************************************
@@ -151,7 +233,7 @@ OPERAND_FUNC(bit)
 {
     int s = ( opc >> 4 ) & 0x07;
     
-    operand( "%d", s );
+    emit_bit( "%d", s );
 }
 
 /******************************************************************************/
@@ -169,9 +251,13 @@ OPERAND_FUNC(rpair_rpair)
     int Rd = ( ( opc >> 4 ) & 0x0F ) * 2;
     int Rr = ( opc & 0x0F ) * 2;
     
-    operand( FORMAT_REG ":" FORMAT_REG, Rd + 1, Rd );
+    emit_reg( FORMAT_REG, Rd + 1 );
+    emit_text( ":" );
+    emit_reg( FORMAT_REG, Rd );
     COMMA;
-    operand( FORMAT_REG ":" FORMAT_REG, Rr + 1, Rr );
+    emit_reg( FORMAT_REG, Rr + 1 );
+    emit_text( ":" );
+    emit_reg( FORMAT_REG, Rr );
 }
 
 /***********************************************************
@@ -185,9 +271,9 @@ OPERAND_FUNC(rhigh_rhigh)
     int Rd = ( ( opc >> 4 ) & 0x0F ) + 16;
     int Rr = ( opc & 0x0F ) + 16;
     
-    operand( FORMAT_REG, Rd );
+    emit_reg( FORMAT_REG, Rd );
     COMMA;
-    operand( FORMAT_REG, Rr );
+    emit_reg( FORMAT_REG, Rr );
 }
 
 /***********************************************************
@@ -201,9 +287,9 @@ OPERAND_FUNC(rhigh3_rhigh3)
     int Rd = ( ( opc >> 4 ) & 0x07 ) + 16;
     int Rr = ( opc & 0x07 ) + 16;
     
-    operand( FORMAT_REG, Rd );
+    emit_reg( FORMAT_REG, Rd );
     COMMA;
-    operand( FORMAT_REG, Rr );
+    emit_reg( FORMAT_REG, Rr );
 }
 
 /***********************************************************
@@ -218,7 +304,7 @@ OPERAND_FUNC(r_r)
     
     operand_rD5( f, addr, opc, xtype );
     COMMA;
-    operand( FORMAT_REG, Rr );
+    emit_reg( FORMAT_REG, Rr );
 }
 
 /***********************************************************
@@ -232,9 +318,16 @@ OPERAND_FUNC(rhigh_k8)
     int Rd = ( ( opc >> 4 ) & 0x0F ) + 16;
     int K  = ( ( opc >> 4 ) & 0xF0 ) | ( opc & 0x0F );
 
-    operand( FORMAT_REG, Rd );
+    emit_reg( FORMAT_REG, Rd );
     COMMA;
-    operand( FORMAT_NUM_8BIT, K );
+    emit_imm( FORMAT_NUM_8BIT, K );
+    
+    if ( ( opc & 0xF000 ) == 0xE000 )     /* LDI */
+    {
+        ldi_reg   = Rd;
+        ldi_value = K;
+        ldi_end   = *addr;
+    }
 }
 
 /***********************************************************
@@ -247,13 +340,13 @@ OPERAND_FUNC(rhigh_k8)
 OPERAND_FUNC(r_YZ)
 {
     int A = opc & 0x0008;
-    int Q = ( opc & 0x07 ) | ( ( opc >> 8 ) & 0x18 ) | ( ( opc >> 8 ) & 0x20 );
+    int Q = ( opc & 0x07 ) | ( ( opc >> 7 ) & 0x18 ) | ( ( opc >> 8 ) & 0x20 );
     
     operand_rD5( f, addr, opc, xtype );
     COMMA;
-    operand( A ? "Y" : "Z" );
+    emit_reg( A ? "Y" : "Z", 0 );
     if ( Q )
-        operand( "+%d", Q );
+        emit_disp( "+%d", Q );
 }
 
 /***********************************************************
@@ -266,11 +359,11 @@ OPERAND_FUNC(r_YZ)
 OPERAND_FUNC(YZ_r)
 {
     int A = opc & 0x0008;
-    int Q = ( opc & 0x07 ) | ( ( opc >> 8 ) & 0x18 ) | ( ( opc >> 8 ) & 0x20 );
+    int Q = ( opc & 0x07 ) | ( ( opc >> 7 ) & 0x18 ) | ( ( opc >> 8 ) & 0x20 );
     
-    operand( A ? "Y" : "Z" );
+    emit_reg( A ? "Y" : "Z", 0 );
     if ( Q )
-        operand( "+%d", Q );
+        emit_disp( "+%d", Q );
     COMMA;
     operand_rD5( f, addr, opc, xtype );
 }
@@ -287,7 +380,7 @@ OPERAND_FUNC(r_b)
     
     operand_rD5( f, addr, opc, xtype );
     COMMA;
-    operand( "%d", b );
+    emit_bit( "%d", b );
 }
     
 /***********************************************************
@@ -301,9 +394,9 @@ OPERAND_FUNC(A_b)
     int A = ( opc >> 3 ) & 0x1F;
     int b = opc & 0x07;
     
-    operand( FORMAT_NUM_8BIT, A );
+    emit_operand( OPND_ADDR, FORMAT_NUM_8BIT, A, A, X_NONE, 0 );
     COMMA;
-    operand( "%d", b );
+    emit_bit( "%d", b );
 }
 
 /***********************************************************
@@ -323,9 +416,9 @@ OPERAND_FUNC(rphigh_k6)
         "ZH:ZL"
     };
     
-    operand( "%s", rpair[R] );
+    emit_reg( rpair[R], R );
     COMMA;
-    operand( "%d", k );
+    emit_imm( "%d", k );
 }
 
 /***********************************************************
@@ -340,8 +433,7 @@ OPERAND_FUNC(r_A6)
     
     operand_rD5( f, addr, opc, xtype );
     COMMA;
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, A ) );
-    xref_addxref( xtype, g_insn_addr, A );
+    emit_addr( FORMAT_NUM_16BIT, A, xtype );
 }
 
 /***********************************************************
@@ -354,17 +446,20 @@ OPERAND_FUNC(A6_r)
 {
     UBYTE A = ( opc & 0x0F ) | ( ( opc >> 5 ) & 0x30 );
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, A ) );
-    xref_addxref( xtype, g_insn_addr, A );
+    emit_addr( FORMAT_NUM_16BIT, A, xtype );
     COMMA;
     operand_rD5( f, addr, opc, xtype );
+    
+    store_io( A, ( opc >> 4 ) & 0x1F );
 }
 
 /***********************************************************
  * Load full register from Z
  *    Encoding:
  *  15       8 7       0
- *   ---- ---r rrrr --mm
+ *   ---- ---r rrrr -lmm
+ * LPM and ELPM (l = 1) only have the static and post-increment
+ *  modes, selected by the lower m bit.
  ************************************************************/
 OPERAND_FUNC(r_Zpm)
 {
@@ -372,17 +467,20 @@ OPERAND_FUNC(r_Zpm)
         STATIC  = 0x00,
         POSTINC = 0x01,
         PREDEC  = 0x02
-    } mode = opc & 0x03;
+    } mode = opc & ( ( opc & 0x04 ) ? 0x01 : 0x03 );
     
     operand_rD5( f, addr, opc, xtype );
     COMMA;
     switch ( mode )
     {
-    case STATIC:  operand(  "Z"  ); break;
-    case POSTINC: operand(  "Z+" ); break;
-    case PREDEC:  operand( "-Z"  ); break;
-    default:      operand( "???" ); break;
+    case STATIC:  emit_reg( "Z", 0 ); break;
+    case POSTINC: emit_reg( "Z+", 0 ); break;
+    case PREDEC:  emit_reg( "-Z", 0 ); break;
+    default:      emit_text( "???" ); break;
     }
+    
+    if ( ( opc & 0x06 ) == 0x06 )          /* ELPM */
+        note_ext( "RAMPZ", rampz );
 }
 
 /***********************************************************
@@ -403,10 +501,10 @@ OPERAND_FUNC(r_Ypm)
     COMMA;
     switch ( mode )
     {
-    case STATIC:  operand(  "Y"  ); break;
-    case POSTINC: operand(  "Y+" ); break;
-    case PREDEC:  operand( "-Y"  ); break;
-    default:      operand( "???" ); break;
+    case STATIC:  emit_reg( "Y", 0 ); break;
+    case POSTINC: emit_reg( "Y+", 0 ); break;
+    case PREDEC:  emit_reg( "-Y", 0 ); break;
+    default:      emit_text( "???" ); break;
     }
 }
 
@@ -428,10 +526,10 @@ OPERAND_FUNC(r_Xpm)
     COMMA;
     switch ( mode )
     {
-    case STATIC:  operand(  "X"  ); break;
-    case POSTINC: operand(  "X+" ); break;
-    case PREDEC:  operand( "-X"  ); break;
-    default:      operand( "???" ); break;
+    case STATIC:  emit_reg( "X", 0 ); break;
+    case POSTINC: emit_reg( "X+", 0 ); break;
+    case PREDEC:  emit_reg( "-X", 0 ); break;
+    default:      emit_text( "???" ); break;
     }
 }
 
@@ -451,10 +549,10 @@ OPERAND_FUNC(Zpm_r)
     
     switch ( mode )
     {
-    case STATIC:  operand(  "Z"  ); break;
-    case POSTINC: operand(  "Z+" ); break;
-    case PREDEC:  operand( "-Z"  ); break;
-    default:      operand( "???" ); break;
+    case STATIC:  emit_reg( "Z", 0 ); break;
+    case POSTINC: emit_reg( "Z+", 0 ); break;
+    case PREDEC:  emit_reg( "-Z", 0 ); break;
+    default:      emit_text( "???" ); break;
     }
     COMMA;
     operand_rD5( f, addr, opc, xtype );
@@ -476,10 +574,10 @@ OPERAND_FUNC(Ypm_r)
     
     switch ( mode )
     {
-    case STATIC:  operand(  "Y"  ); break;
-    case POSTINC: operand(  "Y+" ); break;
-    case PREDEC:  operand( "-Y"  ); break;
-    default:      operand( "???" ); break;
+    case STATIC:  emit_reg( "Y", 0 ); break;
+    case POSTINC: emit_reg( "Y+", 0 ); break;
+    case PREDEC:  emit_reg( "-Y", 0 ); break;
+    default:      emit_text( "???" ); break;
     }
     COMMA;
     operand_rD5( f, addr, opc, xtype );
@@ -501,10 +599,10 @@ OPERAND_FUNC(Xpm_r)
     
     switch ( mode )
     {
-    case STATIC:  operand(  "X"  ); break;
-    case POSTINC: operand(  "X+" ); break;
-    case PREDEC:  operand( "-X"  ); break;
-    default:      operand( "???" ); break;
+    case STATIC:  emit_reg( "X", 0 ); break;
+    case POSTINC: emit_reg( "X+", 0 ); break;
+    case PREDEC:  emit_reg( "-X", 0 ); break;
+    default:      emit_text( "???" ); break;
     }
     COMMA;
     operand_rD5( f, addr, opc, xtype );
@@ -521,8 +619,7 @@ OPERAND_FUNC(r_k16)
     
     operand_rD5( f, addr, opc, xtype );
     COMMA;
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest ); 
+    emit_addr( FORMAT_NUM_16BIT, dest, xtype );
 }
 
 /***********************************************************
@@ -534,10 +631,27 @@ OPERAND_FUNC(k16_r)
 {
     ADDR dest = (ADDR)nextw( f, addr );
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest ); 
+    emit_addr( FORMAT_NUM_16BIT, dest, xtype );
     COMMA;
     operand_rD5( f, addr, opc, xtype );
+    
+    store_io( dest - IO_DATA_OFFSET, ( opc >> 4 ) & 0x1F );
+}
+
+/***********************************************************
+ * No operands, but Z extended by EIND.
+ ************************************************************/
+OPERAND_FUNC(eind)
+{
+    note_ext( "EIND", eind );
+}
+
+/***********************************************************
+ * No operands, but Z extended by RAMPZ.
+ ************************************************************/
+OPERAND_FUNC(rampz)
+{
+    note_ext( "RAMPZ", rampz );
 }
 
 /***********************************************************
@@ -548,7 +662,7 @@ OPERAND_FUNC(k16_r)
  ************************************************************/
 OPERAND_FUNC(Z_r)
 {
-    operand( "Z" );
+    emit_reg( "Z", 0 );
     COMMA;
     operand_rD5( f, addr, opc, xtype );
 }
@@ -637,8 +751,10 @@ optab_t base_optab[] = {
     MASK ( "ORI",    rhigh_k8,      0xF000, 0x6000, X_IMM )
     MASK ( "ANDI",   rhigh_k8,      0xF000, 0x7000, X_IMM )
     
-    MASK ( "LD",     r_YZ,          0xD200, 0x8000, X_NONE )
-    MASK ( "ST",     YZ_r,          0xD200, 0x8200, X_NONE )
+    MASK ( "LD",     r_YZ,          0xFE07, 0x8000, X_NONE )
+    MASK ( "ST",     YZ_r,          0xFE07, 0x8200, X_NONE )
+    MASK ( "LDD",    r_YZ,          0xD200, 0x8000, X_NONE )
+    MASK ( "STD",    YZ_r,          0xD200, 0x8200, X_NONE )
     
     MASK ( "LPM",    r_Zpm,         0xFE0F, 0x9004, X_NONE )
     MASK ( "LPM",    r_Zpm,         0xFE0F, 0x9005, X_NONE )
@@ -699,11 +815,11 @@ optab_t base_optab[] = {
     INSN ( "CLI",    none,          0x94F8,         X_NONE )
     
     INSN ( "IJMP",   none,          0x9409,         X_NONE )
-    INSN ( "EIJMP",  none,          0x9419,         X_NONE )
+    INSN ( "EIJMP",  eind,          0x9419,         X_NONE )
     INSN ( "RET",    none,          0x9508,         X_NONE )
     INSN ( "ICALL",  none,          0x9509,         X_NONE )
     INSN ( "RETI",   none,          0x9518,         X_NONE )
-    INSN ( "EICALL", none,          0x9519,         X_NONE )
+    INSN ( "EICALL", eind,          0x9519,         X_NONE )
     
     INSN ( "SLEEP",  none,          0x9588,         X_NONE )
     INSN ( "BREAK",  none,          0x9598,         X_NONE )
@@ -713,16 +829,16 @@ optab_t base_optab[] = {
     MASK ( "JMP",    long_addr,     0xFE0E, 0x940C, X_JMP  )
     
     INSN ( "LPM",    none,          0x95C8,         X_NONE )
-    INSN ( "ELPM",   none,          0x95D8,         X_NONE )
+    INSN ( "ELPM",   rampz,         0x95D8,         X_NONE )
     INSN ( "SPM",    none,          0x95E8,         X_NONE )
     
     MASK ( "ADIW",   rphigh_k6,     0xFF00, 0x9600, X_IMM )
     MASK ( "SBIW",   rphigh_k6,     0xFF00, 0x9700, X_IMM )
     
-    MASK ( "CBI",    A_b,           0xFC00, 0x9800, X_NONE )
-    MASK ( "SBIC",   A_b,           0xFC00, 0x9900, X_NONE )
-    MASK ( "SBI",    A_b,           0xFC00, 0x9A00, X_NONE )
-    MASK ( "SBIS",   A_b,           0xFC00, 0x9B00, X_NONE )
+    MASK ( "CBI",    A_b,           0xFF00, 0x9800, X_NONE )
+    MASK ( "SBIC",   A_b,           0xFF00, 0x9900, X_NONE )
+    MASK ( "SBI",    A_b,           0xFF00, 0x9A00, X_NONE )
+    MASK ( "SBIS",   A_b,           0xFF00, 0x9B00, X_NONE )
     
     MASK ( "MUL",    r_r,           0xFC00, 0x9C00, X_NONE )
     
@@ -47,6 +47,78 @@
  *****************************************************************************/
 
 DASM_PROFILE( "dasmz80", "Zilog Z80", 4, 9, 0, 1 )
+ASXXXX_SYNTAX( "\t.area\tCODE\t(ABS)", 0 )
+DASM_FLOW(
+    FLOW_N( "JP",   JUMP,   1 )
+    FLOW_N( "JR",   JUMP,   1 )
+    FLOW_N( "RET",  RETURN, 0 )
+    FLOW  ( "RET",  BRANCH )
+    FLOW  ( "RETI", RETURN )
+    FLOW  ( "RETN", RETURN )
+)
+DASM_DISPATCH(
+    DISPATCH( "JP (HL)",     "LD HL,#",      NULL,           "CP #",     ANY,   1 )
+    DISPATCH( "JP (IX)",     "LD IX,#",      NULL,           "CP #",     ANY,   1 )
+    DISPATCH( "JP (IY)",     "LD IY,#",      NULL,           "CP #",     ANY,   1 )
+)
+DASM_TRACK(
+    TRACK_LOAD    ( "HL", "LD HL,#" )
+    TRACK_LOAD    ( "DE", "LD DE,#" )
+    TRACK_LOAD    ( "BC", "LD BC,#" )
+    TRACK_LOAD    ( "IX", "LD IX,#" )
+    TRACK_LOAD    ( "IY", "LD IY,#" )
+    TRACK_STEP    ( "HL", "INC HL",  1 )
+    TRACK_STEP    ( "HL", "DEC HL", -1 )
+    TRACK_STEP    ( "DE", "INC DE",  1 )
+    TRACK_STEP    ( "DE", "DEC DE", -1 )
+    TRACK_STEP    ( "BC", "INC BC",  1 )
+    TRACK_STEP    ( "BC", "DEC BC", -1 )
+    TRACK_STEP    ( "IX", "INC IX",  1 )
+    TRACK_STEP    ( "IX", "DEC IX", -1 )
+    TRACK_STEP    ( "IY", "INC IY",  1 )
+    TRACK_STEP    ( "IY", "DEC IY", -1 )
+    TRACK_KILL    ( "HL", "LD H,*|LD L,*|IN H,*|IN L,*|*,H|*,L|INC H|INC L|DEC H|DEC L|"
+                          "R* H|R* L|S* H|S* L|EXX|LDI*|LDD*|CPI*|CPD*|INI*|IND*|OTI*|OTD*|OUTI|OUTD" )
+    TRACK_KILL    ( "DE", "LD D,*|LD E,*|IN D,*|IN E,*|*,D|*,E|INC D|INC E|DEC D|DEC E|"
+                          "R* D|R* E|S* D|S* E|EXX|LDI*|LDD*" )
+    TRACK_KILL    ( "BC", "LD B,*|LD C,*|IN B,*|IN C,*|*,B|*,C|INC B|INC C|DEC B|DEC C|"
+                          "R* B|R* C|S* B|S* C|EXX|DJNZ*|LDI*|LDD*|CPI*|CPD*|INI*|IND*|OTI*|OTD*|OUTI|OUTD" )
+    TRACK_KILL    ( "IX", "*IXH*|*IXL*" )
+    TRACK_KILL    ( "IY", "*IYH*|*IYL*" )
+    TRACK_USE     ( "HL", "JP (HL)",    JMP )
+    TRACK_USE     ( "HL", "*(HL)*",     DATA )
+    TRACK_USE     ( "DE", "*(DE)*",     DATA )
+    TRACK_USE     ( "BC", "*(BC)*",     DATA )
+    TRACK_USE     ( "IX", "JP (IX)",    JMP )
+    TRACK_USE     ( "IY", "JP (IY)",    JMP )
+    TRACK_USE_DISP( "IX", "*(IX%)*",    DATA )
+    TRACK_USE_DISP( "IY", "*(IY%)*",    DATA )
+    TRACK_USE     ( "HL", "PUSH HL",    NONE )
+    TRACK_USE     ( "DE", "PUSH DE",    NONE )
+    TRACK_USE     ( "BC", "PUSH BC",    NONE )
+    TRACK_USE     ( "IX", "PUSH IX",    NONE )
+    TRACK_USE     ( "IY", "PUSH IY",    NONE )
+)
+DASM_REGS( 0, 0 )
+
+/**
+    Processor variant, and whether an eZ80 runs in ADL (24-bit address)
+    mode.  Both are chosen by the command file, e.g. "o0000 EZ80" and
+    "o0000 ADL"; a JP.LIL or JP.SIS also switches ADL mode at its target.
+**/
+#define CPU_Z180                ( 0x01 )    /* Z180 instructions    */
+#define CPU_EZ80                ( 0x02 )    /* eZ80 instructions    */
+
+static int cpu = 0;
+static int adl = 0;
+
+DASM_SELECTED_MODES(
+    MODE( "Z80",   cpu, 0 )
+    MODE( "Z180",  cpu, CPU_Z180 )
+    MODE( "EZ80",  cpu, CPU_Z180 | CPU_EZ80 )
+    MODE( "ADL",   adl, 1 )
+    MODE( "NOADL", adl, 0 )
+)
 
 /*****************************************************************************
  * Private data types, macros, constants.
@@ -55,14 +127,54 @@ DASM_PROFILE( "dasmz80", "Zilog Z80", 4, 9, 0, 1 )
 /* Common output formats */
 #define FORMAT_NUM_8BIT         "$%02X"
 #define FORMAT_NUM_16BIT        "$%04X"
+#define FORMAT_NUM_24BIT        "$%06X"
 
 /* Construct a 16-bit word out of low and high bytes */
 #define MK_WORD(l,h)            ( ((l) & 0xFF) | (((h) & 0xFF) << 8) )
 
+/* eZ80 suffix prefixes: data width then immediate width */
+#define SFX_SIS                 ( 0x40 )
+#define SFX_LIS                 ( 0x49 )
+#define SFX_SIL                 ( 0x52 )
+#define SFX_LIL                 ( 0x5B )
+
 /*****************************************************************************
  *        Private Functions
  *****************************************************************************/
 
+/***********************************************************
+ * Non-zero if immediates and addresses in the instruction are
+ *  24 bits wide: in ADL mode unless a .SIS or .LIS suffix
+ *  says otherwise, or with a .SIL or .LIL suffix.
+ ************************************************************/
+static int long_imm( void )
+{
+    if ( !( cpu & CPU_EZ80 ) )
+        return 0;
+        
+    switch ( g_insn_prefix )
+    {
+    case SFX_SIS: case SFX_LIS: return 0;
+    case SFX_SIL: case SFX_LIL: return 1;
+    default:                    return adl;
+    }
+}
+
+/***********************************************************
+ * Reads a 16-bit, or 24-bit (see long_imm), immediate or address.
+ ************************************************************/
+static ADDR next_word( FILE *f, ADDR *addr )
+{
+    UBYTE lsb  = next( f, addr );
+    UBYTE msb  = next( f, addr );
+    ADDR  word = MK_WORD( lsb, msb );
+    
+    if ( long_imm() )
+        word |= (ADDR)next( f, addr ) << 16;
+        
+    return word;
+}
+
 /******************************************************************************/
 /**                            Operand Functions                             **/
 /******************************************************************************/
@@ -82,97 +194,97 @@ OPERAND_FUNC(none)
 
 OPERAND_FUNC(a)
 {
-    operand( "A" );
+    emit_reg( "A", 0 );
 }
 
 OPERAND_FUNC(b)
 {
-    operand( "B" );
+    emit_reg( "B", 0 );
 }
 
 OPERAND_FUNC(c)
 {
-    operand( "C" );
+    emit_reg( "C", 0 );
 }
 
 OPERAND_FUNC(ind_c)
 {
-    operand( "(C)" );
+    emit_reg( "(C)", 0 );
 }
 
 OPERAND_FUNC(d)
 {
-    operand( "D" );
+    emit_reg( "D", 0 );
 }
 
 OPERAND_FUNC(e)
 {
-    operand( "E" );
+    emit_reg( "E", 0 );
 }
 
 OPERAND_FUNC(h)
 {
-    operand( "H" );
+    emit_reg( "H", 0 );
 }
 
 OPERAND_FUNC(l)
 {
-    operand( "L" );
+    emit_reg( "L", 0 );
 }
 
 OPERAND_FUNC(de)
 {
-    operand( "DE" );
+    emit_reg( "DE", 0 );
 }
 
 OPERAND_FUNC(hl)
 {
-    operand( "HL" );
+    emit_reg( "HL", 0 );
 }
 
 OPERAND_FUNC(ind_hl)
 {
-    operand( "(HL)" );
+    emit_reg( "(HL)", 0 );
 }
 
 OPERAND_FUNC(af)
 {
-    operand( "AF" );
+    emit_reg( "AF", 0 );
 }
 
 OPERAND_FUNC(afp)
 {
-    operand( "AF\'" );
+    emit_reg( "AF\'", 0 );
 }
 
 OPERAND_FUNC(sp)
 {
-    operand( "SP" );
+    emit_reg( "SP", 0 );
 }
 
 OPERAND_FUNC(indsp)
 {
-    operand( "(SP)" );
+    emit_reg( "(SP)", 0 );
 }
 
 OPERAND_FUNC(ix)
 {
-    operand( "IX" );
+    emit_reg( "IX", 0 );
 }
 
 OPERAND_FUNC(indix)
 {
-    operand( "(IX)" );
+    emit_reg( "(IX)", 0 );
 }
 
 OPERAND_FUNC(ixl)
 {
-    operand( "IXL" );
+    emit_reg( "IXL", 0 );
 }
 
 OPERAND_FUNC(ixh)
 {
-    operand( "IXH" );
+    emit_reg( "IXH", 0 );
 }
 
 OPERAND_FUNC(ixX)
@@ -185,22 +297,22 @@ OPERAND_FUNC(ixX)
 
 OPERAND_FUNC(iy)
 {
-    operand( "IY" );
+    emit_reg( "IY", 0 );
 }
 
 OPERAND_FUNC(indiy)
 {
-    operand( "(IY)" );
+    emit_reg( "(IY)", 0 );
 }
 
 OPERAND_FUNC(iyl)
 {
-    operand( "IYL" );
+    emit_reg( "IYL", 0 );
 }
 
 OPERAND_FUNC(iyh)
 {
-    operand( "IYH" );
+    emit_reg( "IYH", 0 );
 }
 
 OPERAND_FUNC(iyX)
@@ -213,27 +325,32 @@ OPERAND_FUNC(iyX)
 
 OPERAND_FUNC(i)
 {
-    operand( "I" );
+    emit_reg( "I", 0 );
 }
 
 OPERAND_FUNC(r)
 {
-    operand( "R" );
+    emit_reg( "R", 0 );
+}
+
+OPERAND_FUNC(mb)
+{
+    emit_reg( "MB", 0 );
 }
 
 OPERAND_FUNC(0)
 {
-    operand( "0" );
+    emit_text( "0" );
 }
 
 OPERAND_FUNC(1)
 {
-    operand( "1" );
+    emit_text( "1" );
 }
 
 OPERAND_FUNC(2)
 {
-    operand( "2" );
+    emit_text( "2" );
 }
 
 /***********************************************************
@@ -245,7 +362,7 @@ OPERAND_FUNC(imm8)
 {
     UBYTE byte = next( f, addr );
     
-    operand( "#" FORMAT_NUM_8BIT, byte );
+    emit_imm( "#" FORMAT_NUM_8BIT, byte );
 }
 
 /***********************************************************
@@ -254,12 +371,10 @@ OPERAND_FUNC(imm8)
 
 OPERAND_FUNC(imm16)
 {
-    UBYTE lsb   = next( f, addr );
-    UBYTE msb   = next( f, addr );
-    UWORD imm16 = MK_WORD( lsb, msb );
+    const char *fmt = long_imm() ? "#" FORMAT_NUM_24BIT : "#" FORMAT_NUM_16BIT;
+    ADDR imm16 = next_word( f, addr );
 
-    operand( xref_genwordaddr( NULL, "#" FORMAT_NUM_16BIT, imm16 ) );
-    xref_addxref( xtype, g_insn_addr, imm16 );
+    emit_operand( OPND_IMM, fmt, imm16, imm16, xtype, OPF_LABEL );
 }
 
 /***********************************************************
@@ -271,7 +386,7 @@ OPERAND_FUNC(bit)
 {
     UBYTE bit = ( opc >> 3 ) & 0x07;
     
-    operand( "%d", bit );
+    emit_bit( "%d", bit );
 }
 
 /***********************************************************
@@ -284,7 +399,7 @@ OPERAND_FUNC(reg)
     UBYTE reg = opc & 0x07;
     static char *rtab[] = { "B", "C", "D", "E", "H", "L", "(HL)", "A" };
     
-    operand( "%s", rtab[reg] );
+    emit_reg( rtab[reg], reg );
 }
 
 /* xxRRR_Rxxx */
@@ -299,7 +414,7 @@ OPERAND_FUNC(rpair)
     UBYTE reg = ( opc >> 4 ) & 0x03;
     static char *rtab[] = { "BC", "DE", "HL", "SP" };
     
-    operand( "%s", rtab[reg] );
+    emit_reg( rtab[reg], reg );
 }
 
 /* xxRR_xxxx */
@@ -308,7 +423,9 @@ OPERAND_FUNC(indrpair)
     UBYTE reg = ( opc >> 4 ) & 0x03;
     static char *rtab[] = { "BC", "DE", "HL", "SP" };
     
-    operand( "(%s)", rtab[reg] );
+    emit_text( "(" );
+    emit_reg( rtab[reg], reg );
+    emit_text( ")" );
 }
 
 /***********************************************************
@@ -320,8 +437,8 @@ OPERAND_FUNC(rel8)
     BYTE disp = (BYTE)next( f, addr );
     ADDR dest = *addr + disp;
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest );
+    emit_rel( ( cpu & CPU_EZ80 ) && adl ? FORMAT_NUM_24BIT : FORMAT_NUM_16BIT, 
+              dest, xtype );
 }
 
 /***********************************************************
@@ -330,12 +447,14 @@ OPERAND_FUNC(rel8)
 
 OPERAND_FUNC(addr16)
 {
-    UBYTE lsb = next( f, addr );
-    UBYTE msb = next( f, addr );
-    ADDR dest = MK_WORD( lsb, msb );
+    const char *fmt = long_imm() ? FORMAT_NUM_24BIT : FORMAT_NUM_16BIT;
+    ADDR dest = next_word( f, addr );
+    
+    emit_addr( fmt, dest, xtype );
     
-    operand( xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest );
+    /* JP.LIL and JP.SIS switch ADL mode */
+    if ( opc == 0xC3 && ( g_insn_prefix == SFX_LIL || g_insn_prefix == SFX_SIS ) )
+        adl = ( g_insn_prefix == SFX_LIL );
 }
 
 /***********************************************************
@@ -344,20 +463,21 @@ OPERAND_FUNC(addr16)
 
 OPERAND_FUNC(mem16)
 {
-    UBYTE lsb = next( f, addr );
-    UBYTE msb = next( f, addr );
-    ADDR dest = MK_WORD( lsb, msb );
+    const char *fmt = long_imm() ? FORMAT_NUM_24BIT : FORMAT_NUM_16BIT;
+    ADDR dest = next_word( f, addr );
     
-    operand( "(%s)", xref_genwordaddr( NULL, FORMAT_NUM_16BIT, dest ) );
-    xref_addxref( xtype, g_insn_addr, dest );
+    emit_text( "(" );
+    emit_addr( fmt, dest, xtype );
+    emit_text( ")" );
 }
 
 OPERAND_FUNC(mem8)
 {
     UBYTE ioport = next( f, addr );
     
-    operand( "(%s)", xref_genwordaddr( NULL, FORMAT_NUM_8BIT, ioport ) );
-    xref_addxref( xtype, g_insn_addr, ioport );
+    emit_text( "(" );
+    emit_addr( FORMAT_NUM_8BIT, ioport, xtype );
+    emit_text( ")" );
 }
 
 /***********************************************************
@@ -370,7 +490,7 @@ OPERAND_FUNC(cond)
     UBYTE cond = ( opc >> 3 ) & 0x07;
     static char *ctab[] = { "NZ", "Z", "NC", "C", "PO", "PE", "P", "M" };
 
-    operand( "%s", ctab[cond] );
+    emit_cond( ctab[cond], cond );
 }
 
 /***********************************************************
@@ -381,19 +501,27 @@ OPERAND_FUNC(rst)
 {
     UBYTE rst = ( opc & 0x30 ) | ( ( opc & 0x0F ) == 0x0F ? 0x08 : 0x00 );
     
-    operand( FORMAT_NUM_8BIT, rst );
+    emit_operand( OPND_ADDR, FORMAT_NUM_8BIT, rst, rst, X_NONE, 0 );
 }
 
 /***********************************************************
  * Process IX/IY plus offset operands (IX + DISP)
  ************************************************************/
  
-static void z80_emit_signed_index_offset( const char *idx, BYTE disp )
+static void z80_emit_index_disp( const char *idx, BYTE disp )
 {
+    emit_reg( idx, 0 );
     if ( disp < 0 )
-    	operand( "(%s-" FORMAT_NUM_8BIT ")", idx, -disp );
+        emit_disp( "-" FORMAT_NUM_8BIT, -disp );
     else
-    	operand( "(%s+" FORMAT_NUM_8BIT ")", idx, disp );
+        emit_disp( "+" FORMAT_NUM_8BIT, disp );
+}
+
+static void z80_emit_signed_index_offset( const char *idx, BYTE disp )
+{
+    emit_text( "(" );
+    z80_emit_index_disp( idx, disp );
+    emit_text( ")" );
 }
 
 OPERAND_FUNC(ixoff)
@@ -412,23 +540,42 @@ OPERAND_FUNC(iyoff)
 
 /***********************************************************
  * Process special IX/IY offset operands where the displacement
- * comes from the special operand stack.
+ * byte was read before the opcode (DD CB d op).
  ************************************************************/
 
 OPERAND_FUNC(ixoffS)
 {
-    BYTE disp = (BYTE)stack_pop();
+    BYTE disp = (BYTE)g_insn_disp;
 
     z80_emit_signed_index_offset( "IX", disp );    
 }
 
 OPERAND_FUNC(iyoffS)
 {
-    BYTE disp = (BYTE)stack_pop();
+    BYTE disp = (BYTE)g_insn_disp;
 
     z80_emit_signed_index_offset( "IY", disp );    
 }
 
+/***********************************************************
+ * Process eZ80 IX/IY plus offset operands, which are not
+ * indirect (LEA, PEA).
+ ************************************************************/
+
+OPERAND_FUNC(ixdisp)
+{
+    BYTE disp = (BYTE)next( f, addr );
+    
+    z80_emit_index_disp( "IX", disp );
+}
+
+OPERAND_FUNC(iydisp)
+{
+    BYTE disp = (BYTE)next( f, addr );
+    
+    z80_emit_index_disp( "IY", disp );
+}
+
 /******************************************************************************/
 /**                            Double Operands                               **/
 /******************************************************************************/
@@ -509,6 +656,26 @@ TWO_OPERAND(reg2, iyoff)
 TWO_OPERAND(sp, iy)
 TWO_OPERAND(indsp, iy)
 
+/*** Z180 and eZ80 ***/
+
+TWO_OPERAND_PAIR(mb, a)
+TWO_OPERAND_PAIR(i, hl)
+TWO_OPERAND_PAIR(rpair, ind_hl)
+TWO_OPERAND_PAIR(ix, ind_hl)
+TWO_OPERAND_PAIR(iy, ind_hl)
+TWO_OPERAND(rpair, ixdisp)
+TWO_OPERAND(rpair, iydisp)
+TWO_OPERAND(ix, ixdisp)
+TWO_OPERAND(ix, iydisp)
+TWO_OPERAND(iy, ixdisp)
+TWO_OPERAND(iy, iydisp)
+TWO_OPERAND_PAIR(rpair, ixoff)
+TWO_OPERAND_PAIR(rpair, iyoff)
+TWO_OPERAND_PAIR(ix, ixoff)
+TWO_OPERAND_PAIR(ix, iyoff)
+TWO_OPERAND_PAIR(iy, ixoff)
+TWO_OPERAND_PAIR(iy, iyoff)
+
 /* Special double ops */
 
 OPERAND_FUNC(rD_rS)
@@ -559,12 +726,105 @@ optab_t pageBITS[] = {
     END
 };
 
+/******************************************************************************/
+/* Z180 and eZ80 additions */
+/******************************************************************************/
+
+optab_t pageEXTD180[] = {
+
+    INSN ( "IN0",   mem8,      0x30, X_IO )
+    MASK ( "IN0",   reg2_mem8, 0xC7, 0x00, X_IO )
+    UNDEF( 0x31 )
+    MASK ( "OUT0",  mem8_reg2, 0xC7, 0x01, X_IO )
+    
+    MASK ( "TST",   reg2,      0xC7, 0x04, X_NONE )
+    INSN ( "TST",   imm8,      0x64, X_IMM )
+    INSN ( "TSTIO", imm8,      0x74, X_IMM )
+    MASK ( "MLT",   rpair,     0xCF, 0x4C, X_NONE )
+    
+    INSN ( "SLP",   none,      0x76, X_NONE )
+    INSN ( "OTIM",  none,      0x83, X_NONE )
+    INSN ( "OTDM",  none,      0x8B, X_NONE )
+    INSN ( "OTIMR", none,      0x93, X_NONE )
+    INSN ( "OTDMR", none,      0x9B, X_NONE )
+    
+    END
+};
+
+optab_t pageEXTDEZ80[] = {
+
+    INSN ( "LEA",   ix_ixdisp,    0x32, X_NONE )
+    INSN ( "LEA",   iy_iydisp,    0x33, X_NONE )
+    MASK ( "LEA",   rpair_ixdisp, 0xCF, 0x02, X_NONE )
+    MASK ( "LEA",   rpair_iydisp, 0xCF, 0x03, X_NONE )
+    INSN ( "LEA",   iy_ixdisp,    0x54, X_NONE )
+    INSN ( "LEA",   ix_iydisp,    0x55, X_NONE )
+    INSN ( "PEA",   ixdisp,       0x65, X_NONE )
+    INSN ( "PEA",   iydisp,       0x66, X_NONE )
+    
+    INSN ( "LD",    ix_ind_hl,    0x37, X_NONE )
+    INSN ( "LD",    iy_ind_hl,    0x31, X_NONE )
+    MASK ( "LD",    rpair_ind_hl, 0xCF, 0x07, X_NONE )
+    INSN ( "LD",    ind_hl_ix,    0x3F, X_NONE )
+    INSN ( "LD",    ind_hl_iy,    0x3E, X_NONE )
+    MASK ( "LD",    ind_hl_rpair, 0xCF, 0x0F, X_NONE )
+    
+    INSN ( "LD",    mb_a,         0x6D, X_NONE )
+    INSN ( "LD",    a_mb,         0x6E, X_NONE )
+    INSN ( "LD",    i_hl,         0xC7, X_NONE )
+    INSN ( "LD",    hl_i,         0xD7, X_NONE )
+    INSN ( "STMIX", none,         0x7D, X_NONE )
+    INSN ( "RSMIX", none,         0x7E, X_NONE )
+    
+    END
+};
+
+optab_t pageIXEZ80[] = {
+
+    INSN ( "LD",    ix_ixoff,     0x37, X_REG )
+    INSN ( "LD",    iy_ixoff,     0x31, X_REG )
+    MASK ( "LD",    rpair_ixoff,  0xCF, 0x07, X_REG )
+    INSN ( "LD",    ixoff_ix,     0x3F, X_REG )
+    INSN ( "LD",    ixoff_iy,     0x3E, X_REG )
+    MASK ( "LD",    ixoff_rpair,  0xCF, 0x0F, X_REG )
+    
+    END
+};
+
+optab_t pageIYEZ80[] = {
+
+    INSN ( "LD",    iy_iyoff,     0x37, X_REG )
+    INSN ( "LD",    ix_iyoff,     0x31, X_REG )
+    MASK ( "LD",    rpair_iyoff,  0xCF, 0x07, X_REG )
+    INSN ( "LD",    iyoff_iy,     0x3F, X_REG )
+    INSN ( "LD",    iyoff_ix,     0x3E, X_REG )
+    MASK ( "LD",    iyoff_rpair,  0xCF, 0x0F, X_REG )
+    
+    END
+};
+
+/* eZ80 suffixes, which qualify the instruction after them */
+extern optab_t base_optab[];
+
+optab_t pageSUFFIX[] = {
+
+    PREFIX ( base_optab, SFX_SIS, ".SIS" )
+    PREFIX ( base_optab, SFX_LIS, ".LIS" )
+    PREFIX ( base_optab, SFX_SIL, ".SIL" )
+    PREFIX ( base_optab, SFX_LIL, ".LIL" )
+    
+    END
+};
+
 /******************************************************************************/
 /* Extended operations */
 /******************************************************************************/
 
 optab_t pageEXTD[] = {
 
+    VARIANT ( pageEXTDEZ80, cpu, CPU_EZ80 )
+    VARIANT ( pageEXTD180,  cpu, CPU_Z180 )
+
     MASK ( "ADC", hl_rpair, 0xCF, 0x4A, X_NONE )
     MASK ( "SBC", hl_rpair, 0xCF, 0x42, X_NONE )
     INSN ( "NEG", none,     0x44, X_NONE )
@@ -663,6 +923,8 @@ optab_t pageIXBITS[] = {
 
 optab_t pageIX[] = {
 
+    VARIANT ( pageIXEZ80, cpu, CPU_EZ80 )
+
     INSN ( "LD", ix_imm16,   0x21, X_IMM )
     INSN ( "LD", mem16_ix,   0x22, X_DIRECT )
     INSN ( "LD", ix_mem16,   0x2A, X_DIRECT )
@@ -699,7 +961,7 @@ optab_t pageIX[] = {
     
     INSN ( "JP",   indix,    0xE9, X_REG )    
 
-    PUSHTBL ( pageIXBITS,    0xCB, 1 )
+    DISPTBL ( pageIXBITS, 0xCB )
     
     END
 };
@@ -730,6 +992,8 @@ optab_t pageIYBITS[] = {
 };
 
 optab_t pageIY[] = {
+
+    VARIANT ( pageIYEZ80, cpu, CPU_EZ80 )
     
     INSN ( "LD", iy_imm16,   0x21, X_IMM )
     INSN ( "LD", mem16_iy,   0x22, X_DIRECT )
@@ -767,7 +1031,7 @@ optab_t pageIY[] = {
     
     INSN ( "JP",   indiy,    0xE9, X_REG ) 
     
-    PUSHTBL ( pageIYBITS, 0xCB, 1 )
+    DISPTBL ( pageIYBITS, 0xCB )
     
     END
 };
@@ -778,6 +1042,8 @@ optab_t pageIY[] = {
 
 optab_t base_optab[] = {
     
+    VARIANT ( pageSUFFIX, cpu, CPU_EZ80 )
+    
     INSN ( "HALT", none, 0x76, X_NONE )
     
 /*----------------------------------------------------------------------------
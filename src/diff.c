@@ -0,0 +1,734 @@
+/*****************************************************************************
+ *
+ * Copyright (C) 2014-2016, Neil Johnson
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms,
+ * with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of Neil Johnson nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *****************************************************************************/
+ 
+/*****************************************************************************
+ *
+ * Differences between ROM versions, by procedure.
+ *
+ * When one firmware version is built from the last, most procedures are
+ *  the same, but they are at different addresses, so a diff of the two
+ *  listings shows changes on nearly every line.  This compares the two
+ *  images one procedure at a time instead.
+ *
+ * The old image is first summarised in a procedure map (-M): one line for
+ *  each procedure, with its address, size, shape and signature (see
+ *  sig.c), followed by its labels and comments as offsets from its entry:
+ *
+ *      P addr size insns blocks callees hash name
+ *      L offset label
+ *      K offset line comment
+ *      N offset
+ *      block comment lines
+ *      .
+ *
+ * Then the new image is diffed against the map (-D).  Procedures are
+ *  paired in four rounds, each cheaper than quadratic:
+ *
+ *      1. signatures
+ *      2. names given to both by the user
+ *      3. an unpaired procedure alone in the gap between two pairs, in
+ *         both images
+ *      4. flow graph shapes (blocks, callees and instructions)
+ *
+ *  A key pairs procedures when as many have it in both images (most
+ *  often just one); the procedures that share it pair in address order.
+ *
+ * The report is a command file.  Each procedure is listed in a comment as
+ *  the same, moved, changed or added, followed by the commands that port
+ *  its name, labels and comments to its new address; changed procedures
+ *  only keep what was at their entry.  Removed procedures come last.
+ *  The report can be included in the new image's command file.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "dasmxx.h"
+
+/*****************************************************************************
+ *        Data Types, Macros, Constants
+ *****************************************************************************/
+
+#define LINE_LEN        ( 1024 )
+#define NOTE_LEN        ( 4096 )
+
+#define NO_MATCH        ( (unsigned int)-1 )
+
+typedef enum { D_SAME, D_MOVED, D_CHANGED, D_ADDED, D_REMOVED } DIFF_STATUS;
+
+/* A label or comment, from the entry of its procedure */
+typedef struct {
+    char         kind;        /* 'L', 'K' or 'N' */
+    unsigned int offset;
+    const char * text;
+} item_t;
+
+typedef struct {
+    ADDR         addr;
+    ADDR         end;         /* end of its last return, or ~0         */
+    unsigned int size;
+    unsigned int n_insns;
+    unsigned int n_blocks;
+    unsigned int n_callees;
+    unsigned long long hash;
+    const char * name;
+    unsigned int first_item;
+    unsigned int n_items;
+    unsigned int match;       /* procedure in the other map            */
+} dproc_t;
+
+/* Orders procedures by one of the keys they are paired by */
+typedef int (*pair_key_t)( const dproc_t *a, const dproc_t *b );
+
+typedef struct {
+    dproc_t    * procs;
+    unsigned int n_procs, max_procs;
+    item_t     * items;
+    unsigned int n_items, max_items;
+} pmap_t;
+
+/*****************************************************************************
+ *        Private Data
+ *****************************************************************************/
+
+static pmap_t old_map, new_map;
+
+/* Used by the qsort() comparison */
+static const pmap_t * sort_map;
+static pair_key_t          sort_key;
+
+static const char * const status_names[] = {
+    "same", "moved", "changed", "added", "removed"
+};
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      add_proc
+ *
+ * DESCRIPTION
+ *      Adds a procedure to a map.
+ *
+ * RETURNS
+ *      the new procedure
+ *
+ ************************************************************/
+
+static dproc_t * add_proc( pmap_t *map )
+{
+    dproc_t *p;
+    
+    map->procs = grow( map->procs, map->n_procs, &map->max_procs, sizeof( dproc_t ) );
+    p = &map->procs[map->n_procs++];
+    memset( p, 0, sizeof( *p ) );
+    p->first_item = map->n_items;
+    p->match      = NO_MATCH;
+    
+    return p;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      add_item
+ *
+ * DESCRIPTION
+ *      Adds a label or comment to the last procedure of a
+ *       map.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void add_item( pmap_t *map, char kind, unsigned int offset, const char *text )
+{
+    item_t *it;
+    
+    map->items = grow( map->items, map->n_items, &map->max_items, sizeof( item_t ) );
+    it = &map->items[map->n_items++];
+    it->kind   = kind;
+    it->offset = offset;
+    it->text   = dupstr( text );
+    map->procs[map->n_procs - 1].n_items++;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      generated
+ *
+ * DESCRIPTION
+ *      Tests for a name made up by dasmxx.
+ *
+ * RETURNS
+ *      non-zero if it is one
+ *
+ ************************************************************/
+
+static int generated( const char *name )
+{
+    return !strncmp( name, GEN_LABEL_PREFIX, strlen( GEN_LABEL_PREFIX ) );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      read_map
+ *
+ * DESCRIPTION
+ *      Reads a procedure map written by diff_write_map().
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void read_map( const char *mapfile, pmap_t *map )
+{
+    char line[LINE_LEN], text[LINE_LEN], note[NOTE_LEN];
+    unsigned int lineno = 0, offset;
+    dproc_t *p = NULL;
+    FILE *f = fopen( mapfile, "r" );
+    char *q;
+    int n;
+    
+    if ( !f )
+        error( "Failed to open procedure map `%s'", mapfile );
+        
+    while ( lineno++, fgets( line, sizeof( line ), f ) )
+    {
+        if ( ( q = strchr( line, '\n' ) ) )
+            *q = '\0';
+            
+        if ( line[0] == '#' || !line[0] )
+            continue;
+            
+        if ( line[0] == 'P' )
+        {
+            p = add_proc( map );
+            if ( sscanf( line, "P %x %u %u %u %u %llx %s", &p->addr, &p->size, 
+                         &p->n_insns, &p->n_blocks, &p->n_callees, &p->hash, 
+                         text ) != 7 )
+                error( "%s(%u) :: Bad procedure", mapfile, lineno );
+            p->name = dupstr( text );
+            continue;
+        }
+        
+        if ( !p || !strchr( "LKN", line[0] ) 
+             || sscanf( line + 1, " %x%n", &offset, &n ) != 1 )
+            error( "%s(%u) :: Bad procedure map line", mapfile, lineno );
+            
+        for ( q = line + 1 + n; *q == ' '; q++ )
+            ;
+            
+        if ( line[0] == 'N' )
+        {
+            /* Lines up to "." */
+            note[0] = '\0';
+            while ( lineno++, fgets( line, sizeof( line ), f ) && line[0] != '.' )
+                if ( strlen( note ) + strlen( line ) < sizeof( note ) )
+                    strcat( note, line );
+            add_item( map, 'N', offset, note );
+        }
+        else
+            add_item( map, line[0], offset, q );
+    }
+    
+    fclose( f );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      by_hash
+ *
+ * DESCRIPTION
+ *      Orders procedures by signature and size.
+ *
+ * RETURNS
+ *      <0, 0, >0
+ *
+ ************************************************************/
+
+static int by_hash( const dproc_t *a, const dproc_t *b )
+{
+    if ( a->hash != b->hash )
+        return a->hash < b->hash ? -1 : 1;
+        
+    return ( a->size > b->size ) - ( a->size < b->size );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      by_name
+ *
+ * DESCRIPTION
+ *      Orders procedures by name.
+ *
+ * RETURNS
+ *      <0, 0, >0
+ *
+ ************************************************************/
+
+static int by_name( const dproc_t *a, const dproc_t *b )
+{
+    return strcmp( a->name, b->name );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      by_shape
+ *
+ * DESCRIPTION
+ *      Orders procedures by flow graph shape.
+ *
+ * RETURNS
+ *      <0, 0, >0
+ *
+ ************************************************************/
+
+static int by_shape( const dproc_t *a, const dproc_t *b )
+{
+    if ( a->n_blocks != b->n_blocks )
+        return ( a->n_blocks > b->n_blocks ) - ( a->n_blocks < b->n_blocks );
+    if ( a->n_callees != b->n_callees )
+        return ( a->n_callees > b->n_callees ) - ( a->n_callees < b->n_callees );
+        
+    return ( a->n_insns > b->n_insns ) - ( a->n_insns < b->n_insns );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cmp_index
+ *
+ * DESCRIPTION
+ *      qsort() comparison of procedure indices of sort_map
+ *       by sort_key, then by address.
+ *
+ * RETURNS
+ *      <0, 0, >0
+ *
+ ************************************************************/
+
+static int cmp_index( const void *a, const void *b )
+{
+    unsigned int ia = *(const unsigned int *)a, ib = *(const unsigned int *)b;
+    int c = sort_key( &sort_map->procs[ia], &sort_map->procs[ib] );
+    
+    return c ? c : ( ia > ib ) - ( ia < ib );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      sort_unpaired
+ *
+ * DESCRIPTION
+ *      Sorts the unpaired procedures of a map by a key and
+ *       then by address.
+ *
+ * RETURNS
+ *      sorted array of indices; *n is set to its length
+ *
+ ************************************************************/
+
+static unsigned int * sort_unpaired( const pmap_t *map, pair_key_t key, unsigned int *n )
+{
+    unsigned int *index = zalloc( ( map->n_procs + 1 ) * sizeof( unsigned int ) );
+    unsigned int i;
+    
+    for ( *n = 0, i = 0; i < map->n_procs; i++ )
+        if ( map->procs[i].match == NO_MATCH 
+             && ( key != by_name || !generated( map->procs[i].name ) ) )
+            index[(*n)++] = i;
+            
+    sort_map = map;
+    sort_key = key;
+    qsort( index, *n, sizeof( unsigned int ), cmp_index );
+    
+    return index;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      pair_by
+ *
+ * DESCRIPTION
+ *      Pairs the unpaired procedures that share a key with
+ *       as many procedures in the other map, in address
+ *       order, by merging the two sorted lists.  Most keys
+ *       are unique; duplicated routines pair up in order.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void pair_by( pair_key_t key )
+{
+    unsigned int n_old, n_new, i = 0, j = 0, gi, gj;
+    unsigned int *o = sort_unpaired( &old_map, key, &n_old );
+    unsigned int *n = sort_unpaired( &new_map, key, &n_new );
+    
+    while ( i < n_old && j < n_new )
+    {
+        int c = key( &old_map.procs[o[i]], &new_map.procs[n[j]] );
+        
+        if ( c < 0 )
+            i++;
+        else if ( c > 0 )
+            j++;
+        else
+        {
+            for ( gi = i + 1; gi < n_old 
+                  && !key( &old_map.procs[o[i]], &old_map.procs[o[gi]] ); gi++ )
+                ;
+            for ( gj = j + 1; gj < n_new 
+                  && !key( &new_map.procs[n[j]], &new_map.procs[n[gj]] ); gj++ )
+                ;
+                
+            if ( gi - i == gj - j )
+            {
+                for ( ; i < gi; i++, j++ )
+                {
+                    old_map.procs[o[i]].match = n[j];
+                    new_map.procs[n[j]].match = o[i];
+                }
+            }
+            
+            i = gi;
+            j = gj;
+        }
+    }
+    
+    free( o );
+    free( n );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      pair_gaps
+ *
+ * DESCRIPTION
+ *      Pairs procedures that are alone between the same two
+ *       pairs in both maps.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void pair_gaps( void )
+{
+    unsigned int j, last_new = NO_MATCH, last_old = NO_MATCH;
+    
+    for ( j = 0; j <= new_map.n_procs; j++ )
+    {
+        unsigned int o = ( j < new_map.n_procs ) ? new_map.procs[j].match 
+                                                 : old_map.n_procs;
+        unsigned int gap_new, gap_old, first_old;
+        
+        if ( o == NO_MATCH )
+            continue;
+            
+        first_old = ( last_old == NO_MATCH ) ? 0 : last_old + 1;
+        gap_new   = j - ( ( last_new == NO_MATCH ) ? 0 : last_new + 1 );
+        gap_old   = ( o >= first_old ) ? o - first_old : 0;
+        
+        if ( gap_new == 1 && gap_old == 1 
+             && old_map.procs[first_old].match == NO_MATCH )
+        {
+            old_map.procs[first_old].match = j - 1;
+            new_map.procs[j - 1].match     = first_old;
+        }
+        
+        last_new = j;
+        last_old = o;
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      status
+ *
+ * DESCRIPTION
+ *      Works out how a procedure of the new map differs.
+ *
+ * RETURNS
+ *      D_xxx
+ *
+ ************************************************************/
+
+static DIFF_STATUS status( const dproc_t *p )
+{
+    const dproc_t *o;
+    
+    if ( p->match == NO_MATCH )
+        return D_ADDED;
+        
+    o = &old_map.procs[p->match];
+    if ( o->hash != p->hash || o->size != p->size )
+        return D_CHANGED;
+        
+    return ( o->addr == p->addr ) ? D_SAME : D_MOVED;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      port_items
+ *
+ * DESCRIPTION
+ *      Writes the commands giving a new procedure the name,
+ *       labels and comments of the old one.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void port_items( FILE *fp, const dproc_t *p, const dproc_t *o, int entry_only )
+{
+    unsigned int i;
+    
+    if ( !generated( o->name ) )
+        fprintf( fp, "p" FORMAT_ADDR " %s\n", p->addr, o->name );
+        
+    for ( i = 0; i < o->n_items; i++ )
+    {
+        const item_t *it = &old_map.items[o->first_item + i];
+        ADDR addr = p->addr + it->offset;
+        
+        if ( entry_only && it->offset )
+            continue;
+            
+        switch ( it->kind )
+        {
+        case 'L':
+            fprintf( fp, "l" FORMAT_ADDR " %s\n", addr, it->text );
+            break;
+        case 'K':
+            fprintf( fp, "k" FORMAT_ADDR " %s\n", addr, it->text );
+            break;
+        case 'N':
+            fprintf( fp, "n" FORMAT_ADDR "\n%s.\n", addr, it->text );
+            break;
+        }
+    }
+}
+
+/*****************************************************************************
+ *        Public Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      diff_scan
+ *
+ * DESCRIPTION
+ *      Adds one item of a walk to the map of this image: a
+ *       new procedure, or the labels and comments of one.
+ *       The flow graph must have been built.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void diff_scan( const record_t *rec )
+{
+    ADDR addr = rec->insn->addr;
+    proc_info_t info;
+    dproc_t *p;
+    
+    if ( rec->kind == REC_CODE && rec->insn->opcode && cfg_proc_info( addr, &info ) )
+    {
+        p = add_proc( &new_map );
+        p->addr      = addr;
+        p->end       = info.size ? addr + info.size : (ADDR)-1;
+        p->size      = info.size;
+        p->n_blocks  = info.n_blocks;
+        p->n_callees = info.n_callees;
+    }
+    
+    if ( !new_map.n_procs )
+        return;
+        
+    p = &new_map.procs[new_map.n_procs - 1];
+    if ( addr >= p->end )
+        return;
+        
+    if ( rec->label && addr != p->addr && !generated( rec->label ) )
+        add_item( &new_map, 'L', addr - p->addr, rec->label );
+    if ( rec->comment )
+        add_item( &new_map, 'K', addr - p->addr, rec->comment );
+    if ( rec->note )
+        add_item( &new_map, 'N', addr - p->addr, rec->note );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      diff_write_map
+ *
+ * DESCRIPTION
+ *      Writes the procedure map of this image, after the
+ *       diff_scan() and sig_scan() walk.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void diff_write_map( const char *mapfile )
+{
+    FILE *fp = fopen( mapfile, "w" );
+    unsigned int i, k;
+    
+    if ( !fp )
+        error( "Failed to open procedure map `%s'", mapfile );
+        
+    fprintf( fp, "# %s procedure map\n", dasm_name );
+    
+    for ( i = 0; i < new_map.n_procs; i++ )
+    {
+        dproc_t *p = &new_map.procs[i];
+        
+        sig_proc( p->addr, &p->hash, &p->n_insns );
+        p->name = cfg_proc_name( p->addr );
+        fprintf( fp, "P " FORMAT_ADDR " %u %u %u %u %016llX %s\n", p->addr, 
+                 p->size, p->n_insns, p->n_blocks, p->n_callees, p->hash, p->name );
+                 
+        for ( k = 0; k < p->n_items; k++ )
+        {
+            const item_t *it = &new_map.items[p->first_item + k];
+            size_t len = strlen( it->text );
+            
+            if ( it->kind == 'N' )
+                fprintf( fp, "N %X\n%s%s.\n", it->offset, it->text,
+                         ( len && it->text[len - 1] == '\n' ) ? "" : "\n" );
+            else
+                fprintf( fp, "%c %X %s\n", it->kind, it->offset, it->text );
+        }
+    }
+    
+    if ( fclose( fp ) )
+        error( "Failed to write procedure map `%s'", mapfile );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      diff_report
+ *
+ * DESCRIPTION
+ *      Diffs this image against an old procedure map and
+ *       writes the report, a command file, to stdout.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void diff_report( const char *mapfile )
+{
+    unsigned int counts[D_REMOVED + 1] = { 0 };
+    unsigned int i;
+    
+    read_map( mapfile, &old_map );
+    
+    /* Signatures and names are final once the scan is over */
+    for ( i = 0; i < new_map.n_procs; i++ )
+    {
+        dproc_t *p = &new_map.procs[i];
+        
+        sig_proc( p->addr, &p->hash, &p->n_insns );
+        p->name = cfg_proc_name( p->addr );
+    }
+        
+    pair_by( by_hash );
+    pair_by( by_name );
+    pair_gaps();
+    pair_by( by_shape );
+    
+    for ( i = 0; i < new_map.n_procs; i++ )
+        counts[status( &new_map.procs[i] )]++;
+    for ( i = 0; i < old_map.n_procs; i++ )
+        counts[D_REMOVED] += ( old_map.procs[i].match == NO_MATCH );
+        
+    printf( "# Differences from `%s'\n", mapfile );
+    printf( "#   %u same, %u moved, %u changed, %u added, %u removed\n", 
+            counts[D_SAME], counts[D_MOVED], counts[D_CHANGED], counts[D_ADDED],
+            counts[D_REMOVED] );
+            
+    for ( i = 0; i < new_map.n_procs; i++ )
+    {
+        const dproc_t *p = &new_map.procs[i];
+        const dproc_t *o = ( p->match != NO_MATCH ) ? &old_map.procs[p->match] : NULL;
+        DIFF_STATUS st = status( p );
+        
+        printf( "\n# %-8s", status_names[st] );
+        if ( o )
+            printf( FORMAT_ADDR " -> ", o->addr );
+        printf( FORMAT_ADDR "  %s\n", p->addr, o ? o->name : p->name );
+        
+        if ( o )
+            port_items( stdout, p, o, st == D_CHANGED );
+    }
+    
+    for ( i = 0; i < old_map.n_procs; i++ )
+    {
+        const dproc_t *o = &old_map.procs[i];
+        
+        if ( o->match == NO_MATCH )
+            printf( "\n# %-8s" FORMAT_ADDR "  %s\n", status_names[D_REMOVED], 
+                    o->addr, o->name );
+    }
+}
+
+/******************************************************************************/
+/******************************************************************************/
+/******************************************************************************/
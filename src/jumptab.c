@@ -0,0 +1,764 @@
+/*****************************************************************************
+ *
+ * Copyright (C) 2014-2016, Neil Johnson
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms,
+ * with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of Neil Johnson nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *****************************************************************************/
+ 
+/*****************************************************************************
+ *
+ * Jump table resolution.
+ *
+ * A computed jump (JMP @A+DPTR, JP (HL), IJMP, ...) leaves the flow graph
+ *  with no successor, and whatever it jumps through is usually listed as
+ *  code.  Most of them are switch statements compiled to a handful of
+ *  idioms: load the table address, check the index against the number
+ *  of cases, scale the index and jump.  Each target describes its idioms
+ *  in a dispatch table (DASM_DISPATCH), giving the shape of the jump, of
+ *  the instruction(s) loading the table address and of the bounds check.
+ *
+ * The scan pass (jt_scan) keeps the last few instructions of the current
+ *  run of code.  At an indirect jump matching an idiom it looks back for
+ *  the table address and bound, and notes the jump as a candidate.  Each
+ *  candidate is then read from the input (jt_resolve).  A table runs for
+ *  the number of entries given by the bounds check, while the entries
+ *  point into code; without one it runs until an entry does not point
+ *  at the start of an instruction, or up to the next
+ *  label (every segment of the command file starts with one), up to a
+ *  limit of MAX_ENTRIES.  Entries may be:
+ *
+ *      WORDS   - code addresses
+ *      JUMPS   - jump instructions, all of one length
+ *      PAGE    - the low bytes of addresses in the page of the jump
+ *
+ *  The table and its targets are labelled, and the caller is told of
+ *  each one so that it can list WORDS tables as vectors and PAGE tables
+ *  as bytes.  The caller then rescans, as listing a table as data can
+ *  change what is decoded after it, until no new tables are found.
+ *  The flow graph (cfg.c) takes the targets of each jump from jt_targets.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "dasmxx.h"
+
+/*****************************************************************************
+ *        Data Types, Macros, Constants
+ *****************************************************************************/
+
+/* Instructions looked back over from an indirect jump */
+#define JT_WINDOW       ( 16 )
+
+/* Longest instruction shape kept */
+#define MAX_SHAPE       ( 64 )
+
+/* Most entries in a table without a bounds check */
+#define MAX_ENTRIES     ( 256 )
+
+/* Operands stand in an instruction shape as one of these */
+#define SHAPE_IMM       ( '\x01' )
+#define SHAPE_NUM       ( '\x02' )
+
+/* Names of tables and targets with no label */
+#define GEN_TABLE_FORMAT    GEN_LABEL_PREFIX "JTAB_%04X"
+#define GEN_CASE_FORMAT     GEN_LABEL_PREFIX "CASE_%04X"
+
+#define NO_TARGET       ( (ADDR)-1 )
+
+/* One instruction of the look-back window */
+typedef struct {
+    ADDR         addr;
+    char         shape[MAX_SHAPE];  /* mnemonic and operands, no spaces */
+    int          has_value;
+    ADDR         value;             /* first numeric operand            */
+} shape_t;
+
+/* One per indirect jump matching an idiom */
+typedef struct {
+    jump_table_t       jt;
+    const dispatch_t * d;
+    unsigned int       bound;       /* entry count, 0 if not known      */
+    ADDR               from;        /* start of the dispatch sequence   */
+} candidate_t;
+
+/*****************************************************************************
+ *        Private Data
+ *****************************************************************************/
+
+static shape_t window[JT_WINDOW];
+static unsigned int head = 0, n_window = 0;
+
+/* Candidates, in jump address order up to n_sorted */
+static candidate_t * tables = NULL;
+static unsigned int n_tables = 0, max_tables = 0, n_sorted = 0;
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      append
+ *
+ * DESCRIPTION
+ *      Appends text to a shape, leaving out spaces.
+ *
+ * RETURNS
+ *      end of the shape
+ *
+ ************************************************************/
+
+static char * append( char *p, char *end, const char *s )
+{
+    for ( ; *s && p < end; s++ )
+        if ( *s != ' ' && *s != '\t' )
+            *p++ = *s;
+            
+    return p;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      make_shape
+ *
+ * DESCRIPTION
+ *      Makes the shape of an instruction for matching, with
+ *       each numeric operand replaced by SHAPE_IMM or
+ *       SHAPE_NUM, and captures the first numeric operand.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void make_shape( const insn_t *insn, shape_t *sh )
+{
+    char *p = sh->shape, *end = sh->shape + MAX_SHAPE - 1;
+    char buf[128];
+    int i;
+    
+    sh->addr      = insn->addr;
+    sh->has_value = 0;
+    p = append( p, end, insn->opcode );
+    
+    for ( i = 0; i < insn->n_operands && p < end; i++ )
+    {
+        const operand_t *op = &insn->operands[i];
+        
+        switch ( op->type )
+        {
+        case OPND_IMM:
+        case OPND_ADDR:
+        case OPND_REL:
+        case OPND_DISP:
+            /* Some targets give the '#' of an immediate as text */
+            if ( op->type == OPND_IMM && p > sh->shape && p[-1] == '#' )
+                p--;
+            *p++ = ( op->type == OPND_IMM ) ? SHAPE_IMM : SHAPE_NUM;
+            if ( !sh->has_value )
+            {
+                sh->has_value = 1;
+                sh->value = ( op->type == OPND_ADDR || op->type == OPND_REL )
+                            ? op->ref : (ADDR)op->value;
+            }
+            break;
+            
+        case OPND_TEXT:
+            p = append( p, end, op->fmt );
+            break;
+            
+        default:
+            dasm_format_operand( op, buf );
+            p = append( p, end, buf );
+            break;
+        }
+    }
+    
+    *p = '\0';
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      glob
+ *
+ * DESCRIPTION
+ *      Matches a shape against one alternative of a pattern,
+ *       running from p up to pend.
+ *
+ * RETURNS
+ *      non-zero if it matches
+ *
+ ************************************************************/
+
+static int glob( const char *p, const char *pend, const char *s )
+{
+    for ( ; p < pend; p++ )
+    {
+        if ( *p == ' ' )
+            continue;
+            
+        if ( *p == '*' )
+        {
+            do {
+                if ( glob( p + 1, pend, s ) )
+                    return 1;
+            } while ( *s++ );
+            return 0;
+        }
+        
+        if ( *p == '#' ? ( *s != SHAPE_IMM )
+           : *p == '%' ? ( *s != SHAPE_IMM && *s != SHAPE_NUM )
+           : ( toupper( (UBYTE)*p ) != toupper( (UBYTE)*s ) ) )
+            return 0;
+        s++;
+    }
+    
+    return *s == '\0';
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      match
+ *
+ * DESCRIPTION
+ *      Matches a shape against a pattern of alternatives.
+ *
+ * RETURNS
+ *      non-zero if any alternative matches
+ *
+ ************************************************************/
+
+static int match( const char *pat, const char *s )
+{
+    const char *bar;
+    
+    for ( ; ( bar = strchr( pat, '|' ) ); pat = bar + 1 )
+        if ( glob( pat, bar, s ) )
+            return 1;
+            
+    return glob( pat, pat + strlen( pat ), s );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_shape
+ *
+ * DESCRIPTION
+ *      Looks back over the window for instructions matching
+ *       a pattern, taking the value of the nearest or, if
+ *       lowest is set, the lowest value of all of them.
+ *       *from is lowered to the address of the earliest.
+ *
+ * RETURNS
+ *      non-zero if one was found
+ *
+ ************************************************************/
+
+static int find_shape( const char *pat, int lowest, ADDR *value, ADDR *from )
+{
+    unsigned int i;
+    int found = 0;
+    
+    for ( i = 0; i < n_window; i++ )
+    {
+        const shape_t *sh = &window[( head + JT_WINDOW - 1 - i ) % JT_WINDOW];
+        
+        if ( !sh->has_value || !match( pat, sh->shape ) )
+            continue;
+            
+        if ( !found || sh->value < *value )
+            *value = sh->value;
+        if ( sh->addr < *from )
+            *from = sh->addr;
+        found = 1;
+        
+        if ( !lowest )
+            break;
+    }
+    
+    return found;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_table
+ *
+ * DESCRIPTION
+ *      Looks up the candidate for a jump.
+ *
+ * RETURNS
+ *      the candidate, or NULL if none
+ *
+ ************************************************************/
+
+static candidate_t * find_table( ADDR jump )
+{
+    unsigned int lo = 0, hi = n_sorted;
+    
+    while ( lo < hi )
+    {
+        unsigned int mid = lo + ( hi - lo ) / 2;
+        
+        if ( tables[mid].jt.jump < jump )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    
+    if ( lo < n_sorted && tables[lo].jt.jump == jump )
+        return &tables[lo];
+        
+    /* New candidates of this pass are in address order too */
+    if ( n_tables > n_sorted && tables[n_tables - 1].jt.jump == jump )
+        return &tables[n_tables - 1];
+        
+    return NULL;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      add_candidate
+ *
+ * DESCRIPTION
+ *      Notes an indirect jump as a candidate if the window
+ *       holds the rest of the idiom.
+ *
+ * RETURNS
+ *      non-zero if the jump is a candidate
+ *
+ ************************************************************/
+
+static int add_candidate( ADDR jump, const dispatch_t *d )
+{
+    const shape_t *last = &window[( head + JT_WINDOW - 1 ) % JT_WINDOW];
+    candidate_t *c;
+    ADDR base, v, from = jump;
+    
+    if ( find_table( jump ) )
+        return 1;
+        
+    if ( d->base )
+    {
+        if ( !find_shape( d->base, 1, &base, &from ) )
+            return 0;
+    }
+    else if ( last->has_value )
+        base = last->value;
+    else
+        return 0;
+        
+    if ( d->base_hi )
+    {
+        if ( !find_shape( d->base_hi, 0, &v, &from ) )
+            return 0;
+        base = ( base & 0xFF ) | ( ( v & 0xFF ) << 8 );
+    }
+    
+    tables = grow( tables, n_tables, &max_tables, sizeof( *tables ) );
+    
+    c = &tables[n_tables++];
+    memset( c, 0, sizeof( *c ) );
+    c->d       = d;
+    c->from    = from;
+    c->jt.jump = jump;
+    c->jt.kind = d->kind;
+    
+    if ( d->kind == TABLE_PAGE )
+        c->jt.table = ( jump & ~0xFF ) | ( base & 0xFF );
+    else
+        c->jt.table = base * d->scale;
+        
+    if ( d->bound && find_shape( d->bound, 0, &v, &from ) && v > 0 && v <= MAX_ENTRIES )
+        c->bound = v;
+        
+    return 1;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      read_jump
+ *
+ * DESCRIPTION
+ *      Decodes a table entry at addr, f being positioned at
+ *       it.  *size is set to its length.
+ *
+ * RETURNS
+ *      its target, or NO_TARGET if it is not a direct jump
+ *
+ ************************************************************/
+
+static ADDR read_jump( FILE *f, ADDR addr, unsigned int *size )
+{
+    insn_t insn;
+    ADDR target;
+    
+    /* Out of order, so decode it as if nothing went before */
+    dasm_begin_walk();
+    dasm_decode( f, &insn, addr );
+    *size = insn.length;
+    
+    if ( cfg_flow( &insn, &target ) != FLOW_JUMP )
+        return NO_TARGET;
+        
+    return target;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      read_table
+ *
+ * DESCRIPTION
+ *      Reads the entries of a candidate from the input,
+ *       whose first byte is at address base and which is
+ *       length bytes long.
+ *
+ * RETURNS
+ *      number of entries
+ *
+ ************************************************************/
+
+static unsigned int read_table( FILE *f, ADDR base, long length, candidate_t *c )
+{
+    jump_table_t *jt = &c->jt;
+    unsigned int limit = c->bound ? c->bound : MAX_ENTRIES;
+    unsigned int n, size = 0, first = 0;
+    ADDR targets[MAX_ENTRIES];
+    ADDR addr = jt->table, target;
+    
+    if ( jt->kind == TABLE_ANY )
+    {
+        jt->kind = TABLE_WORDS;
+        if ( addr >= base && (long)( addr - base ) + dasm_max_insn_length <= length )
+        {
+            fseek( f, addr - base, SEEK_SET );
+            if ( read_jump( f, addr, &size ) != NO_TARGET )
+                jt->kind = TABLE_JUMPS;
+        }
+    }
+    
+    for ( n = 0; n < limit; n++, addr += size )
+    {
+        long offset = (long)addr - (long)base;
+        
+        if ( addr < base || offset >= length )
+            break;
+        if ( n > 0 && xref_findaddrlabel( addr ) )
+            break;
+            
+        fseek( f, offset, SEEK_SET );
+        
+        if ( jt->kind == TABLE_JUMPS )
+        {
+            if ( offset + dasm_max_insn_length > length 
+                 || read_jump( f, addr, &size ) == NO_TARGET
+                 || ( n > 0 && size != first ) )
+                break;
+            first  = size;
+            target = addr;
+        }
+        else if ( jt->kind == TABLE_WORDS )
+        {
+            int b_1st, b_2nd;
+            
+            if ( offset + 2 > length )
+                break;
+            b_1st = fgetc( f );
+            b_2nd = fgetc( f );
+            if ( dasm_word_msb_first )
+                target = ( b_1st << 8 ) | b_2nd;
+            else
+                target = b_1st | ( b_2nd << 8 );
+            size = 2;
+        }
+        else
+        {
+            target = ( jt->jump & ~0xFF ) | fgetc( f );
+            size = 1;
+        }
+        
+        /* Data entries must point at code, but not into the table or
+         * back into the dispatch.  The code need not be decoded in step
+         * yet if the size is known. */
+        if ( jt->kind != TABLE_JUMPS
+             && ( !cfg_in_code( target, !c->bound ) 
+                  || ( target >= jt->table && target < addr + size )
+                  || ( target >= c->from && target <= jt->jump ) ) )
+            break;
+            
+        targets[n] = target;
+    }
+    
+    if ( n == 0 )
+        return 0;
+        
+    jt->entry_size = size;
+    jt->n_entries  = n;
+    jt->targets    = zalloc( n * sizeof( ADDR ) );
+    memcpy( jt->targets, targets, n * sizeof( ADDR ) );
+    
+    return n;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      label_table
+ *
+ * DESCRIPTION
+ *      Labels a resolved table and, unless it is a table of
+ *       jumps, its targets.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void label_table( const jump_table_t *jt )
+{
+    char buf[32];
+    unsigned int i;
+    
+    if ( !xref_findaddrlabel( jt->table ) )
+    {
+        sprintf( buf, GEN_TABLE_FORMAT, jt->table );
+        xref_addxreflabel( jt->table, buf );
+    }
+    
+    if ( jt->kind == TABLE_JUMPS )
+        return;
+        
+    for ( i = 0; i < jt->n_entries; i++ )
+        if ( !xref_findaddrlabel( jt->targets[i] ) )
+        {
+            sprintf( buf, GEN_CASE_FORMAT, jt->targets[i] );
+            xref_addxreflabel( jt->targets[i], buf );
+        }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cmp_jump
+ *
+ * DESCRIPTION
+ *      qsort() comparison of candidates by jump address.
+ *
+ * RETURNS
+ *      <0, 0, >0
+ *
+ ************************************************************/
+
+static int cmp_jump( const void *a, const void *b )
+{
+    ADDR ja = ( (const candidate_t *)a )->jt.jump;
+    ADDR jb = ( (const candidate_t *)b )->jt.jump;
+    
+    return ( ja > jb ) - ( ja < jb );
+}
+
+/*****************************************************************************
+ *        Public Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      jt_scan
+ *
+ * DESCRIPTION
+ *      Adds one item of the scan pass to the look-back
+ *       window, and notes a candidate at an indirect jump
+ *       matching one of the target's idioms.  Data items and
+ *       the end of a run of code empty the window.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void jt_scan( const record_t *rec )
+{
+    const dispatch_t *d;
+    FLOW_TYPE flow;
+    ADDR target;
+    
+    if ( rec->kind != REC_CODE || !rec->insn->opcode || rec->segment )
+        n_window = 0;
+        
+    if ( rec->kind != REC_CODE || !rec->insn->opcode )
+        return;
+        
+    make_shape( rec->insn, &window[head] );
+    head = ( head + 1 ) % JT_WINDOW;
+    if ( n_window < JT_WINDOW )
+        n_window++;
+        
+    flow = cfg_flow( rec->insn, &target );
+    
+    if ( flow == FLOW_JUMP && target == NO_TARGET )
+        for ( d = dasm_dispatch_table; d->jump; d++ )
+            if ( match( d->jump, window[( head + JT_WINDOW - 1 ) % JT_WINDOW].shape )
+                 && add_candidate( rec->insn->addr, d ) )
+                break;
+                
+    if ( flow == FLOW_JUMP || flow == FLOW_RETURN || flow == FLOW_STOP )
+        n_window = 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      jt_resolve
+ *
+ * DESCRIPTION
+ *      Reads the tables of the candidates found since the 
+ *       last call from f, whose first byte is at address 
+ *       base.  Each table found is labelled and passed to
+ *       found.  Candidates whose table cannot be read are
+ *       not tried again.
+ *
+ * RETURNS
+ *      number of tables found
+ *
+ ************************************************************/
+
+int jt_resolve( FILE *f, ADDR base, void (*found)( const jump_table_t *jt ) )
+{
+    unsigned int i;
+    long length;
+    int n = 0;
+    
+    if ( n_sorted == n_tables )
+        return 0;
+        
+    fseek( f, 0, SEEK_END );
+    length = ftell( f );
+    
+    for ( i = n_sorted; i < n_tables; i++ )
+    {
+        if ( read_table( f, base, length, &tables[i] ) )
+        {
+            label_table( &tables[i].jt );
+            found( &tables[i].jt );
+            n++;
+        }
+    }
+    
+    qsort( tables, n_tables, sizeof( *tables ), cmp_jump );
+    n_sorted = n_tables;
+    
+    return n;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      jt_targets
+ *
+ * DESCRIPTION
+ *      Looks up the table of an indirect jump.  *targets is
+ *       set to its targets.
+ *
+ * RETURNS
+ *      number of targets, 0 if the jump has no table
+ *
+ ************************************************************/
+
+unsigned int jt_targets( ADDR jump, const ADDR **targets )
+{
+    candidate_t *c = find_table( jump );
+    
+    if ( !c )
+        return 0;
+        
+    *targets = c->jt.targets;
+    return c->jt.n_entries;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      jt_shape
+ *
+ * DESCRIPTION
+ *      Makes the shape of an instruction, for matching with
+ *       jt_match() by other passes that describe instructions
+ *       by pattern.
+ *
+ * RETURNS
+ *      non-zero if it has a numeric operand, the first of
+ *       which is put in *value
+ *
+ ************************************************************/
+
+int jt_shape( const insn_t *insn, char *shape, unsigned int size, ADDR *value )
+{
+    shape_t sh;
+    
+    make_shape( insn, &sh );
+    strncpy( shape, sh.shape, size - 1 );
+    shape[size - 1] = '\0';
+    *value = sh.value;
+    
+    return sh.has_value;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      jt_match
+ *
+ * DESCRIPTION
+ *      Matches a shape made by jt_shape() against a pattern.
+ *
+ * RETURNS
+ *      non-zero if it matches
+ *
+ ************************************************************/
+
+int jt_match( const char *pat, const char *shape )
+{
+    return match( pat, shape );
+}
+
+/******************************************************************************/
+/******************************************************************************/
+/******************************************************************************/
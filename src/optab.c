@@ -46,6 +46,27 @@
 #define INSN_FOUND              ( 1 )
 #define INSN_NOT_FOUND          ( 0 )
 
+#define NO_TARGET               ( (ADDR)-1 )
+
+/* Most pieces of decoder state a target may have */
+#define MAX_STATES              ( 8 )
+
+/* A mode selected by an 'o' command */
+typedef struct {
+    ADDR                addr;
+    const dasm_mode_t * mode;
+    int                 value;
+    unsigned int        state;      /* index into states[]              */
+} mode_set_t;
+
+/* Decoder state carried forward to a jump or call target */
+typedef struct {
+    ADDR                addr;
+    unsigned int        known;      /* states carried here              */
+    unsigned int        conflict;   /* ... by paths that disagree       */
+    int                 values[MAX_STATES];
+} carry_t;
+
 /*****************************************************************************
  * External data.
  *****************************************************************************/
@@ -59,29 +80,90 @@ extern optab_t base_optab[];
 /* Start address of each instruction as it is decoded. */
 ADDR g_insn_addr = 0;
 
+/* Displacement byte of a DISPTBL instruction (Z80 DD CB d op). */
+UBYTE g_insn_disp = 0;
+
+/* Prefix byte of a PREFIX instruction (eZ80 .LIL), 0 if none. */
+UBYTE g_insn_prefix = 0;
+
 /*****************************************************************************
  * Private data.
  *****************************************************************************/
 
-/* Global output buffer into which the decoded output is written. */
-static char * output_buffer = NULL;
+/* Instruction record into which the decoded operands are written. */
+static insn_t * cur_insn = NULL;
+
+/* Mnemonic suffix from a PREFIX entry, and the suffixed mnemonics made
+ * so far (kept for good, as records point at them) */
+typedef struct suffixed_s {
+    const char *        opcode;
+    const char *        suffix;
+    struct suffixed_s * next;
+    char                name[1];
+} suffixed_t;
+static const char * cur_suffix = NULL;
+static suffixed_t * suffixed   = NULL;
 
-/* Stack for PUSHTBL */
-#define STACK_DEPTH	( 16 )
-static OPC opcstack[STACK_DEPTH];
-static int tos = -1;
+/**
+    Dispatch index for a table.  For every opcode value it holds the
+    position of the first entry in the table which could match it (or
+    of the END entry if none can), so walk_table() can skip straight
+    to it rather than scanning from the top of the table.  Targets with
+    16-bit opcodes (AVR) get a 64K-entry index, which takes them
+    directly to the matching entry.  Indices are built the first time
+    each table is walked.
+**/
+#define INDEX_SLOTS     ( 64 )
+typedef struct {
+    const optab_t * table;
+    UWORD *         first;
+} optab_index_t;
+static optab_index_t * index_cache[INDEX_SLOTS];
+
+/**
+    Decoder state (see DASM_MODES).  The carried states are kept in a
+    hash table, emptied by dasm_begin_walk() at the start of each walk
+    of the input.  Most addresses have nothing carried to them, so a
+    bitmap of the (hashed) addresses that might is checked before the
+    table.  A state is known once an instruction, an 'o' command or a
+    carry has set it; until then it only holds the default, and does
+    not disagree with what is carried to it.  Only known states are
+    carried.
+**/
+#define CARRY_FILTER_BITS   ( 1u << 20 )
+static int *        states[MAX_STATES];
+static int          initial[MAX_STATES];
+static int          defaults[MAX_STATES];
+static unsigned int n_states = 0;
+static int          states_ready = 0;
+
+static mode_set_t * mode_sets = NULL;
+static unsigned int n_mode_sets = 0, next_mode_set = 0;
+static unsigned int settings_given = 0;     /* by index in dasm_mode_table */
+
+static carry_t *    carries = NULL;
+static unsigned int n_carries = 0, max_carries = 0;
+static UBYTE        carry_filter[CARRY_FILTER_BITS / 8];
+
+static ADDR         last_end = 0;
+static int          last_break = 1;
+static unsigned int known = 0, forgotten = 0;
+static int          entered[MAX_STATES];
 
 /*****************************************************************************
  *        Private Functions
  *****************************************************************************/
 
+static optab_t * find_first( optab_t * optab, OPC opc );
+
 /***********************************************************
  *
  * FUNCTION
  *      opcode
  *
  * DESCRIPTION
- *      Writes the given opcode string into the output buffer.
+ *      Records the given opcode string in the instruction,
+ *       with the suffix of any PREFIX entry followed.
  *
  * RETURNS
  *      none
@@ -90,8 +172,62 @@ static int tos = -1;
  
 static void opcode( const char *opcode )
 {
-    int n = sprintf( output_buffer, "%-*s", dasm_max_opcode_width, opcode );
-    output_buffer += n;
+    if ( cur_suffix )
+    {
+        suffixed_t *p;
+        
+        for ( p = suffixed; p; p = p->next )
+            if ( p->opcode == opcode && p->suffix == cur_suffix )
+                break;
+                
+        if ( !p )
+        {
+            p = zalloc( sizeof( suffixed_t ) + strlen( opcode ) + strlen( cur_suffix ) );
+            p->opcode = opcode;
+            p->suffix = cur_suffix;
+            sprintf( p->name, "%s%s", opcode, cur_suffix );
+            p->next = suffixed;
+            suffixed = p;
+        }
+        
+        opcode = p->name;
+    }
+    
+    cur_insn->opcode = opcode;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      dasm_format_operand
+ *
+ * DESCRIPTION
+ *      Formats a single operand into the buffer, substituting
+ *      a label for the operand if one is defined.
+ *
+ * RETURNS
+ *      number of chars written
+ *
+ ************************************************************/
+
+int dasm_format_operand( const operand_t *op, char *buf )
+{
+    const char *label;
+    
+    if ( op->type == OPND_TEXT )
+        return sprintf( buf, "%s", op->fmt );
+    
+    if ( op->flags & OPF_LABEL )
+    {
+        if ( ( label = xref_findaddrlabel( op->ref ) ) )
+            return sprintf( buf, "%s", label );
+        
+        if ( ( op->flags & OPF_LABEL_NEAR ) 
+             && ( label = xref_findaddrlabel( op->ref - 1 ) ) )
+            return sprintf( buf, "%s+1", label );
+    }
+    
+    return sprintf( buf, op->fmt, op->value );
 }
 
 /***********************************************************
@@ -118,6 +254,316 @@ static OPC next_insn( FILE* fp, ADDR *addr  )
         error( "INTERNAL ERROR: unsupported instruction size.\n" );
 }
 
+/***********************************************************
+ *
+ * FUNCTION
+ *      init_states
+ *
+ * DESCRIPTION
+ *      Finds the target's pieces of decoder state from its
+ *       table of modes, noting their initial values.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void init_states( void )
+{
+    const dasm_mode_t *m;
+    unsigned int i;
+    
+    if ( states_ready )
+        return;
+    states_ready = 1;
+    
+    for ( m = dasm_mode_table; m->name; m++ )
+    {
+        if ( m->setting )
+            continue;
+        for ( i = 0; i < n_states && states[i] != m->state; i++ )
+            ;
+        if ( i == n_states )
+        {
+            if ( n_states == MAX_STATES )
+                error( "INTERNAL ERROR: too many decoder states.\n" );
+            states[n_states]  = m->state;
+            initial[n_states] = *m->state;
+            n_states++;
+        }
+    }
+    
+    memcpy( defaults, initial, sizeof( defaults ) );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_carry
+ *
+ * DESCRIPTION
+ *      Looks up the state carried to an address, adding an
+ *       empty entry for it if add is set.
+ *
+ * RETURNS
+ *      pointer to the entry, or NULL if there is none
+ *
+ ************************************************************/
+
+static carry_t * find_carry( ADDR addr, int add )
+{
+    unsigned int i, bit = addr & ( CARRY_FILTER_BITS - 1 );
+    
+    if ( !add && !( carry_filter[bit / 8] & ( 1 << ( bit % 8 ) ) ) )
+        return NULL;
+    carry_filter[bit / 8] |= 1 << ( bit % 8 );
+    
+    if ( add && ( n_carries + 1 ) * 4 > max_carries * 3 )
+    {
+        carry_t *old = carries;
+        unsigned int n_old = max_carries;
+        
+        max_carries = max_carries ? max_carries * 2 : 1024;
+        carries = zalloc( max_carries * sizeof( carry_t ) );
+        n_carries = 0;
+        
+        for ( i = 0; i < n_old; i++ )
+            if ( old[i].known )
+            {
+                *find_carry( old[i].addr, 1 ) = old[i];
+                n_carries++;
+            }
+        free( old );
+    }
+    
+    if ( !max_carries )
+        return NULL;
+        
+    for ( i = ( addr * 2654435761u ) & ( max_carries - 1 ); 
+          carries[i].known; 
+          i = ( i + 1 ) & ( max_carries - 1 ) )
+        if ( carries[i].addr == addr )
+            return &carries[i];
+            
+    if ( !add )
+        return NULL;
+        
+    carries[i].addr = addr;
+    return &carries[i];
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      enter_state
+ *
+ * DESCRIPTION
+ *      Sets up the decoder state for the instruction at addr
+ *       from the one before it, the jumps and calls to it,
+ *       and the modes selected for it.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void enter_state( ADDR addr )
+{
+    unsigned int i, forced = 0;
+    carry_t *c;
+    
+    if ( addr != last_end )
+        last_break = 1;
+    if ( last_break )
+        known = 0;
+        
+    for ( ; next_mode_set < n_mode_sets && mode_sets[next_mode_set].addr <= addr;
+          next_mode_set++ )
+    {
+        const mode_set_t *ms = &mode_sets[next_mode_set];
+        
+        defaults[ms->state] = ms->value;
+        forced |= 1u << ms->state;
+    }
+    
+    c = find_carry( addr, 0 );
+    
+    for ( i = 0; i < n_states; i++ )
+    {
+        unsigned int bit = 1u << i;
+        int value = *states[i];
+        
+        if ( forced & bit )
+        {
+            value = defaults[i];
+            known |= bit;
+        }
+        else if ( c && ( c->known & bit ) )
+        {
+            if ( ( c->conflict & bit ) 
+                 || ( ( known & bit ) && value != c->values[i] ) )
+            {
+                value = defaults[i];
+                known &= ~bit;
+            }
+            else
+            {
+                value = c->values[i];
+                known |= bit;
+            }
+        }
+        else if ( !( known & bit ) )
+            value = defaults[i];
+        
+        *states[i] = entered[i] = value;
+    }
+    
+    forgotten = 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      leave_state
+ *
+ * DESCRIPTION
+ *      Carries the decoder state after an instruction to the 
+ *       target of a jump or call further on, and notes 
+ *       whether the next instruction follows on from it.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void leave_state( const insn_t *insn )
+{
+    FLOW_TYPE flow;
+    ADDR target;
+    unsigned int i;
+    carry_t *c;
+    
+    /* Whatever the instruction changed is now known, unless it said not */
+    for ( i = 0; i < n_states; i++ )
+        if ( *states[i] != entered[i] )
+            known |= 1u << i;
+    known &= ~forgotten;
+    
+    flow = cfg_flow( insn, &target );
+    
+    if ( target != NO_TARGET && target > insn->addr && known )
+    {
+        c = find_carry( target, 1 );
+        if ( !c->known )
+            n_carries++;
+            
+        for ( i = 0; i < n_states; i++ )
+        {
+            unsigned int bit = 1u << i;
+            
+            if ( !( known & bit ) )
+                continue;
+            if ( !( c->known & bit ) )
+                c->values[i] = *states[i];
+            else if ( c->values[i] != *states[i] )
+                c->conflict |= bit;
+            c->known |= bit;
+        }
+    }
+    
+    last_break = ( flow == FLOW_JUMP || flow == FLOW_RETURN || flow == FLOW_STOP );
+    last_end   = insn->addr + insn->length;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      entry_may_match
+ *
+ * DESCRIPTION
+ *      Tests whether a table entry could match the opcode,
+ *      ignoring any further tests on a peeked byte.
+ *
+ * RETURNS
+ *      non-zero if it could match, zero otherwise.
+ *
+ ************************************************************/
+
+static int entry_may_match( const optab_t * optab, OPC opc )
+{
+    switch ( optab->type )
+    {
+    case OPTAB_RANGE:
+        return opc >= optab->u.range.min && opc <= optab->u.range.max;
+        
+    case OPTAB_MASK:
+        return ( opc & optab->u.mask.mask ) == optab->u.mask.val;
+        
+    case OPTAB_VARIANT:
+        return find_first( optab->u.variant.table, opc )->opcode != NULL;
+        
+    default:
+        return opc == optab->opc;
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_first
+ *
+ * DESCRIPTION
+ *      Finds the first entry in the table which could match
+ *      the opcode, using the table's dispatch index when the
+ *      target has one- or two-byte opcodes.
+ *
+ * RETURNS
+ *      pointer to the entry, or to the END entry if none match.
+ *
+ ************************************************************/
+
+static optab_t * find_first( optab_t * optab, OPC opc )
+{
+    optab_index_t * idx;
+    unsigned int slot, n;
+    unsigned long n_opcs = 1UL << ( 8 * dasm_insn_width_bytes );
+    
+    if ( dasm_insn_width_bytes > 2 || opc >= n_opcs )
+        return optab;
+        
+    slot = ( (size_t)optab >> 4 ) % INDEX_SLOTS;
+    for ( n = 0; n < INDEX_SLOTS; n++, slot = ( slot + 1 ) % INDEX_SLOTS )
+    {
+        idx = index_cache[slot];
+        
+        if ( idx == NULL )
+        {
+            unsigned long i;
+            optab_t * p;
+            
+            /* Claim the slot first: VARIANT entries index their 
+             * own tables while this one is being built */
+            idx = zalloc( sizeof( optab_index_t ) );
+            idx->table = optab;
+            idx->first = zalloc( n_opcs * sizeof( UWORD ) );
+            index_cache[slot] = idx;
+            for ( i = 0; i < n_opcs; i++ )
+            {
+                for ( p = optab; p->opcode != NULL; p++ )
+                    if ( entry_may_match( p, (OPC)i ) )
+                        break;
+                idx->first[i] = (UWORD)( p - optab );
+            }
+        }
+        
+        if ( idx->table == optab )
+            return optab + idx->first[opc];
+    }
+    
+    /* Index full, so fall back to a plain table walk */
+    return optab;
+}
+
 /***********************************************************
  *
  * FUNCTION
@@ -125,6 +571,11 @@ static OPC next_insn( FILE* fp, ADDR *addr  )
  *
  * DESCRIPTION
  *      Disassembles the next instruction in the input stream.
+ *      Prefix bytes (TABLE, DISPTBL and PREFIX entries) move
+ *      the walk on to the next page, so a whole prefix chain is
+ *      decoded in one pass through the indexed pages.  A PEEKTBL
+ *      entry looks the byte after the opcode up in its own
+ *      indexed table, without reading it.
  *      f - file stream to read (pass to calls to next() )
  *      outbuf - pointer to output buffer
  *      addr - address of first input byte for this insn
@@ -143,13 +594,45 @@ static int walk_table( FILE * f, ADDR * addr, optab_t * optab, OPC opc )
     if ( optab == NULL )
         return 0;
         
+    optab = find_first( optab, opc );
+    
     while ( optab->opcode != NULL )
     {
         /* printf("type:%d  ", optab->type); */
         if ( optab->type == OPTAB_TABLE && optab->opc == opc )
         {
             opc = next_insn( f, addr );
-            return walk_table( f, addr, optab->u.table, opc );
+            optab = find_first( optab->u.table, opc );
+            have_peeked = 0;
+            continue;
+        }
+        else if ( optab->type == OPTAB_DISPTBL && optab->opc == opc )
+        {
+            g_insn_disp = next( f, addr );
+            opc = next_insn( f, addr );
+            optab = find_first( optab->u.table, opc );
+            have_peeked = 0;
+            continue;
+        }
+        else if ( optab->type == OPTAB_PREFIX && optab->opc == opc )
+        {
+            g_insn_prefix = (UBYTE)opc;
+            cur_suffix = optab->opcode;
+            opc = next_insn( f, addr );
+            optab = find_first( optab->u.table, opc );
+            have_peeked = 0;
+            continue;
+        }
+        else if ( optab->type == OPTAB_VARIANT 
+                  && ( *optab->u.variant.state & optab->u.variant.mask ) )
+        {
+            optab_t * p = find_first( optab->u.variant.table, opc );
+            
+            if ( p->opcode != NULL )
+            {
+                optab = p;
+                continue;
+            }
         }
         else if ( optab->type == OPTAB_UNDEF && opc == optab->opc )
         {
@@ -183,29 +666,20 @@ static int walk_table( FILE * f, ADDR * addr, optab_t * optab, OPC opc )
                 return INSN_FOUND;
             }
         }
-        else if ( optab->type == OPTAB_MEMMOD 
-                  && ( opc == 0x16 || opc == 0x17 || opc == 0x06 || opc == 0x0A ) )
+        else if ( optab->type == OPTAB_PEEKTBL && optab->opc == opc )
         {
-            if ( !have_peeked )
-            {
-                peek_byte = peek( f );
-                have_peeked = 1;
-            }
+            OPC key = peek( f ) & optab->u.peek.mask;
+            optab_t * p = find_first( optab->u.peek.table, key );
             
-            if ( ( peek_byte & 0x8F ) == optab->opc )
+            while ( p->opcode != NULL && p->opc != key )
+                p++;
+                
+            if ( p->opcode != NULL )
             {
-                opcode( optab->opcode );
-                optab->operands( f, addr, opc, optab->xtype );
+                opcode( p->opcode );
+                p->operands( f, addr, opc, p->xtype );
                 return INSN_FOUND;
-            }        
-        }
-        else if ( optab->type == OPTAB_PUSHTBL && optab->opc == opc )
-        {
-            int n = optab->u.pushtbl.n;
-            while (n--)
-                stack_push( next_insn( f, addr ) );
-            opc = next_insn( f, addr );
-            return walk_table( f, addr, optab->u.pushtbl.table, opc );
+            }
         }
         
         optab++;    
@@ -221,73 +695,284 @@ static int walk_table( FILE * f, ADDR * addr, optab_t * optab, OPC opc )
 /***********************************************************
  *
  * FUNCTION
- *      stack_push
+ *      emit_operand
  *
  * DESCRIPTION
- *      Push a single opcode onto an internal stack
+ *      Appends a typed operand to the instruction currently
+ *      being decoded.
+ *      type  - kind of operand
+ *      fmt   - printf format used to show value (or the 
+ *              literal text for OPND_TEXT)
+ *      value - value to show
+ *      ref   - address for label substitution and xrefs
+ *      xtype - type of xref to record against ref
+ *      flags - OPF_xxx flags
  *
  * RETURNS
  *      none
  *
  ************************************************************/
  
-void stack_push( OPC opc )
+void emit_operand( OPND_TYPE type, const char *fmt, int value, 
+                   ADDR ref, XREF_TYPE xtype, int flags )
+{
+    operand_t *op;
+    
+    if ( cur_insn->n_operands >= MAX_OPERANDS )
+        error( "INTERNAL ERROR: too many operands at " FORMAT_ADDR, cur_insn->addr );
+        
+    op = &cur_insn->operands[cur_insn->n_operands++];
+    op->type  = type;
+    op->fmt   = fmt;
+    op->value = value;
+    op->ref   = ref;
+    op->xtype = xtype;
+    op->flags = flags;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      emit_text, emit_reg, emit_imm, emit_disp, emit_bit,
+ *      emit_cond, emit_addr, emit_rel
+ *
+ * DESCRIPTION
+ *      Short-hand forms of emit_operand() for the common
+ *      operand types.  Addresses and relative targets may be
+ *      replaced by a label, and record an xref unless xtype 
+ *      is X_NONE.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+void emit_text( const char *text )
 {
-    if ( tos >= STACK_DEPTH )
-        error( "Internal disassembler error" );
-	
-    opcstack[++tos] = opc;
+    emit_operand( OPND_TEXT, text, 0, 0, X_NONE, 0 );
+}
+
+void emit_reg( const char *fmt, int reg )
+{
+    emit_operand( OPND_REG, fmt, reg, 0, X_NONE, 0 );
+}
+
+void emit_imm( const char *fmt, int value )
+{
+    emit_operand( OPND_IMM, fmt, value, 0, X_NONE, 0 );
+}
+
+void emit_disp( const char *fmt, int value )
+{
+    emit_operand( OPND_DISP, fmt, value, 0, X_NONE, 0 );
+}
+
+void emit_bit( const char *fmt, int bit )
+{
+    emit_operand( OPND_BIT, fmt, bit, 0, X_NONE, 0 );
+}
+
+void emit_cond( const char *fmt, int cond )
+{
+    emit_operand( OPND_COND, fmt, cond, 0, X_NONE, 0 );
+}
+
+void emit_addr( const char *fmt, ADDR addr, XREF_TYPE xtype )
+{
+    emit_operand( OPND_ADDR, fmt, addr, addr, xtype, OPF_LABEL );
+}
+
+void emit_rel( const char *fmt, ADDR dest, XREF_TYPE xtype )
+{
+    emit_operand( OPND_REL, fmt, dest, dest, xtype, OPF_LABEL );
 }
 
 /***********************************************************
  *
  * FUNCTION
- *      stack_pop
+ *      emit_note
  *
  * DESCRIPTION
- *      Pop a single opcode off an internal stack
+ *      Attaches a note to the instruction being decoded, such 
+ *       as the value of a register it depends on.  It is shown
+ *       as the line comment unless the command file has one.
  *
  * RETURNS
- *      The opcode byte from the top of stack.
+ *      none
+ *
+ ************************************************************/
+
+void emit_note( const char *text )
+{
+    snprintf( cur_insn->note, sizeof( cur_insn->note ), "%s", text );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      dasm_decode
+ *
+ * DESCRIPTION
+ *      Decodes the next instruction in the input stream into
+ *      an instruction record.  No text is generated and no
+ *      xrefs are recorded.
+ *      f    - file stream to read (pass to calls to next() )
+ *      insn - instruction record to fill in
+ *      addr - address of first input byte for this insn
+ *
+ * RETURNS
+ *      address of next input byte
  *
  ************************************************************/
  
-OPC stack_pop( void )
+ADDR dasm_decode( FILE *f, insn_t *insn, ADDR addr )
 {
-    if ( tos < 0 )
+    OPC opc;
+    int follow;
+
+    /* Store start address in a global for use by the decoders */    
+    g_insn_addr = addr;
+    
+    insn->addr       = addr;
+    insn->opcode     = NULL;
+    insn->n_operands = 0;
+    insn->note[0]    = '\0';
+    cur_insn         = insn;
+    g_insn_prefix    = 0;
+    cur_suffix       = NULL;
+
+    /* Get first opcode byte */
+    opc = next_insn( f, &addr );
+
+    init_states();
+    follow = n_states && ( n_mode_sets || !dasm_modes_selected_only );
+    if ( follow )
+        enter_state( insn->addr );
+
+    /* Now walk table(s) looking for an instruction match */
+    if ( walk_table( f, &addr, base_optab, opc ) != INSN_FOUND )
     {
-        error( "Internal disassembler error" );
-        return 0;
+        insn->opcode     = NULL;
+        insn->n_operands = 0;
+        insn->note[0]    = '\0';
     }
-        
-    return opcstack[tos--];
+    
+    insn->length = addr - insn->addr;
+    
+    if ( follow )
+        leave_state( insn );
+    
+    return addr;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      dasm_addxrefs
+ *
+ * DESCRIPTION
+ *      Records the xrefs made by the operands of a decoded
+ *      instruction.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+ 
+void dasm_addxrefs( const insn_t *insn )
+{
+    int i;
+    
+    for ( i = 0; i < insn->n_operands; i++ )
+        if ( insn->operands[i].xtype != X_NONE )
+            xref_addxref( insn->operands[i].xtype, insn->addr, insn->operands[i].ref );
 }
 
 /***********************************************************
  *
  * FUNCTION
- *      operand
+ *      dasm_addaccesses
  *
  * DESCRIPTION
- *      Writes the given operand string and any arguments
- *      into the output buffer.  The string is processed with
- *      the usual printf() conversions.
+ *      Counts the reads and writes the operands of a decoded
+ *      instruction make of the target's register window.
  *
  * RETURNS
  *      none
  *
  ************************************************************/
  
-void operand( const char *operand, ... )
+void dasm_addaccesses( const insn_t *insn )
+{
+    const reg_access_t *ra;
+    ACCESS_TYPE access = ACCESS_STORE;
+    int i, n = 0;
+    
+    if ( !insn->opcode )
+        return;
+        
+    for ( ra = dasm_reg_access_table; ra->opcode; ra++ )
+        if ( !strcasecmp( ra->opcode, insn->opcode ) )
+        {
+            access = ra->access;
+            break;
+        }
+    
+    for ( i = 0; i < insn->n_operands; i++ )
+    {
+        const operand_t *op = &insn->operands[i];
+        const char *prev = i > 0 && insn->operands[i - 1].type == OPND_TEXT 
+                         ? insn->operands[i - 1].fmt : "";
+        int indirect = *prev && strchr( "[(", prev[strlen( prev ) - 1] );
+        int first;
+        
+        if ( op->type == OPND_TEXT )
+            continue;
+            
+        first = ( n++ == 0 );
+        if ( op->type != OPND_ADDR )
+            continue;
+            
+        if ( indirect || access == ACCESS_READ )
+            xref_addaccess( op->ref, 1, 0 );
+        else if ( access == ACCESS_STORE )
+            xref_addaccess( op->ref, !first, first );
+        else if ( access == ACCESS_MODIFY )
+            xref_addaccess( op->ref, 1, first );
+        else
+            xref_addaccess( op->ref, 1, 1 );
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      dasm_format
+ *
+ * DESCRIPTION
+ *      Formats a decoded instruction as text.
+ *
+ * RETURNS
+ *      number of chars written into outbuf
+ *
+ ************************************************************/
+ 
+int dasm_format( const insn_t *insn, char *outbuf )
 {
-    va_list ap;
-    int n;
+    char *p = outbuf;
+    int i;
+    
+    /* only pad the mnemonic out to the operand column if there are operands */
+    if ( insn->n_operands == 0 )
+        p += sprintf( p, "%s", insn->opcode ? insn->opcode : "???" );
+    else
+        p += sprintf( p, "%-*s", dasm_max_opcode_width, 
+                      insn->opcode ? insn->opcode : "???" );
     
-    va_start( ap, operand );
-    n = vsprintf( output_buffer, operand, ap );
-    va_end( ap );
+    for ( i = 0; i < insn->n_operands; i++ )
+        p += dasm_format_operand( &insn->operands[i], p );
     
-    output_buffer += n;
+    return p - outbuf;
 }
 
 /***********************************************************
@@ -308,26 +993,177 @@ void operand( const char *operand, ... )
  
 ADDR dasm_insn( FILE *f, char *outbuf, ADDR addr )
 {
-    OPC opc;
-    int found = 0;
+    insn_t insn;
+    
+    addr = dasm_decode( f, &insn, addr );
+    dasm_addxrefs( &insn );
+    dasm_format( &insn, outbuf );
+    
+    return addr;
+}
 
-    /* Store start address in a global for use in xref calls */    
-    g_insn_addr = addr;
+/***********************************************************
+ *
+ * FUNCTION
+ *      dasm_begin_walk
+ *
+ * DESCRIPTION
+ *      Starts a fresh walk of the input: forgets the state
+ *       carried by the last one and goes back to the modes
+ *       in force at the start.  Called before decoding from
+ *       the top, and before decoding anything out of order.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+ 
+void dasm_begin_walk( void )
+{
+    init_states();
     
-    /* Setup g_output_buffer to point to caller's output buffer */
-    output_buffer = outbuf;
+    if ( max_carries )
+        memset( carries, 0, max_carries * sizeof( carry_t ) );
+    memset( carry_filter, 0, sizeof( carry_filter ) );
+    n_carries = 0;
+    next_mode_set = 0;
+    memcpy( defaults, initial, sizeof( defaults ) );
+    last_break = 1;
+    known = 0;
+}
 
-    /* Get first opcode byte */
-    opc = next_insn( f, &addr );
+/***********************************************************
+ *
+ * FUNCTION
+ *      dasm_forget_state
+ *
+ * DESCRIPTION
+ *      Called by a decoder when the instruction leaves one
+ *       of its states unknown.  The state goes back to its
+ *       default, and is not carried from here until it is
+ *       known again.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+ 
+void dasm_forget_state( int *state )
+{
+    unsigned int i;
+    
+    init_states();
+    
+    for ( i = 0; i < n_states && states[i] != state; i++ )
+        ;
+    if ( i == n_states )
+        error( "INTERNAL ERROR: unknown decoder state.\n" );
+        
+    forgotten |= 1u << i;
+    *state = defaults[i];
+}
 
-    /* Now walk table(s) looking for an instruction match */
-    found = walk_table( f, &addr, base_optab, opc );
+/***********************************************************
+ *
+ * FUNCTION
+ *      dasm_set_mode
+ *
+ * DESCRIPTION
+ *      Selects one of the target's named modes from an
+ *       address onwards.  A mode taking a value is given as
+ *       NAME=value, in hex.
+ *
+ * RETURNS
+ *      non-zero if the target has a mode of that name
+ *
+ ************************************************************/
+ 
+int dasm_set_mode( ADDR addr, const char *name )
+{
+    const dasm_mode_t *m;
+    const char *eq = strchr( name, '=' );
+    size_t len = eq ? (size_t)( eq - name ) : strlen( name );
+    unsigned int i, value = 0;
+    
+    for ( m = dasm_mode_table; m->name; m++ )
+        if ( strlen( m->name ) == len && !strncasecmp( m->name, name, len )
+             && !m->arg == !eq )
+            break;
+    if ( !m->name )
+        return 0;
+    if ( eq && sscanf( eq + 1, "%x", &value ) != 1 )
+        return 0;
+        
+    /* Settings hold for the whole image, so just take the value */
+    if ( m->setting )
+    {
+        if ( m - dasm_mode_table >= 32 )
+            error( "INTERNAL ERROR: too many decoder modes.\n" );
+        *m->state = (int)value;
+        settings_given |= 1u << ( m - dasm_mode_table );
+        return 1;
+    }
     
-    /* If we didn't find a match, indicate this to the output */
-    if ( found != INSN_FOUND )
-        opcode( "???" );
+    init_states();
     
-    return addr;
+    mode_sets = realloc( mode_sets, ( n_mode_sets + 1 ) * sizeof( mode_set_t ) );
+    if ( !mode_sets )
+        error( "Out of memory" );
+        
+    /* Keep them in address order, later ones after earlier ones */
+    for ( i = n_mode_sets; i > 0 && mode_sets[i - 1].addr > addr; i-- )
+        mode_sets[i] = mode_sets[i - 1];
+        
+    mode_sets[i].addr  = addr;
+    mode_sets[i].mode  = m;
+    mode_sets[i].value = m->arg ? (int)value : m->value;
+    for ( mode_sets[i].state = 0; 
+          states[mode_sets[i].state] != m->state; 
+          mode_sets[i].state++ )
+        ;
+    n_mode_sets++;
+    
+    return 1;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      dasm_foreach_mode
+ *
+ * DESCRIPTION
+ *      Calls fn for each setting given and each mode selected,
+ *       in address order, with its name as dasm_set_mode() 
+ *       takes it.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+ 
+void dasm_foreach_mode( void (*fn)( ADDR addr, const char *name ) )
+{
+    const dasm_mode_t *m;
+    char buf[64];
+    unsigned int i;
+    
+    for ( m = dasm_mode_table; m->name; m++ )
+        if ( settings_given & ( 1u << ( m - dasm_mode_table ) ) )
+        {
+            sprintf( buf, "%.40s=%X", m->name, (unsigned int)*m->state );
+            fn( 0, buf );
+        }
+        
+    for ( i = 0; i < n_mode_sets; i++ )
+    {
+        const mode_set_t *ms = &mode_sets[i];
+        
+        if ( ms->mode->arg )
+            sprintf( buf, "%.40s=%X", ms->mode->name, (unsigned int)ms->value );
+        else
+            strcpy( buf, ms->mode->name );
+        fn( ms->addr, buf );
+    }
 }
 
 /****************************************************************************/
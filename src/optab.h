@@ -41,7 +41,7 @@
 typedef struct optab_s {
     OPC opc;
     const char * opcode;
-    void (*operands)( FILE *, ADDR *, UBYTE, XREF_TYPE); /* operand function */
+    void (*operands)( FILE *, ADDR *, OPC, XREF_TYPE);   /* operand function */
     XREF_TYPE xtype;
     enum {
         OPTAB_UNDEF,
@@ -49,9 +49,11 @@ typedef struct optab_s {
         OPTAB_RANGE,
         OPTAB_MASK,
         OPTAB_MASK2,
-        OPTAB_MEMMOD,
         OPTAB_TABLE,
-        OPTAB_PUSHTBL
+        OPTAB_DISPTBL,
+        OPTAB_PREFIX,
+        OPTAB_PEEKTBL,
+        OPTAB_VARIANT
     } type;
     union {
         struct {
@@ -63,8 +65,13 @@ typedef struct optab_s {
         struct optab_s * table;
         struct {
             struct optab_s * table;
-            int n;
-	} pushtbl;
+            OPC mask;
+        } peek;
+        struct {
+            struct optab_s * table;
+            const int * state;
+            int mask;
+        } variant;
     } u;
 } optab_t;
 
@@ -93,17 +100,61 @@ typedef struct optab_s {
     },
 
 /**
-    The given instruction byte pushes M_count opcode bytes onto
-    a stack ans then jumps to another decode table.
+    The given instruction byte is followed by a displacement byte
+    and then an opcode byte, which is looked up in another decode
+    table.  The displacement is left in g_insn_disp.
 **/
-#define PUSHTBL(M_tablename, M_opc, M_count)    \
-    { .type    = OPTAB_PUSHTBL,      \
+#define DISPTBL(M_tablename, M_opc)  \
+    { .type    = OPTAB_DISPTBL,      \
       .opc     = M_opc,              \
-      .opcode  = "PUSHTBL",          \
-      .u.pushtbl.table = M_tablename,\
-      .u.pushtbl.n     = M_count     \
+      .opcode  = "DISPTBL",          \
+      .u.table = M_tablename         \
     },
     
+/**
+    The given instruction byte is a prefix qualifying the instruction
+    after it, which is looked up in another decode table.  M_suffix is
+    added to that instruction's mnemonic (eZ80 ".LIL") and the prefix
+    byte is left in g_insn_prefix.
+**/
+#define PREFIX(M_tablename, M_opc, M_suffix)  \
+    { .type    = OPTAB_PREFIX,       \
+      .opc     = M_opc,              \
+      .opcode  = M_suffix,           \
+      .u.table = M_tablename         \
+    },
+
+/**
+    The given instruction byte is followed by a byte which, under
+    M_mask, selects the instruction from another decode table, such as
+    the operation byte of the 78K/III memory-modifier forms.  That byte
+    is only peeked at, and the operand function of the entry found is
+    passed the first instruction byte.
+**/
+#define PEEKTBL(M_tablename, M_opc, M_mask)  \
+    { .type    = OPTAB_PEEKTBL,      \
+      .opc     = M_opc,              \
+      .opcode  = "PEEKTBL",          \
+      .u.peek.table = M_tablename,   \
+      .u.peek.mask  = M_mask         \
+    },
+
+/**
+    Entries from another decode table which apply only while any of
+    the bits in M_mask are set in the decoder state M_state (see 
+    DASM_MODES), such as the Z180 additions to the Z80 pages.  For the
+    opcodes it covers, that table is used instead of the entries after
+    this one, so it should hold plain INSN, MASK, RANGE and UNDEF
+    entries.
+**/
+#define VARIANT(M_tablename, M_state, M_mask)  \
+    { .type    = OPTAB_VARIANT,      \
+      .opcode  = "VARIANT",          \
+      .u.variant.table = M_tablename,\
+      .u.variant.state = &M_state,   \
+      .u.variant.mask  = M_mask      \
+    },
+
 /**
     A single insruction matches against one op byte.
 **/    
@@ -154,18 +205,6 @@ typedef struct optab_s {
       .u.mask.val  = M_val                                  \
     },
                                                             
-/**
-    A MEMMOD describes an instruction with four memory-modifer combinations
-    which must be decoded together for a prospective match.
-**/    
-#define MEMMOD(M_opcode, M_ops, M_opc, M_xt)    \
-    { .type     = OPTAB_MEMMOD,                 \
-      .opcode   = M_opcode,                     \
-      .opc      = M_opc,                        \
-      .operands = operand_ ## M_ops,            \
-      .xtype    = M_xt                          \
-    },
-                                                            
 /**
     Mark end of op table.
 **/
@@ -173,12 +212,14 @@ typedef struct optab_s {
 
 /**
     Create function definition given a name.
+    Operand functions decode their operand bytes and describe the result
+    through the emit_xxx() functions below; they never format text.
 **/
 #define OPERAND_FUNC(M_name) \
-    static void operand_ ## M_name (FILE *f, ADDR * addr, UBYTE opc, XREF_TYPE xtype )
+    static void operand_ ## M_name (FILE *f, ADDR * addr, OPC opc, XREF_TYPE xtype )
 
 /* Neaten up emitting a comma "," within an operand. */
-#define COMMA                   operand( ", " )
+#define COMMA                   emit_text( ", " )
 
 /**
     Short-cut macro to generate simple two-operand functions.
@@ -214,15 +255,31 @@ OPERAND_FUNC(M_a ## _ ## M_b ## _ ## M_c) \
 /* Create a single-bit mask */
 #define BIT(n)                  ( 1 << (n) )
 
-/* General function for outputting an operand */
-extern void operand( const char * operand, ... );
+/* Append a typed operand to the instruction being decoded */
+extern void emit_operand( OPND_TYPE type, const char * fmt, int value,
+                          ADDR ref, XREF_TYPE xtype, int flags );
 
-/* Push and pop opcodes to an internal stack */
-extern void stack_push( OPC );
-extern OPC  stack_pop( void );
+/* Short-hands for the common operand types */
+extern void emit_text( const char * text );
+extern void emit_reg( const char * fmt, int reg );
+extern void emit_imm( const char * fmt, int value );
+extern void emit_disp( const char * fmt, int value );
+extern void emit_bit( const char * fmt, int bit );
+extern void emit_cond( const char * fmt, int cond );
+extern void emit_addr( const char * fmt, ADDR addr, XREF_TYPE xtype );
+extern void emit_rel( const char * fmt, ADDR dest, XREF_TYPE xtype );
+
+/* Attach a note to the instruction, shown as its line comment */
+extern void emit_note( const char * text );
 
 /* Start address of each instruction as it is decoded. */
 extern ADDR g_insn_addr;
 
+/* Displacement read by a DISPTBL entry for the current instruction. */
+extern UBYTE g_insn_disp;
+
+/* Byte of the PREFIX entry followed for the current instruction, or 0. */
+extern UBYTE g_insn_prefix;
+
 #endif /* _OPTAB_H_ */
 
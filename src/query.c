@@ -0,0 +1,876 @@
+/*****************************************************************************
+ *
+ * Copyright (C) 2014-2016, Neil Johnson
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms,
+ * with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of Neil Johnson nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *****************************************************************************/
+ 
+/*****************************************************************************
+ *
+ * Instruction queries.
+ *
+ * Finds instructions by what they decode to rather than by their bytes:
+ *  the mnemonic, the operands and their values, the cross-references they
+ *  make and how they affect the flow of control.  A query is compiled once
+ *  into a tree of predicates, which is evaluated against each decoded
+ *  instruction; only the matches are ever formatted as text.
+ *
+ * The query language:
+ *
+ *      query   := term { "or" term }
+ *      term    := factor { "and" factor }
+ *      factor  := "not" factor | "(" query ")" 
+ *               | "before" "(" query [ "," count ] ")" | test
+ *      test    := field op value
+ *
+ *  "|", "&" and "!" may be used for "or", "and" and "not".  The fields are:
+ *
+ *      op      mnemonic, matched with '*' and '?' wildcards in any case
+ *      reg     a register operand, as it is shown, with wildcards
+ *      cond    a condition code operand, as it is shown, with wildcards
+ *      imm     an immediate operand
+ *      addr    an absolute or relative address operand
+ *      bit     a bit number operand
+ *      disp    a displacement, offset or count operand
+ *      ref     any operand making a cross-reference
+ *      argN    the Nth operand, not counting punctuation (N = 1 to 9)
+ *      target  the destination of a jump, branch or call
+ *      at      the address of the instruction
+ *      len     the length of the instruction in bytes
+ *      xref    the kind of cross-reference an operand makes: jmp, call,
+ *              imm, table, direct, data, ptr, reg or io
+ *      flow    next, branch, jump, call, return, skip or stop
+ *
+ *  Numeric fields compare with =, !=, <, <=, > or >=, and "=" also takes
+ *  a range "lo..hi".  Values are labels or hex numbers, as in the command
+ *  file, optionally written 0x1F, $1F or 1FH; a field with several
+ *  operands matches if any of them does.  "before(q)" matches if q
+ *  matched one of the previous 8 instructions (or count instructions) of
+ *  the same run of code.  For example
+ *
+ *      flow=call and target=PUTS and before(imm=1234)
+ *      op=mov* and arg1=FF20..FF2F
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "dasmxx.h"
+
+/*****************************************************************************
+ *        Data Types, Macros, Constants
+ *****************************************************************************/
+
+/* Longest token or operand text */
+#define MAX_TOKEN       ( 64 )
+
+/* Default window of before() */
+#define BEFORE_WINDOW   ( 8 )
+
+/* Most before() nodes in a query */
+#define MAX_BEFORE      ( 16 )
+
+typedef enum {
+    Q_OR, Q_AND, Q_NOT, Q_BEFORE,
+    Q_OP, Q_REG, Q_COND, Q_XREF, Q_FLOW,
+    Q_IMM, Q_ADDR, Q_BIT, Q_DISP, Q_REF, Q_ARG, Q_TARGET, Q_AT, Q_LEN
+} NODE_KIND;
+
+typedef enum { CMP_EQ, CMP_NE, CMP_LT, CMP_LE, CMP_GT, CMP_GE } CMP;
+
+typedef struct node {
+    NODE_KIND     kind;
+    struct node * a, * b;      /* operands of or, and, not, before        */
+    CMP           cmp;
+    long          lo, hi;      /* value, or range for CMP_EQ/CMP_NE       */
+    int           arg;         /* operand number of argN, from 0          */
+    const char  * text;        /* pattern of op, reg and cond             */
+    const char  * last_opcode; /* op: last mnemonic tested, and result    */
+    int           last_result;
+    unsigned long last_match;  /* before: sequence number of last match   */
+    unsigned long window;
+} node_t;
+
+/*****************************************************************************
+ *        Private Data
+ *****************************************************************************/
+
+static const struct { const char *name; NODE_KIND kind; } fields[] = {
+    { "op",     Q_OP     }, { "reg",    Q_REG    }, { "cond",   Q_COND   },
+    { "xref",   Q_XREF   }, { "flow",   Q_FLOW   }, { "imm",    Q_IMM    },
+    { "addr",   Q_ADDR   }, { "bit",    Q_BIT    }, { "disp",   Q_DISP   },
+    { "ref",    Q_REF    }, { "target", Q_TARGET }, { "at",     Q_AT     },
+    { "len",    Q_LEN    }, { NULL }
+};
+
+/* In XREF_TYPE order */
+static const char * const xref_names[] = {
+    "jmp", "call", "imm", "table", "direct", "data", "ptr", "reg", "io", NULL
+};
+
+/* In FLOW_TYPE order */
+static const char * const flow_names[] = {
+    "next", "branch", "jump", "call", "return", "skip", "stop", NULL
+};
+
+static const char * query_text = NULL;
+static const char * src;                /* parse position */
+static node_t     * root = NULL;
+
+/* before() nodes, parents ahead of their children */
+static node_t     * befores[MAX_BEFORE];
+static unsigned int n_befores = 0;
+
+static unsigned long seq = 0;           /* instructions seen */
+static unsigned long n_matches = 0;
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      glob
+ *
+ * DESCRIPTION
+ *      Matches text against a pattern with '*' and '?'
+ *       wildcards, ignoring case.
+ *
+ * RETURNS
+ *      non-zero if it matches
+ *
+ ************************************************************/
+
+static int glob( const char *pat, const char *text )
+{
+    for ( ; *pat; pat++, text++ )
+    {
+        if ( *pat == '*' )
+        {
+            for ( ; ; text++ )
+            {
+                if ( glob( pat + 1, text ) )
+                    return 1;
+                if ( !*text )
+                    return 0;
+            }
+        }
+        
+        if ( !*text 
+             || ( *pat != '?' && tolower( (UBYTE)*pat ) != tolower( (UBYTE)*text ) ) )
+            return 0;
+    }
+    
+    return !*text;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      token
+ *
+ * DESCRIPTION
+ *      Reads the next token of the query: a word, or an
+ *       operator of one or two characters.
+ *
+ * RETURNS
+ *      the token in buf, which is empty at the end
+ *
+ ************************************************************/
+
+static char * token( char *buf )
+{
+    unsigned int n = 0;
+    
+    while ( isspace( (UBYTE)*src ) )
+        src++;
+        
+    if ( isalnum( (UBYTE)*src ) || strchr( "_$*?", *src ) )
+    {
+        while ( *src && ( isalnum( (UBYTE)*src ) || strchr( "_$*?", *src ) ) )
+        {
+            if ( n == MAX_TOKEN - 1 )
+                error( "Query `%s': `%.20s...' is too long", query_text, buf );
+            buf[n++] = *src++;
+        }
+    }
+    else if ( *src )
+    {
+        buf[n++] = *src++;
+        if ( ( strchr( "!<>", buf[0] ) && *src == '=' ) 
+             || ( buf[0] == '.' && *src == '.' ) )
+            buf[n++] = *src++;
+    }
+    
+    buf[n] = '\0';
+    return buf;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      next_is
+ *
+ * DESCRIPTION
+ *      Tests whether the next token is one of two words,
+ *       without consuming it.
+ *
+ * RETURNS
+ *      non-zero if it is
+ *
+ ************************************************************/
+
+static int next_is( const char *word, const char *alt )
+{
+    const char *save = src;
+    char buf[MAX_TOKEN];
+    int found;
+    
+    token( buf );
+    found = !strcasecmp( buf, word ) || !strcmp( buf, alt );
+    src = save;
+    
+    return found;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      expect
+ *
+ * DESCRIPTION
+ *      Reads a token that must be the one given.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void expect( const char *want )
+{
+    char buf[MAX_TOKEN];
+    
+    if ( strcmp( token( buf ), want ) )
+        error( "Query `%s': expected `%s' before `%s'", query_text, want, buf );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      number
+ *
+ * DESCRIPTION
+ *      Converts a value of the query: a label, or a hex
+ *       number written as in the command file or as 0x1F,
+ *       $1F or 1FH.
+ *
+ * RETURNS
+ *      the value
+ *
+ ************************************************************/
+
+static long number( const char *text )
+{
+    char digits[MAX_TOKEN], *end;
+    ADDR addr;
+    size_t n;
+    
+    if ( xref_findlabeladdr( text, &addr ) )
+        return addr;
+        
+    if ( text[0] == '$' )
+        text++;
+    else if ( text[0] == '0' && tolower( (UBYTE)text[1] ) == 'x' )
+        text += 2;
+        
+    strcpy( digits, text );
+    n = strlen( digits );
+    if ( n > 1 && tolower( (UBYTE)digits[n - 1] ) == 'h' )
+        digits[n - 1] = '\0';
+        
+    if ( !digits[0] )
+        error( "Query `%s': missing value", query_text );
+        
+    addr = strtoul( digits, &end, 16 );
+    if ( *end )
+        error( "Query `%s': `%s' is neither a label nor a number", 
+               query_text, text );
+               
+    return addr;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      name_index
+ *
+ * DESCRIPTION
+ *      Looks up a word in a list of names, ignoring case.
+ *
+ * RETURNS
+ *      its index; an unknown name is fatal
+ *
+ ************************************************************/
+
+static int name_index( const char * const *names, const char *word, 
+                       const char *field )
+{
+    int i;
+    
+    for ( i = 0; names[i]; i++ )
+        if ( !strcasecmp( names[i], word ) )
+            return i;
+            
+    error( "Query `%s': unknown %s `%s'", query_text, field, word );
+    return 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      new_node
+ *
+ * DESCRIPTION
+ *      Allocates a node of the query tree.
+ *
+ * RETURNS
+ *      the node
+ *
+ ************************************************************/
+
+static node_t * new_node( NODE_KIND kind, node_t *a, node_t *b )
+{
+    node_t *n = zalloc( sizeof( node_t ) );
+    
+    n->kind = kind;
+    n->a    = a;
+    n->b    = b;
+    
+    return n;
+}
+
+static node_t * parse_query( void );
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      parse_test
+ *
+ * DESCRIPTION
+ *      Parses "field op value".
+ *
+ * RETURNS
+ *      the node
+ *
+ ************************************************************/
+
+static node_t * parse_test( const char *field )
+{
+    static const char * const ops[] = { "=", "!=", "<", "<=", ">", ">=", NULL };
+    char buf[MAX_TOKEN];
+    node_t *n = new_node( Q_OR, NULL, NULL );
+    int i;
+    
+    for ( i = 0; fields[i].name && strcasecmp( fields[i].name, field ); i++ )
+        ;
+        
+    if ( fields[i].name )
+        n->kind = fields[i].kind;
+    else if ( !strncasecmp( field, "arg", 3 ) && field[3] >= '1' && field[3] <= '9' 
+              && !field[4] )
+    {
+        n->kind = Q_ARG;
+        n->arg  = field[3] - '1';
+    }
+    else
+        error( "Query `%s': unknown field `%s'", query_text, field );
+        
+    token( buf );
+    for ( i = 0; ops[i] && strcmp( ops[i], buf ); i++ )
+        ;
+    if ( !ops[i] )
+        error( "Query `%s': expected a comparison after `%s'", query_text, field );
+    n->cmp = (CMP)i;
+    
+    token( buf );
+    
+    switch ( n->kind )
+    {
+    case Q_OP:
+    case Q_REG:
+    case Q_COND:
+    case Q_XREF:
+    case Q_FLOW:
+        if ( n->cmp != CMP_EQ && n->cmp != CMP_NE )
+            error( "Query `%s': `%s' can only be compared with = or !=", 
+                   query_text, field );
+        if ( n->kind == Q_XREF )
+            n->lo = name_index( xref_names, buf, "xref type" );
+        else if ( n->kind == Q_FLOW )
+            n->lo = name_index( flow_names, buf, "flow" );
+        else
+            n->text = dupstr( buf );
+        break;
+            
+    default:
+        n->lo = n->hi = number( buf );
+        if ( next_is( "..", ".." ) )
+        {
+            if ( n->cmp != CMP_EQ && n->cmp != CMP_NE )
+                error( "Query `%s': a range needs = or !=", query_text );
+            token( buf );
+            n->hi = number( token( buf ) );
+        }
+        break;
+    }
+    
+    /* x != v is not ( x = v ), so that "any operand" reads naturally */
+    if ( n->cmp == CMP_NE )
+    {
+        n->cmp = CMP_EQ;
+        n = new_node( Q_NOT, n, NULL );
+    }
+    
+    return n;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      parse_factor
+ *
+ * DESCRIPTION
+ *      Parses a negation, a bracketed query, a before() or
+ *       a test.
+ *
+ * RETURNS
+ *      the node
+ *
+ ************************************************************/
+
+static node_t * parse_factor( void )
+{
+    char buf[MAX_TOKEN];
+    node_t *n;
+    
+    token( buf );
+    
+    if ( !strcasecmp( buf, "not" ) || !strcmp( buf, "!" ) )
+        return new_node( Q_NOT, parse_factor(), NULL );
+        
+    if ( !strcmp( buf, "(" ) )
+    {
+        n = parse_query();
+        expect( ")" );
+        return n;
+    }
+    
+    if ( !strcasecmp( buf, "before" ) )
+    {
+        if ( n_befores == MAX_BEFORE )
+            error( "Query `%s': too many before()s", query_text );
+        n = new_node( Q_BEFORE, NULL, NULL );
+        n->window = BEFORE_WINDOW;
+        befores[n_befores++] = n;
+        
+        expect( "(" );
+        n->a = parse_query();
+        if ( next_is( ",", "," ) )
+        {
+            token( buf );
+            n->window = strtoul( token( buf ), NULL, 10 );
+        }
+        expect( ")" );
+        return n;
+    }
+    
+    if ( !buf[0] || !isalpha( (UBYTE)buf[0] ) )
+        error( "Query `%s': unexpected `%s'", query_text, buf[0] ? buf : "end" );
+        
+    return parse_test( buf );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      parse_term
+ *
+ * DESCRIPTION
+ *      Parses factors joined by "and".
+ *
+ * RETURNS
+ *      the node
+ *
+ ************************************************************/
+
+static node_t * parse_term( void )
+{
+    char buf[MAX_TOKEN];
+    node_t *n = parse_factor();
+    
+    while ( next_is( "and", "&" ) )
+    {
+        token( buf );
+        n = new_node( Q_AND, n, parse_factor() );
+    }
+    
+    return n;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      parse_query
+ *
+ * DESCRIPTION
+ *      Parses terms joined by "or".
+ *
+ * RETURNS
+ *      the node
+ *
+ ************************************************************/
+
+static node_t * parse_query( void )
+{
+    char buf[MAX_TOKEN];
+    node_t *n = parse_term();
+    
+    while ( next_is( "or", "|" ) )
+    {
+        token( buf );
+        n = new_node( Q_OR, n, parse_term() );
+    }
+    
+    return n;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      compare
+ *
+ * DESCRIPTION
+ *      Compares a value with a test.
+ *
+ * RETURNS
+ *      non-zero if it passes
+ *
+ ************************************************************/
+
+static int compare( const node_t *n, long v )
+{
+    switch ( n->cmp )
+    {
+    case CMP_LT:  return v <  n->lo;
+    case CMP_LE:  return v <= n->lo;
+    case CMP_GT:  return v >  n->lo;
+    case CMP_GE:  return v >= n->lo;
+    default:      return v >= n->lo && v <= n->hi;
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      test_operands
+ *
+ * DESCRIPTION
+ *      Tests each operand of an instruction that the field
+ *       of a test applies to.
+ *
+ * RETURNS
+ *      non-zero if any passes
+ *
+ ************************************************************/
+
+static int test_operands( const node_t *n, const insn_t *insn )
+{
+    char buf[MAX_TOKEN * 4];
+    int i, k = 0;
+    
+    for ( i = 0; i < insn->n_operands; i++ )
+    {
+        const operand_t *op = &insn->operands[i];
+        long v = ( op->type == OPND_ADDR || op->type == OPND_REL ) ? (long)op->ref 
+                                                                    : op->value;
+        
+        if ( op->type == OPND_TEXT )
+            continue;
+            
+        switch ( n->kind )
+        {
+        case Q_REG:
+        case Q_COND:
+            if ( op->type == ( n->kind == Q_REG ? OPND_REG : OPND_COND ) )
+            {
+                sprintf( buf, op->fmt, op->value );
+                if ( glob( n->text, buf ) )
+                    return 1;
+            }
+            break;
+        
+        case Q_XREF:
+            if ( op->xtype == n->lo )
+                return 1;
+            break;
+            
+        case Q_IMM:
+            if ( op->type == OPND_IMM && compare( n, v ) )
+                return 1;
+            break;
+            
+        case Q_ADDR:
+            if ( ( op->type == OPND_ADDR || op->type == OPND_REL ) && compare( n, v ) )
+                return 1;
+            break;
+            
+        case Q_BIT:
+            if ( op->type == OPND_BIT && compare( n, v ) )
+                return 1;
+            break;
+            
+        case Q_DISP:
+            if ( op->type == OPND_DISP && compare( n, v ) )
+                return 1;
+            break;
+            
+        case Q_REF:
+            if ( op->xtype != X_NONE && compare( n, op->ref ) )
+                return 1;
+            break;
+            
+        case Q_ARG:
+            if ( k == n->arg )
+                return compare( n, v );
+            break;
+            
+        default:
+            break;
+        }
+        
+        k++;
+    }
+    
+    return 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      eval
+ *
+ * DESCRIPTION
+ *      Evaluates a query tree against an instruction.
+ *
+ * RETURNS
+ *      non-zero if it matches
+ *
+ ************************************************************/
+
+static int eval( node_t *n, const insn_t *insn )
+{
+    ADDR target;
+    
+    switch ( n->kind )
+    {
+    case Q_OR:
+        return eval( n->a, insn ) || eval( n->b, insn );
+        
+    case Q_AND:
+        return eval( n->a, insn ) && eval( n->b, insn );
+        
+    case Q_NOT:
+        return !eval( n->a, insn );
+        
+    case Q_BEFORE:
+        return n->last_match && seq - n->last_match <= n->window;
+        
+    case Q_OP:
+        /* Mnemonics are shared strings, so the last result is kept */
+        if ( insn->opcode != n->last_opcode )
+        {
+            n->last_opcode = insn->opcode;
+            n->last_result = insn->opcode && glob( n->text, insn->opcode );
+        }
+        return n->last_result;
+        
+    case Q_FLOW:
+        return cfg_flow( insn, &target ) == (FLOW_TYPE)n->lo;
+        
+    case Q_TARGET:
+        switch ( cfg_flow( insn, &target ) )
+        {
+        case FLOW_BRANCH:
+        case FLOW_JUMP:
+        case FLOW_CALL:
+            return target != (ADDR)-1 && compare( n, target );
+        default:
+            return 0;
+        }
+        
+    case Q_AT:
+        return compare( n, insn->addr );
+        
+    case Q_LEN:
+        return compare( n, insn->length );
+        
+    default:
+        return test_operands( n, insn );
+    }
+}
+
+/*****************************************************************************
+ *        Public Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      query_set
+ *
+ * DESCRIPTION
+ *      Sets the query.  It is compiled by query_begin(),
+ *       once the labels it may use are known.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void query_set( const char *text )
+{
+    query_text = dupstr( text );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      query_begin
+ *
+ * DESCRIPTION
+ *      Compiles the query.  Errors in it are fatal.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void query_begin( void )
+{
+    char buf[MAX_TOKEN];
+    
+    src  = query_text;
+    root = parse_query();
+    
+    if ( *token( buf ) )
+        error( "Query `%s': unexpected `%s'", query_text, buf );
+        
+    printf( ";   Query: %s\n\n", query_text );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      query_record
+ *
+ * DESCRIPTION
+ *      Evaluates the query against one item of the walk
+ *       and lists the instruction if it matches.  Data
+ *       items end the window of before().
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void query_record( const record_t *rec )
+{
+    char buf[256];
+    const char *label;
+    ADDR base = 0;
+    unsigned int i;
+    
+    if ( rec->kind != REC_CODE || !rec->insn->opcode )
+    {
+        for ( i = 0; i < n_befores; i++ )
+            befores[i]->last_match = 0;
+        return;
+    }
+    
+    seq++;
+    
+    if ( eval( root, rec->insn ) )
+    {
+        dasm_format( rec->insn, buf );
+        printf( "    " FORMAT_ADDR ":    %-32s", rec->insn->addr, buf );
+        
+        if ( ( label = xref_nearestlabel( rec->insn->addr, &base ) ) )
+        {
+            if ( base == rec->insn->addr )
+                printf( "  %s", label );
+            else
+                printf( "  %s+%X", label, rec->insn->addr - base );
+        }
+        putchar( '\n' );
+        n_matches++;
+    }
+    
+    /* Record what this instruction was for the before()s of the next */
+    for ( i = 0; i < n_befores; i++ )
+        if ( eval( befores[i]->a, rec->insn ) )
+            befores[i]->last_match = seq;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      query_end
+ *
+ * DESCRIPTION
+ *      Finishes the query report.
+ *
+ * RETURNS
+ *      number of matches
+ *
+ ************************************************************/
+
+unsigned long query_end( void )
+{
+    printf( "\n;   %lu match%s in %lu instructions\n", n_matches, 
+            n_matches == 1 ? "" : "es", seq );
+            
+    return n_matches;
+}
+
+/******************************************************************************/
+/******************************************************************************/
+/******************************************************************************/
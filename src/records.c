@@ -0,0 +1,547 @@
+/*****************************************************************************
+ *
+ * Copyright (C) 2014-2016, Neil Johnson
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms,
+ * with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of Neil Johnson nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *****************************************************************************/
+ 
+/*****************************************************************************
+ *
+ * Machine-readable output records.
+ *
+ * Instead of the text listing, the disassembler can write one record per
+ *  instruction or data item, built straight from the decoded instruction
+ *  records.  Two formats are supported:
+ *
+ * JSON Lines (-j)
+ *  One JSON object per line:
+ *
+ *      {"addr":4660,"kind":"code","length":3,"bytes":"021234",
+ *       "mnemonic":"LJMP","operands":[{"type":"addr","value":4660,
+ *       "ref":4660,"xref":"jmp","label":"Start","text":"Start"}],
+ *       "label":"Reset","comment":"..."}
+ *
+ *  Punctuation between operands is included as operands of type "text" so
+ *  that the original operand syntax can be rebuilt.  "label", "comment",
+ *  "note" and "proc" are only present when set.
+ *
+ * Binary (-b)
+ *  Fixed-width little-endian records suitable for mmap():
+ *
+ *      header   16 bytes   "DASMREC\0", u32 version, u32 record size
+ *      records  n * 144 bytes
+ *      strings  NUL-terminated strings referenced by offset
+ *      trailer  32 bytes   "DASMEND\0", u32 version, u32 record size,
+ *                          u32 record count, u32 strings offset,
+ *                          u32 strings size, u32 reserved
+ *
+ *  Each record:
+ *
+ *      0   u32  address
+ *      4   u32  length in bytes
+ *      8   u8   kind (REC_xxx)
+ *      9   u8   number of raw bytes stored (max 16)
+ *      10  u8   number of operands stored (max 6, text operands omitted)
+ *      11  u8   flags: bit 0 = starts a procedure,
+ *                      bit 1 = operands truncated
+ *      12  u32  mnemonic        } offsets into the string table,
+ *      16  u32  label           }  0xFFFFFFFF if none
+ *      20  u32  comment         }
+ *      24  u32  note            }
+ *      28  u32  procedure name  }
+ *      32  u8   raw[16]
+ *      48  operand[6], each 16 bytes:
+ *              u8 type (OPND_xxx), s8 xref (XREF_TYPE), u8 flags, u8 0,
+ *              s32 value, u32 ref, u32 label (string offset)
+ *
+ *  The trailer is written last so the output can be streamed; readers
+ *  find it at the end of the file.
+ *
+ * Assembler source (-a) is written from the same records by asmout.c.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "dasmxx.h"
+
+/*****************************************************************************
+ *        Data Types, Macros, Constants
+ *****************************************************************************/
+
+#define REC_VERSION         ( 1 )
+#define REC_SIZE            ( 144 )
+#define REC_MAX_RAW         ( 16 )
+#define REC_MAX_OPERANDS    ( 6 )
+#define REC_NO_STRING       ( 0xFFFFFFFF )
+
+#define REC_FLAG_PROC       ( 0x01 )
+#define REC_FLAG_TRUNCATED  ( 0x02 )
+
+/* String table entry, keyed on the string's address */
+struct strent {
+    const char *    s;
+    unsigned long   offset;
+};
+
+/*****************************************************************************
+ *        External Data
+ *****************************************************************************/
+
+extern int string_terminator;
+
+/*****************************************************************************
+ *        Private Data
+ *****************************************************************************/
+
+static int rec_format = REC_FORMAT_TEXT;
+static unsigned long n_records = 0;
+
+/* Binary string table, and a hash of strings already in it */
+static char *          strtab      = NULL;
+static unsigned long   strtab_len  = 0;
+static unsigned long   strtab_size = 0;
+static struct strent * strhash     = NULL;
+static unsigned long   strhash_size  = 0;
+static unsigned long   strhash_count = 0;
+
+static const char * kind_names[] = {
+    "code", "bytes", "string", "words", "vector", "chars", "bitmap"
+};
+
+static const char * opnd_names[] = {
+    "text", "reg", "imm", "addr", "rel", "bit", "disp", "cond"
+};
+
+static const char * xref_names[] = {
+    "jmp", "call", "imm", "table", "direct", "data", "ptr", "reg", "io"
+};
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      json_string
+ *
+ * DESCRIPTION
+ *      Writes a quoted and escaped JSON string.  Bytes outside
+ *      printable ASCII are written as \u00XX.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void json_string( const char *s, size_t n )
+{
+    putchar( '"' );
+    for ( ; n; n--, s++ )
+    {
+        UBYTE c = (UBYTE)*s;
+        
+        if ( c == '"' || c == '\\' )
+            printf( "\\%c", c );
+        else if ( c < 0x20 || c > 0x7E )
+            printf( "\\u%04x", c );
+        else
+            putchar( c );
+    }
+    putchar( '"' );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      json_field
+ *
+ * DESCRIPTION
+ *      Writes an optional ,"name":"value" string field.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void json_field( const char *name, const char *value )
+{
+    if ( value )
+    {
+        printf( ",\"%s\":", name );
+        json_string( value, strlen( value ) );
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      emit_json
+ *
+ * DESCRIPTION
+ *      Writes one record as a line of JSON.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void emit_json( const record_t *rec )
+{
+    const insn_t *insn = rec->insn;
+    char buf[256];
+    unsigned int i;
+    
+    printf( "{\"addr\":%u,\"kind\":\"%s\",\"length\":%u,\"bytes\":\"", 
+            insn->addr, kind_names[rec->kind], insn->length );
+    for ( i = 0; i < rec->n_bytes; i++ )
+        printf( "%02X", rec->bytes[i] );
+    putchar( '"' );
+    
+    json_field( "mnemonic", insn->opcode ? insn->opcode : "???" );
+    
+    if ( rec->kind == REC_STRING )
+    {
+        /* Drop the terminator, if there is one */
+        size_t n = rec->n_bytes;
+        
+        if ( n && ( rec->bytes[n - 1] == string_terminator 
+                    || rec->bytes[n - 1] == '\0' ) )
+            n--;
+        printf( ",\"text\":" );
+        json_string( (const char *)rec->bytes, n );
+    }
+    
+    printf( ",\"operands\":[" );
+    for ( i = 0; i < (unsigned int)insn->n_operands; i++ )
+    {
+        const operand_t *op = &insn->operands[i];
+        
+        dasm_format_operand( op, buf );
+        
+        printf( "%s{\"type\":\"%s\"", i ? "," : "", opnd_names[op->type] );
+        if ( op->type != OPND_TEXT )
+        {
+            printf( ",\"value\":%d", op->value );
+            if ( op->flags & OPF_LABEL || op->xtype != X_NONE )
+                printf( ",\"ref\":%u", op->ref );
+            if ( op->xtype != X_NONE )
+                printf( ",\"xref\":\"%s\"", xref_names[op->xtype] );
+            if ( op->flags & OPF_LABEL )
+                json_field( "label", xref_findaddrlabel( op->ref ) );
+        }
+        json_field( "text", buf );
+        putchar( '}' );
+    }
+    putchar( ']' );
+    
+    json_field( "label",   rec->label );
+    json_field( "comment", rec->comment );
+    json_field( "note",    rec->note );
+    json_field( "proc",    rec->proc );
+    
+    printf( "}\n" );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      put_u8, put_u16, put_u32
+ *
+ * DESCRIPTION
+ *      Write little-endian values to the output.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void put_u8( unsigned int v )
+{
+    putchar( v & 0xFF );
+}
+
+static void put_u16( unsigned int v )
+{
+    put_u8( v );
+    put_u8( v >> 8 );
+}
+
+static void put_u32( unsigned long v )
+{
+    put_u16( v & 0xFFFF );
+    put_u16( ( v >> 16 ) & 0xFFFF );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      strtab_add
+ *
+ * DESCRIPTION
+ *      Adds a string to the binary string table.  Strings 
+ *      are matched on their address, so each distinct label,
+ *      mnemonic or comment is only stored once.
+ *
+ * RETURNS
+ *      offset of string in table, or REC_NO_STRING if s is NULL
+ *
+ ************************************************************/
+
+static unsigned long strtab_add( const char *s )
+{
+    unsigned long h, i, len;
+    
+    if ( s == NULL )
+        return REC_NO_STRING;
+    
+    /* Grow hash when half full */
+    if ( strhash_count * 2 >= strhash_size )
+    {
+        struct strent * old = strhash;
+        unsigned long old_size = strhash_size;
+        
+        strhash_size  = old_size ? old_size * 2 : 1024;
+        strhash       = zalloc( strhash_size * sizeof( struct strent ) );
+        strhash_count = 0;
+        
+        for ( i = 0; i < old_size; i++ )
+        {
+            if ( old[i].s )
+            {
+                h = ( (size_t)old[i].s >> 3 ) % strhash_size;
+                while ( strhash[h].s )
+                    h = ( h + 1 ) % strhash_size;
+                strhash[h] = old[i];
+                strhash_count++;
+            }
+        }
+        free( old );
+    }
+    
+    h = ( (size_t)s >> 3 ) % strhash_size;
+    while ( strhash[h].s )
+    {
+        if ( strhash[h].s == s )
+            return strhash[h].offset;
+        h = ( h + 1 ) % strhash_size;
+    }
+    
+    len = strlen( s ) + 1;
+    if ( strtab_len + len > strtab_size )
+    {
+        strtab_size = ( strtab_size + len ) * 2;
+        strtab = realloc( strtab, strtab_size );
+        if ( !strtab )
+            error( "Out of memory" );
+    }
+    memcpy( strtab + strtab_len, s, len );
+    
+    strhash[h].s      = s;
+    strhash[h].offset = strtab_len;
+    strhash_count++;
+    strtab_len += len;
+    
+    return strhash[h].offset;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      emit_binary
+ *
+ * DESCRIPTION
+ *      Writes one fixed-width binary record.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+static void emit_binary( const record_t *rec )
+{
+    const insn_t *insn = rec->insn;
+    unsigned int n_raw = MIN( rec->n_bytes, REC_MAX_RAW );
+    unsigned int n_ops = 0;
+    unsigned int flags = rec->proc ? REC_FLAG_PROC : 0;
+    unsigned int i, j;
+    
+    for ( i = 0; i < (unsigned int)insn->n_operands; i++ )
+        if ( insn->operands[i].type != OPND_TEXT )
+            n_ops++;
+            
+    if ( n_ops > REC_MAX_OPERANDS )
+    {
+        n_ops = REC_MAX_OPERANDS;
+        flags |= REC_FLAG_TRUNCATED;
+    }
+    
+    put_u32( insn->addr );
+    put_u32( insn->length );
+    put_u8( rec->kind );
+    put_u8( n_raw );
+    put_u8( n_ops );
+    put_u8( flags );
+    put_u32( strtab_add( insn->opcode ? insn->opcode : "???" ) );
+    put_u32( strtab_add( rec->label ) );
+    put_u32( strtab_add( rec->comment ) );
+    put_u32( strtab_add( rec->note ) );
+    put_u32( strtab_add( rec->proc ) );
+    
+    for ( i = 0; i < REC_MAX_RAW; i++ )
+        put_u8( i < n_raw ? rec->bytes[i] : 0 );
+    
+    for ( i = 0, j = 0; i < (unsigned int)insn->n_operands && j < n_ops; i++ )
+    {
+        const operand_t *op = &insn->operands[i];
+        
+        if ( op->type == OPND_TEXT )
+            continue;
+            
+        put_u8( op->type );
+        put_u8( (unsigned int)op->xtype );
+        put_u8( op->flags );
+        put_u8( 0 );
+        put_u32( (unsigned long)op->value );
+        put_u32( op->ref );
+        put_u32( op->flags & OPF_LABEL ? strtab_add( xref_findaddrlabel( op->ref ) ) 
+                                       : REC_NO_STRING );
+        j++;
+    }
+    
+    /* Pad out unused operand slots */
+    for ( ; j < REC_MAX_OPERANDS; j++ )
+    {
+        put_u32( 0 );
+        put_u32( 0 );
+        put_u32( 0 );
+        put_u32( REC_NO_STRING );
+    }
+}
+
+/*****************************************************************************
+ *        Public Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      record_begin
+ *
+ * DESCRIPTION
+ *      Starts record output in the given format.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+void record_begin( int format )
+{
+    rec_format = format;
+    n_records  = 0;
+    
+    if ( rec_format == REC_FORMAT_BINARY )
+    {
+        fwrite( "DASMREC", 1, 8, stdout );
+        put_u32( REC_VERSION );
+        put_u32( REC_SIZE );
+    }
+    else if ( rec_format == REC_FORMAT_ASM )
+        asm_begin();
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      record_emit
+ *
+ * DESCRIPTION
+ *      Writes a single record.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+void record_emit( const record_t *rec )
+{
+    if ( rec_format == REC_FORMAT_JSON )
+        emit_json( rec );
+    else if ( rec_format == REC_FORMAT_BINARY )
+        emit_binary( rec );
+    else if ( rec_format == REC_FORMAT_ASM )
+        asm_emit( rec );
+        
+    n_records++;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      record_end
+ *
+ * DESCRIPTION
+ *      Finishes record output.  For binary output this writes
+ *      the string table and the trailer.
+ *
+ * RETURNS
+ *      none
+ *
+ ************************************************************/
+
+void record_end( void )
+{
+    if ( rec_format == REC_FORMAT_BINARY )
+    {
+        unsigned long strings_offset = 16 + n_records * REC_SIZE;
+        
+        if ( strtab_len )
+            fwrite( strtab, 1, strtab_len, stdout );
+            
+        fwrite( "DASMEND", 1, 8, stdout );
+        put_u32( REC_VERSION );
+        put_u32( REC_SIZE );
+        put_u32( n_records );
+        put_u32( strings_offset );
+        put_u32( strtab_len );
+        put_u32( 0 );
+    }
+    else if ( rec_format == REC_FORMAT_ASM )
+        asm_end();
+    
+    fflush( stdout );
+}
+
+/******************************************************************************/
+/******************************************************************************/
+/******************************************************************************/
@@ -0,0 +1,541 @@
+/*****************************************************************************
+ *
+ * Copyright (C) 2014-2016, Neil Johnson
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms,
+ * with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of Neil Johnson nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *****************************************************************************/
+ 
+/*****************************************************************************
+ *
+ * Byte pattern search.
+ *
+ * Finds byte patterns (library routines, constants, opcode sequences)
+ *  anywhere in the input image.  A pattern is a list of hex bytes, in
+ *  which '?' stands for any nibble, so "CD ?? ?3" matches a call to any
+ *  address whose low byte ends in 3.  Spaces between bytes are optional.
+ *  A pattern may be given a name, as in "memcpy: 7E 12 23 13 0B".
+ *
+ * All patterns are searched for in one pass over the image.  The longest
+ *  run of fixed bytes of each pattern, its anchor, goes into an Aho-Corasick
+ *  automaton, held as a full 256-way transition table per state so that
+ *  each byte of the image costs one table lookup.  Where an anchor ends
+ *  the rest of its pattern is checked, wildcards and all.
+ *
+ * Each match is reported with its address, the pattern's name, the bytes
+ *  matched and the nearest label at or below it in the cross-reference
+ *  table, as "label+offset".
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "dasmxx.h"
+
+/*****************************************************************************
+ *        Data Types, Macros, Constants
+ *****************************************************************************/
+
+/* Longest pattern */
+#define MAX_PATTERN     ( 256 )
+
+/* Most bytes shown of a match */
+#define MAX_SHOWN       ( 8 )
+
+#define NO_STATE        ( -1 )
+
+/* One byte of a pattern: matches b if ( b & mask ) == value */
+typedef struct {
+    UBYTE        value;
+    UBYTE        mask;
+} pbyte_t;
+
+typedef struct {
+    const char * name;
+    pbyte_t    * bytes;
+    unsigned int length;
+    unsigned int anchor;          /* offset of the longest fixed run */
+    unsigned int anchor_len;
+    int          next;            /* next pattern with the same anchor */
+} pattern_t;
+
+/* One state of the automaton */
+typedef struct {
+    int          fail;            /* longest proper suffix in the trie */
+    int          out;             /* first pattern whose anchor ends here */
+    int          out_link;        /* nearest suffix state with patterns */
+} state_t;
+
+typedef struct {
+    ADDR         addr;
+    unsigned int pattern;
+} match_t;
+
+/*****************************************************************************
+ *        Private Data
+ *****************************************************************************/
+
+static pattern_t * patterns = NULL;
+static unsigned int n_patterns = 0;
+
+static state_t * states = NULL;
+static int     (*delta)[256] = NULL;
+static unsigned int n_states = 0, max_states = 0;
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      hex_digit
+ *
+ * DESCRIPTION
+ *      Converts a hex digit.
+ *
+ * RETURNS
+ *      its value, or -1 if c is not a hex digit
+ *
+ ************************************************************/
+
+static int hex_digit( int c )
+{
+    if ( isdigit( c ) )
+        return c - '0';
+    if ( isxdigit( c ) )
+        return toupper( c ) - 'A' + 10;
+    return -1;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      new_state
+ *
+ * DESCRIPTION
+ *      Adds a state with no transitions to the automaton.
+ *
+ * RETURNS
+ *      its index
+ *
+ ************************************************************/
+
+static int new_state( void )
+{
+    int c;
+    
+    if ( n_states == max_states )
+    {
+        max_states = max_states ? max_states * 2 : 64;
+        states = realloc( states, max_states * sizeof( *states ) );
+        delta  = realloc( delta,  max_states * sizeof( *delta ) );
+        if ( !states || !delta )
+            error( "Out of memory" );
+    }
+    
+    states[n_states].fail     = 0;
+    states[n_states].out      = NO_STATE;
+    states[n_states].out_link = NO_STATE;
+    for ( c = 0; c < 256; c++ )
+        delta[n_states][c] = NO_STATE;
+        
+    return n_states++;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      build
+ *
+ * DESCRIPTION
+ *      Builds the automaton from the anchors of the patterns:
+ *       a trie, then the failure links in breadth-first
+ *       order, folding them into the transition table.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void build( void )
+{
+    unsigned int i, j, head = 0, tail = 0;
+    int *queue, s, c;
+    
+    new_state();
+    
+    for ( i = 0; i < n_patterns; i++ )
+    {
+        pattern_t *pat = &patterns[i];
+        
+        for ( s = 0, j = 0; j < pat->anchor_len; j++ )
+        {
+            c = pat->bytes[pat->anchor + j].value;
+            if ( delta[s][c] == NO_STATE )
+            {
+                int t = new_state();
+                delta[s][c] = t;
+            }
+            s = delta[s][c];
+        }
+        
+        pat->next     = states[s].out;
+        states[s].out = i;
+    }
+    
+    queue = zalloc( n_states * sizeof( int ) );
+    
+    for ( c = 0; c < 256; c++ )
+    {
+        if ( delta[0][c] == NO_STATE )
+            delta[0][c] = 0;
+        else
+            queue[tail++] = delta[0][c];
+    }
+    
+    while ( head < tail )
+    {
+        int r = queue[head++];
+        int f = states[r].fail;
+        
+        states[r].out_link = ( states[f].out != NO_STATE ) ? f : states[f].out_link;
+        
+        for ( c = 0; c < 256; c++ )
+        {
+            s = delta[r][c];
+            if ( s == NO_STATE )
+                delta[r][c] = delta[f][c];
+            else
+            {
+                states[s].fail = delta[f][c];
+                queue[tail++] = s;
+            }
+        }
+    }
+    
+    free( queue );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      verify
+ *
+ * DESCRIPTION
+ *      Checks a whole pattern against the image at p, which
+ *       has room for it.
+ *
+ * RETURNS
+ *      non-zero if it matches
+ *
+ ************************************************************/
+
+static int verify( const pattern_t *pat, const UBYTE *p )
+{
+    unsigned int i;
+    
+    for ( i = 0; i < pat->length; i++ )
+        if ( ( p[i] & pat->bytes[i].mask ) != pat->bytes[i].value )
+            return 0;
+            
+    return 1;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      cmp_match
+ *
+ * DESCRIPTION
+ *      qsort() comparison of matches by address, then by
+ *       pattern.
+ *
+ * RETURNS
+ *      <0, 0, >0
+ *
+ ************************************************************/
+
+static int cmp_match( const void *a, const void *b )
+{
+    const match_t *ma = a, *mb = b;
+    
+    if ( ma->addr != mb->addr )
+        return ( ma->addr > mb->addr ) - ( ma->addr < mb->addr );
+        
+    return ( ma->pattern > mb->pattern ) - ( ma->pattern < mb->pattern );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      read_image
+ *
+ * DESCRIPTION
+ *      Reads the whole input into memory.  It is read in
+ *       growing blocks, so it may be a pipe.
+ *
+ * RETURNS
+ *      the image; *length is set to its size
+ *
+ ************************************************************/
+
+static UBYTE * read_image( FILE *f, unsigned long *length )
+{
+    unsigned long size = 65536, n = 0;
+    UBYTE *image = malloc( size );
+    size_t got;
+    
+    while ( image && ( got = fread( image + n, 1, size - n, f ) ) > 0 )
+    {
+        n += got;
+        if ( n == size )
+            image = realloc( image, size *= 2 );
+    }
+    
+    if ( !image )
+        error( "Out of memory" );
+        
+    *length = n;
+    return image;
+}
+
+/*****************************************************************************
+ *        Public Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      search_add
+ *
+ * DESCRIPTION
+ *      Adds a pattern to search for, as "[name:] hex bytes".
+ *       Syntax errors are fatal.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void search_add( const char *text )
+{
+    pbyte_t buf[MAX_PATTERN];
+    pattern_t *pat;
+    const char *p = strchr( text, ':' ), *name = text;
+    unsigned int n = 0, run = 0, i;
+    
+    if ( p )
+    {
+        char *s = zalloc( p - text + 1 );
+        
+        memcpy( s, text, p - text );
+        for ( i = p - text; i > 0 && isspace( (UBYTE)s[i - 1] ); i-- )
+            s[i - 1] = '\0';
+        name = s;
+        p++;
+    }
+    else
+        p = text;
+        
+    patterns = realloc( patterns, ( n_patterns + 1 ) * sizeof( *patterns ) );
+    if ( !patterns )
+        error( "Out of memory" );
+    pat = &patterns[n_patterns];
+    memset( pat, 0, sizeof( *pat ) );
+    
+    while ( *p )
+    {
+        int hi, lo;
+        
+        if ( isspace( (UBYTE)*p ) )
+        {
+            p++;
+            continue;
+        }
+        
+        if ( n == MAX_PATTERN )
+            error( "Search pattern `%s' is too long (limit is %d bytes)", text, MAX_PATTERN );
+            
+        hi = ( *p == '?' ) ? 0x10 : hex_digit( (UBYTE)*p );
+        lo = ( p[1] == '?' ) ? 0x10 : hex_digit( (UBYTE)p[1] );
+        if ( hi < 0 || lo < 0 )
+            error( "Bad search pattern `%s'", text );
+        p += 2;
+        
+        buf[n].mask  = ( hi == 0x10 ? 0x00 : 0xF0 ) | ( lo == 0x10 ? 0x00 : 0x0F );
+        buf[n].value = ( ( hi << 4 ) | lo ) & buf[n].mask;
+        
+        /* Track the longest run of fixed bytes */
+        run = ( buf[n].mask == 0xFF ) ? run + 1 : 0;
+        if ( run > pat->anchor_len )
+        {
+            pat->anchor_len = run;
+            pat->anchor     = n + 1 - run;
+        }
+        n++;
+    }
+    
+    if ( pat->anchor_len == 0 )
+        error( "Search pattern `%s' has no fixed byte", text );
+        
+    pat->name   = ( name == text ) ? dupstr( text ) : name;
+    pat->length = n;
+    pat->bytes  = zalloc( n * sizeof( pbyte_t ) );
+    memcpy( pat->bytes, buf, n * sizeof( pbyte_t ) );
+    n_patterns++;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      search_add_file
+ *
+ * DESCRIPTION
+ *      Adds the patterns in a file, one per line.  Blank
+ *       lines and lines starting with '#' are skipped.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void search_add_file( const char *filename )
+{
+    char buf[1024], *p, *q;
+    FILE *f = fopen( filename, "r" );
+    
+    if ( !f )
+        error( "Failed to open pattern file `%s'", filename );
+        
+    while ( fgets( buf, sizeof( buf ), f ) )
+    {
+        if ( ( q = strchr( buf, '\n' ) ) )
+            *q = '\0';
+        for ( p = buf; isspace( (UBYTE)*p ); p++ )
+            ;
+        if ( *p && *p != '#' )
+            search_add( p );
+    }
+    
+    fclose( f );
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      search_run
+ *
+ * DESCRIPTION
+ *      Searches the input f, whose first byte is at address
+ *       base, for all the patterns and prints the matches in
+ *       address order.
+ *
+ * RETURNS
+ *      number of matches
+ *
+ ************************************************************/
+
+unsigned int search_run( FILE *f, ADDR base )
+{
+    unsigned long length, i;
+    unsigned int n_matches = 0, max_matches = 0, k;
+    match_t *matches = NULL;
+    UBYTE *image;
+    int s = 0;
+    
+    build();
+    image = read_image( f, &length );
+    
+    for ( i = 0; i < length; i++ )
+    {
+        int t;
+        
+        s = delta[s][image[i]];
+        
+        for ( t = ( states[s].out != NO_STATE ) ? s : states[s].out_link;
+              t != NO_STATE; t = states[t].out_link )
+        {
+            int p;
+            
+            for ( p = states[t].out; p != NO_STATE; p = patterns[p].next )
+            {
+                const pattern_t *pat = &patterns[p];
+                unsigned long start = i + 1 - pat->anchor_len;
+                
+                if ( start < pat->anchor || start - pat->anchor + pat->length > length 
+                     || !verify( pat, image + start - pat->anchor ) )
+                    continue;
+                    
+                matches = grow( matches, n_matches, &max_matches, sizeof( *matches ) );
+                matches[n_matches].addr    = base + start - pat->anchor;
+                matches[n_matches].pattern = p;
+                n_matches++;
+            }
+        }
+    }
+    
+    if ( n_matches )
+        qsort( matches, n_matches, sizeof( *matches ), cmp_match );
+    
+    printf( ";   Searched %lu bytes for %u pattern%s\n\n", length, 
+            n_patterns, n_patterns == 1 ? "" : "s" );
+            
+    for ( k = 0; k < n_matches; k++ )
+    {
+        const pattern_t *pat = &patterns[matches[k].pattern];
+        ADDR base_addr = 0;
+        const char *label = xref_nearestlabel( matches[k].addr, &base_addr );
+        const UBYTE *p = image + ( matches[k].addr - base );
+        unsigned int j, w = 0;
+        
+        printf( "    " FORMAT_ADDR ":    ", matches[k].addr );
+        for ( j = 0; j < pat->length && j < MAX_SHOWN; j++ )
+            w += printf( "%02X ", p[j] );
+        w += printf( "%s", j < pat->length ? "..." : "" );
+        printf( "%*s  %-20s", 3 * MAX_SHOWN + 3 - w, "", pat->name );
+        
+        if ( label && base_addr == matches[k].addr )
+            printf( "  %s", label );
+        else if ( label )
+            printf( "  %s+%X", label, matches[k].addr - base_addr );
+        putchar( '\n' );
+    }
+    
+    printf( "\n;   %u match%s\n", n_matches, n_matches == 1 ? "" : "es" );
+    
+    free( image );
+    free( matches );
+    return n_matches;
+}
+
+/******************************************************************************/
+/******************************************************************************/
+/******************************************************************************/
@@ -0,0 +1,551 @@
+/*****************************************************************************
+ *
+ * Copyright (C) 2014-2016, Neil Johnson
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms,
+ * with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of Neil Johnson nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *****************************************************************************/
+ 
+/*****************************************************************************
+ *
+ * Procedure signatures.
+ *
+ * Compiler runtimes and vendor libraries turn up in ROM after ROM, at a
+ *  different address each time.  A signature is a 64-bit hash of the
+ *  instructions of a procedure, from its entry to its last return (or to
+ *  the next procedure), with everything that moves when code is relocated
+ *  masked out: absolute and relative addresses, and operands that refer
+ *  to code or data.  Mnemonics, registers, constants and hardware
+ *  addresses are kept.  Procedures of fewer than MIN_INSNS instructions
+ *  are too common to identify and are ignored.
+ *
+ * Signatures of named procedures are written to a database file (-w),
+ *  merging with those already in it.  Another ROM's procedures can then
+ *  be looked up in it (-m), and the ones that only have generated names
+ *  take the name of their match.
+ *
+ * The database is a single open-addressing hash table on disk, which is
+ *  mapped into memory and probed in place, so a lookup costs the same
+ *  however large the database grows:
+ *
+ *      header      "DASMSIG1", slot count (a power of two), entry count,
+ *                  size of the name pool
+ *      slots       hash (64 bits), size in bytes, offset of name + 1
+ *                  (0 for an empty slot)
+ *      names       NUL-terminated names
+ *
+ *  All fields are in host byte order; the magic number is checked
+ *  to make sure that the database was written by a host of the same
+ *  order.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dasmxx.h"
+
+/*****************************************************************************
+ *        Data Types, Macros, Constants
+ *****************************************************************************/
+
+/* Shortest procedure given a signature */
+#define MIN_INSNS       ( 4 )
+
+#define SIG_MAGIC       "DASMSIG1"
+#define SIG_MAGIC_LEN   ( 8 )
+
+#define FNV_BASIS       ( 0xCBF29CE484222325ull )
+#define FNV_PRIME       ( 0x100000001B3ull )
+
+typedef struct {
+    char         magic[SIG_MAGIC_LEN];
+    uint32_t     n_slots;
+    uint32_t     n_entries;
+    uint32_t     names_size;
+    uint32_t     reserved;
+} sig_header_t;
+
+typedef struct {
+    uint64_t     hash;
+    uint32_t     size;
+    uint32_t     name;        /* offset in the name pool + 1, 0 if empty */
+} sig_slot_t;
+
+/* Signature of a procedure of the input */
+typedef struct {
+    ADDR         addr;
+    ADDR         end;         /* end of the procedure's last return      */
+    uint64_t     hash;
+    unsigned int size;        /* bytes hashed                            */
+    unsigned int n_insns;
+} proc_sig_t;
+
+/*****************************************************************************
+ *        Private Data
+ *****************************************************************************/
+
+static proc_sig_t * sigs = NULL;
+static unsigned int n_sigs = 0, max_sigs = 0;
+static int          in_proc = 0;
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      mix
+ *
+ * DESCRIPTION
+ *      Adds bytes to an FNV-1a hash.
+ *
+ * RETURNS
+ *      the new hash
+ *
+ ************************************************************/
+
+static uint64_t mix( uint64_t h, const void *data, size_t n )
+{
+    const UBYTE *p = data;
+    
+    while ( n-- )
+        h = ( h ^ *p++ ) * FNV_PRIME;
+        
+    return h;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      relocatable
+ *
+ * DESCRIPTION
+ *      Decides whether an operand changes when the code is
+ *       moved: it is an address, or refers to code or data.
+ *       References to registers, I/O and direct (on-chip)
+ *       memory stay where they are.
+ *
+ * RETURNS
+ *      non-zero if it is masked out of the signature
+ *
+ ************************************************************/
+
+static int relocatable( const operand_t *op )
+{
+    switch ( op->xtype )
+    {
+    case X_JMP:
+    case X_CALL:
+    case X_IMM:
+    case X_TABLE:
+    case X_DATA:
+    case X_PTR:
+        return 1;
+    case X_REG:
+    case X_IO:
+    case X_DIRECT:
+        return 0;
+    default:
+        return op->type == OPND_ADDR || op->type == OPND_REL;
+    }
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      hash_insn
+ *
+ * DESCRIPTION
+ *      Adds an instruction to a hash.
+ *
+ * RETURNS
+ *      the new hash
+ *
+ ************************************************************/
+
+static uint64_t hash_insn( uint64_t h, const insn_t *insn )
+{
+    int i;
+    
+    h = mix( h, insn->opcode, strlen( insn->opcode ) + 1 );
+    
+    for ( i = 0; i < insn->n_operands; i++ )
+    {
+        const operand_t *op = &insn->operands[i];
+        UBYTE type = (UBYTE)op->type;
+        
+        h = mix( h, &type, 1 );
+        if ( op->type == OPND_TEXT || op->type == OPND_REG || op->type == OPND_COND )
+            h = mix( h, op->fmt, strlen( op->fmt ) );
+        if ( op->type != OPND_TEXT && !relocatable( op ) )
+            h = mix( h, &op->value, sizeof( op->value ) );
+    }
+    
+    return h;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      open_db
+ *
+ * DESCRIPTION
+ *      Maps a signature database into memory and checks it.
+ *
+ * RETURNS
+ *      the mapping, or NULL if the file does not exist;
+ *       *length is set to its size
+ *
+ ************************************************************/
+
+static const sig_header_t * open_db( const char *dbfile, size_t *length )
+{
+    const sig_header_t *db;
+    struct stat st;
+    int fd = open( dbfile, O_RDONLY );
+    
+    if ( fd < 0 )
+        return NULL;
+        
+    if ( fstat( fd, &st ) < 0 || (size_t)st.st_size < sizeof( sig_header_t ) )
+        error( "Signature database `%s' is not valid", dbfile );
+        
+    db = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( db == MAP_FAILED )
+        error( "Failed to map signature database `%s'", dbfile );
+        
+    if ( memcmp( db->magic, SIG_MAGIC, SIG_MAGIC_LEN ) 
+         || ( db->n_slots & ( db->n_slots - 1 ) ) || !db->n_slots
+         || (size_t)st.st_size != sizeof( sig_header_t ) 
+                                  + db->n_slots * sizeof( sig_slot_t ) + db->names_size )
+        error( "Signature database `%s' is not valid", dbfile );
+        
+    *length = st.st_size;
+    return db;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      lookup
+ *
+ * DESCRIPTION
+ *      Finds a signature in a database.
+ *
+ * RETURNS
+ *      its slot, or NULL if it is not there
+ *
+ ************************************************************/
+
+static const sig_slot_t * lookup( const sig_header_t *db, uint64_t hash, 
+                                  unsigned int size )
+{
+    const sig_slot_t *slots = (const sig_slot_t *)( db + 1 );
+    uint32_t mask = db->n_slots - 1, h;
+    
+    for ( h = (uint32_t)hash & mask; slots[h].name; h = ( h + 1 ) & mask )
+        if ( slots[h].hash == hash && slots[h].size == size )
+            return &slots[h];
+            
+    return NULL;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      insert
+ *
+ * DESCRIPTION
+ *      Adds a signature to a table being built, unless it
+ *       is there already.
+ *
+ * RETURNS
+ *      non-zero if it was added
+ *
+ ************************************************************/
+
+static int insert( sig_slot_t *slots, uint32_t n_slots, uint64_t hash, 
+                   unsigned int size, uint32_t name )
+{
+    uint32_t mask = n_slots - 1, h;
+    
+    for ( h = (uint32_t)hash & mask; slots[h].name; h = ( h + 1 ) & mask )
+        if ( slots[h].hash == hash && slots[h].size == size )
+            return 0;
+            
+    slots[h].hash = hash;
+    slots[h].size = size;
+    slots[h].name = name;
+    
+    return 1;
+}
+
+/*****************************************************************************
+ *        Public Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      sig_scan
+ *
+ * DESCRIPTION
+ *      Adds one item of a walk to the signature of the
+ *       procedure it is in.  The flow graph must have been
+ *       built, to know where the procedures are.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void sig_scan( const record_t *rec )
+{
+    const insn_t *insn = rec->insn;
+    proc_info_t info;
+    proc_sig_t *s;
+    
+    if ( rec->kind != REC_CODE || !insn->opcode )
+    {
+        in_proc = 0;
+        return;
+    }
+    
+    if ( cfg_proc_info( insn->addr, &info ) )
+    {
+        sigs = grow( sigs, n_sigs, &max_sigs, sizeof( *sigs ) );
+        
+        s = &sigs[n_sigs++];
+        memset( s, 0, sizeof( *s ) );
+        s->addr = insn->addr;
+        s->end  = info.size ? insn->addr + info.size : (ADDR)-1;
+        s->hash = FNV_BASIS;
+        in_proc = 1;
+    }
+    
+    if ( !in_proc )
+        return;
+        
+    s = &sigs[n_sigs - 1];
+    if ( insn->addr >= s->end )
+    {
+        in_proc = 0;
+        return;
+    }
+    
+    s->hash  = hash_insn( s->hash, insn );
+    s->size += insn->length;
+    s->n_insns++;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      sig_proc
+ *
+ * DESCRIPTION
+ *      Looks up the signature of the procedure starting at
+ *       addr, from the last sig_scan() walk.
+ *
+ * RETURNS
+ *      non-zero if there is one; *hash and *n_insns are set
+ *
+ ************************************************************/
+
+int sig_proc( ADDR addr, unsigned long long *hash, unsigned int *n_insns )
+{
+    unsigned int lo = 0, hi = n_sigs;
+    
+    while ( lo < hi )
+    {
+        unsigned int mid = lo + ( hi - lo ) / 2;
+        
+        if ( sigs[mid].addr < addr )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    
+    if ( lo == n_sigs || sigs[lo].addr != addr )
+        return 0;
+        
+    *hash    = sigs[lo].hash;
+    *n_insns = sigs[lo].n_insns;
+    
+    return 1;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      sig_match
+ *
+ * DESCRIPTION
+ *      Looks up the signatures of the procedures with
+ *       generated names in a database and names the ones
+ *       that are found.  A missing database is fatal.
+ *
+ * RETURNS
+ *      number of procedures named
+ *
+ ************************************************************/
+
+unsigned int sig_match( const char *dbfile )
+{
+    const sig_header_t *db;
+    const sig_slot_t *slot;
+    const char *names;
+    size_t length;
+    unsigned int i, n = 0;
+    
+    if ( !( db = open_db( dbfile, &length ) ) )
+        error( "Failed to open signature database `%s'", dbfile );
+        
+    names = (const char *)( (const sig_slot_t *)( db + 1 ) + db->n_slots );
+    
+    for ( i = 0; i < n_sigs; i++ )
+        if ( sigs[i].n_insns >= MIN_INSNS 
+             && ( slot = lookup( db, sigs[i].hash, sigs[i].size ) )
+             && slot->name <= db->names_size
+             && cfg_proc_rename( sigs[i].addr, names + slot->name - 1 ) )
+            n++;
+            
+    munmap( (void *)db, length );
+    
+    return n;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      sig_write
+ *
+ * DESCRIPTION
+ *      Adds the signatures of the procedures with names of
+ *       their own to a database, creating it if need be.
+ *       Signatures already in the database keep their names.
+ *
+ * RETURNS
+ *      number of signatures added
+ *
+ ************************************************************/
+
+unsigned int sig_write( const char *dbfile )
+{
+    const sig_header_t *old;
+    sig_header_t hdr;
+    sig_slot_t *slots;
+    char *names, *tmpname;
+    size_t length = 0, names_size = 0, max_names;
+    unsigned int i, n_new = 0, n_old = 0;
+    FILE *fp;
+    
+    old = open_db( dbfile, &length );
+    if ( old )
+    {
+        n_old      = old->n_entries;
+        names_size = old->names_size;
+    }
+    
+    /* Room for every name; the table is kept at most half full */
+    for ( max_names = names_size, i = 0; i < n_sigs; i++ )
+        max_names += strlen( cfg_proc_name( sigs[i].addr ) ) + 1;
+        
+    memset( &hdr, 0, sizeof( hdr ) );
+    memcpy( hdr.magic, SIG_MAGIC, SIG_MAGIC_LEN );
+    for ( hdr.n_slots = 1024; hdr.n_slots < 2 * ( n_old + n_sigs ); hdr.n_slots *= 2 )
+        ;
+        
+    slots = zalloc( hdr.n_slots * sizeof( sig_slot_t ) );
+    names = zalloc( max_names + 1 );
+    
+    if ( old )
+    {
+        const sig_slot_t *p = (const sig_slot_t *)( old + 1 );
+        
+        memcpy( names, p + old->n_slots, names_size );
+        for ( i = 0; i < old->n_slots; i++ )
+            if ( p[i].name )
+                insert( slots, hdr.n_slots, p[i].hash, p[i].size, p[i].name );
+        munmap( (void *)old, length );
+    }
+    
+    for ( i = 0; i < n_sigs; i++ )
+    {
+        const char *name = cfg_proc_name( sigs[i].addr );
+        
+        if ( sigs[i].n_insns < MIN_INSNS 
+             || !strncmp( name, GEN_LABEL_PREFIX, strlen( GEN_LABEL_PREFIX ) ) )
+            continue;
+            
+        if ( insert( slots, hdr.n_slots, sigs[i].hash, sigs[i].size, names_size + 1 ) )
+        {
+            strcpy( names + names_size, name );
+            names_size += strlen( name ) + 1;
+            n_new++;
+        }
+    }
+    
+    hdr.n_entries  = n_old + n_new;
+    hdr.names_size = names_size;
+    
+    /* Write a new file and move it into place, so a database that is
+       mapped by another process is never seen half written */
+    tmpname = zalloc( strlen( dbfile ) + 5 );
+    sprintf( tmpname, "%s.tmp", dbfile );
+    
+    if ( !( fp = fopen( tmpname, "wb" ) ) )
+        error( "Failed to open signature database `%s'", tmpname );
+        
+    if ( fwrite( &hdr, sizeof( hdr ), 1, fp ) != 1
+         || fwrite( slots, sizeof( sig_slot_t ), hdr.n_slots, fp ) != hdr.n_slots
+         || fwrite( names, 1, names_size, fp ) != names_size
+         || fclose( fp ) )
+        error( "Failed to write signature database `%s'", tmpname );
+        
+    if ( rename( tmpname, dbfile ) )
+        error( "Failed to replace signature database `%s'", dbfile );
+        
+    free( tmpname );
+    free( slots );
+    free( names );
+    
+    return n_new;
+}
+
+/******************************************************************************/
+/******************************************************************************/
+/******************************************************************************/
@@ -0,0 +1,357 @@
+/*****************************************************************************
+ *
+ * Copyright (C) 2014-2016, Neil Johnson
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms,
+ * with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of Neil Johnson nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *****************************************************************************/
+ 
+/*****************************************************************************
+ *
+ * Register tracking.
+ *
+ * Much of a ROM's data is reached through a register loaded with its 
+ *  address a few instructions earlier: MOV DPTR,#table then MOVC A,@A+DPTR
+ *  on the 8051, LD HL,#buffer then LD A,(HL) on the Z80, movw VP,#block 
+ *  then mov A,[VP+4] on the 78K/III.  None of those instructions carry
+ *  the address, so the data is left without a cross-reference.
+ *
+ * This pass follows the decoded code in address order, keeping the value
+ *  of each register that the target's DASM_TRACK table names.  A load 
+ *  of a constant makes the register known, an increment or decrement 
+ *  steps it, and any other instruction naming it, or matching one of its
+ *  TRACK_KILL entries, makes it unknown again.  Everything is forgotten 
+ *  where other code can join the flow (a jump or call target, the start 
+ *  of a range) and at calls, so a value is only ever carried along a 
+ *  straight run of code with a single way in.  An instruction that uses
+ *  a known register as a pointer gets a cross-reference to the address 
+ *  it holds, plus the displacement of an indexed operand.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "dasmxx.h"
+
+/*****************************************************************************
+ *        Data Types, Macros, Constants
+ *****************************************************************************/
+
+/* Most registers a target may track */
+#define MAX_REGS        ( 8 )
+
+#define MAX_SHAPE       ( 64 )
+
+typedef struct {
+    const char * name;
+    int          known;
+    ADDR         value;
+} reg_state_t;
+
+/* A reference made through a known register */
+typedef struct {
+    ADDR         addr;        /* instruction making it                   */
+    ADDR         value;
+    const char * reg;
+    XREF_TYPE    xtype;
+} track_ref_t;
+
+/*****************************************************************************
+ *        Private Data
+ *****************************************************************************/
+
+static reg_state_t  regs[MAX_REGS];
+static unsigned int n_regs = 0;
+
+static track_ref_t * refs = NULL;
+static unsigned int  n_refs = 0, max_refs = 0;
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_reg
+ *
+ * DESCRIPTION
+ *      Looks up the state of a register, adding it if it is
+ *       not there yet.
+ *
+ * RETURNS
+ *      pointer to the state
+ *
+ ************************************************************/
+
+static reg_state_t *find_reg( const char *name )
+{
+    unsigned int i;
+    
+    for ( i = 0; i < n_regs; i++ )
+        if ( !strcmp( regs[i].name, name ) )
+            return &regs[i];
+            
+    if ( n_regs == MAX_REGS )
+        error( "Too many tracked registers" );
+        
+    regs[n_regs].name  = name;
+    regs[n_regs].known = 0;
+    return &regs[n_regs++];
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      forget_all
+ *
+ * DESCRIPTION
+ *      Makes every register unknown.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void forget_all( void )
+{
+    unsigned int i;
+    
+    for ( i = 0; i < n_regs; i++ )
+        regs[i].known = 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      names_reg
+ *
+ * DESCRIPTION
+ *      Checks whether operand text names a register, as a 
+ *       whole word.
+ *
+ * RETURNS
+ *      non-zero if it does
+ *
+ ************************************************************/
+
+static int names_reg( const char *text, const char *name )
+{
+    size_t len = strlen( name );
+    const char *p;
+    
+    for ( p = text; *p; p++ )
+        if ( ( p == text || !isalnum( (UBYTE)p[-1] ) )
+             && !strncasecmp( p, name, len )
+             && !isalnum( (UBYTE)p[len] ) )
+            return 1;
+            
+    return 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      displacement
+ *
+ * DESCRIPTION
+ *      Finds the displacement of an indexed operand, which 
+ *       the decoders give as a magnitude with any minus sign
+ *       in its format.
+ *
+ * RETURNS
+ *      the signed displacement, 0 if there is none
+ *
+ ************************************************************/
+
+static long displacement( const insn_t *insn )
+{
+    int i;
+    
+    for ( i = 0; i < insn->n_operands; i++ )
+    {
+        const operand_t *op = &insn->operands[i];
+        
+        if ( op->type == OPND_DISP )
+            return op->fmt[0] == '-' ? -(long)op->value : (long)op->value;
+    }
+    
+    return 0;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      add_ref
+ *
+ * DESCRIPTION
+ *      Notes a reference made through a known register.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+static void add_ref( ADDR addr, const reg_state_t *r, ADDR value, XREF_TYPE xtype )
+{
+    refs = grow( refs, n_refs, &max_refs, sizeof( *refs ) );
+    
+    refs[n_refs].addr  = addr;
+    refs[n_refs].value = value;
+    refs[n_refs].reg   = r->name;
+    refs[n_refs].xtype = xtype;
+    n_refs++;
+}
+
+/*****************************************************************************
+ *        Public Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      track_scan
+ *
+ * DESCRIPTION
+ *      Follows one item of a walk of the input through the
+ *       target's tracked registers, noting each reference 
+ *       made through a register whose value is known.
+ *
+ * RETURNS
+ *      nothing
+ *
+ ************************************************************/
+
+void track_scan( const record_t *rec )
+{
+    const insn_t *insn = rec->insn;
+    const track_t *t;
+    char shape[MAX_SHAPE];
+    ADDR value, target;
+    FLOW_TYPE flow;
+    int has_value;
+    unsigned int i, used = 0, done;
+    
+    if ( n_regs == 0 )
+        for ( t = dasm_track_table; t->reg; t++ )
+            find_reg( t->reg );
+            
+    if ( rec->kind != REC_CODE || !insn->opcode || cfg_is_join( insn->addr ) )
+        forget_all();
+        
+    if ( rec->kind != REC_CODE || !insn->opcode || n_regs == 0 )
+        return;
+        
+    has_value = jt_shape( insn, shape, sizeof( shape ), &value );
+    
+    /* References through the values before this instruction */
+    for ( t = dasm_track_table; t->reg; t++ )
+    {
+        reg_state_t *r = find_reg( t->reg );
+        unsigned int bit = 1u << ( r - regs );
+        
+        if ( t->op != TR_USE || ( used & bit ) || !jt_match( t->shape, shape ) )
+            continue;
+            
+        used |= bit;
+        if ( r->known && t->xtype != X_NONE )
+            add_ref( insn->addr, r, 
+                     (ADDR)( r->value + ( t->arg ? displacement( insn ) : 0 ) ),
+                     t->xtype );
+    }
+    
+    /* Then what it does to each of them */
+    done = 0;
+    for ( t = dasm_track_table; t->reg; t++ )
+    {
+        reg_state_t *r = find_reg( t->reg );
+        unsigned int bit = 1u << ( r - regs );
+        
+        if ( t->op == TR_USE || ( done & bit ) || !jt_match( t->shape, shape ) )
+            continue;
+            
+        if ( t->op == TR_KILL && t->arg && ( !has_value || value != (ADDR)t->arg ) )
+            continue;
+            
+        done |= bit;
+        if ( t->op == TR_LOAD && has_value )
+        {
+            r->known = 1;
+            r->value = value;
+        }
+        else if ( t->op == TR_STEP )
+            r->value += t->arg;
+        else
+            r->known = 0;
+    }
+    
+    /* Anything else naming a register changes it, as far as we know */
+    for ( i = 0; i < n_regs; i++ )
+        if ( !( ( done | used ) & ( 1u << i ) ) 
+             && names_reg( shape + strlen( insn->opcode ), regs[i].name ) )
+            regs[i].known = 0;
+            
+    flow = cfg_flow( insn, &target );
+    if ( flow != FLOW_NEXT && flow != FLOW_BRANCH && flow != FLOW_SKIP )
+        forget_all();
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      track_resolve
+ *
+ * DESCRIPTION
+ *      Adds a cross-reference for each reference found since
+ *       the last call and passes it to found.
+ *
+ * RETURNS
+ *      number of references
+ *
+ ************************************************************/
+
+unsigned int track_resolve( void (*found)( ADDR addr, const char *reg, 
+                                           ADDR value ) )
+{
+    unsigned int i, n = n_refs;
+    
+    for ( i = 0; i < n_refs; i++ )
+    {
+        xref_addxref( refs[i].xtype, refs[i].addr, refs[i].value );
+        found( refs[i].addr, refs[i].reg, refs[i].value );
+    }
+    
+    n_refs = 0;
+    return n;
+}
+
+/******************************************************************************/
+/******************************************************************************/
+/******************************************************************************/
@@ -60,6 +60,194 @@ struct xref {
 
 struct xref *xref = NULL;
 
+/*****************************************************************************
+ *        Private Data
+ *****************************************************************************/
+
+/* The list is kept in address order for the dump, and indexed by a hash
+   table (open addressing, at most half full) so that finding an address
+   does not walk the list. */
+static struct xref **xref_hash = NULL;
+static unsigned int  hash_size = 0;
+static unsigned int  hash_used = 0;
+
+/* Last entry inserted; labels and xrefs often arrive in address order */
+static struct xref  *last_insert = NULL;
+
+/* Labelled entries in address order, for finding the label nearest an
+   address; rebuilt when a label has been added since */
+static struct xref **label_index = NULL;
+static unsigned int  n_label_index = 0;
+static int           labels_changed = 1;
+
+#define HASH(r)     ( ( (r) * 2654435761u ) & ( hash_size - 1 ) )
+
+/* The target's register window (see DASM_REGS): each register's entry,
+   so that finding it is a single lookup, and its reads and writes */
+struct reg {
+    struct xref     *x;
+    unsigned int    reads;
+    unsigned int    writes;
+};
+static struct reg   *regs = NULL;
+
+#define IN_REGS(r)  ( (r) - dasm_regs_base < dasm_regs_size )
+
+/*****************************************************************************
+ *        Private Functions
+ *****************************************************************************/
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      hash_add
+ *
+ * DESCRIPTION
+ *      Adds an entry to the hash index, growing the index
+ *       when it becomes half full.
+ *
+ * RETURNS
+ *      void
+ *
+ ************************************************************/
+
+static void hash_add( struct xref *x )
+{
+    unsigned int h;
+    
+    if ( 2 * ( hash_used + 1 ) > hash_size )
+    {
+        struct xref *p;
+        
+        free( xref_hash );
+        hash_size = hash_size ? hash_size * 2 : 1024;
+        xref_hash = zalloc( hash_size * sizeof( *xref_hash ) );
+        hash_used = 0;
+        
+        /* x is already on the list */
+        for ( p = xref; p != NULL; p = p->n )
+        {
+            for ( h = HASH( p->ref ); xref_hash[h]; h = ( h + 1 ) & ( hash_size - 1 ) )
+                ;
+            xref_hash[h] = p;
+            hash_used++;
+        }
+        return;
+    }
+    
+    for ( h = HASH( x->ref ); xref_hash[h]; h = ( h + 1 ) & ( hash_size - 1 ) )
+        ;
+    xref_hash[h] = x;
+    hash_used++;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      reg_slot
+ *
+ * DESCRIPTION
+ *      Finds the slot of an address in the register window,
+ *       which must hold it, allocating the window first if
+ *       need be.
+ *
+ * RETURNS
+ *      slot
+ *
+ ************************************************************/
+
+static struct reg * reg_slot( ADDR ref )
+{
+    if ( !regs )
+        regs = zalloc( dasm_regs_size * sizeof( struct reg ) );
+        
+    return &regs[ref - dasm_regs_base];
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      find_xref
+ *
+ * DESCRIPTION
+ *      Finds the entry for an address.
+ *
+ * RETURNS
+ *      entry, or NULL if the address has none
+ *
+ ************************************************************/
+
+static struct xref * find_xref( ADDR ref )
+{
+    unsigned int h;
+    
+    if ( IN_REGS( ref ) )
+        return regs ? regs[ref - dasm_regs_base].x : NULL;
+        
+    if ( !hash_size )
+        return NULL;
+        
+    for ( h = HASH( ref ); xref_hash[h]; h = ( h + 1 ) & ( hash_size - 1 ) )
+        if ( xref_hash[h]->ref == ref )
+            return xref_hash[h];
+            
+    return NULL;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      insert_xref
+ *
+ * DESCRIPTION
+ *      Inserts a new, empty entry for an address in address
+ *       order.  The search starts from the last entry
+ *       inserted if that is before the new one.
+ *
+ * RETURNS
+ *      new entry
+ *
+ ************************************************************/
+
+static struct xref * insert_xref( ADDR ref )
+{
+    struct xref *p, *q, *new;
+    
+    if ( last_insert && last_insert->ref < ref )
+    {
+        q = last_insert;
+        p = q->n;
+    }
+    else
+    {
+        q = NULL;
+        p = xref;
+    }
+    
+    while ( p != NULL && ref > p->ref )
+    {
+        q = p;
+        p = p->n;
+    }
+    
+    new = zalloc( sizeof( struct xref ) );
+    new->n   = p;
+    new->ref = ref;
+    
+    if ( q == NULL )
+        xref = new;
+    else
+        q->n = new;
+        
+    hash_add( new );
+    last_insert = new;
+    
+    if ( IN_REGS( ref ) )
+        reg_slot( ref )->x = new;
+    
+    return new;
+}
+
 /*****************************************************************************
  *        Public Functions
  *****************************************************************************/
@@ -80,7 +268,6 @@ struct xref *xref = NULL;
  void xref_addxref( int type, ADDR addr, ADDR ref )
 {
     struct xref     *p;
-    struct xref     *q;
     struct addrlist *new;
     
     if ( type == X_NONE )
@@ -92,41 +279,11 @@ struct xref *xref = NULL;
     new->addr = addr;
     new->type = type;
 
-    p = xref;
-    q = NULL;
-    
-    /* Find entry in list for xref */
-    
-    while ( p != NULL && ref > p->ref )
-    {
-        q = p;
-        p = p->n;
-    }
-
-    if ( p != NULL && ref == p->ref)  /* new addr for ref */
-    {
-        new->n  = p->list;
-        p->list = new;
-    }
-    else /* insert */
-    {
-        new->n = NULL;
+    if ( ( p = find_xref( ref ) ) == NULL )
+        p = insert_xref( ref );
         
-        if ( q == NULL )
-        {
-            q = zalloc( sizeof( struct xref ) );
-            xref = q;
-        }
-        else
-        {
-            q->n = zalloc( sizeof( struct xref ) );
-            q = q->n;
-        }
-        q->n    = p;
-        q->list = new;
-        q->label= NULL;
-        q->ref  = ref;
-    }
+    new->n  = p->list;
+    p->list = new;
 }
 
 /***********************************************************
@@ -146,48 +303,21 @@ struct xref *xref = NULL;
 
 void xref_addxreflabel( ADDR ref, char *label )
 {
-    struct xref     *p;
-    struct xref     *q;
-    struct addrlist *new;
-    
-    p = xref;
-    q = NULL;
-    
-    /* Find entry in list for xref */
+    struct xref *p;
     
-    while ( p != NULL && ref > p->ref )
-    {
-        q = p;
-        p = p->n;
-    }
-
-    if ( p != NULL && ref == p->ref)  /* new label for ref */
-    {
-        if ( p->label )
-            if ( strncmp( p->label, GEN_LABEL_PREFIX, strlen( GEN_LABEL_PREFIX ) ) )
-                error( "multiple labels for same address (0x%X) (was: %s, new:%s)", ref, p->label, label );
-            else
-                free( p->label );
+    if ( ( p = find_xref( ref ) ) == NULL )
+        p = insert_xref( ref );
         
-        p->label = dupstr( label );
-    }
-    else /* insert */
+    if ( p->label )
     {
-        if ( q == NULL )
-        {
-            q = zalloc( sizeof( struct xref ) );
-            xref = q;
-        }
+        if ( strncmp( p->label, GEN_LABEL_PREFIX, strlen( GEN_LABEL_PREFIX ) ) )
+            error( "multiple labels for same address (0x%X) (was: %s, new:%s)", ref, p->label, label );
         else
-        {
-            q->n = zalloc( sizeof( struct xref ) );
-            q = q->n;
-        }
-        q->n     = p;
-        q->ref   = ref;
-        q->list  = NULL;
-        q->label = dupstr( label );
+            free( p->label );
     }
+    
+    p->label = dupstr( label );
+    labels_changed = 1;
 }
 
 /***********************************************************
@@ -206,13 +336,87 @@ void xref_addxreflabel( ADDR ref, char *label )
 
 char * xref_findaddrlabel( ADDR addr )
 {
+    struct xref *p = find_xref( addr );
+    
+    return p ? p->label : NULL;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      xref_nearestlabel
+ *
+ * DESCRIPTION
+ *      Finds the nearest label at or below an address, such
+ *       as the routine a match or a data item lies in.
+ *      *base is set to the address of the label.
+ *
+ * RETURNS
+ *      Pointer to label if found, else NULL.
+ *
+ ************************************************************/
+
+const char * xref_nearestlabel( ADDR addr, ADDR *base )
+{
+    unsigned int lo = 0, hi;
     struct xref *p;
     
-    for ( p = xref; p != NULL; p = p->n )
-        if ( p->ref == addr && p->label != NULL )
-            return p->label;
+    if ( labels_changed )
+    {
+        free( label_index );
+        for ( n_label_index = 0, p = xref; p != NULL; p = p->n )
+            n_label_index += ( p->label != NULL );
+        label_index = zalloc( ( n_label_index + 1 ) * sizeof( *label_index ) );
+        for ( n_label_index = 0, p = xref; p != NULL; p = p->n )
+            if ( p->label )
+                label_index[n_label_index++] = p;
+        labels_changed = 0;
+    }
+    
+    for ( hi = n_label_index; lo < hi; )
+    {
+        unsigned int mid = lo + ( hi - lo ) / 2;
+        
+        if ( label_index[mid]->ref <= addr )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    
+    if ( lo == 0 )
+        return NULL;
+        
+    *base = label_index[lo - 1]->ref;
+    return label_index[lo - 1]->label;
+}
 
-    return NULL;
+/***********************************************************
+ *
+ * FUNCTION
+ *      xref_findlabeladdr
+ *
+ * DESCRIPTION
+ *      Searches the xref table for the given label.
+ *
+ * RETURNS
+ *      1 and the address in *addr if found, else 0.
+ *
+ ************************************************************/
+
+int xref_findlabeladdr( const char *label, ADDR *addr )
+{
+    struct xref *p;
+    
+    for ( p = xref; p != NULL; p = p->n )
+    {
+        if ( p->label && !strcmp( p->label, label ) )
+        {
+            *addr = p->ref;
+            return 1;
+        }
+    }
+    
+    return 0;
 }
 
 /***********************************************************
@@ -250,6 +454,37 @@ char * xref_genwordaddr( char * buf, const char * format, ADDR addr )
     return buf;
 }
 
+/***********************************************************
+ *
+ * FUNCTION
+ *      xref_foreach
+ *
+ * DESCRIPTION
+ *      Calls fn for each referenced or labelled address in
+ *       ascending order, with the label (if any) and a mask
+ *       of ( 1 << type ) for each type of reference made.
+ *      fn may change the label of the address it is given.
+ *
+ * RETURNS
+ *      void
+ *
+ ************************************************************/
+
+void xref_foreach( void (*fn)( ADDR ref, const char *label, unsigned int types ) )
+{
+    struct xref     *p;
+    struct addrlist *q;
+    unsigned int     types;
+    
+    for ( p = xref; p != NULL; p = p->n )
+    {
+        for ( types = 0, q = p->list; q != NULL; q = q->n )
+            types |= 1 << q->type;
+            
+        fn( p->ref, p->label, types );
+    }
+}
+
 /***********************************************************
  *
  * FUNCTION
@@ -308,6 +543,67 @@ void xref_dump( void )
     }
     puts( "---------------------------\n" );
 }
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      xref_addaccess
+ *
+ * DESCRIPTION
+ *      Counts reads and writes of an address, if it lies in
+ *       the target's register window.
+ *
+ * RETURNS
+ *      void
+ *
+ ************************************************************/
+
+void xref_addaccess( ADDR ref, unsigned int reads, unsigned int writes )
+{
+    struct reg *r;
+    
+    if ( !IN_REGS( ref ) )
+        return;
+        
+    r = reg_slot( ref );
+    r->reads  += reads;
+    r->writes += writes;
+}
+
+/***********************************************************
+ *
+ * FUNCTION
+ *      xref_dumpregs
+ *
+ * DESCRIPTION
+ *      Prints the reads and writes of each register in the
+ *       target's register window which has any.
+ *
+ * RETURNS
+ *      void
+ *
+ ************************************************************/
+
+void xref_dumpregs( void )
+{
+    unsigned int i;
+    
+    printf( "\n\nREGISTERS :\n\n---------------------------\n" );
+    for ( i = 0; regs && i < dasm_regs_size; i++ )
+    {
+        const struct reg *r = &regs[i];
+        
+        if ( !r->reads && !r->writes )
+            continue;
+            
+        printf( FORMAT_ADDR ": Read %5u  Write %5u", dasm_regs_base + i,
+                r->reads, r->writes );
+        if ( r->x && r->x->label )
+            printf( "   (%s)", r->x->label );
+        putchar( '\n' );
+    }
+    puts( "---------------------------\n" );
+}
  
 /******************************************************************************/
 /******************************************************************************/